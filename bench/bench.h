@@ -0,0 +1,51 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/*
+ * BENCH - Tiện ích đo thời gian cho benchmark native
+ * Thời gian thật lấy từ std::chrono (millis() của host shim là đồng hồ ảo)
+ */
+
+inline uint64_t benchNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Chặn compiler bỏ đi phép tính có kết quả không dùng
+template <typename T>
+inline void benchKeep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Lấy median của các lần chạy (ổn định hơn trung bình khi bị nhiễu)
+inline double benchMedian(std::vector<double> values) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// Số lần cấp phát heap (operator new thay thế trong bench_main.cpp)
+inline uint64_t benchAllocCount = 0;
+
+// Ghim tiến trình vào 1 core để kết quả ít nhiễu hơn (chỉ Linux)
+inline void benchPinCpu(int cpu = 0) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+#endif
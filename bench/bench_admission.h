@@ -0,0 +1,148 @@
+#ifndef BENCH_ADMISSION_H
+#define BENCH_ADMISSION_H
+
+#include "bench.h"
+#include "bms_admission.h"
+#include <deque>
+
+/*
+ * Admission control: chi phí 1 quyết định admit() + finish() và mô hình loop()
+ * theo thời gian ảo (chu kỳ 100ms, 60s) khi bị flood
+ * - Kẻ flood (1 IP) luôn lấp đầy backlog 4 kết nối: / (60ms ±25%) và /bms (9ms)
+ *   xen kẽ; dashboard (IP khác) hỏi /bms mỗi giây
+ * - Từ chối 1 request tốn 1ms (đọc header + gửi 429/503)
+ * - Có admission: mẫu trễ tối đa < 20ms, dashboard được phục vụ hết
+ */
+
+#define ADMISSION_BENCH_PERIOD_US 100000UL
+#define ADMISSION_BENCH_BACKLOG   4
+#define ADMISSION_BENCH_REJECT_US 1000UL
+#define ADMISSION_BENCH_TOLERANCE 20000UL
+
+struct AdmissionFloodResult {
+    uint32_t samples;
+    uint32_t lateMaxUs;
+    uint32_t lateP99Us;
+    uint32_t served;
+    uint32_t rejected429;
+    uint32_t rejected503;
+    uint32_t dashboardServed;
+    uint32_t dashboardRejected;
+    float httpPercent;
+};
+
+inline AdmissionFloodResult admissionFloodRun(bool useAdmission) {
+    const uint32_t attacker = 0x0A000042;
+    const uint32_t dashboard = 0x0A000007;
+    const unsigned long durationUs = 60000000UL;
+    BMSAdmission control;
+    uint8_t page = control.addRoute("/", 4, 60000);
+    uint8_t bms = control.addRoute("/bms", 1, 3000);
+
+    struct Pending { uint8_t route; uint32_t ip; };
+    std::deque<Pending> backlog;
+    std::vector<uint32_t> late;
+    AdmissionFloodResult result = {};
+    uint32_t noise = 1;
+    bool nextPage = true;
+    unsigned long now = 0, lastSample = 0, nextPoll = 0, httpUs = 0;
+    control.onTick(now, ADMISSION_BENCH_PERIOD_US);
+
+    while (now < durationUs) {
+        // Kết nối mới vào backlog: dashboard chiếm chỗ trống trước, flood lấp phần còn lại
+        if (now >= nextPoll && backlog.size() < ADMISSION_BENCH_BACKLOG) {
+            backlog.push_back({ bms, dashboard });
+            nextPoll += 1000000UL;
+        }
+        while (backlog.size() < ADMISSION_BENCH_BACKLOG) {
+            backlog.push_back({ nextPage ? page : bms, attacker });
+            nextPage = !nextPage;
+        }
+
+        if (!useAdmission || control.accepting(now)) {
+            Pending p = backlog.front();
+            backlog.pop_front();
+            noise = noise * 1664525u + 1013904223u;
+            uint32_t serviceUs = p.route == page ? 45000 + (noise >> 8) % 30000 : 9000;
+            uint8_t verdict = useAdmission ? control.admit(p.route, p.ip, now) : ADMIT_OK;
+            uint32_t elapsed = verdict == ADMIT_OK ? serviceUs : ADMISSION_BENCH_REJECT_US;
+            now += elapsed;
+            httpUs += elapsed;
+            if (useAdmission) control.finish(p.route, verdict, elapsed);
+            if (verdict == ADMIT_OK) result.served++;
+            else if (BMSAdmission::statusCode(verdict) == 429) result.rejected429++;
+            else result.rejected503++;
+            if (p.ip == dashboard) {
+                if (verdict == ADMIT_OK) result.dashboardServed++;
+                else result.dashboardRejected++;
+            }
+        } else {
+            now = lastSample + ADMISSION_BENCH_PERIOD_US;   // loop() chỉ lấy mẫu tới tick sau
+        }
+
+        if (now - lastSample >= ADMISSION_BENCH_PERIOD_US) {
+            late.push_back(now - lastSample - ADMISSION_BENCH_PERIOD_US);
+            lastSample = now;
+            control.onTick(now, ADMISSION_BENCH_PERIOD_US);
+        }
+    }
+
+    std::sort(late.begin(), late.end());
+    result.samples = late.size();
+    result.lateMaxUs = late.back();
+    result.lateP99Us = late[late.size() * 99 / 100];
+    result.httpPercent = 100.0f * httpUs / now;
+    return result;
+}
+
+inline int benchAdmission(int, char**) {
+    int errors = 0;
+    printf("\n=== Admission (CPU %d%%, %d conn/tick, client %d/s burst %d, global %d/s burst %d, %d B) ===\n",
+           ADMISSION_CPU_PERCENT, ADMISSION_MAX_PER_TICK, ADMISSION_CLIENT_RATE, ADMISSION_CLIENT_BURST,
+           ADMISSION_GLOBAL_RATE, ADMISSION_GLOBAL_BURST, (int)sizeof(BMSAdmission));
+
+    // Chi phí: 32 IP xoay vòng (LRU 8 ô luôn phải thay), tick 100ms, 1 request / 200µs
+    BMSAdmission control;
+    uint8_t routes[3] = { control.addRoute("/", 4, 60000), control.addRoute("/bms", 1, 3000),
+                          control.addRoute("/info", 1, 5000) };
+    const int decisions = 1 << 20;
+    std::vector<double> runs;
+    uint32_t okCount = 0;
+    for (int r = 0; r < 7; r++) {
+        control.reset(0);
+        unsigned long now = 0;
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < decisions; i++) {
+            now += 200;
+            if (i % 500 == 0) control.onTick(now, ADMISSION_BENCH_PERIOD_US);
+            uint8_t route = routes[i % 3];
+            uint8_t verdict = control.admit(route, 0x0A000000 + (i * 7) % 32, now);
+            control.finish(route, verdict, 150);
+            okCount += verdict == ADMIT_OK;
+        }
+        runs.push_back((double)(benchNowNs() - start) / decisions);
+    }
+    benchKeep(okCount);
+    printf("admit + finish: %.1f ns/request\n", benchMedian(runs));
+
+    // Flood 60s thời gian ảo
+    printf("flood 60s, period %lu ms:   samples  late p99   late max  served    429    503  dashboard ok/rej  HTTP CPU\n",
+           ADMISSION_BENCH_PERIOD_US / 1000);
+    for (int mode = 0; mode < 2; mode++) {
+        AdmissionFloodResult f = admissionFloodRun(mode == 1);
+        printf("  %-24s %7lu %7.1f ms %7.1f ms %7lu %6lu %6lu  %8lu / %-6lu %6.1f%%\n",
+               mode ? "admission" : "no admission", (unsigned long)f.samples, f.lateP99Us / 1000.0f,
+               f.lateMaxUs / 1000.0f, (unsigned long)f.served, (unsigned long)f.rejected429,
+               (unsigned long)f.rejected503, (unsigned long)f.dashboardServed,
+               (unsigned long)f.dashboardRejected, f.httpPercent);
+        if (mode == 1 && (f.lateMaxUs >= ADMISSION_BENCH_TOLERANCE || f.dashboardRejected ||
+                          f.samples < 590)) {
+            errors++;
+        }
+    }
+
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
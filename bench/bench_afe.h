@@ -0,0 +1,157 @@
+#ifndef BENCH_AFE_H
+#define BENCH_AFE_H
+
+#include "bench.h"
+#include "bms_afe.h"
+
+/*
+ * AFE BQ76952: thời gian 1 lần đọc đầy đủ (cell + dòng + 3 thermistor) ở 4S và 16S,
+ * gom block (mặc định) so với đọc từng thanh ghi
+ * - MockAfeBus giữ ảnh thanh ghi, trả dữ liệu kèm CRC như chip thật và tăng
+ *   đồng hồ ảo theo số bit trên dây ở AFE_I2C_HZ + overhead mỗi transaction
+ * - CPU ns đo trên PC (driver CRC + giải mã, kèm bus giả lập), bus us là mô hình
+ * - Kiểm tra giá trị đọc lại, lỗi CRC / NACK phải bị phát hiện và giữ giá trị cũ
+ *   program afe [--txn-us 50]
+ */
+
+#define AFE_BENCH_TXN_US 50   // Overhead driver I2C ESP32 mỗi transaction (ước lượng)
+
+class MockAfeBus : public AfeBus {
+private:
+    uint8_t regs[0x80];
+    uint8_t crcs[0x80];   // CRC của từng byte (byte thứ 2 trở đi của block)
+
+public:
+    uint32_t hz;
+    uint32_t txnOverheadUs;
+    uint32_t transactions;
+    uint32_t wireBytes;
+    bool corruptNext;
+    bool nackNext;
+
+    MockAfeBus() {
+        memset(regs, 0, sizeof(regs));
+        for (int i = 0; i < 0x80; i++) crcs[i] = afeCrc8(&regs[i], 1);
+        hz = AFE_I2C_HZ;
+        txnOverheadUs = AFE_BENCH_TXN_US;
+        transactions = 0;
+        wireBytes = 0;
+        corruptNext = false;
+        nackNext = false;
+    }
+
+    void set16(uint8_t reg, int16_t value) {
+        regs[reg] = value & 0xFF;
+        regs[reg + 1] = (uint16_t)value >> 8;
+        crcs[reg] = afeCrc8(&regs[reg], 1);
+        crcs[reg + 1] = afeCrc8(&regs[reg + 1], 1);
+    }
+
+    bool begin() override { return true; }
+
+    bool read(uint8_t address, uint8_t reg, uint8_t* raw, size_t rawLength) override {
+        // START + addr W + reg + Sr + addr R + dữ liệu + STOP, 9 bit mỗi byte
+        transactions++;
+        wireBytes += 3 + rawLength;
+        hostAdvanceMicros(txnOverheadUs + ((3 + rawLength) * 9 + 3) * 1000000ULL / hz);
+        if (address != BQ76952_ADDRESS || nackNext) {
+            nackNext = false;
+            return false;
+        }
+
+        uint8_t header[3] = { (uint8_t)(address << 1), reg, (uint8_t)((address << 1) | 1) };
+        raw[0] = regs[reg];
+        raw[1] = afeCrc8(&regs[reg], 1, afeCrc8(header, 3));
+        for (size_t i = 1; i < rawLength / 2; i++) {
+            raw[2 * i] = regs[reg + i];
+            raw[2 * i + 1] = crcs[reg + i];
+        }
+        if (corruptNext) {
+            raw[rawLength - 1] ^= 0x01;
+            corruptNext = false;
+        }
+        return true;
+    }
+};
+
+// Nạp giá trị vào chip giả lập (thay đổi theo step)
+inline void afeBenchLoad(MockAfeBus& bus, uint16_t mask, uint32_t step) {
+    for (int vc = 0; vc < AFE_MAX_CELLS; vc++) {
+        if (mask & (1u << vc)) bus.set16(BQ76952_CELL1 + 2 * vc, 3200 + vc * 7 + step % 50);
+    }
+    bus.set16(BQ76952_CC2_CURRENT, (step & 1) ? -1750 : 2500);
+    for (int t = 0; t < AFE_TEMP_SENSORS; t++) {
+        bus.set16(BQ76952_TS1 + 2 * t, 2981 + t * 10 + step % 5);   // ~25°C
+    }
+}
+
+inline bool afeBenchVerify(BQ76952Afe& afe, uint16_t mask, uint32_t step) {
+    int n = 1;
+    for (int vc = 0; vc < AFE_MAX_CELLS; vc++) {
+        if (!(mask & (1u << vc))) continue;
+        if (fabs(afe.getCellVoltage(n++) - (3200 + vc * 7 + step % 50) / 1000.0) > 1e-4) return false;
+    }
+    if (fabs(afe.getCurrent() - ((step & 1) ? -1.75 : 2.5)) > 1e-4) return false;
+    return fabs(afe.getThermistor(2) - ((2981 + 20 + step % 5) / 10.0 - 273.15)) < 1e-3;
+}
+
+inline int benchAfe(int argc, char** argv) {
+    uint32_t txnUs = AFE_BENCH_TXN_US;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--txn-us") && i + 1 < argc) txnUs = atoi(argv[++i]);
+    }
+
+    printf("\n=== BQ76952 AFE acquisition (I2C %lu kHz, %lu us/transaction overhead) ===\n",
+           (unsigned long)(AFE_I2C_HZ / 1000), (unsigned long)txnUs);
+    printf("%5s %13s %6s %11s %12s %12s\n", "cells", "mode", "txns", "wire bytes", "bus us", "CPU ns");
+
+    int errors = 0;
+    const int cellCounts[] = { 4, 16 };
+    for (int cells : cellCounts) {
+        uint16_t mask = (uint16_t)((1u << cells) - 1);
+        for (int burst = 1; burst >= 0; burst--) {
+            MockAfeBus bus;
+            bus.txnOverheadUs = txnUs;
+            BQ76952Afe afe(&bus, mask, burst);
+
+            // Đúng giá trị
+            for (uint32_t step = 0; step < 100; step++) {
+                afeBenchLoad(bus, mask, step);
+                if (!afe.readAllSensors() || !afeBenchVerify(afe, mask, step)) errors++;
+            }
+
+            // Lỗi CRC và NACK: đọc thất bại, giá trị cũ giữ nguyên
+            afeBenchLoad(bus, mask, 7);
+            afe.readAllSensors();
+            afeBenchLoad(bus, mask, 8);
+            bus.corruptNext = true;
+            if (afe.readAllSensors() || !afeBenchVerify(afe, mask, 7)) errors++;
+            bus.nackNext = true;
+            if (afe.readAllSensors() || !afeBenchVerify(afe, mask, 7)) errors++;
+            if (afe.getCrcErrorCount() != 1 || afe.getBusErrorCount() != 1) errors++;
+
+            // Thời gian bus (đồng hồ ảo) của 1 lần đọc
+            uint32_t txnBefore = bus.transactions, bytesBefore = bus.wireBytes;
+            afe.readAllSensors();
+            uint32_t busUs = afe.getLastReadUs();
+            uint32_t txns = bus.transactions - txnBefore, bytes = bus.wireBytes - bytesBefore;
+
+            // CPU trên PC
+            std::vector<double> runs;
+            const int count = 200000;
+            for (int r = 0; r < 7; r++) {
+                uint64_t start = benchNowNs();
+                for (int i = 0; i < count; i++) {
+                    benchKeep(afe.readAllSensors());
+                }
+                runs.push_back((double)(benchNowNs() - start) / count);
+            }
+            printf("%5d %13s %6lu %11lu %12lu %12.1f\n", cells, burst ? "burst" : "per-register",
+                   (unsigned long)txns, (unsigned long)bytes, (unsigned long)busUs, benchMedian(runs));
+        }
+    }
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
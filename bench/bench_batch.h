@@ -0,0 +1,61 @@
+#ifndef BENCH_BATCH_H
+#define BENCH_BATCH_H
+
+#include "bench.h"
+#include "bms_data.h"
+
+/*
+ * BENCH BATCH - Thông lượng updateBMSBatch() theo kích thước batch
+ * Trace: 65536 mẫu cách nhau 10ms, dòng hình sin ±3A chu kỳ 10 phút
+ * Cùng trace nên SOC cuối phải giống nhau với mọi kích thước batch
+ */
+
+#define BENCH_BATCH_SAMPLES 65536
+#define BENCH_BATCH_RUNS    7
+
+inline void buildBatchTrace(std::vector<BMSSample>& trace) {
+    trace.resize(BENCH_BATCH_SAMPLES);
+    for (size_t n = 0; n < trace.size(); n++) {
+        BMSSample& s = trace[n];
+        s.timestamp = 1000 + n * 10;
+        float phase = (s.timestamp / 600000.0f) * 2 * M_PI;
+        s.current = 3.0f * sinf(phase);
+        s.temperature = 25.0f + 5.0f * sinf(phase * 0.5f);
+        s.minTemperature = s.temperature - 3.0f;
+        for (int i = 0; i < NUM_CELLS; i++) {
+            s.cellVoltages[i] = 3.2f + 0.1f * sinf(phase) + 0.005f * i;
+        }
+    }
+}
+
+inline int benchBatch(int, char**) {
+    std::vector<BMSSample> trace;
+    buildBatchTrace(trace);
+
+    printf("\n=== updateBMSBatch: samples/s vs batch size (%d samples) ===\n", BENCH_BATCH_SAMPLES);
+    printf("%8s %14s %12s %12s\n", "batch", "samples/s", "ns/sample", "final SOC");
+
+    for (size_t batch = 1; batch <= 1024; batch *= 2) {
+        std::vector<double> runs;
+        float finalSoc = 0;
+        for (int r = 0; r < BENCH_BATCH_RUNS; r++) {
+            hostSetMillis(1000);
+            initBMSData();
+            resetSOC(50.0);
+
+            uint64_t start = benchNowNs();
+            for (size_t offset = 0; offset < trace.size(); offset += batch) {
+                size_t count = std::min(batch, trace.size() - offset);
+                updateBMSBatch(&trace[offset], count);
+            }
+            uint64_t elapsed = benchNowNs() - start;
+            runs.push_back((double)elapsed / trace.size());
+            finalSoc = bmsData.soc;
+        }
+        double nsPerSample = benchMedian(runs);
+        printf("%8zu %14.0f %12.1f %12.4f\n", batch, 1e9 / nsPerSample, nsPerSample, finalSoc);
+    }
+    return 0;
+}
+
+#endif
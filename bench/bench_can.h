@@ -0,0 +1,201 @@
+#ifndef BENCH_CAN_H
+#define BENCH_CAN_H
+
+#include "bench.h"
+#include "bms_can.h"
+
+/*
+ * CAN Pylontech: chi phí encode mỗi chu kỳ (6 frame) và độ trễ của scheduler
+ * - Mô phỏng loop() 1 giờ trên đồng hồ ảo: lấy mẫu 500ms, trung bình mỗi
+ *   CAN_BENCH_HTTP_MS có 1 request HTTP chiếm 5-30ms, ngủ theo msUntilNext()
+ * - Bộ giải mã riêng đọc lại dòng frame, so với bmsData tại thời điểm gửi
+ */
+
+#define CAN_BENCH_SECONDS   3600
+#define CAN_BENCH_SAMPLE_MS 500
+#define CAN_BENCH_HTTP_MS   2000    // Khoảng cách trung bình giữa 2 request HTTP
+
+struct CANDecoded {
+    float chargeVoltage, chargeCurrent, dischargeCurrent, dischargeVoltage;
+    int soc, soh;
+    float packVoltage, current, temperature;
+    uint8_t protection[2], warning[2];
+    uint8_t request;
+    char manufacturer[9];
+};
+
+inline int16_t canBenchI16(const uint8_t* p) {
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint16_t canBenchU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Giải mã độc lập với encoder; false nếu ID/độ dài không đúng
+inline bool canBenchDecode(const CANFrame& frame, CANDecoded& out) {
+    const uint8_t* d = frame.data;
+    switch (frame.id) {
+        case 0x351:
+            if (frame.length != 8) return false;
+            out.chargeVoltage = canBenchU16(d) / 10.0f;
+            out.chargeCurrent = canBenchI16(d + 2) / 10.0f;
+            out.dischargeCurrent = canBenchI16(d + 4) / 10.0f;
+            out.dischargeVoltage = canBenchU16(d + 6) / 10.0f;
+            return true;
+        case 0x355:
+            if (frame.length != 4) return false;
+            out.soc = canBenchU16(d);
+            out.soh = canBenchU16(d + 2);
+            return true;
+        case 0x356:
+            if (frame.length != 6) return false;
+            out.packVoltage = canBenchI16(d) / 100.0f;
+            out.current = canBenchI16(d + 2) / 10.0f;
+            out.temperature = canBenchI16(d + 4) / 10.0f;
+            return true;
+        case 0x359:
+            if (frame.length != 7 || d[5] != 'P' || d[6] != 'N') return false;
+            memcpy(out.protection, d, 2);
+            memcpy(out.warning, d + 2, 2);
+            return true;
+        case 0x35C:
+            if (frame.length != 2) return false;
+            out.request = d[0];
+            return true;
+        case 0x35E:
+            if (frame.length != 8) return false;
+            memcpy(out.manufacturer, d, 8);
+            out.manufacturer[8] = '\0';
+            return true;
+    }
+    return false;
+}
+
+// Kiểm tra giá trị giải mã với bmsData lúc gửi
+inline bool canBenchVerify(const CANFrame& frame, const CANDecoded& f, const BMSData& data) {
+    switch (frame.id) {
+        case 0x351:
+            return fabs(f.chargeVoltage - CAN_CHARGE_VOLTAGE) < 0.051 &&
+                   fabs(f.dischargeVoltage - CAN_DISCHARGE_VOLTAGE) < 0.051 &&
+                   f.chargeCurrent >= 0 && f.chargeCurrent <= CAN_MAX_CHARGE_CURRENT + 0.05 &&
+                   (data.overVoltageAlarm ? f.chargeCurrent == 0 : f.chargeCurrent > 0);
+        case 0x355:
+            return abs(f.soc - data.soc) <= 0.5 && abs(f.soh - data.soh) <= 0.5;
+        case 0x356:
+            return fabs(f.packVoltage - data.packVoltage) < 0.0051 &&
+                   fabs(f.current - data.current) < 0.051 &&
+                   fabs(f.temperature - data.packTemp) < 0.051;
+        case 0x359:
+            return ((f.protection[0] >> 1) & 1) == data.overVoltageAlarm &&
+                   ((f.protection[0] >> 2) & 1) == data.underVoltageAlarm &&
+                   ((f.protection[0] >> 3) & 1) == data.overTempAlarm;
+        case 0x35C: {
+            bool discharge = !data.underVoltageAlarm && !data.overTempAlarm &&
+                             !data.shortCircuitAlarm && !(data.overCurrentAlarm && data.current < 0);
+            return ((f.request >> 6) & 1) == discharge;
+        }
+        case 0x35E:
+            return strcmp(f.manufacturer, CAN_MANUFACTURER) == 0;
+    }
+    return false;
+}
+
+inline int benchCan(int, char**) {
+    hostSetMillis(1000);
+    initBMSData();
+    resetSOC(60.0);
+    updateBMSData(3.312f, 3.254f, 3.298f, 3.301f, -1.75f, 31.4f);
+
+    printf("\n=== CAN Pylontech encoder / scheduler ===\n");
+
+    // Chi phí encode 1 chu kỳ (cả 6 frame)
+    CANScheduler::Encoder encoders[] = {
+        PylonCANEncoder::encodeLimits, PylonCANEncoder::encodeSOC,
+        PylonCANEncoder::encodeMeasurements, PylonCANEncoder::encodeAlarms,
+        PylonCANEncoder::encodeRequest, PylonCANEncoder::encodeManufacturer,
+    };
+    std::vector<double> runs;
+    const int cycles = 1000000;
+    for (int r = 0; r < 7; r++) {
+        uint64_t start = benchNowNs();
+        for (int c = 0; c < cycles; c++) {
+            bmsData.current = (c & 1) ? -1.75f : 2.5f;
+            for (CANScheduler::Encoder encode : encoders) {
+                CANFrame frame;
+                encode(bmsData, frame);
+                benchKeep(frame);
+            }
+        }
+        runs.push_back((double)(benchNowNs() - start) / cycles);
+    }
+    printf("encode: %.1f ns per cycle (%d frames)\n", benchMedian(runs), CAN_FRAME_COUNT);
+
+    // Mô phỏng loop() trên đồng hồ ảo
+    CANScheduler scheduler;
+    scheduler.begin(micros());
+    uint32_t rng = 777;
+    unsigned long lastSample = millis();
+    unsigned long nextHttp = millis();
+    unsigned long endMs = millis() + CAN_BENCH_SECONDS * 1000UL;
+    uint64_t frames = 0;
+    int errors = 0;
+    unsigned long lastSeenUs[0x360] = {0};
+    unsigned long maxIntervalUs[0x360] = {0};
+    CANDecoded decoded;
+    memset(&decoded, 0, sizeof(decoded));
+
+    while (millis() < endMs) {
+        rng = rng * 1664525u + 1013904223u;
+
+        if (millis() - lastSample >= CAN_BENCH_SAMPLE_MS) {
+            lastSample = millis();
+            float t = lastSample / 1000.0f;
+            float current = 3.0f * sinf(t / 600.0f);
+            float cell = 3.25f + 0.05f * sinf(t / 900.0f);
+            updateBMSData(cell + 0.004f, cell, cell - 0.006f, cell + 0.002f, current, 30.0f);
+            hostAdvanceMicros(300);   // Đọc sensor + cập nhật
+        }
+
+        // Request HTTP đến ngẫu nhiên theo thời gian, chặn loop() 5-30ms
+        if ((long)(millis() - nextHttp) >= 0) {
+            hostAdvanceMicros(5000 + (rng & 0x7FFF) % 25000);
+            nextHttp = millis() + (rng >> 16) % (2 * CAN_BENCH_HTTP_MS);
+        }
+
+        scheduler.poll(bmsData, micros(), [&](const CANFrame& frame) {
+            frames++;
+            if (!canBenchDecode(frame, decoded) || !canBenchVerify(frame, decoded, bmsData)) {
+                errors++;
+            }
+            unsigned long now = micros();
+            if (lastSeenUs[frame.id] != 0) {
+                maxIntervalUs[frame.id] = max(maxIntervalUs[frame.id], now - lastSeenUs[frame.id]);
+            }
+            lastSeenUs[frame.id] = now;
+            return true;
+        });
+
+        // Ngủ như loop(): tới mẫu kế tiếp / frame kế tiếp, tối đa 10ms mỗi lần
+        unsigned long sinceSample = millis() - lastSample;
+        unsigned long remaining = sinceSample < CAN_BENCH_SAMPLE_MS ? CAN_BENCH_SAMPLE_MS - sinceSample : 0;
+        remaining = min(remaining, scheduler.msUntilNext(micros()));
+        remaining = min(remaining, 10UL);
+        hostAdvanceMicros(remaining ? remaining * 1000 : 50);
+    }
+
+    printf("simulated %ds: %llu frames, %d decode/verify errors\n", CAN_BENCH_SECONDS,
+           (unsigned long long)frames, errors);
+    printf("%6s %8s %14s %14s %16s\n", "id", "sent", "late avg (us)", "late max (us)", "max gap (ms)");
+    for (int i = 0; i < scheduler.getCount(); i++) {
+        const CANScheduler::Entry& e = scheduler.getEntry(i);
+        printf(" 0x%03X %8lu %14.0f %14lu %16.1f\n", (unsigned)e.id, (unsigned long)e.sent,
+               e.sent ? (double)e.totalLateUs / e.sent : 0.0, (unsigned long)e.maxLateUs,
+               maxIntervalUs[e.id] / 1000.0);
+        unsigned long expected = CAN_BENCH_SECONDS * 1000000UL / e.periodUs;
+        if (e.sent + 1 < expected) errors++;
+    }
+    return errors ? 1 : 0;
+}
+
+#endif
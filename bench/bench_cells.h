@@ -0,0 +1,167 @@
+#ifndef BENCH_CELLS_H
+#define BENCH_CELLS_H
+
+#include "bench.h"
+#include "bms_data.h"
+
+/*
+ * Ước lượng từng cell: chi phí 1 lần cập nhật và bộ nhớ mỗi cell ở 4S/16S/24S
+ * - SoA: CellEstimatorBank<N> (1 dq cho cả pack, vòng int32 không rẽ nhánh)
+ * - AoS: cùng phép tính, mỗi cell 1 struct (tham chiếu bố cục)
+ * - N x SOCEstimator: mỗi cell tự tích phân dòng (cách làm hiển nhiên)
+ * Kiểm tra: cell yếu (80% dung lượng) được nhận ra, dung lượng ước lượng hội tụ
+ * sau vài chu kỳ nghỉ - xả - nghỉ, SOC pack = 0% khi cell yếu cạn
+ */
+
+struct CellAoS {
+    int32_t chargeUah;
+    int32_t capacityUah;
+    float socScale;
+    float soc;
+    float socAtCalibration;
+};
+
+template <int N>
+inline void cellsBenchRow(int& errors) {
+    const int updates = 200000;
+    // Dòng xả ~1.2A mỗi 100ms, đổi ra đơn vị bộ đếm
+    const int64_t stepUnits = -(int64_t)(1.2 * 100 * 2e6);
+
+    // SoA
+    CellEstimatorBank<N> bank(BATTERY_CAPACITY);
+    std::vector<double> soaRuns;
+    for (int r = 0; r < 7; r++) {
+        bank.reset(100.0);
+        int64_t net = 0;
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < updates; i++) {
+            net += (i & 1023) < 512 ? stepUnits : -stepUnits;
+            bank.update(net);
+            benchKeep(bank.getMinSOC());
+        }
+        soaRuns.push_back((double)(benchNowNs() - start) / updates);
+    }
+    if (bank.getMinSOC() != bank.getMaxSOC()) errors++;
+
+    // AoS
+    CellAoS cells[N];
+    std::vector<double> aosRuns;
+    for (int r = 0; r < 7; r++) {
+        for (int c = 0; c < N; c++) {
+            cells[c].capacityUah = 6000000;
+            cells[c].chargeUah = 6000000;
+            cells[c].socScale = 100.0f / 6000000;
+            cells[c].socAtCalibration = 100;
+        }
+        int32_t dqStep = (int32_t)(stepUnits / CELL_UNITS_PER_UAH);
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < updates; i++) {
+            int32_t dq = (i & 1023) < 512 ? dqStep : -dqStep;
+            for (int c = 0; c < N; c++) {
+                int32_t q = cells[c].chargeUah + dq;
+                q = q < 0 ? 0 : q;
+                q = q > cells[c].capacityUah ? cells[c].capacityUah : q;
+                cells[c].chargeUah = q;
+                cells[c].soc = q * cells[c].socScale;
+            }
+            float lo = cells[0].soc;
+            for (int c = 1; c < N; c++) lo = cells[c].soc < lo ? cells[c].soc : lo;
+            benchKeep(lo);
+        }
+        aosRuns.push_back((double)(benchNowNs() - start) / updates);
+    }
+
+    // N x SOCEstimator
+    std::vector<SOCEstimator> estimators(N, SOCEstimator(BATTERY_CAPACITY, 100.0));
+    std::vector<double> naiveRuns;
+    for (int r = 0; r < 7; r++) {
+        unsigned long t = 1000;
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < updates; i++) {
+            t += 100;
+            float current = (i & 1023) < 512 ? -1.2f : 1.2f;
+            float lo = 100;
+            for (int c = 0; c < N; c++) {
+                estimators[c].updateAt(current, 25.0f, t);
+                lo = min(lo, estimators[c].getSOC());
+            }
+            benchKeep(lo);
+        }
+        naiveRuns.push_back((double)(benchNowNs() - start) / updates);
+    }
+
+    double soa = benchMedian(soaRuns), aos = benchMedian(aosRuns), naive = benchMedian(naiveRuns);
+    printf("%4d %12.1f %10.2f %12.1f %16.1f %10.1f %10.1f\n", N, soa, soa / N, aos, naive,
+           (double)sizeof(CellEstimatorBank<N>) / N, (double)sizeof(SOCEstimator));
+}
+
+// Pack 4S với cell 3 chỉ còn 80% dung lượng; chu kỳ nghỉ -> xả 3Ah -> nghỉ -> sạc
+inline int cellsBenchConvergence() {
+    const float trueCapacity[NUM_CELLS] = { 6.0f, 6.0f, 4.8f, 6.0f };
+    int errors = 0;
+
+    hostSetMillis(1000);
+    SOCEstimator pack(BATTERY_CAPACITY, 100.0);
+    CellEstimatorBank<NUM_CELLS> bank(BATTERY_CAPACITY);
+    bank.reset(100.0, pack.getNetChargeUnits());
+    float trueCharge[NUM_CELLS];
+    for (int i = 0; i < NUM_CELLS; i++) trueCharge[i] = trueCapacity[i];
+
+    int64_t lastNet = pack.getNetChargeUnits();
+    float voltages[NUM_CELLS];
+    auto rest = [&]() {
+        for (int i = 0; i < NUM_CELLS; i++) {
+            voltages[i] = pack.interpolateOCV(trueCharge[i] / trueCapacity[i] * 100.0f);
+        }
+        bank.calibrate(voltages, pack);
+    };
+
+    rest();
+    float packSocWhenWeakEmpty = -1;
+    for (int cycle = 0; cycle < 12; cycle++) {
+        float current = (cycle % 2 == 0) ? -2.0f : 2.0f;
+        for (int s = 0; s < 5400; s++) {   // 1.5 giờ, mẫu 1s
+            hostAdvanceMillis(1000);
+            pack.updateAt(current, 25.0f, millis());
+            int64_t net = pack.getNetChargeUnits();
+            float dq = (float)((double)(net - lastNet) / CHARGE_UNITS_PER_AH);
+            lastNet = net;
+            for (int i = 0; i < NUM_CELLS; i++) {
+                trueCharge[i] = constrain(trueCharge[i] + dq, 0.0f, trueCapacity[i]);
+            }
+            bank.update(net);
+        }
+        rest();
+    }
+    printf("capacity after 12 half-cycles:");
+    for (int i = 0; i < NUM_CELLS; i++) printf(" %.2f", bank.getCapacity(i));
+    printf(" Ah (true 6.00 6.00 4.80 6.00), weakest cell %d\n", bank.getWeakestCell() + 1);
+    if (fabs(bank.getCapacity(2) - 4.8f) > 0.2f || fabs(bank.getCapacity(0) - 6.0f) > 0.2f) errors++;
+
+    // Xả tới khi cell yếu cạn: SOC pack phải về 0 trước các cell khác
+    while (bank.getMinSOC() > 0) {
+        hostAdvanceMillis(1000);
+        pack.updateAt(-2.0f, 25.0f, millis());
+        bank.update(pack.getNetChargeUnits());
+    }
+    packSocWhenWeakEmpty = bank.getPackSOC();
+    printf("weakest cell empty: pack SOC %.1f%%, strongest cell %.1f%%\n", packSocWhenWeakEmpty,
+           bank.getMaxSOC());
+    if (bank.getWeakestCell() != 2 || packSocWhenWeakEmpty != 0 || bank.getMaxSOC() <= 0) errors++;
+    return errors;
+}
+
+inline int benchCells(int, char**) {
+    printf("\n=== Per-cell estimator bank (update per sample) ===\n");
+    printf("%4s %12s %10s %12s %16s %10s %10s\n", "N", "SoA ns", "ns/cell", "AoS ns",
+           "N x SOCEst ns", "B/cell", "B/SOCEst");
+    int errors = 0;
+    cellsBenchRow<4>(errors);
+    cellsBenchRow<16>(errors);
+    cellsBenchRow<24>(errors);
+    errors += cellsBenchConvergence();
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
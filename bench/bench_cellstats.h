@@ -0,0 +1,142 @@
+#ifndef BENCH_CELLSTATS_H
+#define BENCH_CELLSTATS_H
+
+#include "bench.h"
+#include "bms_data.h"
+
+/*
+ * Thống kê từng cell: bộ nhớ mỗi cell, chi phí 1 mẫu ở 4S/16S/24S và kiểm tra
+ * phát hiện trên trace 24S (nhiễu ADC 2 mV, lệch tĩnh ±3 mV, 1 mẫu/s)
+ * - Cell yếu (85% dung lượng) khi xả: bị đánh dấu trước khi chạm UV
+ * - 10 chu kỳ sạc/xả, nội trở các cell lệch ±10%: không cell nào bị đánh dấu
+ * - Nghỉ 8h, 1 cell tự xả nhanh hơn 3 mV/h: ước lượng sai < 20%, bị đánh dấu
+ */
+
+#define CELLSTATS_CELLS 24
+
+struct CellStatsNoise {
+    uint32_t state;
+
+    // Xấp xỉ Gauss (tổng 4 số đều), độ lệch chuẩn sigma
+    float next(float sigma) {
+        float sum = 0;
+        for (int i = 0; i < 4; i++) {
+            state = state * 1664525u + 1013904223u;
+            sum += (state >> 8) * (1.0f / 16777216.0f);
+        }
+        return (sum - 2.0f) * 1.7320508f * sigma;
+    }
+};
+
+template <int N>
+inline void cellStatsCostRow() {
+    const int traces = 1024;
+    const int updates = 1 << 19;
+    std::vector<float> voltages((size_t)traces * N);
+    CellStatsNoise noise = { 12345 };
+    for (float& v : voltages) v = 3.30f + noise.next(0.002f);
+
+    CellStatsBank<N> bank;
+    std::vector<double> runs;
+    for (int r = 0; r < 7; r++) {
+        bank.reset();
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < updates; i++) {
+            bank.update(&voltages[(size_t)(i & (traces - 1)) * N], -1.2f, (uint32_t)i * 100);
+        }
+        runs.push_back((double)(benchNowNs() - start) / updates);
+        benchKeep(bank.getOutlierMask());
+    }
+    double ns = benchMedian(runs);
+    printf("%2dS  %5d B  %6.1f ns/sample  %5.2f ns/cell\n", N, (int)sizeof(CellStatsBank<N>), ns, ns / N);
+}
+
+inline int benchCellStats(int, char**) {
+    int errors = 0;
+    int perCell = (int)(sizeof(CellStatsBank<24>) - sizeof(CellStatsBank<4>)) / 20;
+    printf("\n=== Cell stats (%d B/cell, window %d, EWMA 1/%d, outlier %.0f mV / %.0f sigma / %.1f mV/h) ===\n",
+           perCell, CELL_STATS_WINDOW, (int)(1 / CELL_STATS_EWMA_ALPHA), CELL_OUTLIER_DEV_MV,
+           CELL_OUTLIER_Z, CELL_SELF_DISCHARGE_MV_H);
+
+    cellStatsCostRow<4>();
+    cellStatsCostRow<16>();
+    cellStatsCostRow<24>();
+
+    const int n = CELLSTATS_CELLS;
+    float offset[n];
+    float resistance[n];
+    CellStatsNoise noise = { 777 };
+    for (int c = 0; c < n; c++) {
+        offset[c] = noise.next(0.003f);
+        resistance[c] = 0.020f * (1.0f + 0.1f * (2.0f * (c % 5) / 4.0f - 1.0f));
+    }
+    float v[n];
+    CellStatsBank<n> stats;
+
+    // Cell yếu xả 1C từ đầy: thời điểm bị đánh dấu so với thời điểm chạm UV
+    const int weak = 6;
+    const float current = -6.0f;
+    long flaggedAt = -1, uvAt = -1;
+    uint32_t falseMask = 0;
+    for (long t = 0; t < 3600 && uvAt < 0; t++) {
+        float soc = 100.0f - t * (100.0f / 3600);
+        for (int c = 0; c < n; c++) {
+            float cellSoc = c == weak ? max(0.0f, 100.0f - (100.0f - soc) / 0.85f) : soc;
+            v[c] = chemistryOcv<BatteryChemistry>(cellSoc) + current * resistance[c] + offset[c] +
+                   noise.next(0.002f);
+        }
+        stats.update(v, current, t * 1000);
+        if (flaggedAt < 0 && stats.isOutlier(weak)) flaggedAt = t;
+        if (v[weak] < CELL_UV_THRESHOLD) uvAt = t;
+        falseMask |= stats.getOutlierMask() & ~(1u << weak);
+    }
+    bool early = flaggedAt >= 0 && uvAt >= 0 && flaggedAt < uvAt;
+    if (!early || falseMask) errors++;
+    printf("weak cell (85%%) at 1C: flagged at %ld s, UV at %ld s (%ld s / %.0f%% SOC earlier), other cells flagged 0x%lX\n",
+           flaggedAt, uvAt, uvAt - flaggedAt, (uvAt - flaggedAt) * (100.0f / 3600),
+           (unsigned long)falseMask);
+
+    // Pack khoẻ, 10 chu kỳ sạc / nghỉ / xả / nghỉ
+    stats.reset();
+    falseMask = 0;
+    float soc = 50.0f;
+    for (long t = 0; t < 10 * 4 * 1800; t++) {
+        int phase = (t / 1800) % 4;
+        float i = phase == 0 ? 3.0f : phase == 2 ? -3.0f : 0.0f;
+        soc += i * (100.0f / 6.0f / 3600.0f);
+        for (int c = 0; c < n; c++) {
+            v[c] = chemistryOcv<BatteryChemistry>(soc) + i * resistance[c] + offset[c] + noise.next(0.002f);
+        }
+        stats.update(v, i, t * 1000);
+        falseMask |= stats.getOutlierMask();
+    }
+    if (falseMask) errors++;
+    printf("healthy 24S, 10 cycles (%lu samples): flagged 0x%lX, worst score %.2f\n",
+           (unsigned long)stats.getSampleCount(), (unsigned long)falseMask, stats.getWorstScore());
+
+    // Nghỉ 8h, cell 12 tự xả nhanh hơn 3 mV/h
+    stats.reset();
+    const int leaky = 11;
+    const float leak = -3.0f;
+    for (long t = 0; t < 8 * 3600; t++) {
+        for (int c = 0; c < n; c++) {
+            v[c] = 3.30f + offset[c] + noise.next(0.002f) + (c == leaky ? leak * t / 3600000.0f : 0.0f);
+        }
+        stats.update(v, 0.0f, t * 1000);
+    }
+    float estimate = stats.getSelfDischarge(leaky);
+    float otherMax = 0;
+    for (int c = 0; c < n; c++) {
+        if (c != leaky) otherMax = max(otherMax, fabsf(stats.getSelfDischarge(c)));
+    }
+    bool leakFound = fabsf(estimate - leak) < 0.2f * fabsf(leak) && stats.getOutlierMask() == (1u << leaky);
+    if (!leakFound || otherMax > 0.5f) errors++;
+    printf("8h rest, cell %d leaking %.1f mV/h: estimate %.2f mV/h over %u periods, others max |%.2f| mV/h, mask 0x%lX\n",
+           leaky + 1, leak, estimate, stats.getSelfDischargePeriods(), otherMax,
+           (unsigned long)stats.getOutlierMask());
+
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef BENCH_CHEMISTRY_H
+#define BENCH_CHEMISTRY_H
+
+#include "bench.h"
+#include "bms_data.h"
+
+/*
+ * Chemistry traits: chi phí so với cách cũ (#define + bảng OCV là mảng thành viên)
+ * - Bản "legacy" dưới đây là code trước khi có bms_chemistry.h, cùng giá trị LiFePO4
+ * - Cùng đầu vào thì kết quả phải giống hệt, ns/op phải ngang nhau (không tốn thêm gì)
+ * - Bảng OCV / ngưỡng của LFP, NMC, LTO tính lúc biên dịch (static_assert bên dưới)
+ */
+
+#define LEGACY_CELL_OV_THRESHOLD 3.65
+#define LEGACY_CELL_UV_THRESHOLD 2.80
+#define LEGACY_PACK_OT_THRESHOLD 50.0
+#define LEGACY_PACK_UT_THRESHOLD -10.0
+
+static_assert(chemistryOcv<ChemistryLFP>(50) == 3.20f, "OCV not folded at compile time");
+static_assert(chemistrySocFromOcv<ChemistryNMC>(4.20f) == 100, "OCV not folded at compile time");
+
+class LegacyOcv {
+private:
+    const float ocvTable[11][2] = {
+        {0,   2.50}, {10,  2.90}, {20,  3.00}, {30,  3.10},
+        {40,  3.15}, {50,  3.20}, {60,  3.25}, {70,  3.28},
+        {80,  3.30}, {90,  3.35}, {100, 3.40}
+    };
+
+public:
+    float interpolateOCV(float soc) {
+        soc = constrain(soc, 0, 100);
+        for (int i = 0; i < 10; i++) {
+            if (soc >= ocvTable[i][0] && soc <= ocvTable[i + 1][0]) {
+                float soc1 = ocvTable[i][0];
+                float soc2 = ocvTable[i + 1][0];
+                float v1 = ocvTable[i][1];
+                float v2 = ocvTable[i + 1][1];
+                return v1 + (v2 - v1) * (soc - soc1) / (soc2 - soc1);
+            }
+        }
+        return 3.20;
+    }
+
+    // Cũ kẹp tới 3.6V nên 3.40-3.60V rơi ra ngoài bảng (trả 50%); bench chỉ so trong bảng
+    float socFromOCV(float voltage) {
+        voltage = constrain(voltage, 2.5, 3.6);
+        for (int i = 0; i < 10; i++) {
+            if (voltage >= ocvTable[i][1] && voltage <= ocvTable[i + 1][1]) {
+                float v1 = ocvTable[i][1];
+                float v2 = ocvTable[i + 1][1];
+                float soc1 = ocvTable[i][0];
+                float soc2 = ocvTable[i + 1][0];
+                return soc1 + (soc2 - soc1) * (voltage - v1) / (v2 - v1);
+            }
+        }
+        return 50.0;
+    }
+};
+
+inline uint8_t legacyProtectionMask(float maxV, float minV, float maxT, float minT) {
+    return (maxV > LEGACY_CELL_OV_THRESHOLD) | (minV < LEGACY_CELL_UV_THRESHOLD) << 1 |
+           (maxT > LEGACY_PACK_OT_THRESHOLD) << 2 | (minT < LEGACY_PACK_UT_THRESHOLD) << 3;
+}
+
+template <typename Chemistry>
+inline uint8_t traitsProtectionMask(float maxV, float minV, float maxT, float minT) {
+    return (maxV > Chemistry::overVoltage) | (minV < Chemistry::underVoltage) << 1 |
+           (maxT > Chemistry::maxTemperature) << 2 | (minT < Chemistry::minTemperature) << 3;
+}
+
+// Median ns/op của fn(i) qua 9 lần chạy
+template <typename Fn>
+inline double chemistryTime(int count, Fn fn) {
+    std::vector<double> runs;
+    for (int r = 0; r < 9; r++) {
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < count; i++) fn(i);
+        runs.push_back((double)(benchNowNs() - start) / count);
+    }
+    return benchMedian(runs);
+}
+
+template <typename Chemistry>
+inline int chemistryRoundTrip() {
+    int errors = 0;
+    SOCEstimatorT<Chemistry> estimator(BATTERY_CAPACITY, 50.0);
+    double maxError = 0;
+    for (int s = 0; s <= 1000; s++) {
+        float soc = s * 0.1f;
+        maxError = max(maxError, (double)fabs(estimator.socFromOCV(estimator.interpolateOCV(soc)) - soc));
+    }
+    if (maxError > 0.01) errors++;
+    if (estimator.socFromOCV(Chemistry::overVoltage) != 100 || estimator.socFromOCV(0) != 0) errors++;
+    printf("%-8s %6.2f %6.2f %6.2f %6.2f %7.1f %7.1f %6.3f %10.4f\n", Chemistry::name,
+           Chemistry::emptyVoltage, Chemistry::fullVoltage, Chemistry::underVoltage,
+           Chemistry::overVoltage, Chemistry::minTemperature, Chemistry::maxTemperature,
+           estimator.interpolateOCV(50), maxError);
+    return errors;
+}
+
+inline int benchChemistry(int, char**) {
+    int errors = 0;
+    printf("\n=== Chemistry traits (active: %s, sizeof(SOCEstimator) = %d B) ===\n",
+           BatteryChemistry::name, (int)sizeof(SOCEstimator));
+    printf("%-8s %6s %6s %6s %6s %7s %7s %6s %10s\n", "chem", "empty", "full", "UV", "OV",
+           "minT", "maxT", "ocv50", "roundtrip");
+    errors += chemistryRoundTrip<ChemistryLFP>();
+    errors += chemistryRoundTrip<ChemistryNMC>();
+    errors += chemistryRoundTrip<ChemistryLTO>();
+
+    // Đầu vào lúc chạy để compiler không gập hằng. Điện áp / nhiệt độ lệch nửa bước
+    // khỏi ngưỡng: ngưỡng cũ là double, mới là float, chỉ khác khi giá trị trùng ngưỡng
+    const int count = 1 << 20;
+    std::vector<float> socs(count), volts(count), temps(count);
+    for (int i = 0; i < count; i++) {
+        socs[i] = (i * 7919u % 10001) * 0.01f;
+        volts[i] = 2.50005f + (i * 104729u % 9000) * 0.0001f;   // 2.50 - 3.40V
+        temps[i] = -19.95f + (i * 31u % 800) * 0.1f;
+    }
+
+    LegacyOcv legacy;
+    SOCEstimatorT<ChemistryLFP> traits(BATTERY_CAPACITY, 50.0);
+    for (int i = 0; i < count; i++) {
+        if (legacy.interpolateOCV(socs[i]) != traits.interpolateOCV(socs[i]) ||
+            fabs(legacy.socFromOCV(volts[i]) - traits.socFromOCV(volts[i])) > 1e-4f ||
+            legacyProtectionMask(volts[i] + 0.3f, volts[i], temps[i], temps[i]) !=
+                traitsProtectionMask<ChemistryLFP>(volts[i] + 0.3f, volts[i], temps[i], temps[i])) {
+            errors++;
+            break;
+        }
+    }
+
+    printf("%-22s %12s %12s\n", "case (LiFePO4)", "legacy ns", "traits ns");
+    double a = chemistryTime(count, [&](int i) { benchKeep(legacy.interpolateOCV(socs[i])); });
+    double b = chemistryTime(count, [&](int i) { benchKeep(traits.interpolateOCV(socs[i])); });
+    printf("%-22s %12.2f %12.2f\n", "interpolateOCV", a, b);
+    a = chemistryTime(count, [&](int i) { benchKeep(legacy.socFromOCV(volts[i])); });
+    b = chemistryTime(count, [&](int i) { benchKeep(traits.socFromOCV(volts[i])); });
+    printf("%-22s %12.2f %12.2f\n", "socFromOCV", a, b);
+    a = chemistryTime(count, [&](int i) {
+        benchKeep(legacyProtectionMask(volts[i] + 0.3f, volts[i], temps[i], temps[i]));
+    });
+    b = chemistryTime(count, [&](int i) {
+        benchKeep(traitsProtectionMask<ChemistryLFP>(volts[i] + 0.3f, volts[i], temps[i], temps[i]));
+    });
+    printf("%-22s %12.2f %12.2f\n", "protection thresholds", a, b);
+
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef BENCH_DRIFT_H
+#define BENCH_DRIFT_H
+
+#include "bench.h"
+#include "soc_estimator.h"
+
+/*
+ * BENCH DRIFT - Độ trôi của bộ đếm điện tích sau 1 năm chạy liên tục
+ * So sánh 3 đường tính cùng một profile, mẫu mỗi 500ms:
+ * - reference: double, cùng thuật toán (hình thang, hiệu suất 0.97)
+ * - float:     đường float cũ (chargeAccumulated/totalChargeIn/Out là float)
+ * - int64:     SOCEstimator hiện tại
+ * Profile mỗi ngày: sạc 1.0A 5h, nghỉ 2h, xả 0.97A 5h, nghỉ 12h (cân bằng
+ * điện tích nên SOC không chạm 0/100%), thêm ripple ±5% chu kỳ 37s.
+ */
+
+#define DRIFT_SAMPLE_MS   500
+#define DRIFT_DAYS        365
+#define DRIFT_CAPACITY    6.0
+#define DRIFT_START_SOC   10.0
+
+// Đường tính cũ, giữ lại để so sánh
+template <typename Real>
+struct LegacyChargeCounter {
+    Real capacity;
+    Real charge;
+    Real totalIn;
+    Real totalOut;
+    Real lastCurrent;
+    bool hasLast;
+
+    LegacyChargeCounter(Real capacityAh, Real startSoc) {
+        capacity = capacityAh;
+        charge = startSoc / 100 * capacityAh;
+        totalIn = 0;
+        totalOut = 0;
+        lastCurrent = 0;
+        hasLast = false;
+    }
+
+    void apply(Real ah) {
+        if (ah > 0) {
+            charge += ah * (Real)0.97;
+            totalIn += ah;
+        } else if (ah < 0) {
+            charge -= -ah;   // 25°C: tempFactor = 1.0
+            totalOut += -ah;
+        }
+    }
+
+    void update(Real current, unsigned long deltaMs) {
+        Real prev = hasLast ? lastCurrent : current;
+        lastCurrent = current;
+        hasLast = true;
+        Real deltaTime = deltaMs / (Real)3600000.0;
+        if ((prev >= 0) == (current >= 0)) {
+            apply((prev + current) * (Real)0.5 * deltaTime);
+        } else {
+            Real tZero = deltaTime * fabs(prev) / (fabs(prev) + fabs(current));
+            apply(prev * (Real)0.5 * tZero);
+            apply(current * (Real)0.5 * (deltaTime - tZero));
+        }
+        charge = constrain(charge, (Real)0, capacity);
+    }
+};
+
+inline float driftProfileCurrent(uint64_t ms) {
+    uint64_t dayMs = ms % 86400000ULL;
+    double hour = dayMs / 3600000.0;
+    float ripple = 1.0f + 0.05f * sinf((ms % 37000) / 37000.0f * 2 * M_PI);
+    if (hour < 5) return 1.0f * ripple;
+    if (hour >= 7 && hour < 12) return -0.97f * ripple;
+    return 0.0f;
+}
+
+inline int benchDrift(int, char**) {
+    hostSetMillis(0);
+    SOCEstimator estimator(DRIFT_CAPACITY, DRIFT_START_SOC);
+    LegacyChargeCounter<float> legacy(DRIFT_CAPACITY, DRIFT_START_SOC);
+    LegacyChargeCounter<double> reference(DRIFT_CAPACITY, DRIFT_START_SOC);
+
+    printf("\n=== Charge counter drift: %d days, sample %dms ===\n", DRIFT_DAYS, DRIFT_SAMPLE_MS);
+    printf("%5s | %-26s | %-26s | %-26s\n", "day", "remaining Ah (ref/f32/i64)",
+           "total in Ah (ref/f32/i64)", "total out Ah (ref/f32/i64)");
+
+    uint64_t start = benchNowNs();
+    uint64_t samples = 0;
+    for (uint64_t ms = DRIFT_SAMPLE_MS; ms <= DRIFT_DAYS * 86400000ULL; ms += DRIFT_SAMPLE_MS) {
+        float current = driftProfileCurrent(ms);
+        estimator.updateAt(current, 25.0, (unsigned long)ms);
+        legacy.update(current, DRIFT_SAMPLE_MS);
+        reference.update(current, DRIFT_SAMPLE_MS);
+        samples++;
+
+        if (ms % (30 * 86400000ULL) == 0 || ms == DRIFT_DAYS * 86400000ULL) {
+            printf("%5llu | %8.4f %8.4f %8.4f | %8.2f %8.2f %8.2f | %8.2f %8.2f %8.2f\n",
+                   (unsigned long long)(ms / 86400000ULL),
+                   reference.charge, legacy.charge, estimator.getRemainingCapacity(),
+                   reference.totalIn, legacy.totalIn, estimator.getTotalChargeIn(),
+                   reference.totalOut, legacy.totalOut, estimator.getTotalChargeOut());
+        }
+    }
+    uint64_t elapsed = benchNowNs() - start;
+
+    printf("Final error vs reference (mAh):\n");
+    printf("  remaining: float %+10.3f   int64 %+10.3f\n",
+           (legacy.charge - reference.charge) * 1000, (estimator.getRemainingCapacity() - reference.charge) * 1000);
+    printf("  total in:  float %+10.3f   int64 %+10.3f\n",
+           (legacy.totalIn - reference.totalIn) * 1000, (estimator.getTotalChargeIn() - reference.totalIn) * 1000);
+    printf("  total out: float %+10.3f   int64 %+10.3f\n",
+           (legacy.totalOut - reference.totalOut) * 1000, (estimator.getTotalChargeOut() - reference.totalOut) * 1000);
+    printf("%llu samples in %.2fs\n", (unsigned long long)samples, elapsed / 1e9);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef BENCH_EVENTS_H
+#define BENCH_EVENTS_H
+
+#include "bench.h"
+#include "bms_data.h"
+
+/*
+ * Nhật ký sự kiện: bộ nhớ mỗi sự kiện, chi phí ghi mỗi mẫu và kiểm tra hành vi
+ * - Quá dòng 300ms giữa 2 lần poll 2s: cách cũ (alert tính lại từ cờ lúc poll)
+ *   không thấy, nhật ký giữ lại kèm dòng đỉnh
+ * - Alarm chập chờn trong EVENT_DEDUP_MS: 1 sự kiện, count = số lần bật
+ * - Ring đầy: ghi đè cũ nhất, /alerts?since= phân trang theo revision không sót
+ */
+
+inline BMSSample eventsSample(uint32_t t, float current) {
+    BMSSample s;
+    s.timestamp = t;
+    for (int i = 0; i < NUM_CELLS; i++) s.cellVoltages[i] = 3.30f;
+    s.current = current;
+    s.temperature = 25.0f;
+    s.minTemperature = 24.0f;
+    return s;
+}
+
+// Đọc hết các trang /alerts?since=, trả về số sự kiện và số trang
+inline int eventsDrain(uint32_t& since, int& pages) {
+    int total = 0;
+    pages = 0;
+    bool more = true;
+    while (more) {
+        uint32_t next;
+        BufferWriter out(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+        out.printf("{");
+        bmsEvents.writeJson(out, since, next);
+        out.printf("}");
+        for (const char* p = out.c_str(); (p = strstr(p, "\"id\":")); p++) total++;
+        more = strstr(out.c_str(), "\"more\":true") != NULL;
+        if (out.isTruncated() || (more && next == since)) return -1;
+        since = next;
+        pages++;
+    }
+    return total;
+}
+
+inline int benchEvents(int, char**) {
+    int errors = 0;
+    printf("\n=== Event journal (%d B/event, %d events = %d B, dedup %d ms) ===\n",
+           (int)sizeof(BMSEvent), EVENT_CAPACITY, (int)sizeof(BMSEventJournal), EVENT_DEDUP_MS);
+
+    // Quá dòng ngắn giữa 2 lần poll
+    initBMSData();
+    bmsEvents.reset();
+    uint32_t t = 0;
+    int oldSeen = 0;
+    for (int i = 0; i < 40; i++, t += 100) {
+        float current = (i >= 23 && i < 26) ? -7.5f - i * 0.1f : -1.0f;
+        BMSSample s = eventsSample(t, current);
+        updateBMSBatch(&s, 1);
+        if (i % 20 == 19 && bmsData.overCurrentAlarm) oldSeen++;   // Poll mỗi 2s
+    }
+    uint32_t since = 0;
+    int pages;
+    int seen = eventsDrain(since, pages);
+    bool caught = strstr(bmsJsonBuffer, "\"type\":\"overCurrent\"") &&
+                  strstr(bmsJsonBuffer, "\"peak\":10.00") && strstr(bmsJsonBuffer, "\"start\":2300") &&
+                  strstr(bmsJsonBuffer, "\"end\":2600");
+    if (oldSeen != 0 || seen != 1 || !caught) errors++;
+    printf("300ms over-current between polls: flags at poll %d, journal %d event (%s)\n",
+           oldSeen, seen, caught ? "peak 10.00 A, 2300-2600 ms" : "MISSING");
+
+    // Alarm chập chờn: 10 lần bật/tắt trong 5s
+    for (int i = 0; i < 100; i++, t += 50) {
+        BMSSample s = eventsSample(t, (i % 10) < 3 ? -6.0f - i * 0.01f : -1.0f);
+        updateBMSBatch(&s, 1);
+    }
+    uint32_t before = since;
+    int flapping = eventsDrain(since, pages);
+    const char* count = strstr(bmsJsonBuffer, "\"count\":");
+    bool merged = flapping == 1 && count && atoi(count + 8) == 11;
+    if (!merged || bmsEvents.getDeduplicatedCount() != 10) errors++;
+    printf("10 repeats within %d ms: %d event, count %d, revision %lu -> %lu\n", EVENT_DEDUP_MS,
+           flapping, count ? atoi(count + 8) : 0, (unsigned long)before, (unsigned long)since);
+
+    // Ring đầy: 3 * capacity sự kiện tách biệt, client đọc từ đầu và theo dõi dần
+    bmsEvents.reset();
+    since = 0;
+    int followed = 0;
+    for (int i = 0; i < 3 * EVENT_CAPACITY; i++) {
+        t += EVENT_DEDUP_MS + 1000;
+        bmsEvents.update(EVENT_OVER_TEMPERATURE, true, 55.0f + i, t);
+        bmsEvents.update(EVENT_OVER_TEMPERATURE, false, 0, t + 500);
+        if (i % 8 == 7) {
+            int n = eventsDrain(since, pages);
+            if (n < 0) errors++;
+            else followed += n;
+        }
+    }
+    since = 0;
+    int all = eventsDrain(since, pages);
+    if (followed != 3 * EVENT_CAPACITY || all != EVENT_CAPACITY ||
+        bmsEvents.getOverwrittenCount() != 2 * EVENT_CAPACITY) errors++;
+    printf("%d events: follower saw %d, full read %d in %d pages of %d B, %lu overwritten\n",
+           3 * EVENT_CAPACITY, followed, all, pages, BMS_JSON_BUFFER_SIZE,
+           (unsigned long)bmsEvents.getOverwrittenCount());
+
+    // Chi phí ghi mỗi mẫu: 9 loại, không alarm / 1 alarm đang mở / bật-tắt mỗi mẫu
+    const int count2 = 1 << 20;
+    const char* names[] = { "idle (11 types)", "1 active", "transition each sample" };
+    for (int mode = 0; mode < 3; mode++) {
+        std::vector<double> runs;
+        for (int r = 0; r < 7; r++) {
+            bmsEvents.reset();
+            bmsData.overCurrentAlarm = mode == 1;
+            uint64_t start = benchNowNs();
+            for (int i = 0; i < count2; i++) {
+                if (mode == 2) bmsData.overCurrentAlarm = i & 1;
+                recordEvents(3.3f, 3.2f, 6.0f + (i & 7), 30.0f, 20.0f, 0.01f, (uint32_t)i * 100);
+            }
+            runs.push_back((double)(benchNowNs() - start) / count2);
+        }
+        benchKeep(bmsEvents.getRevision());
+        printf("recordEvents %-24s %6.2f ns/sample\n", names[mode], benchMedian(runs));
+    }
+
+    initBMSData();
+    bmsEvents.reset();
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef BENCH_EXPORT_H
+#define BENCH_EXPORT_H
+
+#include "bench.h"
+#include "bms_export.h"
+
+/*
+ * Xuất lịch sử (/export): thông lượng mã hoá mỗi định dạng (chunk 2KB như
+ * handler) và kiểm tra nội dung
+ * - bin = header + bản ghi y như RAM; csv rộng cố định; delta giải mã lại khớp
+ * - seek tới offset ngẫu nhiên + read = đúng lát cắt của bản xuất đầy đủ
+ *   (điều kiện để HTTP Range / tải tiếp ghép lại đúng file)
+ * - parseByteRange: các dạng Range thường gặp và trường hợp 416
+ */
+
+inline std::vector<uint8_t> exportAll(HistoryExporter& exporter, size_t chunk) {
+    std::vector<uint8_t> out(exporter.size());
+    exporter.seek(0);
+    size_t pos = 0;
+    while (pos < out.size()) {
+        size_t n = exporter.read(out.data() + pos, min(chunk, out.size() - pos));
+        if (n == 0) break;
+        pos += n;
+    }
+    out.resize(pos);
+    return out;
+}
+
+inline int32_t exportVarint(const uint8_t*& p) {
+    uint32_t zigzag = 0;
+    for (int shift = 0; ; shift += 7) {
+        zigzag |= (uint32_t)(*p & 0x7F) << shift;
+        if (!(*p++ & 0x80)) break;
+    }
+    return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+inline int benchExport(int, char**) {
+    int errors = 0;
+    printf("\n=== History export (%d records, chunk %d B) ===\n", HISTORY_CAPACITY, BMS_JSON_BUFFER_SIZE);
+
+    // Ring đầy + quay vòng, giá trị thay đổi chậm như pin thật
+    BMSHistory* history = new BMSHistory();
+    BMSData data;
+    for (int i = 0; i < NUM_CELLS; i++) data.cellVoltages[i] = 3.30;
+    uint32_t now = 0;
+    for (int i = 0; i < (HISTORY_CAPACITY + 500) * 10; i++, now += 100) {
+        data.current = -12.0 + 4.0 * sin(i * 0.001);
+        data.soc = 80.0 - i * 0.0004;
+        data.packVoltage = 52.0 - i * 0.00005;
+        data.packTemp = 25.0 + (i % 4000) * 0.001;
+        data.cellVoltages[0] = 3.25 + (i % 300) * 0.0001;
+        history->onSample(data, now);
+    }
+    HistoryExporter exporter(*history);
+    uint32_t next = history->getNextSeq();
+
+    const uint8_t formats[] = { EXPORT_FORMAT_CSV, EXPORT_FORMAT_BIN, EXPORT_FORMAT_DELTA };
+    std::vector<uint8_t> full[3];
+    for (int f = 0; f < 3; f++) {
+        exporter.begin(formats[f], 0, next, now, false);
+        std::vector<double> runs;
+        for (int r = 0; r < 7; r++) {
+            uint64_t start = benchNowNs();
+            full[f] = exportAll(exporter, BMS_JSON_BUFFER_SIZE);
+            runs.push_back((double)(benchNowNs() - start));
+        }
+        double ns = benchMedian(runs);
+        if (full[f].size() != exporter.size() || exporter.getCount() != HISTORY_CAPACITY) errors++;
+        printf("%-5s %7lu B (%5.2f B/record)  %7.1f MB/s  %6.2f ms\n", exporter.formatName(),
+               (unsigned long)full[f].size(), (double)full[f].size() / exporter.getCount(),
+               full[f].size() * 1e3 / ns, ns / 1e6);
+    }
+
+    // bin: header + bản ghi trong RAM
+    uint32_t first = next - HISTORY_CAPACITY;
+    bool binOk = full[1].size() == HISTORY_HEADER_SIZE + HISTORY_CAPACITY * sizeof(HistoryRecord);
+    for (uint32_t k = 0; binOk && k < HISTORY_CAPACITY; k++) {
+        binOk = memcmp(full[1].data() + HISTORY_HEADER_SIZE + k * sizeof(HistoryRecord),
+                       &history->getRecord(first + k), sizeof(HistoryRecord)) == 0;
+    }
+
+    // csv: mọi dòng đúng EXPORT_CSV_ROW byte, dòng đầu khớp bản ghi đầu
+    size_t headerLength = sizeof(EXPORT_CSV_HEADER) - 1;
+    bool csvOk = full[0].size() == headerLength + HISTORY_CAPACITY * EXPORT_CSV_ROW;
+    for (uint32_t k = 0; csvOk && k < HISTORY_CAPACITY; k++) {
+        csvOk = full[0][headerLength + (k + 1) * EXPORT_CSV_ROW - 1] == '\n';
+    }
+    if (csvOk) {
+        std::string row((const char*)full[0].data() + headerLength, EXPORT_CSV_ROW);
+        const HistoryRecord& r = history->getRecord(first);
+        csvOk = strtoul(row.c_str(), NULL, 10) == r.timestamp &&
+                lround(atof(row.c_str() + 11) * 100) == r.packVoltage &&
+                lround(atof(row.c_str() + 18) * 100) == r.current;
+    }
+
+    // delta: giải mã lại bằng cộng dồn, khớp bản ghi trong RAM
+    bool deltaOk = true;
+    const uint8_t* p = full[2].data() + HISTORY_HEADER_SIZE;
+    HistoryRecord prev;
+    memset(&prev, 0, sizeof(prev));
+    for (uint32_t k = 0; deltaOk && k < HISTORY_CAPACITY; k++) {
+        HistoryRecord r;
+        r.timestamp = prev.timestamp + exportVarint(p) + HISTORY_INTERVAL_MS;
+        r.packVoltage = prev.packVoltage + exportVarint(p);
+        r.current = prev.current + exportVarint(p);
+        r.soc = prev.soc + exportVarint(p);
+        r.temperature = prev.temperature + exportVarint(p);
+        r.minCell = prev.minCell + exportVarint(p);
+        r.maxCell = prev.maxCell + exportVarint(p);
+        const HistoryRecord& e = history->getRecord(first + k);
+        deltaOk = r.timestamp == e.timestamp && r.packVoltage == e.packVoltage &&
+                  r.current == e.current && r.soc == e.soc && r.temperature == e.temperature &&
+                  r.minCell == e.minCell && r.maxCell == e.maxCell;
+        prev = r;
+    }
+    deltaOk = deltaOk && p == full[2].data() + full[2].size();
+    if (!binOk || !csvOk || !deltaOk) errors++;
+    printf("content: bin %s, csv fixed %d B rows %s, delta roundtrip %s\n", binOk ? "ok" : "FAIL",
+           EXPORT_CSV_ROW, csvOk ? "ok" : "FAIL", deltaOk ? "ok" : "FAIL");
+
+    // seek + read ở offset ngẫu nhiên = lát cắt của bản đầy đủ
+    uint32_t seed = 12345;
+    int sliceErrors = 0;
+    std::vector<uint8_t> slice(3000);
+    for (int f = 0; f < 3; f++) {
+        exporter.begin(formats[f], first, next, now, true);
+        for (int i = 0; i < 200; i++) {
+            seed = seed * 1103515245 + 12345;
+            size_t offset = (seed >> 8) % full[f].size();
+            size_t want = min((size_t)(seed % slice.size()) + 1, full[f].size() - offset);
+            exporter.seek(offset);
+            size_t got = exporter.read(slice.data(), want);
+            if (got != want || memcmp(slice.data(), full[f].data() + offset, want) != 0) sliceErrors++;
+        }
+    }
+    // Resume sau khi ring ghi thêm: cùng from/to => cùng nội dung; from đã bị ghi đè => từ chối
+    exporter.begin(EXPORT_FORMAT_BIN, first + 10, next, now, true);
+    for (int i = 0; i < 5 * 10; i++, now += 100) history->onSample(data, now);
+    exporter.seek(HISTORY_HEADER_SIZE);
+    exporter.read(slice.data(), sizeof(HistoryRecord));
+    bool resumeOk = memcmp(slice.data(), full[1].data() + HISTORY_HEADER_SIZE + 10 * sizeof(HistoryRecord),
+                           sizeof(HistoryRecord)) == 0 && !exporter.isOverwritten();
+    bool goneOk = !exporter.begin(EXPORT_FORMAT_BIN, first, next, now, true);
+    if (sliceErrors || !resumeOk || !goneOk) errors++;
+    printf("seek/read 600 random slices: %d mismatches, resume %s, overwritten from %s\n",
+           sliceErrors, resumeOk ? "ok" : "FAIL", goneOk ? "rejected" : "ACCEPTED");
+
+    // HTTP Range
+    struct { const char* header; size_t start, end; bool ranged, ok; } ranges[] = {
+        { NULL,                0, 999, false, true },
+        { "bytes=0-99",        0,  99, true,  true },
+        { "bytes=500-",      500, 999, true,  true },
+        { "bytes=-100",      900, 999, true,  true },
+        { "bytes=900-5000",  900, 999, true,  true },
+        { "bytes=0-1,5-9",     0, 999, false, true },
+        { "bytes=1000-",       0,   0, false, false },
+        { "bytes=50-10",       0,   0, false, false },
+    };
+    int rangeErrors = 0;
+    for (auto& c : ranges) {
+        size_t start, end;
+        bool ranged;
+        bool ok = parseByteRange(c.header, 1000, start, end, ranged);
+        if (ok != c.ok || (ok && (start != c.start || end != c.end || ranged != c.ranged))) rangeErrors++;
+    }
+    if (rangeErrors) errors++;
+    printf("Range parsing: %d/%d cases ok\n", (int)(sizeof(ranges) / sizeof(ranges[0])) - rangeErrors,
+           (int)(sizeof(ranges) / sizeof(ranges[0])));
+    printf("memory: exporter %d B + chunk buffer %d B, independent of range\n",
+           (int)sizeof(HistoryExporter), BMS_JSON_BUFFER_SIZE);
+
+    delete history;
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
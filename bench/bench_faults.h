@@ -0,0 +1,212 @@
+#ifndef BENCH_FAULTS_H
+#define BENCH_FAULTS_H
+
+#include "bench.h"
+#include "bms_data.h"
+#include "bms_faults.h"
+
+/*
+ * Tiêm lỗi vào BMSSensors (cấu hình firmware, chu kỳ 120s) và đo độ trễ bảo vệ
+ * - Thời gian ảo bước 1ms: giá trị thật (sau khi tiêm lỗi) được xét mỗi ms để
+ *   biết lúc vượt ngưỡng; pipeline như readAndUpdateBMS() chạy mỗi chu kỳ lấy mẫu;
+ *   /bms được poll theo chu kỳ dashboard (UPDATE_INTERVAL 2s) và tìm alert
+ * - Cột: vượt ngưỡng / alarm trong bmsData / alert trên /bms, ms sau lúc bắt đầu
+ *   lỗi; "samples" = số mẫu tới khi alarm; "also" = sự kiện khác cũng mở
+ * - Chạy ở chu kỳ FAST (100ms) và ACTIVE (500ms) của BMSPowerManager
+ * - Lỗi bench: alarm mong đợi không bật trong maxLatencyMs sau lúc vượt ngưỡng, alarm
+ *   đang bật lúc poll mà /bms không có alert, hoặc kịch bản không mong alarm lại
+ *   bật alarm critical. Alarm tắt trước lần poll kế tiếp chỉ còn trong /alerts
+ * - Xung ngắn hơn chu kỳ lấy mẫu không thấy được bằng lấy mẫu (cần bảo vệ phần cứng
+ *   của AFE): kịch bản đó chỉ kiểm tra không có alarm giả
+ */
+
+#define FAULT_BENCH_START_MS  1000UL
+#define FAULT_BENCH_WINDOW_MS 30000UL   // Theo dõi sau lúc bắt đầu lỗi
+#define FAULT_BENCH_POLL_MS   2000UL    // UPDATE_INTERVAL của dashboard
+#define FAULT_BENCH_POLL_PHASE 700UL
+
+struct FaultScenario {
+    const char* name;
+    const char* script;
+    int8_t event;            // Sự kiện mong đợi, -1 = không alarm
+    uint16_t maxLatencyMs;   // Alarm chậm nhất sau lúc vượt ngưỡng (ở chu kỳ ACTIVE 500ms)
+};
+
+const FaultScenario FAULT_SCENARIOS[] = {
+    { "cell sag -0.25 V/s",    "cell 2 value=-1.2 rate=0.25 at=50000",   EVENT_UNDER_VOLTAGE,    500 },
+    { "overcharge +50 mV/s",   "cell 1 value=0.8 rate=0.05 at=10000",    EVENT_OVER_VOLTAGE,     500 },
+    { "thermal runaway 2 C/s", "temp 1 value=80 rate=2 at=10000",        EVENT_OVER_TEMPERATURE, 500 },
+    { "current 7 A 2 s",       "current value=7 at=45000 for=2000",      EVENT_OVER_CURRENT,     500 },
+    { "short -40 A 300 ms",    "current value=-40 at=45000 for=300",     EVENT_SHORT_CIRCUIT,    500 },
+    { "short -40 A 50 ms",     "current value=-40 at=45050 for=50",      -1,                     0 },
+    { "thermistor 4 open",     "open 4 at=10000",                        EVENT_SENSOR_FAULT,     500 },
+    { "all thermistors open",  "open at=10000",                          EVENT_THERMAL_LOSS,     500 },
+    { "no thermistors + sag",  "cell 2 value=-1.2 rate=0.25 at=50000; open at=50000",
+                                                                         EVENT_UNDER_VOLTAGE,    500 },
+    { "cell 3 stuck",          "stuck 3 at=2000",                        EVENT_CELL_OUTLIER,     8000 },
+    { "bus dropout 5 s",       "dropout at=10000 for=5000",              EVENT_COMMS_FAULT,      SENSOR_COMMS_FAULT_READS * 500 },
+    { "ADC noise 10 mV",       "noise value=0.01 at=0",                  -1,                     0 },
+};
+
+#define FAULT_SCENARIO_COUNT (int)(sizeof(FAULT_SCENARIOS) / sizeof(FAULT_SCENARIOS[0]))
+
+// Alarm trong bmsData (cờ protection), các loại khác theo nhật ký sự kiện
+inline bool faultAlarmRaised(int8_t event) {
+    switch (event) {
+        case EVENT_OVER_VOLTAGE:     return bmsData.overVoltageAlarm;
+        case EVENT_UNDER_VOLTAGE:    return bmsData.underVoltageAlarm;
+        case EVENT_OVER_CURRENT:     return bmsData.overCurrentAlarm;
+        case EVENT_OVER_TEMPERATURE: return bmsData.overTempAlarm;
+        case EVENT_SHORT_CIRCUIT:    return bmsData.shortCircuitAlarm;
+        case EVENT_COMMS_FAULT:      return bmsData.commsFaultAlarm;
+        case EVENT_THERMAL_LOSS:     return bmsData.thermalLossAlarm;
+        default:                     return bmsEvents.isActive(event);
+    }
+}
+
+// Giá trị thật (đã tiêm lỗi) đã vượt ngưỡng của sự kiện chưa
+inline bool faultThresholdCrossed(int8_t event, BMSFaultInjector& driver, BMSTemperatureBank& bank) {
+    float maxV = driver.getCellVoltage(1), minV = maxV;
+    for (int c = 2; c <= NUM_CELLS; c++) {
+        maxV = max(maxV, driver.getCellVoltage(c));
+        minV = min(minV, driver.getCellVoltage(c));
+    }
+    float current = fabsf(driver.getCurrent());
+    switch (event) {
+        case EVENT_OVER_VOLTAGE:     return maxV > CELL_OV_THRESHOLD;
+        case EVENT_UNDER_VOLTAGE:    return minV < CELL_UV_THRESHOLD;
+        case EVENT_OVER_CURRENT:     return current > PACK_OC_THRESHOLD;
+        case EVENT_SHORT_CIRCUIT:    return current > 10.0f;
+        case EVENT_OVER_TEMPERATURE: return bank.getHottest() > PACK_OT_THRESHOLD;
+        case EVENT_SENSOR_FAULT:     return bank.getFaultMask() != 0;
+        case EVENT_THERMAL_LOSS:     return bank.getFaultMask() == (1u << TEMP_CHANNELS) - 1;
+        case EVENT_COMMS_FAULT:      return false;   // Đọc được là còn liên lạc
+        default:                     return true;   // Không có ngưỡng: tính từ lúc bắt đầu lỗi
+    }
+}
+
+struct FaultResult {
+    long crossMs;     // -1 = không xảy ra
+    long alarmMs;
+    long visibleMs;
+    int samples;
+    uint32_t otherMask;
+    uint32_t droppedReads;      // Mẫu mất do dropout (như bộ đếm /fault của thiết bị)
+    int hiddenPolls;            // Poll lúc alarm đang bật mà /bms không có alert
+};
+
+inline FaultResult faultRun(const FaultScenario& scenario, unsigned long intervalMs) {
+    hostSetMillis(FAULT_BENCH_START_MS);
+    BMSSensors simulator;
+    BMSFaultInjector driver(simulator);
+    BMSTemperatureBank truth;
+    driver.load(scenario.script);
+    driver.arm(FAULT_BENCH_START_MS);
+    initBMSData();
+    bmsEvents.reset();
+    temperatureBank.reset();
+
+    unsigned long onset = driver.getStep(0).atMs;
+    FaultResult r = { -1, -1, -1, 0, 0, 0, 0 };
+    for (unsigned long t = 0; t <= onset + FAULT_BENCH_WINDOW_MS; t++) {
+        unsigned long now = FAULT_BENCH_START_MS + t;
+        hostSetMillis(now);
+        bool sampleDue = t % intervalMs == 0;
+
+        // loop(): handleClient() trước sampleIfDue()
+        if (t >= onset && r.visibleMs < 0 && scenario.event >= 0 &&
+            t % FAULT_BENCH_POLL_MS == FAULT_BENCH_POLL_PHASE) {
+            writeBMSJson(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+            bool shown = strstr(bmsJsonBuffer, EVENT_TYPES[scenario.event].message) != NULL;
+            if (shown) r.visibleMs = t - onset;
+            else if (faultAlarmRaised(scenario.event)) r.hiddenPolls++;
+        }
+
+        bool read = driver.readAllSensors();
+        if (read) {
+            driver.readThermistors(truth);
+            truth.update();
+        }
+        if (t >= onset && r.crossMs < 0 && scenario.event >= 0 &&
+            (read ? faultThresholdCrossed(scenario.event, driver, truth) : scenario.event == EVENT_COMMS_FAULT)) {
+            r.crossMs = t - onset;
+        }
+        if (!sampleDue) continue;
+
+        // Như readAndUpdateBMS()
+        // driver.getDroppedReads() còn đếm cả các lần đọc 1 ms để dò ngưỡng ở trên
+        if (!read) {
+            r.droppedReads++;
+            recordSensorReadFailure(now);
+        } else {
+            driver.readThermistors(temperatureBank);
+            bool tempValid = temperatureBank.update();
+            updateBMSData(driver.getCellVoltage(1), driver.getCellVoltage(2), driver.getCellVoltage(3),
+                          driver.getCellVoltage(4), driver.getCurrent(),
+                          tempValid ? temperatureBank.getHottest() : NAN,
+                          tempValid ? temperatureBank.getColdest() : NAN);
+        }
+        if (t < onset) continue;
+        if (r.alarmMs < 0) r.samples++;
+        if (r.alarmMs < 0 && scenario.event >= 0 && faultAlarmRaised(scenario.event)) r.alarmMs = t - onset;
+        bmsEvents.forEachActive([&](const BMSEvent& e) {
+            if (e.type != scenario.event) r.otherMask |= 1u << e.type;
+        });
+    }
+    return r;
+}
+
+inline void faultPrintMs(long ms) {
+    if (ms < 0) printf(" %9s", "-");
+    else printf(" %9ld", ms);
+}
+
+inline int benchFaults(int, char**) {
+    int errors = 0;
+    printf("\n=== Fault injection (%s: OV %.2f V, UV %.2f V, OC %.0f A, SC 10 A, OT %.0f C; "
+           "/bms polled every %lu ms) ===\n",
+           BatteryChemistry::name, CELL_OV_THRESHOLD, CELL_UV_THRESHOLD, PACK_OC_THRESHOLD,
+           PACK_OT_THRESHOLD, FAULT_BENCH_POLL_MS);
+
+    const unsigned long intervals[] = { 100, 500 };
+    for (unsigned long interval : intervals) {
+        printf("\nsample interval %lu ms\n", interval);
+        printf("%-22s %-16s %9s %9s %9s %7s  %s\n", "scenario", "expect", "cross ms", "alarm ms",
+               "/bms ms", "samples", "also");
+        for (int s = 0; s < FAULT_SCENARIO_COUNT; s++) {
+            const FaultScenario& scenario = FAULT_SCENARIOS[s];
+            FaultResult r = faultRun(scenario, interval);
+            printf("%-22s %-16s", scenario.name, scenario.event >= 0 ? EVENT_TYPES[scenario.event].name : "(none)");
+            faultPrintMs(r.crossMs);
+            faultPrintMs(r.alarmMs);
+            faultPrintMs(r.visibleMs);
+            printf(" %7d  ", r.alarmMs >= 0 ? r.samples : 0);
+            bool criticalOther = false;
+            const char* sep = "";
+            for (int e = 0; e < EVENT_TYPE_COUNT; e++) {
+                if (!((r.otherMask >> e) & 1)) continue;
+                printf("%s%s", sep, EVENT_TYPES[e].name);
+                sep = ",";
+                criticalOther |= strcmp(EVENT_TYPES[e].severity, "critical") == 0;
+            }
+            if (*sep) sep = ", ";
+            if (r.droppedReads) {
+                printf("%s%lu reads dropped", sep, (unsigned long)r.droppedReads);
+                sep = ", ";
+            }
+            bool late = r.alarmMs >= 0 && r.alarmMs - max(r.crossMs, 0L) > scenario.maxLatencyMs;
+            if (scenario.event >= 0 && r.alarmMs < 0) printf("%sMISSED", sep);
+            else if (late) printf("%sLATE (> %u ms)", sep, scenario.maxLatencyMs);
+            else if (scenario.event >= 0 && r.visibleMs < 0) printf("%scleared before /bms poll (in /alerts)", sep);
+            printf("\n");
+
+            if (scenario.event >= 0 && (r.alarmMs < 0 || late || r.hiddenPolls)) errors++;
+            if (scenario.event < 0 && criticalOther) errors++;
+        }
+    }
+
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef BENCH_HISTORY_H
+#define BENCH_HISTORY_H
+
+#include "bench.h"
+#include "bms_data.h"
+#include "bms_history.h"
+
+/*
+ * Lịch sử xu hướng (/history): chi phí onSample mỗi mẫu và kiểm tra ring
+ * - Mẫu mỗi ~100ms có jitter: số bản ghi phải khớp thời gian (lưới 1s không trôi)
+ * - Dòng điện trong bản ghi = trung bình các mẫu trong khoảng
+ * - select(): sau khi ring quay vòng, since quá cũ / đúng / tương lai (client của
+ *   lần boot trước), 2 đoạn nối lại phải liên tục theo thời gian
+ */
+
+inline int historyCheckSelect(BMSHistory& history, uint32_t since, uint32_t expectFirst,
+                              uint32_t expectCount) {
+    uint32_t first;
+    HistorySpan spans[2];
+    uint32_t count = history.select(since, first, spans);
+    int errors = 0;
+    if (first != expectFirst || count != expectCount) errors++;
+    if (spans[0].length + spans[1].length != count * sizeof(HistoryRecord)) errors++;
+
+    // Nối 2 đoạn: timestamp phải tăng đều
+    std::vector<HistoryRecord> joined(count);
+    memcpy(joined.data(), spans[0].data, spans[0].length);
+    memcpy((uint8_t*)joined.data() + spans[0].length, spans[1].data, spans[1].length);
+    for (uint32_t i = 1; i < count; i++) {
+        if (joined[i].timestamp <= joined[i - 1].timestamp) {
+            errors++;
+            break;
+        }
+    }
+    if (count && memcmp(&joined[0], &history.getRecord(first), sizeof(HistoryRecord)) != 0) errors++;
+    printf("  since %-8lu -> first %-6lu count %-5lu %s\n", (unsigned long)since,
+           (unsigned long)first, (unsigned long)count, errors ? "FAIL" : "ok");
+    return errors;
+}
+
+inline int benchHistory(int, char**) {
+    int errors = 0;
+    printf("\n=== History ring (%d x %d B = %d B, %d ms/record) ===\n", HISTORY_CAPACITY,
+           (int)sizeof(HistoryRecord), (int)(HISTORY_CAPACITY * sizeof(HistoryRecord)),
+           HISTORY_INTERVAL_MS);
+
+    BMSData data;
+    data.packVoltage = 52.1;
+    data.soc = 63.4;
+    data.packTemp = 28.7;
+    for (int i = 0; i < NUM_CELLS; i++) data.cellVoltages[i] = 3.2 + i * 0.01;
+
+    // Lưới thời gian + trung bình dòng: mẫu 100-130ms, dòng xen kẽ 1A / 3A
+    BMSHistory* history = new BMSHistory();
+    uint32_t now = 0;
+    const uint32_t duration = 5000UL * HISTORY_INTERVAL_MS;
+    int samples = 0;
+    while (now < duration) {
+        data.current = (samples++ & 1) ? 3.0 : 1.0;
+        history->onSample(data, now);
+        now += 100 + (samples * 7) % 31;
+    }
+    uint32_t expected = duration / HISTORY_INTERVAL_MS;
+    uint32_t records = history->getNextSeq();
+    if (records + 1 < expected || records > expected + 1) errors++;
+    const HistoryRecord& last = history->getRecord(records - 2);
+    if (abs(last.current - 200) > 15 || last.packVoltage != 5210 || last.soc != 634 ||
+        last.temperature != 287 || last.minCell != 3200) errors++;
+    printf("%lu s sampled ~110ms -> %lu records, avg current %.2f A, pack %.2f V\n",
+           (unsigned long)(duration / 1000), (unsigned long)records, last.current / 100.0,
+           last.packVoltage / 100.0);
+
+    uint32_t next = history->getNextSeq();
+    uint32_t oldest = next - HISTORY_CAPACITY;
+    errors += historyCheckSelect(*history, 0, oldest, HISTORY_CAPACITY);
+    errors += historyCheckSelect(*history, oldest + 1, oldest + 1, HISTORY_CAPACITY - 1);
+    errors += historyCheckSelect(*history, next - 2, next - 2, 2);
+    errors += historyCheckSelect(*history, next, next, 0);
+    errors += historyCheckSelect(*history, next + 1000, oldest, HISTORY_CAPACITY);
+
+    // Chi phí: onSample mỗi mẫu (đa số chỉ cộng dồn, 1/10 ghi bản ghi)
+    const int count = 1 << 20;
+    std::vector<double> runs;
+    for (int r = 0; r < 7; r++) {
+        history->reset();
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < count; i++) {
+            data.current = (float)(i & 15);
+            history->onSample(data, (uint32_t)i * 100);
+        }
+        runs.push_back((double)(benchNowNs() - start) / count);
+    }
+    benchKeep(history->getNextSeq());
+    printf("onSample: %.2f ns/sample (%d cells)\n", benchMedian(runs), NUM_CELLS);
+    printf("poll every 2s: %d B per response (header + 2 records)\n",
+           HISTORY_HEADER_SIZE + 2 * (int)sizeof(HistoryRecord));
+
+    delete history;
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
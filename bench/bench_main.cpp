@@ -0,0 +1,98 @@
+/*
+ * Benchmark native cho các hot path của firmware
+ *   pio run -e native && .pio/build/native/program [tên benchmark] [tham số]
+ * Không có tham số: chạy tất cả
+ * Mã thoát khác 0 khi benchmark báo lỗi (ví dụ suite chậm hơn baseline)
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include <new>
+#include "bms_data.h"
+
+#include "bench_batch.h"
+#include "bench_drift.h"
+#include "bench_suite.h"
+#include "bench_modbus.h"
+#include "bench_can.h"
+#include "bench_mqtt.h"
+#include "bench_udp.h"
+#include "bench_afe.h"
+#include "bench_temperature.h"
+#include "bench_cells.h"
+#include "bench_chemistry.h"
+#include "bench_history.h"
+#include "bench_events.h"
+#include "bench_export.h"
+#include "bench_cellstats.h"
+#include "bench_admission.h"
+#include "bench_faults.h"
+
+// ============ ĐẾM CẤP PHÁT HEAP ============
+
+// GCC inline operator new/delete thay thế rồi báo nhầm malloc/free không khớp
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    benchAllocCount++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+struct BenchEntry {
+    const char* name;
+    int (*run)(int argc, char** argv);
+};
+
+const BenchEntry benches[] = {
+    { "batch", benchBatch },
+    { "drift", benchDrift },
+    { "suite", benchSuite },
+    { "modbus", benchModbus },
+    { "can", benchCan },
+    { "mqtt", benchMqtt },
+    { "udp", benchUdp },
+    { "afe", benchAfe },
+    { "temp", benchTemperature },
+    { "cells", benchCells },
+    { "chemistry", benchChemistry },
+    { "history", benchHistory },
+    { "events", benchEvents },
+    { "export", benchExport },
+    { "cellstats", benchCellStats },
+    { "admission", benchAdmission },
+    { "faults", benchFaults },
+};
+
+int main(int argc, char** argv) {
+    const char* only = (argc > 1) ? argv[1] : NULL;
+    bool found = false;
+    int status = 0;
+
+    for (const BenchEntry& bench : benches) {
+        if (only == NULL || strcmp(only, bench.name) == 0) {
+            // Tham số sau tên benchmark được chuyển tiếp
+            int result = only ? bench.run(argc - 2, argv + 2) : bench.run(0, NULL);
+            if (result != 0) status = result;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        fprintf(stderr, "Unknown benchmark: %s\n", only);
+        return 1;
+    }
+    return status;
+}
@@ -0,0 +1,142 @@
+#ifndef BENCH_MODBUS_H
+#define BENCH_MODBUS_H
+
+#include "bench.h"
+#include "bms_modbus.h"
+
+/*
+ * Throughput Modbus TCP: client giả lập trong cùng process gửi request
+ * FC03/FC04 (1..MODBUS_REG_COUNT thanh ghi) qua ModbusConnection như server
+ * thật, cắt dòng byte thành segment ngẫu nhiên như TCP, kiểm tra từng response
+ * với snapshot. So sánh với chi phí tạo JSON /bms cho cùng dữ liệu.
+ */
+
+#define MODBUS_BENCH_REQUESTS 2000000
+#define MODBUS_BENCH_PIPELINE 8     // Số request client gửi dồn trước khi đọc
+
+inline size_t modbusBenchRequest(uint8_t* out, uint16_t transaction, uint8_t function,
+                                 uint16_t start, uint16_t count) {
+    const uint8_t frame[12] = {
+        (uint8_t)(transaction >> 8), (uint8_t)transaction, 0, 0, 0, 6, 1,
+        function, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(count >> 8), (uint8_t)count
+    };
+    memcpy(out, frame, sizeof(frame));
+    return sizeof(frame);
+}
+
+// Kiểm tra response khớp request và snapshot
+inline bool modbusBenchCheck(const uint8_t* resp, int len, uint16_t transaction,
+                             uint8_t function, uint16_t start, uint16_t count) {
+    if (len != 9 + count * 2) return false;
+    if (((resp[0] << 8) | resp[1]) != transaction || resp[7] != function || resp[8] != count * 2) {
+        return false;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        if (((resp[9 + i * 2] << 8) | resp[10 + i * 2]) != modbusRegisters.get(start + i)) return false;
+    }
+    return true;
+}
+
+inline int benchModbus(int, char**) {
+    hostSetMillis(1000);
+    initBMSData();
+    updateBMSData(3.312f, 3.254f, 3.298f, 3.301f, -1.75f, 31.4f);
+    modbusRegisters.update(bmsData, cellEstimators.getUsableCapacity(), millis());
+
+    printf("\n=== Modbus TCP (%d registers, pipeline %d) ===\n", MODBUS_REG_COUNT, MODBUS_BENCH_PIPELINE);
+
+    // Cập nhật snapshot (chạy 1 lần mỗi mẫu)
+    uint64_t start = benchNowNs();
+    const int updates = 1000000;
+    for (int i = 0; i < updates; i++) {
+        bmsData.current = (i & 1) ? -1.75f : -1.74f;
+        modbusRegisters.update(bmsData, 4.2f, i);
+    }
+    printf("snapshot update: %.1f ns\n", (double)(benchNowNs() - start) / updates);
+
+    ModbusConnection connection;
+    uint8_t stream[MODBUS_BENCH_PIPELINE * 12];
+    uint16_t starts[MODBUS_BENCH_PIPELINE];
+    uint16_t counts[MODBUS_BENCH_PIPELINE];
+    uint8_t functions[MODBUS_BENCH_PIPELINE];
+    uint8_t response[MODBUS_ADU_MAX];
+
+    uint32_t rng = 12345;
+    uint64_t transactions = 0;
+    uint64_t registersRead = 0;
+    uint64_t segments = 0;
+    int errors = 0;
+
+    start = benchNowNs();
+    for (uint16_t tid = 0; transactions < MODBUS_BENCH_REQUESTS;) {
+        size_t streamLength = 0;
+        for (int p = 0; p < MODBUS_BENCH_PIPELINE; p++) {
+            rng = rng * 1664525u + 1013904223u;
+            counts[p] = 1 + (rng >> 8) % MODBUS_REG_COUNT;
+            starts[p] = (rng >> 20) % (MODBUS_REG_COUNT - counts[p] + 1);
+            functions[p] = (rng & 1) ? MODBUS_FC_READ_INPUT : MODBUS_FC_READ_HOLDING;
+            streamLength += modbusBenchRequest(stream + streamLength, tid + p, functions[p], starts[p], counts[p]);
+        }
+
+        // Gửi theo segment độ dài ngẫu nhiên (1..64 byte)
+        size_t sent = 0;
+        int answered = 0;
+        while (sent < streamLength) {
+            rng = rng * 1664525u + 1013904223u;
+            size_t segment = min((size_t)(1 + (rng >> 24) % 64), streamLength - sent);
+            sent += connection.feed(stream + sent, segment);
+            segments++;
+
+            int len;
+            while ((len = connection.process(modbusRegisters, response, sizeof(response))) > 0) {
+                if (!modbusBenchCheck(response, len, (uint16_t)(tid + answered), functions[answered],
+                                      starts[answered], counts[answered])) {
+                    errors++;
+                }
+                registersRead += counts[answered];
+                answered++;
+            }
+            if (len < 0) errors++;
+        }
+        if (answered != MODBUS_BENCH_PIPELINE) errors++;
+        transactions += answered;
+        tid += MODBUS_BENCH_PIPELINE;
+    }
+    uint64_t elapsed = benchNowNs() - start;
+
+    printf("transactions: %llu in %.2fs (%llu segments)\n", (unsigned long long)transactions,
+           elapsed / 1e9, (unsigned long long)segments);
+    printf("  %.0f transactions/s, %.0f registers/s, %.1f ns/transaction\n",
+           transactions * 1e9 / elapsed, registersRead * 1e9 / elapsed, (double)elapsed / transactions);
+
+    // Tham chiếu: cùng dữ liệu qua JSON /bms
+    const int jsonRuns = 20000;
+    size_t jsonBytes = 0;
+    start = benchNowNs();
+    for (int i = 0; i < jsonRuns; i++) {
+        jsonBytes = writeBMSJson(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+    }
+    printf("JSON /bms (reference): %.1f ns, %zu bytes vs %d bytes full Modbus read\n",
+           (double)(benchNowNs() - start) / jsonRuns, jsonBytes, 9 + MODBUS_REG_COUNT * 2);
+
+    // Request sai: function code / địa chỉ / protocol
+    uint8_t bad[12];
+    modbusBenchRequest(bad, 1, 0x06, 0, 1);
+    connection.feed(bad, 12);
+    bool badFunction = connection.process(modbusRegisters, response, sizeof(response)) == 9 &&
+                       response[7] == 0x86 && response[8] == MODBUS_EX_ILLEGAL_FUNCTION;
+    modbusBenchRequest(bad, 2, MODBUS_FC_READ_INPUT, MODBUS_REG_COUNT - 1, 2);
+    connection.feed(bad, 12);
+    bool badAddress = connection.process(modbusRegisters, response, sizeof(response)) == 9 &&
+                      response[8] == MODBUS_EX_ILLEGAL_ADDRESS;
+    modbusBenchRequest(bad, 3, MODBUS_FC_READ_INPUT, 0, 1);
+    bad[2] = 1;
+    connection.feed(bad, 12);
+    bool badProtocol = connection.process(modbusRegisters, response, sizeof(response)) < 0;
+    if (!badFunction || !badAddress || !badProtocol) errors++;
+
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef BENCH_MQTT_H
+#define BENCH_MQTT_H
+
+#include "bench.h"
+#include "bms_mqtt.h"
+
+/*
+ * MQTT publisher với broker giả lập trong cùng process:
+ * - Throughput: enqueue + format + publish, batch 1..32 mẫu / message
+ * - Mất broker: lấy mẫu 500ms (ACTIVE) trong 20 phút, broker mất 2 lần (60s, 180s);
+ *   đo high-water của hàng đợi, mẫu bị bỏ, thời gian từ lúc broker trở lại
+ *   tới khi xả hết hàng đợi (gồm cả thời gian chờ reconnect)
+ * Broker kiểm tra seq liên tục (không trùng, không đảo thứ tự)
+ * Nhật ký sự kiện đẩy cùng kết nối: alarm bật/tắt cả lúc mất broker, sau khi
+ * kết nối lại broker phải nhận đủ tới revision cuối
+ * - QoS 1: tối đa 1 publish (chặn tới PUBACK) mỗi update(); broker treo nửa chừng
+ *   (TCP còn kết nối, không PUBACK) 60s: đếm số publish phải chờ hết MQTT_TIMEOUT_MS
+ */
+
+#define MQTT_BENCH_SAMPLE_MS 500   // Chu kỳ lấy mẫu ACTIVE
+
+class BenchBroker : public MqttTransport {
+public:
+    bool online;
+    bool session;
+    uint64_t messages;
+    uint64_t samples;
+    uint64_t bytes;
+    uint32_t expectedSeq;
+    uint32_t gaps;        // seq nhảy cóc (mẫu bị bỏ khi hàng đợi đầy)
+    uint32_t reordered;   // seq lùi lại: lỗi
+    uint32_t eventMessages;
+    uint32_t events;
+    uint32_t eventRevision;
+    bool stalled;         // TCP còn kết nối nhưng không PUBACK: publish chờ hết timeout rồi lỗi
+    uint32_t timeouts;
+    uint32_t perLoop;     // Publish kể từ loop() gần nhất (= trong 1 update())
+    uint32_t maxPerLoop;
+
+    BenchBroker() {
+        online = true;
+        session = false;
+        messages = 0;
+        samples = 0;
+        bytes = 0;
+        expectedSeq = 0;
+        gaps = 0;
+        reordered = 0;
+        eventMessages = 0;
+        events = 0;
+        eventRevision = 0;
+        stalled = false;
+        timeouts = 0;
+        perLoop = 0;
+        maxPerLoop = 0;
+    }
+
+    bool connected() override { return online && session; }
+
+    bool connect() override {
+        session = online;
+        return session;
+    }
+
+    // Đọc seq đầu mỗi mẫu "[seq," sau "\"s\":["; topic sự kiện thì đếm sự kiện
+    bool publish(const char* topic, const char* payload, size_t length, int) override {
+        if (!connected()) return false;
+        if (++perLoop > maxPerLoop) maxPerLoop = perLoop;
+        if (stalled) {
+            timeouts++;
+            return false;
+        }
+        if (strstr(topic, "events")) {
+            for (const char* e = payload; (e = strstr(e, "\"id\":")); e++) events++;
+            const char* r = strstr(payload, "\"revision\":");
+            if (r) eventRevision = strtoul(r + 11, NULL, 10);
+            eventMessages++;
+            return true;
+        }
+        const char* p = strstr(payload, "\"s\":[");
+        if (!p) return false;
+        p += 5;
+        while (*p == '[') {
+            uint32_t seq = strtoul(p + 1, NULL, 10);
+            if (seq < expectedSeq) reordered++;
+            else if (seq > expectedSeq) gaps++;
+            expectedSeq = seq + 1;
+            samples++;
+            // Sang mẫu kế tiếp: bỏ qua mảng cell lồng bên trong
+            int depth = 0;
+            do {
+                if (*p == '[') depth++;
+                else if (*p == ']') depth--;
+                p++;
+            } while (depth > 0);
+            if (*p == ',') p++;
+        }
+        messages++;
+        bytes += length;
+        return true;
+    }
+
+    void loop() override {
+        if (!online) session = false;
+        perLoop = 0;
+    }
+};
+
+inline int benchMqtt(int, char**) {
+    int errors = 0;
+    hostSetMillis(1000);
+    initBMSData();
+    updateBMSData(3.312f, 3.254f, 3.298f, 3.301f, -1.75f, 31.4f);
+
+    printf("\n=== MQTT publisher (queue %d samples) ===\n", MQTT_QUEUE_SIZE);
+    printf("%6s %14s %14s %12s\n", "batch", "msgs/s", "samples/s", "bytes/msg");
+
+    const uint16_t batches[] = { 1, 4, 10, 32 };
+    for (uint16_t batch : batches) {
+        BenchBroker broker;
+        BMSMqttPublisher publisher(&broker, "bms/bench", "bench", 1, batch);
+        const int samples = 200000;
+        uint64_t start = benchNowNs();
+        for (int i = 0; i < samples; i++) {
+            hostAdvanceMillis(100);
+            bmsData.current = (i & 1) ? -1.75f : 2.5f;
+            publisher.enqueue(bmsData, millis());
+            publisher.update(millis(), true);
+        }
+        double seconds = (benchNowNs() - start) / 1e9;
+        printf("%6u %14.0f %14.0f %12.0f\n", batch, broker.messages / seconds, broker.samples / seconds,
+               broker.messages ? (double)broker.bytes / broker.messages : 0.0);
+        if (broker.gaps || broker.reordered || broker.samples + batch < (uint64_t)samples) errors++;
+    }
+
+    // Mất broker trên đồng hồ ảo: vòng loop() 10ms, lấy mẫu 500ms
+    BenchBroker broker;
+    BMSMqttPublisher publisher(&broker, "bms/bench", "bench", 1, 10);
+    bmsEvents.reset();
+    publisher.publishEvents(&bmsEvents, "bms/bench/events");
+    struct Outage { unsigned long startS, endS; };
+    const Outage outages[] = { { 120, 180 }, { 600, 780 } };
+    const Outage stall = { 900, 960 };
+    unsigned long startMs = millis();
+    unsigned long lastSample = startMs;
+    unsigned long reconnectedAt = 0;
+    unsigned long longestDrainMs = 0;
+    bool wasOnline = true;
+    uint32_t enqueued = 0;
+
+    for (unsigned long t = 0; t < 1200000; t += 10) {
+        hostSetMillis(startMs + t);
+        bool online = true;
+        for (const Outage& o : outages) {
+            if (t >= o.startS * 1000 && t < o.endS * 1000) online = false;
+        }
+        broker.online = online;
+        broker.stalled = t >= stall.startS * 1000 && t < stall.endS * 1000;
+        if (online && !wasOnline) reconnectedAt = millis();
+        wasOnline = online;
+
+        if (millis() - lastSample >= MQTT_BENCH_SAMPLE_MS) {
+            lastSample = millis();
+            publisher.enqueue(bmsData, millis());
+            enqueued++;
+            // Quá nhiệt 5s mỗi phút, lệch cell 2s mỗi 45s (có lúc rơi vào khoảng mất broker)
+            bmsEvents.update(EVENT_OVER_TEMPERATURE, t % 60000 < 5000, 51.0f + (t % 5000) / 1000.0f, millis());
+            bmsEvents.update(EVENT_BALANCING, t % 45000 < 2000, 0.06f, millis());
+        }
+        publisher.update(millis(), true);
+
+        if (reconnectedAt && publisher.getQueued() < 10) {
+            longestDrainMs = max(longestDrainMs, millis() - reconnectedAt);
+            reconnectedAt = 0;
+        }
+    }
+
+    printf("outage: %lu samples published in %lu msgs, queue high-water %lu, dropped %lu, "
+           "reconnects %lu, drain after reconnect %lu ms\n",
+           (unsigned long)publisher.getSampleCount(), (unsigned long)publisher.getMessageCount(),
+           (unsigned long)publisher.getHighWater(), (unsigned long)publisher.getDroppedCount(),
+           (unsigned long)publisher.getReconnectCount(), longestDrainMs);
+    printf("broker: %lu seq gaps, %lu reordered\n", (unsigned long)broker.gaps,
+           (unsigned long)broker.reordered);
+    printf("stalled broker %lus: %lu publishes timed out (%lu ms blocked), max %lu publishes / update()\n",
+           stall.endS - stall.startS, (unsigned long)broker.timeouts,
+           (unsigned long)broker.timeouts * MQTT_TIMEOUT_MS, (unsigned long)broker.maxPerLoop);
+    printf("events: revision %lu, %lu event msgs carrying %lu events, broker at revision %lu\n",
+           (unsigned long)bmsEvents.getRevision(), (unsigned long)broker.eventMessages,
+           (unsigned long)broker.events, (unsigned long)broker.eventRevision);
+
+    // 60s mất kết nối (120 mẫu) vừa hàng đợi; 180s (360 mẫu) thì bỏ mẫu cũ nhất
+    if (broker.reordered || publisher.getHighWater() != MQTT_QUEUE_SIZE || broker.gaps != 1) errors++;
+    if (broker.samples + publisher.getDroppedCount() + publisher.getQueued() != enqueued) errors++;
+    if (broker.eventRevision != bmsEvents.getRevision() || broker.events == 0) errors++;
+    // Lùi 1, 2, 4, 8, 15, 15.. s: ~8 lần chờ PUBACK trong 60s thay vì mỗi vòng loop()
+    if (broker.maxPerLoop > 1 || broker.timeouts == 0 || broker.timeouts > 10) errors++;
+    bmsEvents.reset();
+
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
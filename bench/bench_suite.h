@@ -0,0 +1,243 @@
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include "bench.h"
+#include "bms_data.h"
+#include "bms_html.h"
+
+/*
+ * BENCH SUITE - Hot path của firmware, so với baseline đã lưu
+ *   program suite [--baseline FILE] [--tolerance 0.25] [--update-baseline]
+ * Mỗi case: warmup, tự chọn số vòng lặp để mỗi lần đo >= 20ms, lấy median
+ * của 9 lần. Báo ns/op, số lần cấp phát heap/op và số byte tạo ra.
+ * Thoát với mã 1 nếu ns/op vượt baseline quá tolerance (và quá SUITE_MIN_DELTA_NS),
+ * allocs/op tăng, hot path không cấp phát (allocFree) lại cấp phát (không cần
+ * baseline), hoặc không có file baseline.
+ * Baseline phụ thuộc máy, không commit: ghi bằng --update-baseline trên máy tham chiếu
+ * (hoặc máy CI) rồi truyền --baseline FILE.
+ */
+
+#define SUITE_RUNS         9
+#define SUITE_MIN_RUN_NS   20000000ULL
+#define SUITE_MIN_DELTA_NS 5.0   // Case vài ns: chênh lệch nhỏ hơn mức này là nhiễu
+#define SUITE_DEFAULT_FILE "bench/baseline.txt"
+
+// writeBMSJson() chỉ dùng pool của StaticJsonDocument với ArduinoJson thật
+#ifdef ARDUINOJSON_VERSION
+#define SUITE_JSON_ALLOC_FREE true
+#else
+#define SUITE_JSON_ALLOC_FREE false
+#endif
+
+struct SuiteResult {
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+    size_t bytes;
+    bool allocFree;   // Hot path phải 0 cấp phát / op
+};
+
+// Đo một case; fn(i) trả về số byte tạo ra ở lần gọi thứ i
+template <typename Fn>
+SuiteResult suiteMeasure(const char* name, bool allocFree, Fn fn) {
+    size_t bytes = 0;
+
+    // Warmup + chọn số vòng lặp
+    uint64_t iterations = 1;
+    for (;;) {
+        uint64_t start = benchNowNs();
+        for (uint64_t i = 0; i < iterations; i++) bytes = fn(i);
+        if (benchNowNs() - start >= SUITE_MIN_RUN_NS) break;
+        iterations *= 2;
+    }
+
+    std::vector<double> runs;
+    runs.reserve(SUITE_RUNS);   // Không tính cấp phát của chính bench
+    uint64_t allocStart = benchAllocCount;
+    for (int r = 0; r < SUITE_RUNS; r++) {
+        uint64_t start = benchNowNs();
+        for (uint64_t i = 0; i < iterations; i++) bytes = fn(i);
+        runs.push_back((double)(benchNowNs() - start) / iterations);
+    }
+    double allocs = (double)(benchAllocCount - allocStart) / (iterations * SUITE_RUNS);
+
+    SuiteResult result;
+    result.name = name;
+    result.nsPerOp = benchMedian(runs);
+    result.allocsPerOp = allocs;
+    result.bytes = bytes;
+    result.allocFree = allocFree;
+    return result;
+}
+
+inline void suiteResetState() {
+    hostSetMillis(1000);
+    initBMSData();
+    resetSOC(60.0);
+}
+
+inline float suiteWave(uint64_t i, float center, float amplitude) {
+    return center + amplitude * sinf((i % 1000) * 0.00628f);
+}
+
+inline std::vector<SuiteResult> suiteRunAll() {
+    std::vector<SuiteResult> results;
+
+    suiteResetState();
+    results.push_back(suiteMeasure("updateBMSData", true, [](uint64_t i) {
+        hostAdvanceMillis(500);
+        float v = suiteWave(i, 3.2f, 0.15f);
+        updateBMSData(v + 0.01f, v, v - 0.004f, v - 0.01f, suiteWave(i, 0, 2.0f), 28.0f);
+        return (size_t)0;
+    }));
+
+    SOCEstimator estimator(BATTERY_CAPACITY, 60.0);
+    results.push_back(suiteMeasure("SOCEstimator::update", true, [&](uint64_t i) {
+        hostAdvanceMillis(500);
+        estimator.update(suiteWave(i, 0, 2.0f), 28.0f);
+        return (size_t)0;
+    }));
+
+    float sink = 0;
+    results.push_back(suiteMeasure("interpolateOCV", true, [&](uint64_t i) {
+        sink += estimator.interpolateOCV((i % 1001) * 0.1f);
+        return (size_t)0;
+    }));
+
+    results.push_back(suiteMeasure("socFromOCV", true, [&](uint64_t i) {
+        sink += estimator.socFromOCV(2.5f + (i % 1001) * 0.0011f);
+        return (size_t)0;
+    }));
+    benchKeep(sink);
+
+    suiteResetState();
+    updateBMSData(3.31f, 3.25f, 3.29f, 3.30f, 1.5f, 30.0f);
+    results.push_back(suiteMeasure("checkProtection", true, [](uint64_t i) {
+        bmsData.current = suiteWave(i, 0, 6.0f);
+        checkProtection();
+        return (size_t)0;
+    }));
+
+    results.push_back(suiteMeasure("checkBalancing", true, [](uint64_t i) {
+        bmsData.cellVoltages[i % NUM_CELLS] = suiteWave(i, 3.28f, 0.05f);
+        checkBalancing();
+        return (size_t)0;
+    }));
+
+    suiteResetState();
+    updateBMSData(3.31f, 3.25f, 3.29f, 3.30f, 1.5f, 30.0f);
+    results.push_back(suiteMeasure("writeBMSJson", SUITE_JSON_ALLOC_FREE, [](uint64_t) {
+        return writeBMSJson(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+    }));
+
+    results.push_back(suiteMeasure("getBMSJson", false, [](uint64_t) {
+        String json = getBMSJson();
+        return (size_t)json.length();
+    }));
+
+    results.push_back(suiteMeasure("getHTMLPage", false, [](uint64_t) {
+        String html = getHTMLPage();
+        return (size_t)html.length();
+    }));
+
+    return results;
+}
+
+// ============ BASELINE ============
+// Mỗi dòng: name ns_per_op allocs_per_op bytes
+
+inline bool suiteLoadBaseline(const char* path, std::vector<SuiteResult>& baseline) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        char name[128];
+        SuiteResult r;
+        if (sscanf(line, "%127s %lf %lf %zu", name, &r.nsPerOp, &r.allocsPerOp, &r.bytes) == 4) {
+            r.name = name;
+            r.allocFree = false;
+            baseline.push_back(r);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+inline bool suiteSaveBaseline(const char* path, const std::vector<SuiteResult>& results) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "# name ns_per_op allocs_per_op bytes (program suite --update-baseline)\n");
+    for (const SuiteResult& r : results) {
+        fprintf(file, "%s %.2f %.3f %zu\n", r.name.c_str(), r.nsPerOp, r.allocsPerOp, r.bytes);
+    }
+    fclose(file);
+    return true;
+}
+
+inline const SuiteResult* suiteFind(const std::vector<SuiteResult>& list, const std::string& name) {
+    for (const SuiteResult& r : list) {
+        if (r.name == name) return &r;
+    }
+    return NULL;
+}
+
+inline int benchSuite(int argc, char** argv) {
+    const char* baselinePath = SUITE_DEFAULT_FILE;
+    double tolerance = 0.25;
+    bool update = false;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--update-baseline") == 0) update = true;
+    }
+
+    benchPinCpu();
+    std::vector<SuiteResult> results = suiteRunAll();
+    std::vector<SuiteResult> baseline;
+    bool haveBaseline = !update && suiteLoadBaseline(baselinePath, baseline);
+
+    printf("\n=== Hot path suite (tolerance %.0f%%) ===\n", tolerance * 100);
+    printf("%-22s %12s %12s %10s %10s  %s\n", "case", "ns/op", "baseline", "allocs/op", "bytes", "status");
+
+    int failures = 0;
+    for (const SuiteResult& r : results) {
+        const SuiteResult* base = haveBaseline ? suiteFind(baseline, r.name) : NULL;
+        const char* status = "new";
+        if (base) {
+            bool slower = r.nsPerOp > base->nsPerOp * (1.0 + tolerance) &&
+                          r.nsPerOp - base->nsPerOp > SUITE_MIN_DELTA_NS;
+            bool moreAllocs = r.allocsPerOp > base->allocsPerOp + 0.01;
+            status = (slower || moreAllocs) ? "REGRESSION" : "ok";
+            if (slower || moreAllocs) failures++;
+        }
+        // Không phụ thuộc baseline
+        if (r.allocFree && r.allocsPerOp > 0) {
+            if (strcmp(status, "REGRESSION") != 0) failures++;
+            status = "ALLOCS";
+        }
+        printf("%-22s %12.1f %12.1f %10.2f %10zu  %s\n", r.name.c_str(), r.nsPerOp,
+               base ? base->nsPerOp : 0.0, r.allocsPerOp, r.bytes, status);
+    }
+
+    if (update) {
+        if (!suiteSaveBaseline(baselinePath, results)) {
+            fprintf(stderr, "Cannot write baseline %s\n", baselinePath);
+            return 1;
+        }
+        printf("Baseline written to %s\n", baselinePath);
+    }
+
+    if (failures > 0) {
+        printf("%d case(s) regressed beyond baseline or allocate on an allocation-free hot path\n", failures);
+        return 1;
+    }
+    if (!update && !haveBaseline) {
+        fprintf(stderr, "No baseline at %s: record one with --update-baseline on the reference machine\n",
+                baselinePath);
+        return 1;
+    }
+    return 0;
+}
+
+#endif
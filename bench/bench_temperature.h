@@ -0,0 +1,107 @@
+#ifndef BENCH_TEMPERATURE_H
+#define BENCH_TEMPERATURE_H
+
+#include "bench.h"
+#include "bms_data.h"
+
+/*
+ * Nhiệt độ nhiều kênh: chi phí đổi 8 kênh ADC -> °C bằng bảng (LUT) so với
+ * Steinhart-Hart trực tiếp (logf), sai số của bảng trên -40..125°C, và
+ * protection OT/UT theo kênh nóng nhất / lạnh nhất (kênh lỗi bị bỏ qua)
+ */
+
+#define TEMP_BENCH_CHANNELS 8
+
+inline int benchTemperature(int, char**) {
+    printf("\n=== Thermistor pipeline (%d channels, LUT %d entries = %d bytes) ===\n",
+           TEMP_BENCH_CHANNELS, TEMP_LUT_SIZE, (int)sizeof(thermistorTable));
+    int errors = 0;
+
+    // Sai số bảng so với công thức
+    double maxError = 0;
+    for (int adc = TEMP_ADC_SHORT; adc <= TEMP_ADC_OPEN; adc++) {
+        float exact = thermistorSteinhartHart(adc);
+        if (exact < -40 || exact > 125) continue;
+        maxError = max(maxError, fabs(thermistorCentiCelsius(adc) / 100.0 - exact));
+    }
+    printf("LUT max error -40..125°C: %.3f °C\n", maxError);
+    if (maxError > 0.1) errors++;
+
+    // Mã ADC đầu vào: 8 kênh quanh 20-45°C, đổi mỗi mẫu
+    const int samples = 4096;
+    std::vector<uint16_t> adc(samples * TEMP_BENCH_CHANNELS);
+    for (int n = 0; n < samples; n++) {
+        for (int ch = 0; ch < TEMP_BENCH_CHANNELS; ch++) {
+            adc[n * TEMP_BENCH_CHANNELS + ch] =
+                thermistorAdcFromCelsius(20.0f + 25.0f * ((n * 7 + ch * 13) % 100) / 100.0f);
+        }
+    }
+
+    std::vector<double> lutRuns, naiveRuns;
+    for (int r = 0; r < 9; r++) {
+        uint64_t start = benchNowNs();
+        for (int rep = 0; rep < 50; rep++) {
+            for (int n = 0; n < samples; n++) {
+                const uint16_t* s = &adc[n * TEMP_BENCH_CHANNELS];
+                int16_t out[TEMP_BENCH_CHANNELS];
+                for (int ch = 0; ch < TEMP_BENCH_CHANNELS; ch++) out[ch] = thermistorCentiCelsius(s[ch]);
+                benchKeep(out);
+            }
+        }
+        lutRuns.push_back((double)(benchNowNs() - start) / (50.0 * samples));
+
+        start = benchNowNs();
+        for (int rep = 0; rep < 50; rep++) {
+            for (int n = 0; n < samples; n++) {
+                const uint16_t* s = &adc[n * TEMP_BENCH_CHANNELS];
+                float out[TEMP_BENCH_CHANNELS];
+                for (int ch = 0; ch < TEMP_BENCH_CHANNELS; ch++) out[ch] = thermistorSteinhartHart(s[ch]);
+                benchKeep(out);
+            }
+        }
+        naiveRuns.push_back((double)(benchNowNs() - start) / (50.0 * samples));
+    }
+    double lutNs = benchMedian(lutRuns), naiveNs = benchMedian(naiveRuns);
+    printf("%-26s %10.1f ns / %d channels\n", "LUT + interpolation", lutNs, TEMP_BENCH_CHANNELS);
+    printf("%-26s %10.1f ns / %d channels (%.1fx)\n", "Steinhart-Hart (logf)", naiveNs,
+           TEMP_BENCH_CHANNELS, naiveNs / lutNs);
+
+    // Cả pipeline: nạp kênh + stats + nóng/lạnh nhất
+    BMSTemperatureBank bank;
+    std::vector<double> bankRuns;
+    for (int r = 0; r < 9; r++) {
+        uint64_t start = benchNowNs();
+        for (int n = 0; n < samples; n++) {
+            for (int ch = 0; ch < TEMP_BENCH_CHANNELS; ch++) bank.setAdc(ch, adc[n * TEMP_BENCH_CHANNELS + ch]);
+            benchKeep(bank.update());
+        }
+        bankRuns.push_back((double)(benchNowNs() - start) / samples);
+    }
+    printf("%-26s %10.1f ns / sample\n", "bank setAdc x8 + update", benchMedian(bankRuns));
+
+    // Protection: kênh nóng nhất / lạnh nhất, kênh hở mạch bị bỏ qua
+    hostSetMillis(1000);
+    initBMSData();
+    bank.reset();
+    for (int ch = 0; ch < TEMP_BENCH_CHANNELS; ch++) bank.setAdc(ch, thermistorAdcFromCelsius(25.0f));
+    bank.setAdc(4, thermistorAdcFromCelsius(55.0f));    // FET quá nhiệt
+    bank.setAdc(7, 4095);                                // Ambient hở mạch
+    bank.update();
+    updateBMSData(3.3f, 3.3f, 3.3f, 3.3f, 1.0f, bank.getHottest(), bank.getColdest());
+    if (!bmsData.overTempAlarm || bmsData.underTempAlarm || bank.getHottestChannel() != 4 ||
+        bank.getFaultMask() != (1 << 7)) errors++;
+
+    bank.setAdc(4, thermistorAdcFromCelsius(25.0f));
+    bank.setAdc(2, thermistorAdcFromCelsius(-15.0f));   // Nhóm cell lạnh
+    bank.update();
+    hostAdvanceMillis(100);
+    updateBMSData(3.3f, 3.3f, 3.3f, 3.3f, 1.0f, bank.getHottest(), bank.getColdest());
+    if (bmsData.overTempAlarm || !bmsData.underTempAlarm || bank.getColdestChannel() != 2 ||
+        !(getStatusFlags(bmsData) & BMS_FLAG_UT)) errors++;
+    if (fabs(bank.getMax(4) - 55.0f) > 0.1f || fabs(bank.getMin(2) + 15.0f) > 0.1f) errors++;
+
+    printf("errors: %d\n", errors);
+    return errors ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef BENCH_UDP_H
+#define BENCH_UDP_H
+
+#include "bench.h"
+#include "bms_udp.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+/*
+ * UDP stream: chi phí encode 1 frame và kiểm tra đọc lại
+ * Gửi thật để thử tools/bms_udp_receiver.py:
+ *   program udp --send 127.0.0.1:5005 [--rate 100] [--seconds 10] [--skip 1000]
+ * --rate 0 = gửi nhanh nhất có thể (đo frames/s của host)
+ * --skip N = bỏ 1 frame mỗi N frame (seq vẫn tăng) để kiểm tra phát hiện mất frame
+ */
+
+inline bool udpBenchVerify(const uint8_t* frame, uint32_t seq, const BMSData& data) {
+    if ((frame[0] | (frame[1] << 8)) != UDP_FRAME_MAGIC || frame[2] != UDP_FRAME_VERSION ||
+        frame[3] != NUM_CELLS) return false;
+    uint32_t s = frame[4] | (frame[5] << 8) | (frame[6] << 16) | ((uint32_t)frame[7] << 24);
+    if (s != seq) return false;
+    const uint8_t* p = frame + 12;
+    for (int i = 0; i < NUM_CELLS; i++, p += 2) {
+        if (fabs((p[0] | (p[1] << 8)) / 1000.0 - data.cellVoltages[i]) > 0.0006) return false;
+    }
+    int16_t current = (int16_t)(p[0] | (p[1] << 8));
+    int16_t temp = (int16_t)(p[2] | (p[3] << 8));
+    return fabs(current / 1000.0 - data.current) < 0.0006 && fabs(temp / 100.0 - data.packTemp) < 0.006;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+inline int udpBenchSend(const char* target, int rate, int seconds, int skip) {
+    char host[64];
+    strncpy(host, target, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    char* colon = strchr(host, ':');
+    int port = UDP_PORT;
+    if (colon) {
+        *colon = '\0';
+        port = atoi(colon + 1);
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        printf("bad address: %s\n", target);
+        return 1;
+    }
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        printf("socket() failed\n");
+        return 1;
+    }
+
+    uint8_t packet[UDP_FRAME_SIZE * UDP_FRAMES_PER_PACKET];
+    int framesInPacket = 0;
+    uint32_t seq = 0;
+    uint64_t frames = 0, skipped = 0, failures = 0;
+    uint64_t periodNs = rate > 0 ? 1000000000ULL / rate : 0;
+    uint64_t start = benchNowNs();
+    uint64_t end = start + (uint64_t)seconds * 1000000000ULL;
+    uint64_t next = start;
+
+    for (uint64_t now = start; now < end; now = benchNowNs()) {
+        if (periodNs) {
+            if (now < next) {
+                uint64_t wait = next - now;
+                timespec ts = { (time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL) };
+                nanosleep(&ts, NULL);
+                continue;
+            }
+            next += periodNs;
+        }
+        float t = (now - start) / 1e9f;
+        bmsData.current = 3.0f * sinf(t);
+        bmsData.cellVoltages[0] = 3.3f + 0.01f * sinf(t * 5);
+
+        uint32_t frameSeq = seq++;
+        if (skip > 0 && frameSeq % skip == (uint32_t)skip - 1) {
+            skipped++;
+            continue;
+        }
+        UdpFrameEncoder::encode(bmsData, frameSeq, (uint32_t)(now / 1000),
+                                packet + framesInPacket * UDP_FRAME_SIZE);
+        if (++framesInPacket < UDP_FRAMES_PER_PACKET) continue;
+        framesInPacket = 0;
+        if (sendto(sock, packet, sizeof(packet), 0, (sockaddr*)&addr, sizeof(addr)) ==
+            (ssize_t)sizeof(packet)) {
+            frames += UDP_FRAMES_PER_PACKET;
+        } else {
+            failures++;
+        }
+    }
+    close(sock);
+
+    double elapsed = (benchNowNs() - start) / 1e9;
+    printf("sent %llu frames to %s:%d in %.1fs (%.0f frames/s), skipped %llu, send failures %llu\n",
+           (unsigned long long)frames, host, port, elapsed, frames / elapsed,
+           (unsigned long long)skipped, (unsigned long long)failures);
+    return failures ? 1 : 0;
+}
+#endif
+
+inline int benchUdp(int argc, char** argv) {
+    const char* target = NULL;
+    int rate = 100, seconds = 10, skip = 0;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "--send") && i + 1 < argc) target = argv[++i];
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--skip") && i + 1 < argc) skip = atoi(argv[++i]);
+    }
+
+    hostSetMillis(1000);
+    initBMSData();
+    updateBMSData(3.312f, 3.254f, 3.298f, 3.301f, -1.75f, 31.4f);
+
+    printf("\n=== UDP stream (%d bytes/frame, %d frames/packet) ===\n",
+           UDP_FRAME_SIZE, UDP_FRAMES_PER_PACKET);
+
+    uint8_t frame[UDP_FRAME_SIZE];
+    int errors = 0;
+    for (uint32_t seq = 0; seq < 1000; seq++) {
+        bmsData.current = (seq & 1) ? -1.75f : 2.5f;
+        UdpFrameEncoder::encode(bmsData, seq, seq * 10000, frame);
+        if (!udpBenchVerify(frame, seq, bmsData)) errors++;
+    }
+
+    std::vector<double> runs;
+    const uint32_t count = 2000000;
+    uint64_t allocs = 0;
+    for (int r = 0; r < 7; r++) {
+        uint64_t allocsBefore = benchAllocCount;
+        uint64_t start = benchNowNs();
+        for (uint32_t i = 0; i < count; i++) {
+            UdpFrameEncoder::encode(bmsData, i, i * 10000, frame);
+            benchKeep(frame);
+        }
+        uint64_t elapsed = benchNowNs() - start;
+        allocs += benchAllocCount - allocsBefore;
+        runs.push_back((double)elapsed / count);
+    }
+    double ns = benchMedian(runs);
+    printf("encode: %.1f ns/frame, %llu allocs, %d verify errors\n", ns,
+           (unsigned long long)allocs, errors);
+    if (allocs) errors++;
+    printf("at %d Hz: %.4f%% of one host core for encoding\n", 1000 / UDP_STREAM_INTERVAL,
+           ns * (1000 / UDP_STREAM_INTERVAL) / 1e7);
+
+    if (target) {
+#if defined(__unix__) || defined(__APPLE__)
+        if (udpBenchSend(target, rate, seconds, skip)) errors++;
+#else
+        printf("--send needs POSIX sockets\n");
+#endif
+    }
+    return errors ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/*
+ * HOST ARDUINO SHIM - Build native (env:native và các tool trên PC)
+ * Chỉ cung cấp phần Arduino API mà các header trong src/ dùng tới:
+ * - millis()/micros()/delay() chạy trên đồng hồ ảo (thread_local),
+ *   code mô phỏng tự tăng thời gian bằng hostAdvanceMillis()
+ * - String tối giản trên std::string
+ * - Serial ghi ra stdout
+ * Không dùng để đo thời gian thật: benchmark dùng std::chrono.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <cmath>
+#include <algorithm>
+#include <string>
+
+using std::abs;
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define PGM_P const char*
+#define strlen_P strlen
+#define memcpy_P memcpy
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ============ VIRTUAL CLOCK ============
+
+inline thread_local uint64_t hostClockUs = 0;
+
+inline unsigned long millis() { return (unsigned long)(hostClockUs / 1000); }
+inline unsigned long micros() { return (unsigned long)hostClockUs; }
+inline void delay(unsigned long ms) { hostClockUs += (uint64_t)ms * 1000; }
+inline void yield() {}
+
+inline void hostSetMillis(uint64_t ms) { hostClockUs = ms * 1000; }
+inline void hostAdvanceMillis(uint64_t ms) { hostClockUs += ms * 1000; }
+inline void hostAdvanceMicros(uint64_t us) { hostClockUs += us; }
+
+// ============ STRING ============
+
+class String {
+private:
+    std::string str;
+
+public:
+    String() {}
+    String(const char* cstr) : str(cstr ? cstr : "") {}
+    String(const std::string& s) : str(s) {}
+    String(char c) : str(1, c) {}
+    String(int value) : str(std::to_string(value)) {}
+    String(unsigned int value) : str(std::to_string(value)) {}
+    String(long value) : str(std::to_string(value)) {}
+    String(unsigned long value) : str(std::to_string(value)) {}
+    String(float value, unsigned int decimals = 2) { setFloat(value, decimals); }
+    String(double value, unsigned int decimals = 2) { setFloat(value, decimals); }
+
+    void setFloat(double value, unsigned int decimals) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+        str = buf;
+    }
+
+    const char* c_str() const { return str.c_str(); }
+    unsigned int length() const { return (unsigned int)str.size(); }
+    bool reserve(unsigned int size) { str.reserve(size); return true; }
+    bool concat(const char* cstr) { str += cstr; return true; }
+    bool concat(const char* cstr, unsigned int len) { str.append(cstr, len); return true; }
+    bool concat(char c) { str += c; return true; }
+
+    String& operator+=(const String& rhs) { str += rhs.str; return *this; }
+    String& operator+=(const char* rhs) { str += rhs; return *this; }
+    String& operator+=(char rhs) { str += rhs; return *this; }
+
+    bool operator==(const String& rhs) const { return str == rhs.str; }
+    bool operator==(const char* rhs) const { return str == rhs; }
+    char operator[](unsigned int index) const { return str[index]; }
+
+    int toInt() const { return atoi(str.c_str()); }
+    float toFloat() const { return (float)atof(str.c_str()); }
+    bool isEmpty() const { return str.empty(); }
+    int indexOf(char c) const {
+        size_t pos = str.find(c);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int from) const { return String(str.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const { return String(str.substr(from, to - from)); }
+};
+
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String& lhs, const String& rhs) {
+    String result(lhs);
+    result += rhs;
+    return StringSumHelper(result);
+}
+
+inline StringSumHelper operator+(const String& lhs, const char* rhs) {
+    String result(lhs);
+    result += rhs;
+    return StringSumHelper(result);
+}
+
+inline StringSumHelper operator+(const char* lhs, const String& rhs) {
+    String result(lhs);
+    result += rhs;
+    return StringSumHelper(result);
+}
+
+// ============ SERIAL ============
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* data, size_t len) { return fwrite(data, 1, len, stdout); }
+
+    size_t print(const char* s) { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T& v) { size_t n = print(v); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n < 0 ? 0 : n;
+    }
+
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() { fflush(stdout); }
+};
+
+inline HardwareSerial Serial;
+
+// ============ ESP ============
+// Không có heap ESP32 trên PC: trả về 0 để báo cáo bộ nhớ vẫn chạy được
+
+struct HostEsp {
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getMinFreeHeap() { return 0; }
+    uint32_t getMaxAllocHeap() { return 0; }
+};
+
+inline HostEsp ESP;
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef BMS_ADMISSION_H
+#define BMS_ADMISSION_H
+
+#include <Arduino.h>
+#include "bms_memory.h"
+
+/*
+ * BMS Admission - Kiểm soát request HTTP để flood không lấn chu kỳ lấy mẫu
+ * - loop() chỉ có 1 luồng: request đang phục vụ chặn readAndUpdateBMS(). Mỗi
+ *   chu kỳ lấy mẫu ("tick", onTick() sau mỗi mẫu) có ngân sách CPU
+ *   ADMISSION_CPU_PERCENT % cho HTTP và tối đa ADMISSION_MAX_PER_TICK kết nối
+ * - Request được phục vụ khi (theo thứ tự):
+ *   1. Vừa ngân sách: thời gian dự trữ của route (EWMA thời gian đo được +
+ *      2 lần độ lệch trung bình, như RTO của TCP) còn vừa phần ngân sách và
+ *      kết thúc trước mẫu kế tiếp. Request đầu tiên
+ *      của tick luôn được xét (không bỏ đói route nặng), route nặng hơn cả chu
+ *      kỳ chỉ chạy ở đầu tick. Không vừa => 503
+ *   2. Token bucket theo IP (ADMISSION_CLIENTS IP gần nhất, thay IP cũ nhất) => 429
+ *   3. Token bucket toàn server => 503
+ *   Mỗi route có giá token riêng (trang / nặng hơn /bms)
+ * - Hết ngân sách / số kết nối của tick, hoặc mẫu kế tiếp còn <= ADMISSION_TAIL_US:
+ *   accepting() = false, loop() không gọi handleClient() tới mẫu sau; kết nối chờ
+ *   trong backlog listen của WiFiServer (cố định) và được phục vụ ở đầu tick mới,
+ *   handler không bao giờ chờ mẫu => client đơn lẻ tới cuối tick không bị 503 oan,
+ *   số kết nối đồng thời bị chặn trên, phần dư bị TCP từ chối
+ * - Thời gian gửi 429/503 và các chunk /export gửi sau handler cũng trừ vào ngân sách
+ * - Mọi thời điểm truyền vào (µs): dùng được với đồng hồ thật trên PC
+ */
+
+#ifndef ADMISSION_CPU_PERCENT
+#define ADMISSION_CPU_PERCENT   40     // % mỗi chu kỳ lấy mẫu cho HTTP
+#endif
+#ifndef ADMISSION_MAX_PER_TICK
+#define ADMISSION_MAX_PER_TICK  8      // Kết nối xử lý tối đa mỗi tick (gồm cả bị từ chối)
+#endif
+#ifndef ADMISSION_CLIENT_RATE
+#define ADMISSION_CLIENT_RATE   4      // Token/s mỗi IP
+#endif
+#ifndef ADMISSION_CLIENT_BURST
+#define ADMISSION_CLIENT_BURST  12     // Đủ tải trang + /history + /bms liền nhau
+#endif
+#ifndef ADMISSION_GLOBAL_RATE
+#define ADMISSION_GLOBAL_RATE   20
+#endif
+#ifndef ADMISSION_GLOBAL_BURST
+#define ADMISSION_GLOBAL_BURST  40
+#endif
+
+#define ADMISSION_CLIENTS       8
+#define ADMISSION_ROUTES        16
+#define ADMISSION_RETRY_AFTER_S 1
+#define ADMISSION_EWMA_SHIFT    3      // Ước lượng thời gian route: EWMA 1/8
+#define ADMISSION_DEV_SHIFT     2      // Độ lệch trung bình: EWMA 1/4
+#define ADMISSION_TAIL_US       20000  // Cuối tick không nhận kết nối mới (tối đa 1/4 chu kỳ)
+
+// Kết quả admit()
+#define ADMIT_OK            0
+#define ADMIT_CPU_BUDGET    1   // 503: hết ngân sách CPU của tick
+#define ADMIT_CLIENT_LIMIT  2   // 429: IP này vượt tốc độ
+#define ADMIT_GLOBAL_LIMIT  3   // 503: cả server vượt tốc độ
+#define ADMIT_VERDICTS      4
+
+class BMSAdmission {
+public:
+    struct Route {
+        const char* path;
+        uint8_t cost;             // Token mỗi request
+        uint32_t estimateUs;      // EWMA thời gian phục vụ
+        uint32_t deviationUs;     // EWMA |sai số ước lượng|
+        uint32_t maxUs;
+        uint32_t verdicts[ADMIT_VERDICTS];
+    };
+
+private:
+    struct TokenBucket {
+        uint32_t milliTokens;
+        unsigned long lastUs;
+    };
+
+    struct Client {
+        uint32_t ip;
+        unsigned long lastSeenUs;
+        TokenBucket bucket;
+        uint8_t used;
+    };
+
+    Route routes[ADMISSION_ROUTES];
+    uint8_t routeCount;
+    Client clients[ADMISSION_CLIENTS];
+    TokenBucket global;
+
+    // Tick hiện tại
+    unsigned long tickStartUs;
+    uint32_t tickPeriodUs;
+    uint32_t budgetUs;
+    uint32_t usedUs;
+    uint8_t handled;
+    bool deferred;
+
+    // Thống kê
+    uint32_t ticks;
+    uint32_t deferredTicks;       // Tick có kết nối phải chờ sang tick sau
+    uint32_t overBudgetTicks;     // Tick dùng quá ngân sách (request đầu / route nặng)
+    uint64_t totalHttpUs;
+    uint64_t totalPeriodUs;
+    uint32_t maxTickUs;
+
+    static void refill(TokenBucket& b, uint32_t rate, uint32_t burst, unsigned long nowUs) {
+        uint32_t elapsed = nowUs - b.lastUs;
+        uint32_t full = burst * 1000;
+        // Kẹp trước khi nhân: không tràn dù nghỉ lâu
+        uint32_t fillUs = full / rate * 1000;
+        uint32_t add = elapsed >= fillUs ? full : (uint32_t)((uint64_t)elapsed * rate / 1000);
+        b.milliTokens = min(full, b.milliTokens + add);
+        b.lastUs = nowUs;
+    }
+
+    static bool take(TokenBucket& b, uint32_t rate, uint32_t burst, uint8_t cost, unsigned long nowUs) {
+        refill(b, rate, burst, nowUs);
+        if (b.milliTokens < cost * 1000u) return false;
+        b.milliTokens -= cost * 1000u;
+        return true;
+    }
+
+    // IP đã biết, hoặc thay ô lâu không thấy nhất (bucket đầy)
+    Client& client(uint32_t ip, unsigned long nowUs) {
+        int oldest = 0;
+        for (int i = 0; i < ADMISSION_CLIENTS; i++) {
+            if (clients[i].used && clients[i].ip == ip) {
+                clients[i].lastSeenUs = nowUs;
+                return clients[i];
+            }
+            if (!clients[i].used) {
+                oldest = i;
+                break;
+            }
+            if (nowUs - clients[i].lastSeenUs > nowUs - clients[oldest].lastSeenUs) oldest = i;
+        }
+        Client& c = clients[oldest];
+        c.ip = ip;
+        c.used = 1;
+        c.lastSeenUs = nowUs;
+        c.bucket.milliTokens = ADMISSION_CLIENT_BURST * 1000;
+        c.bucket.lastUs = nowUs;
+        return c;
+    }
+
+    bool fitsTick(const Route& r, unsigned long nowUs) {
+        uint32_t inTick = nowUs - tickStartUs;
+        uint32_t reserveUs = r.estimateUs + 2 * r.deviationUs;
+        bool deadline = inTick + reserveUs <= tickPeriodUs || (usedUs == 0 && reserveUs > tickPeriodUs);
+        bool budget = usedUs == 0 || usedUs + reserveUs <= budgetUs;
+        return deadline && budget;
+    }
+
+    void closeTick() {
+        if (ticks == 0) return;
+        totalHttpUs += usedUs;
+        totalPeriodUs += tickPeriodUs;
+        if (usedUs > budgetUs) overBudgetTicks++;
+        if (usedUs > maxTickUs) maxTickUs = usedUs;
+        if (deferred) deferredTicks++;
+    }
+
+public:
+    BMSAdmission() {
+        routeCount = 0;
+        reset(0);
+    }
+
+    // Xoá thống kê và bucket (giữ route, ước lượng thời gian)
+    void reset(unsigned long nowUs) {
+        for (int i = 0; i < ADMISSION_CLIENTS; i++) clients[i].used = 0;
+        global.milliTokens = ADMISSION_GLOBAL_BURST * 1000;
+        global.lastUs = nowUs;
+        for (int r = 0; r < routeCount; r++) {
+            routes[r].maxUs = 0;
+            memset(routes[r].verdicts, 0, sizeof(routes[r].verdicts));
+        }
+        ticks = 0;
+        deferredTicks = 0;
+        overBudgetTicks = 0;
+        totalHttpUs = 0;
+        totalPeriodUs = 0;
+        maxTickUs = 0;
+        tickStartUs = nowUs;
+        tickPeriodUs = 100000;
+        budgetUs = tickPeriodUs * ADMISSION_CPU_PERCENT / 100;
+        usedUs = 0;
+        handled = 0;
+        deferred = false;
+    }
+
+    // Đăng ký route lúc setup; estimateUs = ước lượng ban đầu trước khi đo được
+    uint8_t addRoute(const char* path, uint8_t cost, uint32_t estimateUs) {
+        if (routeCount >= ADMISSION_ROUTES) return ADMISSION_ROUTES - 1;
+        Route& r = routes[routeCount];
+        r.path = path;
+        r.cost = cost;
+        r.estimateUs = estimateUs;
+        r.deviationUs = estimateUs / 4;
+        r.maxUs = 0;
+        memset(r.verdicts, 0, sizeof(r.verdicts));
+        return routeCount++;
+    }
+
+    // Sau mỗi mẫu: bắt đầu tick mới, periodUs = chu kỳ lấy mẫu hiện tại
+    void onTick(unsigned long nowUs, uint32_t periodUs) {
+        closeTick();
+        ticks++;
+        tickStartUs = nowUs;
+        tickPeriodUs = periodUs;
+        budgetUs = (uint64_t)periodUs * ADMISSION_CPU_PERCENT / 100;
+        usedUs = 0;
+        handled = 0;
+        deferred = false;
+    }
+
+    // loop() hỏi trước khi nhận kết nối mới (không chặn: kết nối chưa nhận thì nằm
+    // trong backlog, loop() lấy mẫu rồi phục vụ ở đầu tick mới)
+    bool accepting(unsigned long nowUs) {
+        uint32_t inTick = nowUs - tickStartUs;
+        uint32_t tailUs = min((uint32_t)ADMISSION_TAIL_US, tickPeriodUs / 4);
+        if (handled >= ADMISSION_MAX_PER_TICK || usedUs >= budgetUs) {
+            deferred = true;
+            return false;
+        }
+        return inTick + tailUs < tickPeriodUs;
+    }
+
+    // Quyết định cho 1 request đã đọc xong header
+    uint8_t admit(uint8_t route, uint32_t ip, unsigned long nowUs) {
+        Route& r = routes[route];
+        handled++;
+        if (!fitsTick(r, nowUs)) return ADMIT_CPU_BUDGET;
+        if (!take(client(ip, nowUs).bucket, ADMISSION_CLIENT_RATE, ADMISSION_CLIENT_BURST, r.cost, nowUs)) {
+            return ADMIT_CLIENT_LIMIT;
+        }
+        if (!take(global, ADMISSION_GLOBAL_RATE, ADMISSION_GLOBAL_BURST, r.cost, nowUs)) {
+            return ADMIT_GLOBAL_LIMIT;
+        }
+        return ADMIT_OK;
+    }
+
+    // Sau khi gửi xong (phục vụ hoặc từ chối): trừ ngân sách, cập nhật ước lượng
+    void finish(uint8_t route, uint8_t verdict, uint32_t elapsedUs) {
+        Route& r = routes[route];
+        usedUs += elapsedUs;
+        r.verdicts[verdict]++;
+        if (verdict != ADMIT_OK) return;
+        int32_t delta = (int32_t)(elapsedUs - r.estimateUs);
+        int32_t spread = (delta < 0 ? -delta : delta) - (int32_t)r.deviationUs;
+        r.estimateUs += delta >> ADMISSION_EWMA_SHIFT;
+        r.deviationUs += spread >> ADMISSION_DEV_SHIFT;
+        if (elapsedUs > r.maxUs) r.maxUs = elapsedUs;
+    }
+
+    // Thời gian gửi ngoài handler (body /export gửi dần trong loop()): chỉ trừ ngân sách
+    void charge(uint32_t elapsedUs) {
+        usedUs += elapsedUs;
+    }
+
+    static int statusCode(uint8_t verdict) {
+        return verdict == ADMIT_CLIENT_LIMIT ? 429 : verdict == ADMIT_OK ? 200 : 503;
+    }
+
+    static const char* verdictName(uint8_t verdict) {
+        switch (verdict) {
+            case ADMIT_OK:           return "ok";
+            case ADMIT_CPU_BUDGET:   return "busy: sampling budget exhausted";
+            case ADMIT_CLIENT_LIMIT: return "too many requests from this client";
+            default:                 return "busy: server request rate exceeded";
+        }
+    }
+
+    // "Admission: ..." + 1 dòng mỗi route (cho /info)
+    void printTo(BufferWriter& out) {
+        uint32_t totals[ADMIT_VERDICTS] = { 0 };
+        for (int r = 0; r < routeCount; r++) {
+            for (int v = 0; v < ADMIT_VERDICTS; v++) totals[v] += routes[r].verdicts[v];
+        }
+        out.printf("Admission: %lu served, %lu 429 (client), %lu 503 (rate), %lu 503 (cpu), "
+                   "%lu deferred / %lu over-budget of %lu ticks, HTTP CPU avg %.1f%% / max %.1f ms "
+                   "(budget %d%%)\n",
+                   (unsigned long)totals[ADMIT_OK], (unsigned long)totals[ADMIT_CLIENT_LIMIT],
+                   (unsigned long)totals[ADMIT_GLOBAL_LIMIT], (unsigned long)totals[ADMIT_CPU_BUDGET],
+                   (unsigned long)deferredTicks, (unsigned long)overBudgetTicks, (unsigned long)ticks,
+                   totalPeriodUs ? 100.0f * totalHttpUs / totalPeriodUs : 0.0f, maxTickUs / 1000.0f,
+                   ADMISSION_CPU_PERCENT);
+        for (int r = 0; r < routeCount; r++) {
+            const Route& e = routes[r];
+            out.printf("  [%s] cost %u, est %lu±%lu us / max %lu us, ok %lu, 429 %lu, 503 %lu\n",
+                       e.path, e.cost, (unsigned long)e.estimateUs, (unsigned long)e.deviationUs,
+                       (unsigned long)e.maxUs,
+                       (unsigned long)e.verdicts[ADMIT_OK], (unsigned long)e.verdicts[ADMIT_CLIENT_LIMIT],
+                       (unsigned long)(e.verdicts[ADMIT_GLOBAL_LIMIT] + e.verdicts[ADMIT_CPU_BUDGET]));
+        }
+    }
+
+    // Getters
+    int getRouteCount() { return routeCount; }
+    const Route& getRoute(int r) { return routes[r]; }
+    uint32_t getVerdictCount(uint8_t verdict) {
+        uint32_t n = 0;
+        for (int r = 0; r < routeCount; r++) n += routes[r].verdicts[verdict];
+        return n;
+    }
+    uint32_t getDeferredTicks() { return deferredTicks; }
+    uint32_t getOverBudgetTicks() { return overBudgetTicks; }
+    uint32_t getUsedUs() { return usedUs; }
+    uint32_t getBudgetUs() { return budgetUs; }
+};
+
+BMSAdmission admission;
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef BMS_AFE_H
+#define BMS_AFE_H
+
+#include <Arduino.h>
+#include "bms_data.h"
+#include "bms_sensors.h"
+#ifdef ESP32
+#include <Wire.h>
+#endif
+
+/*
+ * BMS AFE - Driver analog front end TI BQ76952 (3-16S) qua I2C (-DBMS_AFE_BQ76952)
+ * - Đọc bằng direct command: thanh ghi 16-bit little-endian, chip tự tăng
+ *   địa chỉ khi đọc block nên nhiều thanh ghi liền nhau = 1 transaction
+ * - Các thanh ghi cần đọc (cell theo Vcell Mode, CC2 current, TS1-TS3) được gom
+ *   thành ít block nhất: khoảng trống giữa 2 vùng rẻ hơn 1 transaction mới thì
+ *   đọc luôn phần ở giữa. 16S: 0x14-0x33 (cell) + 0x3A (CC2) + 0x70-0x75 (TS)
+ *   = 3 transaction thay vì 20 lần đọc từng thanh ghi
+ * - I2C CRC mode: mỗi byte dữ liệu kèm 1 byte CRC-8 (đa thức 0x07); sai CRC
+ *   thì bỏ cả lần đọc, giữ giá trị cũ và đếm lỗi
+ * - AfeBus tách phần I2C ra, trên PC dùng bus giả lập (bench/bench_afe.h)
+ */
+
+#define BQ76952_ADDRESS      0x08   // 7-bit
+#define BQ76952_CELL1        0x14   // Cell n: 0x14 + 2*(n-1), mV
+#define BQ76952_CC2_CURRENT  0x3A   // userA (mặc định mA)
+#define BQ76952_TS1          0x70   // TS1..TS3 liền nhau, 0.1 K
+
+#define AFE_MAX_CELLS        16
+#define AFE_TEMP_SENSORS     3
+#define AFE_MAX_SPANS        24     // Đủ cho trường hợp mỗi thanh ghi 1 transaction
+#define AFE_MAX_BLOCK        60     // Byte dữ liệu mỗi block (x2 kèm CRC, vừa buffer Wire 128)
+#define AFE_TXN_OVERHEAD     6      // Byte-time: địa chỉ W/R + thanh ghi + start/stop + driver ESP32
+
+#ifndef AFE_VCELL_MODE
+#define AFE_VCELL_MODE       ((1u << NUM_CELLS) - 1)   // Cell dùng tới (bit n = VC n+1)
+#endif
+#ifndef AFE_SDA_PIN
+#define AFE_SDA_PIN          21
+#endif
+#ifndef AFE_SCL_PIN
+#define AFE_SCL_PIN          22
+#endif
+#ifndef AFE_I2C_HZ
+#define AFE_I2C_HZ           400000
+#endif
+
+// CRC-8 đa thức 0x07, giá trị đầu 0 (BQ769x0 / BQ769x2)
+inline uint8_t afeCrc8(const uint8_t* data, size_t length, uint8_t crc = 0) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// ============ BUS ============
+
+class AfeBus {
+public:
+    virtual bool begin() = 0;
+    // Đọc block bắt đầu từ reg; raw = byte dữ liệu xen kẽ CRC (d0 c0 d1 c1 ...)
+    virtual bool read(uint8_t address, uint8_t reg, uint8_t* raw, size_t rawLength) = 0;
+};
+
+#ifdef ESP32
+class I2CAfeBus : public AfeBus {
+private:
+    TwoWire& wire;
+    int sda;
+    int scl;
+    uint32_t frequency;
+
+public:
+    I2CAfeBus(TwoWire& i2c, int sdaPin, int sclPin, uint32_t hz) : wire(i2c) {
+        sda = sdaPin;
+        scl = sclPin;
+        frequency = hz;
+    }
+
+    bool begin() override {
+        if (!wire.begin(sda, scl, frequency)) return false;
+        wire.setTimeOut(10);   // ms, bus treo không được chặn loop()
+        return true;
+    }
+
+    bool read(uint8_t address, uint8_t reg, uint8_t* raw, size_t rawLength) override {
+        wire.beginTransmission(address);
+        wire.write(reg);
+        if (wire.endTransmission(false) != 0) return false;   // Repeated start
+        if (wire.requestFrom((uint16_t)address, rawLength, true) != rawLength) return false;
+        for (size_t i = 0; i < rawLength; i++) {
+            raw[i] = wire.read();
+        }
+        return true;
+    }
+};
+#endif
+
+// ============ BQ76952 DRIVER ============
+
+class BQ76952Afe : public BMSSensorDriver {
+public:
+    struct Span {
+        uint8_t reg;
+        uint8_t length;   // Byte dữ liệu
+    };
+
+private:
+    AfeBus* bus;
+    uint16_t vcellMode;
+    int cellCount;
+
+    Span spans[AFE_MAX_SPANS];
+    int spanCount;
+    uint8_t image[0x80];                  // Ảnh thanh ghi direct command của lần đọc này
+    uint8_t raw[AFE_MAX_BLOCK * 2];
+
+    // Giá trị đã giải mã từ lần đọc thành công gần nhất
+    float cellVoltages[AFE_MAX_CELLS];
+    float current;
+    float temperatures[AFE_TEMP_SENSORS];
+
+    // Thống kê
+    uint32_t reads;
+    uint32_t busErrors;
+    uint32_t crcErrors;
+    uint32_t lastReadUs;
+    uint32_t maxReadUs;
+
+    // Thêm vùng [reg, reg + length), gộp với vùng trước nếu khoảng trống
+    // (2 byte trên dây mỗi byte dữ liệu) rẻ hơn overhead của 1 transaction
+    void addRegister(uint8_t reg, uint8_t length, bool burst) {
+        if (burst && spanCount > 0) {
+            Span& last = spans[spanCount - 1];
+            int end = last.reg + last.length;
+            int gap = reg - end;
+            if (gap >= 0 && 2 * gap <= AFE_TXN_OVERHEAD && reg + length - last.reg <= AFE_MAX_BLOCK) {
+                last.length = reg + length - last.reg;
+                return;
+            }
+        }
+        if (spanCount < AFE_MAX_SPANS) {
+            spans[spanCount].reg = reg;
+            spans[spanCount].length = length;
+            spanCount++;
+        }
+    }
+
+    // Byte đầu: CRC tính trên địa chỉ W, thanh ghi, địa chỉ R và dữ liệu;
+    // các byte sau: CRC chỉ tính trên chính byte đó
+    bool checkCrc(uint8_t reg, const uint8_t* data, uint8_t length) {
+        uint8_t header[3] = { (uint8_t)(BQ76952_ADDRESS << 1), reg, (uint8_t)((BQ76952_ADDRESS << 1) | 1) };
+        uint8_t crc = afeCrc8(header, 3);
+        for (int i = 0; i < length; i++) {
+            crc = afeCrc8(&data[2 * i], 1, i == 0 ? crc : 0);
+            if (crc != data[2 * i + 1]) return false;
+        }
+        return true;
+    }
+
+    int16_t reg16(uint8_t reg) {
+        return (int16_t)(image[reg] | (image[reg + 1] << 8));
+    }
+
+public:
+    BQ76952Afe(AfeBus* afeBus, uint16_t cellMask = AFE_VCELL_MODE, bool burst = true) {
+        bus = afeBus;
+        vcellMode = cellMask;
+        cellCount = 0;
+        spanCount = 0;
+        for (int vc = 0; vc < AFE_MAX_CELLS; vc++) {
+            if (vcellMode & (1u << vc)) {
+                addRegister(BQ76952_CELL1 + 2 * vc, 2, burst);
+                cellVoltages[cellCount++] = 0;
+            }
+        }
+        addRegister(BQ76952_CC2_CURRENT, 2, burst);
+        for (int t = 0; t < AFE_TEMP_SENSORS; t++) {
+            addRegister(BQ76952_TS1 + 2 * t, 2, burst);
+            temperatures[t] = 25.0;
+        }
+        memset(image, 0, sizeof(image));
+        current = 0;
+
+        reads = 0;
+        busErrors = 0;
+        crcErrors = 0;
+        lastReadUs = 0;
+        maxReadUs = 0;
+    }
+
+    void begin() override {
+        bool ok = bus->begin();
+        LOGI("%s BQ76952 AFE: %d cells, %d block reads per sample",
+             ok ? "✅" : "❌", cellCount, spanCount);
+    }
+
+    bool readAllSensors() override {
+        unsigned long start = micros();
+        for (int s = 0; s < spanCount; s++) {
+            const Span& span = spans[s];
+            if (!bus->read(BQ76952_ADDRESS, span.reg, raw, span.length * 2)) {
+                busErrors++;
+                return false;
+            }
+            if (!checkCrc(span.reg, raw, span.length)) {
+                crcErrors++;
+                return false;
+            }
+            for (int i = 0; i < span.length; i++) {
+                image[span.reg + i] = raw[2 * i];
+            }
+        }
+
+        // Mọi block đều hợp lệ mới cập nhật giá trị
+        int n = 0;
+        for (int vc = 0; vc < AFE_MAX_CELLS; vc++) {
+            if (vcellMode & (1u << vc)) {
+                cellVoltages[n++] = reg16(BQ76952_CELL1 + 2 * vc) / 1000.0f;
+            }
+        }
+        current = reg16(BQ76952_CC2_CURRENT) / 1000.0f;
+        for (int t = 0; t < AFE_TEMP_SENSORS; t++) {
+            temperatures[t] = reg16(BQ76952_TS1 + 2 * t) / 10.0f - 273.15f;
+        }
+
+        reads++;
+        lastReadUs = micros() - start;
+        if (lastReadUs > maxReadUs) maxReadUs = lastReadUs;
+        return true;
+    }
+
+    // Getters
+    int getCellCount() override { return cellCount; }
+
+    float getCellVoltage(int cellNum) override {
+        if (cellNum >= 1 && cellNum <= cellCount)
+            return cellVoltages[cellNum - 1];
+        return 0.0;
+    }
+
+    float getCurrent() override { return current; }
+
+    // Nóng nhất trong các thermistor (bảo vệ theo điểm nóng nhất)
+    float getTemperature() override {
+        float hottest = temperatures[0];
+        for (int t = 1; t < AFE_TEMP_SENSORS; t++) {
+            if (temperatures[t] > hottest) hottest = temperatures[t];
+        }
+        return hottest;
+    }
+
+    float getThermistor(int index) { return temperatures[index]; }
+
+    // TS1-TS3 đã được chip đổi sang nhiệt độ
+    void readThermistors(BMSTemperatureBank& bank) override {
+        for (int t = 0; t < AFE_TEMP_SENSORS; t++) {
+            bank.setCelsius(t, temperatures[t]);
+        }
+    }
+
+    float getPackVoltage() override {
+        float sum = 0;
+        for (int i = 0; i < cellCount; i++) sum += cellVoltages[i];
+        return sum;
+    }
+
+    int getSpanCount() { return spanCount; }
+    const Span& getSpan(int index) { return spans[index]; }
+    uint32_t getReadCount() { return reads; }
+    uint32_t getBusErrorCount() { return busErrors; }
+    uint32_t getCrcErrorCount() { return crcErrors; }
+    uint32_t getLastReadUs() { return lastReadUs; }
+    uint32_t getMaxReadUs() { return maxReadUs; }
+};
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef BMS_CAN_H
+#define BMS_CAN_H
+
+#include <Arduino.h>
+#include "bms_data.h"
+#if defined(ESP32) && defined(BMS_CAN_ENABLE)
+#include <driver/twai.h>
+#endif
+
+/*
+ * BMS CAN - Giao thức inverter kiểu Pylontech (CAN 500 kbps, ID 11 bit)
+ * - Encoder ghi thẳng payload 8 byte từ bmsData, không qua chuỗi trung gian
+ * - Scheduler gửi mỗi frame theo chu kỳ riêng, lệch pha để không dồn bus;
+ *   hạn kế tiếp = hạn cũ + chu kỳ (không trôi), đo độ trễ so với hạn
+ * - Truyền qua TWAI của ESP32 khi build với -DBMS_CAN_ENABLE
+ *   (cần transceiver, ví dụ SN65HVD230 trên CAN_TX_PIN / CAN_RX_PIN)
+ *
+ * Frame (little-endian):
+ *   0x351 charge V limit (0.1V) | charge I limit (0.1A) | discharge I limit (0.1A) | discharge V limit (0.1V)
+ *   0x355 SOC (%) | SOH (%)
+ *   0x356 pack V (0.01V) | current (0.1A, i16) | nhiệt độ (0.1°C, i16)
+ *   0x359 protection[2] | warning[2] | số module | 'P' 'N'
+ *   0x35C cờ yêu cầu (bit7 cho phép sạc, bit6 cho phép xả, bit5 force charge);
+ *         mất liên lạc với AFE (commsFaultAlarm) hoặc mọi kênh nhiệt độ lỗi (thermalLossAlarm):
+ *         không cho sạc / xả, 0x359 báo lỗi hệ thống
+ *   0x35E tên hãng (8 ký tự ASCII)
+ */
+
+#ifndef CAN_TX_PIN
+#define CAN_TX_PIN 5
+#endif
+#ifndef CAN_RX_PIN
+#define CAN_RX_PIN 4
+#endif
+
+// Giới hạn gửi cho inverter
+#define CAN_CHARGE_VOLTAGE     (CELL_FULL_VOLTAGE * NUM_CELLS)   // V
+#define CAN_DISCHARGE_VOLTAGE  (CELL_UV_THRESHOLD * NUM_CELLS)   // V
+#define CAN_MAX_CHARGE_CURRENT (BATTERY_CAPACITY * 0.5)          // A (0.5C)
+#define CAN_MAX_DISCHARGE_CURRENT PACK_OC_THRESHOLD              // A
+#define CAN_TAPER_SOC          95.0   // Trên mức này giảm dần dòng sạc
+#define CAN_FORCE_CHARGE_SOC   5.0    // Dưới mức này yêu cầu inverter sạc
+
+// Ngưỡng cảnh báo (trước khi tới ngưỡng alarm)
+#define CAN_WARN_MARGIN_V      0.05   // V mỗi cell
+#define CAN_WARN_MARGIN_T      5.0    // °C
+#define CAN_WARN_CURRENT_RATIO 0.8
+
+#define CAN_MANUFACTURER       "PYLON   "
+#define CAN_FRAME_COUNT        6
+
+struct CANFrame {
+    uint32_t id;
+    uint8_t length;
+    uint8_t data[8];
+};
+
+// ============ ENCODER ============
+
+class PylonCANEncoder {
+private:
+    static void put16(uint8_t* p, int value) {
+        p[0] = value & 0xFF;
+        p[1] = (value >> 8) & 0xFF;
+    }
+
+    static int scale(float value, float factor, long low, long high) {
+        long scaled = lroundf(value * factor);
+        return (int)constrain(scaled, low, high);
+    }
+
+    static void begin(CANFrame& frame, uint32_t id, uint8_t length) {
+        frame.id = id;
+        frame.length = length;
+        memset(frame.data, 0, sizeof(frame.data));
+    }
+
+    static void cellRange(const BMSData& data, float& minV, float& maxV) {
+        minV = data.cellVoltages[0];
+        maxV = data.cellVoltages[0];
+        for (int i = 1; i < NUM_CELLS; i++) {
+            if (data.cellVoltages[i] < minV) minV = data.cellVoltages[i];
+            if (data.cellVoltages[i] > maxV) maxV = data.cellVoltages[i];
+        }
+    }
+
+    static bool chargeAllowed(const BMSData& data) {
+        return !data.overVoltageAlarm && !data.overTempAlarm && !data.underTempAlarm &&
+               !data.shortCircuitAlarm && !data.commsFaultAlarm && !data.thermalLossAlarm &&
+               !(data.overCurrentAlarm && data.current > 0);
+    }
+
+    static bool dischargeAllowed(const BMSData& data) {
+        return !data.underVoltageAlarm && !data.overTempAlarm &&
+               !data.shortCircuitAlarm && !data.commsFaultAlarm && !data.thermalLossAlarm &&
+               !(data.overCurrentAlarm && data.current < 0);
+    }
+
+public:
+    // 0x351: giới hạn sạc/xả
+    static void encodeLimits(const BMSData& data, CANFrame& frame) {
+        begin(frame, 0x351, 8);
+        float chargeCurrent = chargeAllowed(data) ? CAN_MAX_CHARGE_CURRENT : 0;
+        if (data.soc > CAN_TAPER_SOC) {
+            // Giảm tuyến tính còn 10% khi SOC = 100%
+            float ratio = 1.0f - 0.9f * (data.soc - CAN_TAPER_SOC) / (100.0f - CAN_TAPER_SOC);
+            chargeCurrent *= constrain(ratio, 0.1f, 1.0f);
+        }
+        float dischargeCurrent = dischargeAllowed(data) ? CAN_MAX_DISCHARGE_CURRENT : 0;
+
+        put16(frame.data + 0, scale(CAN_CHARGE_VOLTAGE, 10, 0, 65535));
+        put16(frame.data + 2, scale(chargeCurrent, 10, 0, 32767));
+        put16(frame.data + 4, scale(dischargeCurrent, 10, 0, 32767));
+        put16(frame.data + 6, scale(CAN_DISCHARGE_VOLTAGE, 10, 0, 65535));
+    }
+
+    // 0x355: SOC / SOH
+    static void encodeSOC(const BMSData& data, CANFrame& frame) {
+        begin(frame, 0x355, 4);
+        put16(frame.data + 0, scale(data.soc, 1, 0, 100));
+        put16(frame.data + 2, scale(data.soh, 1, 0, 100));
+    }
+
+    // 0x356: điện áp / dòng / nhiệt độ pack
+    static void encodeMeasurements(const BMSData& data, CANFrame& frame) {
+        begin(frame, 0x356, 6);
+        put16(frame.data + 0, scale(data.packVoltage, 100, 0, 32767));
+        put16(frame.data + 2, scale(data.current, 10, -32768, 32767));
+        put16(frame.data + 4, scale(data.packTemp, 10, -32768, 32767));
+    }
+
+    // 0x359: protection (byte 0-1) và warning (byte 2-3)
+    static void encodeAlarms(const BMSData& data, CANFrame& frame) {
+        begin(frame, 0x359, 7);
+        float minV, maxV;
+        cellRange(data, minV, maxV);
+        bool charging = data.current > 0;
+
+        uint8_t* p = frame.data;
+        if (data.overVoltageAlarm)                 p[0] |= 1 << 1;
+        if (data.underVoltageAlarm)                p[0] |= 1 << 2;
+        if (data.overTempAlarm)                    p[0] |= 1 << 3;
+        if (data.underTempAlarm)                   p[0] |= 1 << 4;
+        if (data.overCurrentAlarm && !charging)    p[0] |= 1 << 7;
+        if (data.overCurrentAlarm && charging)     p[1] |= 1 << 0;
+        if (data.shortCircuitAlarm || data.commsFaultAlarm ||
+            data.thermalLossAlarm)                 p[1] |= 1 << 3;
+
+        float currentWarn = PACK_OC_THRESHOLD * CAN_WARN_CURRENT_RATIO;
+        if (maxV > CELL_OV_THRESHOLD - CAN_WARN_MARGIN_V)       p[2] |= 1 << 1;
+        if (minV < CELL_UV_THRESHOLD + CAN_WARN_MARGIN_V)       p[2] |= 1 << 2;
+        if (data.packTemp > PACK_OT_THRESHOLD - CAN_WARN_MARGIN_T) p[2] |= 1 << 3;
+        if (!charging && -data.current > currentWarn)           p[2] |= 1 << 7;
+        if (charging && data.current > currentWarn)             p[3] |= 1 << 0;
+
+        p[4] = 1;    // Số module
+        p[5] = 'P';
+        p[6] = 'N';
+    }
+
+    // 0x35C: cờ yêu cầu
+    static void encodeRequest(const BMSData& data, CANFrame& frame) {
+        begin(frame, 0x35C, 2);
+        if (chargeAllowed(data))    frame.data[0] |= 1 << 7;
+        if (dischargeAllowed(data)) frame.data[0] |= 1 << 6;
+        if (data.soc < CAN_FORCE_CHARGE_SOC && chargeAllowed(data)) frame.data[0] |= 1 << 5;
+    }
+
+    // 0x35E: tên hãng
+    static void encodeManufacturer(const BMSData&, CANFrame& frame) {
+        begin(frame, 0x35E, 8);
+        memcpy(frame.data, CAN_MANUFACTURER, 8);
+    }
+};
+
+// ============ SCHEDULER ============
+
+class CANScheduler {
+public:
+    typedef void (*Encoder)(const BMSData&, CANFrame&);
+
+    struct Entry {
+        uint32_t id;
+        Encoder encode;
+        unsigned long periodUs;
+        unsigned long nextDueUs;
+        // Thống kê độ trễ so với hạn (µs)
+        uint32_t sent;
+        uint32_t maxLateUs;
+        unsigned long long totalLateUs;
+    };
+
+private:
+    Entry entries[CAN_FRAME_COUNT];
+    int count;
+    uint32_t failed;
+
+    void add(uint32_t id, Encoder encode, unsigned long periodMs, unsigned long phaseMs,
+             unsigned long nowUs) {
+        Entry& e = entries[count++];
+        e.id = id;
+        e.encode = encode;
+        e.periodUs = periodMs * 1000UL;
+        e.nextDueUs = nowUs + phaseMs * 1000UL;
+        e.sent = 0;
+        e.maxLateUs = 0;
+        e.totalLateUs = 0;
+    }
+
+public:
+    CANScheduler() {
+        count = 0;
+        failed = 0;
+    }
+
+    // Chu kỳ 1s cho dữ liệu, 5s cho tên hãng; lệch pha 20ms giữa các frame
+    void begin(unsigned long nowUs) {
+        count = 0;
+        add(0x351, PylonCANEncoder::encodeLimits,       1000, 0,   nowUs);
+        add(0x355, PylonCANEncoder::encodeSOC,          1000, 20,  nowUs);
+        add(0x356, PylonCANEncoder::encodeMeasurements, 1000, 40,  nowUs);
+        add(0x359, PylonCANEncoder::encodeAlarms,       1000, 60,  nowUs);
+        add(0x35C, PylonCANEncoder::encodeRequest,      1000, 80,  nowUs);
+        add(0x35E, PylonCANEncoder::encodeManufacturer, 5000, 100, nowUs);
+    }
+
+    // Gửi các frame đã tới hạn; send(frame) trả về false nếu không gửi được
+    template <typename Send>
+    int poll(const BMSData& data, unsigned long nowUs, Send send) {
+        int sentCount = 0;
+        for (int i = 0; i < count; i++) {
+            Entry& e = entries[i];
+            long late = (long)(nowUs - e.nextDueUs);
+            if (late < 0) continue;
+
+            CANFrame frame;
+            e.encode(data, frame);
+            if (send(frame)) {
+                sentCount++;
+            } else {
+                failed++;
+            }
+
+            e.sent++;
+            e.totalLateUs += late;
+            if ((uint32_t)late > e.maxLateUs) e.maxLateUs = late;
+
+            // Giữ nhịp cố định; trễ quá 1 chu kỳ thì bắt nhịp lại từ bây giờ
+            e.nextDueUs += e.periodUs;
+            if ((long)(nowUs - e.nextDueUs) >= 0) {
+                e.nextDueUs = nowUs + e.periodUs;
+            }
+        }
+        return sentCount;
+    }
+
+    // Thời gian (ms) tới hạn gần nhất, để loop() không ngủ quá hạn
+    unsigned long msUntilNext(unsigned long nowUs) {
+        if (count == 0) return (unsigned long)-1;
+        long nearest = (long)(entries[0].nextDueUs - nowUs);
+        for (int i = 1; i < count; i++) {
+            long remaining = (long)(entries[i].nextDueUs - nowUs);
+            if (remaining < nearest) nearest = remaining;
+        }
+        if (nearest <= 0) return 0;
+        return (unsigned long)nearest / 1000;
+    }
+
+    // Getters
+    int getCount() { return count; }
+    const Entry& getEntry(int i) { return entries[i]; }
+    uint32_t getFailedCount() { return failed; }
+};
+
+// ============ TWAI (ESP32) ============
+
+#if defined(ESP32) && defined(BMS_CAN_ENABLE)
+class BMSCanBus {
+private:
+    bool started;
+    uint32_t transmitted;
+    uint32_t busOffCount;
+
+public:
+    BMSCanBus() {
+        started = false;
+        transmitted = 0;
+        busOffCount = 0;
+    }
+
+    bool begin() {
+        twai_general_config_t general = TWAI_GENERAL_CONFIG_DEFAULT(
+            (gpio_num_t)CAN_TX_PIN, (gpio_num_t)CAN_RX_PIN, TWAI_MODE_NORMAL);
+        general.tx_queue_len = CAN_FRAME_COUNT * 2;
+        twai_timing_config_t timing = TWAI_TIMING_CONFIG_500KBITS();
+        twai_filter_config_t filter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+
+        if (twai_driver_install(&general, &timing, &filter) != ESP_OK || twai_start() != ESP_OK) {
+            LOGE("❌ CAN (TWAI) init failed");
+            return false;
+        }
+        started = true;
+        LOGI("✅ CAN 500 kbps on TX=%d RX=%d", CAN_TX_PIN, CAN_RX_PIN);
+        return true;
+    }
+
+    // Đưa frame vào hàng đợi TX, không chờ
+    bool transmit(const CANFrame& frame) {
+        if (!started) return false;
+        twai_message_t message = {};
+        message.identifier = frame.id;
+        message.data_length_code = frame.length;
+        memcpy(message.data, frame.data, frame.length);
+        if (twai_transmit(&message, 0) != ESP_OK) return false;
+        transmitted++;
+        return true;
+    }
+
+    // Gọi định kỳ: tự phục hồi khi bus-off (không có inverter / dây lỏng)
+    void update() {
+        if (!started) return;
+        twai_status_info_t status;
+        if (twai_get_status_info(&status) != ESP_OK) return;
+        if (status.state == TWAI_STATE_BUS_OFF) {
+            busOffCount++;
+            twai_initiate_recovery();
+        } else if (status.state == TWAI_STATE_STOPPED) {
+            twai_start();
+        }
+    }
+
+    // Getters
+    uint32_t getTransmittedCount() { return transmitted; }
+    uint32_t getBusOffCount() { return busOffCount; }
+};
+#endif
+
+#endif
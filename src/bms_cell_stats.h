@@ -0,0 +1,219 @@
+#ifndef BMS_CELL_STATS_H
+#define BMS_CELL_STATS_H
+
+#include <Arduino.h>
+#include "bms_chemistry.h"
+#include "bms_memory.h"
+
+/*
+ * BMS Cell Stats - Thống kê chạy cho từng cell, phát hiện cell bất thường
+ * - Đại lượng theo dõi: độ lệch d = V_cell - V_trung bình pack (mV, trung bình
+ *   bỏ cell cao nhất và thấp nhất). Dòng tải, nhiệt độ, SOC chung của pack bị
+ *   trừ đi, chỉ còn khác biệt riêng của cell
+ * - Mỗi mẫu O(1) cho mỗi cell, không lưu mẫu cũ:
+ *   + Welford mean / variance của d. Đếm tới CELL_STATS_WINDOW rồi giữ nguyên
+ *     => quên dần theo hàm mũ (cửa sổ hiệu dụng ~WINDOW mẫu), mean / sigma là
+ *     "bình thường" dài hạn của cell
+ *   + EWMA của d (α = CELL_STATS_EWMA_ALPHA): giá trị ngắn hạn đã lọc nhiễu ADC
+ *   + drift = EWMA - mean: cell đang trôi khỏi mức bình thường của chính nó
+ *   + Tự xả: khi pack nghỉ (|I| < CELL_STATS_IDLE_CURRENT), chờ điện áp hồi phục
+ *     CELL_STATS_IDLE_SETTLE_MS rồi cứ mỗi CELL_STATS_IDLE_PERIOD_MS đo ΔEWMA / giờ
+ *     (mV/h so với pack, âm = tự xả nhanh hơn các cell khác), trộn 50/50 với
+ *     ước lượng trước. Chỉ tốn O(N) ở đầu / cuối mỗi chu kỳ đo
+ * - Điểm bất thường = max của 3 tỉ số (1.0 = chạm ngưỡng):
+ *     |EWMA| / CELL_OUTLIER_DEV_MV                (lệch tuyệt đối, < ngưỡng cân bằng)
+ *     |drift| / (CELL_OUTLIER_Z * sigma)          (sau CELL_STATS_WARMUP mẫu)
+ *     -tự xả / CELL_SELF_DISCHARGE_MV_H
+ *   Bật cờ khi điểm >= 1, tắt khi < CELL_OUTLIER_CLEAR (trễ, không chập chờn).
+ *   Cell yếu / rò được báo trước khi chạm UV/OV của cả pack
+ * - SoA như CellEstimatorBank: vòng cập nhật không rẽ nhánh, mask cờ 32 bit
+ */
+
+#define CELL_STATS_WINDOW         4096       // Số mẫu Welford trước khi chuyển sang quên dần
+#define CELL_STATS_WARMUP         256        // Mẫu tối thiểu trước khi dùng tiêu chí drift
+#define CELL_STATS_EWMA_ALPHA     (1.0f / 32)
+#define CELL_STATS_SIGMA_MIN_MV   1.0f       // Sàn sigma (ADC mô phỏng không có nhiễu)
+#define CELL_STATS_IDLE_CURRENT   0.1f       // A, như updateChargingStatus()
+#define CELL_STATS_IDLE_SETTLE_MS 600000UL   // 10 phút chờ điện áp hồi phục sau tải
+#define CELL_STATS_IDLE_PERIOD_MS 3600000UL  // Mỗi chu kỳ đo tự xả
+
+#define CELL_OUTLIER_DEV_MV       (BatteryChemistry::balanceDiff * 400)   // 40% ngưỡng cân bằng
+#define CELL_OUTLIER_Z            4.0f
+#define CELL_SELF_DISCHARGE_MV_H  2.0f
+#define CELL_OUTLIER_CLEAR        0.75f
+
+template <int N>
+class CellStatsBank {
+    static_assert(N <= 32, "outlier mask is 32 bit");
+
+private:
+    // SoA: chỉ số i = cell i+1, đơn vị mV
+    float deviation[N];      // Mẫu gần nhất
+    float mean[N];           // Welford
+    float variance[N];
+    float ewma[N];
+    float selfDischarge[N];  // mV/h so với pack
+    float idleAnchor[N];     // EWMA lúc bắt đầu chu kỳ đo tự xả
+
+    uint32_t samples;
+    uint32_t weight;         // Số mẫu Welford, kẹp ở CELL_STATS_WINDOW
+    uint32_t outlierMask;
+
+    // Theo dõi thời gian nghỉ
+    unsigned long idleSince;     // 0 = đang có tải
+    unsigned long anchorTime;    // 0 = chưa bắt đầu chu kỳ đo
+    uint16_t selfDischargePeriods;
+
+    void anchor(unsigned long now) {
+        for (int i = 0; i < N; i++) idleAnchor[i] = ewma[i];
+        anchorTime = now;
+    }
+
+    // Kết thúc 1 chu kỳ đo: tốc độ thay đổi độ lệch trong lúc nghỉ
+    void closePeriod(unsigned long now) {
+        float hours = (now - anchorTime) / 3600000.0f;
+        float gain = selfDischargePeriods ? 0.5f : 1.0f;
+        for (int i = 0; i < N; i++) {
+            float rate = (ewma[i] - idleAnchor[i]) / hours;
+            selfDischarge[i] += gain * (rate - selfDischarge[i]);
+        }
+        if (selfDischargePeriods < 0xFFFF) selfDischargePeriods++;
+    }
+
+    void trackIdle(float current, unsigned long now) {
+        if (fabsf(current) >= CELL_STATS_IDLE_CURRENT) {
+            idleSince = 0;
+            anchorTime = 0;   // Chu kỳ dở dang bị bỏ (tải làm lệch điện áp)
+            return;
+        }
+        if (idleSince == 0) idleSince = now ? now : 1;
+        if (anchorTime == 0) {
+            if (now - idleSince >= CELL_STATS_IDLE_SETTLE_MS) anchor(now);
+        } else if (now - anchorTime >= CELL_STATS_IDLE_PERIOD_MS) {
+            closePeriod(now);
+            anchor(now);
+        }
+    }
+
+public:
+    CellStatsBank() {
+        reset();
+    }
+
+    void reset() {
+        for (int i = 0; i < N; i++) {
+            deviation[i] = 0;
+            mean[i] = 0;
+            variance[i] = 0;
+            ewma[i] = 0;
+            selfDischarge[i] = 0;
+            idleAnchor[i] = 0;
+        }
+        samples = 0;
+        weight = 0;
+        outlierMask = 0;
+        idleSince = 0;
+        anchorTime = 0;
+        selfDischargePeriods = 0;
+    }
+
+    // Gọi mỗi mẫu (cellVoltages theo V)
+    void update(const float* cellVoltages, float current, unsigned long now) {
+        // Trung bình bỏ cell cao nhất / thấp nhất: 1 cell hỏng không kéo lệch
+        // độ lệch của mọi cell còn lại (4S = trung vị)
+        float sum = 0, lo = cellVoltages[0], hi = cellVoltages[0];
+        for (int i = 0; i < N; i++) {
+            sum += cellVoltages[i];
+            lo = cellVoltages[i] < lo ? cellVoltages[i] : lo;
+            hi = cellVoltages[i] > hi ? cellVoltages[i] : hi;
+        }
+        float average = N > 3 ? (sum - lo - hi) / (N - 2) : sum / N;
+
+        if (samples == 0) {
+            for (int i = 0; i < N; i++) {
+                deviation[i] = (cellVoltages[i] - average) * 1000.0f;
+                mean[i] = deviation[i];
+                ewma[i] = deviation[i];
+            }
+            weight = 1;
+        } else {
+            if (weight < CELL_STATS_WINDOW) weight++;
+            // Welford dạng variance: var = (1 - 1/n)(var + δ²/n), đúng bằng Welford
+            // khi n tăng dần, n kẹp ở WINDOW thì thành trung bình trượt hàm mũ
+            float k = 1.0f / weight;
+            float keep = 1.0f - k;
+            for (int i = 0; i < N; i++) {
+                float d = (cellVoltages[i] - average) * 1000.0f;
+                float delta = d - mean[i];
+                deviation[i] = d;
+                mean[i] += delta * k;
+                variance[i] = keep * (variance[i] + delta * delta * k);
+                ewma[i] += (d - ewma[i]) * CELL_STATS_EWMA_ALPHA;
+            }
+        }
+        samples++;
+
+        trackIdle(current, now);
+
+        // Cờ bất thường có trễ, so sánh bình phương (không sqrt / chia mỗi mẫu);
+        // điểm tính lại khi cần (getScore)
+        float driftGate = samples >= CELL_STATS_WARMUP ? 1.0f : 0.0f;
+        uint32_t mask = 0;
+        for (int i = 0; i < N; i++) {
+            float threshold = (outlierMask >> i) & 1 ? CELL_OUTLIER_CLEAR : 1.0f;
+            float drift = (ewma[i] - mean[i]) * driftGate;
+            float driftLimit = threshold * CELL_OUTLIER_Z;
+            float spread = variance[i] > CELL_STATS_SIGMA_MIN_MV * CELL_STATS_SIGMA_MIN_MV
+                               ? variance[i] : CELL_STATS_SIGMA_MIN_MV * CELL_STATS_SIGMA_MIN_MV;
+            uint32_t flagged = (fabsf(ewma[i]) >= threshold * CELL_OUTLIER_DEV_MV) |
+                               (drift * drift >= driftLimit * driftLimit * spread) |
+                               (-selfDischarge[i] >= threshold * CELL_SELF_DISCHARGE_MV_H);
+            mask |= flagged << i;
+        }
+        outlierMask = mask;
+    }
+
+    // {"samples":..,"outlierMask":..,"cells":[...]} cho /cells
+    void writeJson(BufferWriter& out, unsigned long now) {
+        out.printf("{\"samples\":%lu,\"window\":%d,\"outlierMask\":%lu,\"worstCell\":%d,"
+                   "\"idle\":{\"seconds\":%lu,\"measuring\":%s,\"periods\":%u},\"cells\":[",
+                   (unsigned long)samples, CELL_STATS_WINDOW, (unsigned long)outlierMask,
+                   getWorstCell() + 1, idleSince ? (now - idleSince) / 1000 : 0UL,
+                   anchorTime ? "true" : "false", selfDischargePeriods);
+        for (int i = 0; i < N; i++) {
+            out.printf("%s{\"cell\":%d,\"deviation\":%.1f,\"ewma\":%.1f,\"mean\":%.1f,\"sigma\":%.2f,"
+                       "\"drift\":%.1f,\"selfDischarge\":%.2f,\"score\":%.2f,\"outlier\":%s}",
+                       i ? "," : "", i + 1, deviation[i], ewma[i], mean[i], getSigma(i),
+                       ewma[i] - mean[i], selfDischarge[i], getScore(i),
+                       (outlierMask >> i) & 1 ? "true" : "false");
+        }
+        out.printf("]}");
+    }
+
+    // Getters (mV, mV/h)
+    uint32_t getSampleCount() { return samples; }
+    uint32_t getOutlierMask() { return outlierMask; }
+    bool isOutlier(int i) { return (outlierMask >> i) & 1; }
+    float getScore(int i) {
+        float sigma = fmaxf(getSigma(i), CELL_STATS_SIGMA_MIN_MV);
+        float s = fabsf(ewma[i]) / CELL_OUTLIER_DEV_MV;
+        if (samples >= CELL_STATS_WARMUP) s = fmaxf(s, fabsf(getDrift(i)) / (CELL_OUTLIER_Z * sigma));
+        return fmaxf(s, -selfDischarge[i] / CELL_SELF_DISCHARGE_MV_H);
+    }
+    int getWorstCell() {
+        int worst = 0;
+        for (int i = 1; i < N; i++) {
+            if (getScore(i) > getScore(worst)) worst = i;
+        }
+        return worst;
+    }
+    float getWorstScore() { return getScore(getWorstCell()); }
+    float getDeviation(int i) { return ewma[i]; }
+    float getMean(int i) { return mean[i]; }
+    float getSigma(int i) { return sqrtf(variance[i]); }
+    float getDrift(int i) { return ewma[i] - mean[i]; }
+    float getSelfDischarge(int i) { return selfDischarge[i]; }
+    uint16_t getSelfDischargePeriods() { return selfDischargePeriods; }
+};
+
+#endif
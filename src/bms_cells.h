@@ -0,0 +1,161 @@
+#ifndef BMS_CELLS_H
+#define BMS_CELLS_H
+
+#include <Arduino.h>
+#include "soc_estimator.h"
+
+/*
+ * BMS Cells - Ước lượng SOC / dung lượng cho từng cell
+ * - Cell nối tiếp cùng chịu 1 dòng: mỗi mẫu chỉ tính 1 lượng điện tích dq (µAh)
+ *   từ bộ đếm int64 của SOCEstimator (phần lẻ dưới 1 µAh giữ lại cho mẫu sau),
+ *   rồi cộng vào N cell, kẹp theo dung lượng riêng của từng cell
+ * - Structure-of-arrays: mỗi đại lượng là 1 mảng liền nhau, vòng cập nhật
+ *   không rẽ nhánh => compiler vector hoá được trên PC, trên ESP32 là vòng
+ *   int32 ngắn
+ * - SOC pack suy ra từ cell yếu nhất / mạnh nhất:
+ *   pack = min / (100 - max + min) * 100 (0% khi cell yếu nhất cạn, 100% khi cell mạnh nhất đầy)
+ * - Hiệu chỉnh OCV khi pin nghỉ: trộn 70/30 như pack, đồng thời ước lượng
+ *   dung lượng từng cell = điện tích ròng / ΔSOC(OCV) giữa 2 lần hiệu chỉnh
+ */
+
+#define CELL_UNITS_PER_UAH      (CHARGE_UNITS_PER_AH / 1000000)
+#define CELL_CAPACITY_MIN_DSOC  30.0    // % ΔSOC tối thiểu giữa 2 lần hiệu chỉnh để ước lượng dung lượng
+#define CELL_CAPACITY_GAIN      0.2     // Trọng số của ước lượng mới
+#define CELL_CAPACITY_MIN_RATIO 0.5     // Kẹp ước lượng theo dung lượng danh định
+#define CELL_CAPACITY_MAX_RATIO 1.2
+
+template <int N>
+class CellEstimatorBank {
+private:
+    // SoA: chỉ số i = cell i+1
+    int32_t chargeUah[N];        // Điện tích còn lại
+    int32_t capacityUah[N];      // Dung lượng ước lượng
+    float socScale[N];           // 100 / capacityUah (đổi điện tích ra %)
+    float soc[N];
+    float socAtCalibration[N];   // SOC theo OCV ở lần hiệu chỉnh trước
+
+    int32_t nominalUah;
+    int64_t lastNetUnits;        // SOCEstimator::getNetChargeUnits() lần trước
+    int64_t remainderUnits;      // Phần lẻ dưới 1 µAh
+    int64_t netSinceCalibration; // µAh, không kẹp
+    bool calibrated;
+
+    float minSoc;
+    float maxSoc;
+
+    void setCapacity(int i, int32_t uah) {
+        capacityUah[i] = uah;
+        socScale[i] = 100.0f / uah;
+    }
+
+    // Chỉ tính giá trị min/max (vector hoá được); vị trí cell tìm khi cần
+    void refreshSoc() {
+        for (int i = 0; i < N; i++) {
+            soc[i] = chargeUah[i] * socScale[i];
+        }
+        float lo = soc[0], hi = soc[0];
+        for (int i = 1; i < N; i++) {
+            lo = soc[i] < lo ? soc[i] : lo;
+            hi = soc[i] > hi ? soc[i] : hi;
+        }
+        minSoc = lo;
+        maxSoc = hi;
+    }
+
+public:
+    CellEstimatorBank(float capacityAh) {
+        nominalUah = (int32_t)lroundf(capacityAh * 1000000.0f);
+        for (int i = 0; i < N; i++) {
+            setCapacity(i, nominalUah);
+        }
+        reset(100.0);
+    }
+
+    // Mọi cell về cùng SOC, netUnits = SOCEstimator::getNetChargeUnits() hiện tại
+    void reset(float initialSoc, int64_t netUnits = 0) {
+        for (int i = 0; i < N; i++) {
+            chargeUah[i] = (int32_t)lroundf(initialSoc / 100.0f * capacityUah[i]);
+            socAtCalibration[i] = initialSoc;
+        }
+        lastNetUnits = netUnits;
+        remainderUnits = 0;
+        netSinceCalibration = 0;
+        calibrated = false;
+        refreshSoc();
+    }
+
+    // Gọi sau mỗi lần SOCEstimator cập nhật (1 mẫu hoặc cả batch)
+    void update(int64_t netUnits) {
+        int64_t delta = netUnits - lastNetUnits + remainderUnits;
+        lastNetUnits = netUnits;
+        int32_t dq = (int32_t)(delta / CELL_UNITS_PER_UAH);
+        remainderUnits = delta - (int64_t)dq * CELL_UNITS_PER_UAH;
+        netSinceCalibration += dq;
+
+        for (int i = 0; i < N; i++) {
+            int32_t c = chargeUah[i] + dq;
+            c = c < 0 ? 0 : c;
+            c = c > capacityUah[i] ? capacityUah[i] : c;
+            chargeUah[i] = c;
+        }
+        refreshSoc();
+    }
+
+    // Hiệu chỉnh OCV khi pin nghỉ đủ lâu (cùng điều kiện với pack)
+    void calibrate(const float* cellVoltages, SOCEstimator& ocv) {
+        int64_t net = netSinceCalibration < 0 ? -netSinceCalibration : netSinceCalibration;
+        for (int i = 0; i < N; i++) {
+            float socOcv = ocv.socFromOCV(cellVoltages[i]);
+
+            // Dung lượng = điện tích ròng / ΔSOC giữa 2 điểm nghỉ
+            float dSoc = fabsf(socOcv - socAtCalibration[i]);
+            if (calibrated && dSoc >= CELL_CAPACITY_MIN_DSOC) {
+                float estimate = net * 100.0f / dSoc;
+                estimate = constrain(estimate, nominalUah * (float)CELL_CAPACITY_MIN_RATIO,
+                                     nominalUah * (float)CELL_CAPACITY_MAX_RATIO);
+                float blended = capacityUah[i] * (1.0f - (float)CELL_CAPACITY_GAIN) +
+                                estimate * (float)CELL_CAPACITY_GAIN;
+                setCapacity(i, (int32_t)lroundf(blended));
+            }
+            socAtCalibration[i] = socOcv;
+
+            float calibratedSoc = soc[i] * 0.7f + socOcv * 0.3f;
+            chargeUah[i] = (int32_t)lroundf(calibratedSoc / 100.0f * capacityUah[i]);
+        }
+        netSinceCalibration = 0;
+        calibrated = true;
+        refreshSoc();
+    }
+
+    // SOC pack theo cell yếu nhất / mạnh nhất
+    float getPackSOC() {
+        float span = 100.0f - maxSoc + minSoc;
+        return span > 0 ? constrain(minSoc / span * 100.0f, 0.0f, 100.0f) : 0.0f;
+    }
+
+    // Getters
+    int getCellCount() { return N; }
+    float getSOC(int i) { return soc[i]; }
+    float getCapacity(int i) { return capacityUah[i] / 1000000.0f; }
+    float getRemaining(int i) { return chargeUah[i] / 1000000.0f; }
+    float getMinSOC() { return minSoc; }
+    float getMaxSOC() { return maxSoc; }
+    int getWeakestCell() {
+        int weakest = 0;
+        for (int i = 1; i < N; i++) {
+            if (soc[i] < soc[weakest]) weakest = i;
+        }
+        return weakest;
+    }
+
+    // Điện tích xả được tới khi cell yếu nhất cạn (Ah)
+    float getUsableCapacity() {
+        int32_t usable = chargeUah[0];
+        for (int i = 1; i < N; i++) {
+            if (chargeUah[i] < usable) usable = chargeUah[i];
+        }
+        return usable / 1000000.0f;
+    }
+};
+
+#endif
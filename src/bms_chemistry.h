@@ -0,0 +1,159 @@
+#ifndef BMS_CHEMISTRY_H
+#define BMS_CHEMISTRY_H
+
+#include <Arduino.h>
+
+/*
+ * BMS Chemistry - Thông số theo hoá học cell, chọn lúc biên dịch
+ * - Mỗi hoá học là 1 struct chỉ chứa hằng constexpr: bảng OCV, ngưỡng điện áp /
+ *   nhiệt độ, hiệu suất sạc, hệ số nhiệt độ
+ * - SOCEstimator là template theo struct này, protection / CAN / JSON / dashboard
+ *   đọc cùng nguồn => không còn trộn ngưỡng NMC với bảng OCV LiFePO4
+ * - Mọi giá trị là hằng lúc biên dịch: so sánh ngưỡng vẫn là so với hằng số
+ *   như khi dùng #define, không có biến toàn cục hay con trỏ bảng
+ *
+ * Chọn hoá học: mặc định LiFePO4, -DBMS_CHEMISTRY_NMC hoặc -DBMS_CHEMISTRY_LTO
+ */
+
+struct OcvPoint {
+    float soc;       // %
+    float voltage;   // V mỗi cell, lúc nghỉ
+};
+
+// ============ CHEMISTRIES ============
+
+struct ChemistryLFP {
+    static constexpr const char* name = "LiFePO4";
+    static constexpr int OCV_POINTS = 11;
+    static constexpr OcvPoint ocvTable[OCV_POINTS] = {
+        {0,   2.50}, {10,  2.90}, {20,  3.00}, {30,  3.10},
+        {40,  3.15}, {50,  3.20}, {60,  3.25}, {70,  3.28},
+        {80,  3.30}, {90,  3.35}, {100, 3.40}
+    };
+
+    static constexpr float fullVoltage = 3.40;     // Điện áp nghỉ khi đầy
+    static constexpr float emptyVoltage = 2.50;    // Điện áp nghỉ khi cạn
+    static constexpr float overVoltage = 3.65;     // Ngưỡng alarm OV
+    static constexpr float underVoltage = 2.80;    // Ngưỡng alarm UV
+    static constexpr float balanceDiff = 0.05;     // Lệch áp bắt đầu cân bằng
+
+    static constexpr float maxTemperature = 50.0;  // °C, kênh nóng nhất
+    static constexpr float minTemperature = -10.0; // °C, kênh lạnh nhất
+
+    static constexpr float chargeEfficiency = 0.97;
+    static constexpr float referenceTemperature = 25.0;
+    static constexpr float temperatureCoefficient = 0.6;   // %/°C
+    static constexpr float temperatureFactorMin = 0.8;
+    static constexpr float temperatureFactorMax = 1.2;
+};
+
+struct ChemistryNMC {
+    static constexpr const char* name = "NMC";
+    static constexpr int OCV_POINTS = 11;
+    static constexpr OcvPoint ocvTable[OCV_POINTS] = {
+        {0,   3.00}, {10,  3.45}, {20,  3.55}, {30,  3.62},
+        {40,  3.68}, {50,  3.74}, {60,  3.82}, {70,  3.90},
+        {80,  3.98}, {90,  4.08}, {100, 4.20}
+    };
+
+    static constexpr float fullVoltage = 4.20;
+    static constexpr float emptyVoltage = 3.00;
+    static constexpr float overVoltage = 4.25;
+    static constexpr float underVoltage = 3.00;
+    static constexpr float balanceDiff = 0.03;
+
+    static constexpr float maxTemperature = 55.0;
+    static constexpr float minTemperature = -20.0;
+
+    static constexpr float chargeEfficiency = 0.99;
+    static constexpr float referenceTemperature = 25.0;
+    static constexpr float temperatureCoefficient = 0.5;
+    static constexpr float temperatureFactorMin = 0.8;
+    static constexpr float temperatureFactorMax = 1.2;
+};
+
+struct ChemistryLTO {
+    static constexpr const char* name = "LTO";
+    static constexpr int OCV_POINTS = 11;
+    static constexpr OcvPoint ocvTable[OCV_POINTS] = {
+        {0,   1.70}, {10,  2.15}, {20,  2.22}, {30,  2.27},
+        {40,  2.31}, {50,  2.35}, {60,  2.39}, {70,  2.43},
+        {80,  2.48}, {90,  2.55}, {100, 2.70}
+    };
+
+    static constexpr float fullVoltage = 2.70;
+    static constexpr float emptyVoltage = 1.70;
+    static constexpr float overVoltage = 2.85;
+    static constexpr float underVoltage = 1.80;
+    static constexpr float balanceDiff = 0.04;
+
+    static constexpr float maxTemperature = 60.0;
+    static constexpr float minTemperature = -30.0;
+
+    static constexpr float chargeEfficiency = 0.995;
+    static constexpr float referenceTemperature = 25.0;
+    static constexpr float temperatureCoefficient = 0.3;
+    static constexpr float temperatureFactorMin = 0.9;
+    static constexpr float temperatureFactorMax = 1.1;
+};
+
+#if defined(BMS_CHEMISTRY_NMC)
+typedef ChemistryNMC BatteryChemistry;
+#elif defined(BMS_CHEMISTRY_LTO)
+typedef ChemistryLTO BatteryChemistry;
+#else
+typedef ChemistryLFP BatteryChemistry;
+#endif
+
+// ============ OCV ============
+
+// SOC (%) -> điện áp nghỉ, nội suy tuyến tính trong bảng
+template <typename Chemistry>
+constexpr float chemistryOcv(float soc) {
+    const OcvPoint* t = Chemistry::ocvTable;
+    if (soc <= t[0].soc) return t[0].voltage;
+    for (int i = 0; i < Chemistry::OCV_POINTS - 1; i++) {
+        if (soc <= t[i + 1].soc) {
+            return t[i].voltage + (t[i + 1].voltage - t[i].voltage) * (soc - t[i].soc) /
+                                  (t[i + 1].soc - t[i].soc);
+        }
+    }
+    return t[Chemistry::OCV_POINTS - 1].voltage;
+}
+
+// Điện áp nghỉ -> SOC (%), ngoài bảng thì kẹp về 0 / 100
+template <typename Chemistry>
+constexpr float chemistrySocFromOcv(float voltage) {
+    const OcvPoint* t = Chemistry::ocvTable;
+    if (voltage <= t[0].voltage) return t[0].soc;
+    for (int i = 0; i < Chemistry::OCV_POINTS - 1; i++) {
+        if (voltage <= t[i + 1].voltage) {
+            return t[i].soc + (t[i + 1].soc - t[i].soc) * (voltage - t[i].voltage) /
+                              (t[i + 1].voltage - t[i].voltage);
+        }
+    }
+    return t[Chemistry::OCV_POINTS - 1].soc;
+}
+
+// Kiểm tra lúc biên dịch: bảng 0..100% tăng dần, ngưỡng hợp lý
+template <typename Chemistry>
+constexpr bool chemistryValid() {
+    const OcvPoint* t = Chemistry::ocvTable;
+    if (t[0].soc != 0 || t[Chemistry::OCV_POINTS - 1].soc != 100) return false;
+    for (int i = 0; i < Chemistry::OCV_POINTS - 1; i++) {
+        if (t[i + 1].soc <= t[i].soc || t[i + 1].voltage <= t[i].voltage) return false;
+    }
+    return Chemistry::emptyVoltage == t[0].voltage &&
+           Chemistry::fullVoltage == t[Chemistry::OCV_POINTS - 1].voltage &&
+           Chemistry::underVoltage < Chemistry::overVoltage &&
+           Chemistry::fullVoltage < Chemistry::overVoltage &&
+           Chemistry::minTemperature < Chemistry::maxTemperature &&
+           Chemistry::chargeEfficiency > 0 && Chemistry::chargeEfficiency <= 1 &&
+           Chemistry::temperatureFactorMin <= 1 && Chemistry::temperatureFactorMax >= 1;
+}
+
+static_assert(chemistryValid<ChemistryLFP>(), "LiFePO4 chemistry table invalid");
+static_assert(chemistryValid<ChemistryNMC>(), "NMC chemistry table invalid");
+static_assert(chemistryValid<ChemistryLTO>(), "LTO chemistry table invalid");
+
+#endif
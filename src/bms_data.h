@@ -3,27 +3,35 @@
 
 #include <ArduinoJson.h>
 #include "soc_estimator.h"
+#include "bms_cells.h"
+#include "bms_cell_stats.h"
+#include "bms_memory.h"
+#include "bms_temperature.h"
+#include "bms_events.h"
 
 const int NUM_CELLS = 4;
 
-// Ngưỡng bảo vệ
-#define CELL_OV_THRESHOLD 4.25   // Over voltage
-#define CELL_UV_THRESHOLD 2.80   // Under voltage
+// Ngưỡng bảo vệ (điện áp / nhiệt độ theo hoá học cell, bms_chemistry.h)
+#define CELL_OV_THRESHOLD BatteryChemistry::overVoltage       // Over voltage
+#define CELL_UV_THRESHOLD BatteryChemistry::underVoltage      // Under voltage
 #define PACK_OC_THRESHOLD 5.0    // Over current (A)
-#define PACK_OT_THRESHOLD 50.0   // Over temperature (°C)
-#define CELL_BALANCE_DIFF 0.05   // 50mV difference to trigger balancing
+#define PACK_OT_THRESHOLD BatteryChemistry::maxTemperature    // Over temperature (°C), kênh nóng nhất
+#define PACK_UT_THRESHOLD BatteryChemistry::minTemperature    // Under temperature (°C), kênh lạnh nhất
+#define CELL_BALANCE_DIFF BatteryChemistry::balanceDiff       // Lệch áp bắt đầu balancing
+#define SENSOR_COMMS_FAULT_READS 3   // Lần đọc lỗi (bus / CRC) liên tiếp trước khi báo mất liên lạc
 
 // Tham số tính toán SOC
 #define BATTERY_CAPACITY 6.0     // Ah (per cell / pack capacity)
-#define CELL_FULL_VOLTAGE 3.40   // LiFePO4 full voltage per cell
-#define CELL_EMPTY_VOLTAGE 2.50  // LiFePO4 empty voltage per cell
+#define CELL_FULL_VOLTAGE BatteryChemistry::fullVoltage       // Điện áp nghỉ khi đầy
+#define CELL_EMPTY_VOLTAGE BatteryChemistry::emptyVoltage     // Điện áp nghỉ khi cạn
 
 struct BMSData {
     // Đo lường cơ bản
     float cellVoltages[NUM_CELLS];
     float packVoltage;
     float current;
-    float packTemp;
+    float packTemp;          // Kênh nhiệt độ nóng nhất
+    float minTemp;           // Kênh nhiệt độ lạnh nhất
     float soc;
     float soh;
     float avgCellVoltage;
@@ -33,7 +41,10 @@ struct BMSData {
     bool underVoltageAlarm;
     bool overCurrentAlarm;
     bool overTempAlarm;
+    bool underTempAlarm;
     bool shortCircuitAlarm;
+    bool commsFaultAlarm;    // Driver cảm biến lỗi liên tiếp, giá trị đo đã cũ
+    bool thermalLossAlarm;   // Mọi kênh nhiệt độ đều lỗi, không còn nhiệt độ tin cậy
     
     // Balancing
     bool balancingActive;
@@ -48,6 +59,7 @@ struct BMSData {
     unsigned long lastUpdateTime;
     unsigned long idleStartTime;
     float accumulatedCharge; // Ah
+    uint16_t failedReads;    // Lần đọc cảm biến lỗi liên tiếp
 };
 
 BMSData bmsData;
@@ -55,141 +67,399 @@ BMSData bmsData;
 // SOC Estimator instance
 SOCEstimator socEstimator(BATTERY_CAPACITY, 100.0);
 
+// SOC / dung lượng từng cell, SOC pack suy ra từ cell yếu nhất / mạnh nhất
+CellEstimatorBank<NUM_CELLS> cellEstimators(BATTERY_CAPACITY);
+
+// Thống kê độ lệch từng cell, phát hiện cell bất thường
+CellStatsBank<NUM_CELLS> cellStats;
+
+// JSON document dùng lại cho mỗi request (không nằm trên stack/heap)
+StaticJsonDocument<BMS_JSON_DOC_SIZE> bmsJsonDoc;
+
+// ============ PACK CONTEXT ============
+// Toàn bộ trạng thái xử lý của 1 pack. Firmware có đúng 1 bộ (bmsPack, trỏ vào
+// các global ở trên); fleet simulator trên PC tạo hàng nghìn bộ độc lập.
+// Các hàm dưới đây nhận BMSPack&, bản không tham số dùng bmsPack
+struct BMSPack {
+    BMSData* data;
+    SOCEstimator* soc;
+    CellEstimatorBank<NUM_CELLS>* cells;
+    BMSTemperatureBank* temperatures;
+    BMSEventJournal* events;
+    CellStatsBank<NUM_CELLS>* cellStats;
+};
+
+BMSPack bmsPack = { &bmsData, &socEstimator, &cellEstimators, &temperatureBank, &bmsEvents, &cellStats };
+
 // ============ HELPER FUNCTIONS ============
 
 const char* statusToString(bool alarm) {
     return alarm ? "alarm" : "normal";
 }
 
-// Kiểm tra balancing cần thiết
-void checkBalancing() {
-    float maxV = bmsData.cellVoltages[0];
-    float minV = bmsData.cellVoltages[0];
+// Bitfield trạng thái (status frame nhị phân, Modbus)
+#define BMS_FLAG_OV  (1 << 0)
+#define BMS_FLAG_UV  (1 << 1)
+#define BMS_FLAG_OC  (1 << 2)
+#define BMS_FLAG_OT  (1 << 3)
+#define BMS_FLAG_SC  (1 << 4)
+#define BMS_FLAG_BAL (1 << 5)
+#define BMS_FLAG_CHG (1 << 6)
+#define BMS_FLAG_DSG (1 << 7)
+#define BMS_FLAG_UT  (1 << 8)
+#define BMS_FLAG_COMMS (1 << 9)
+#define BMS_FLAG_THERM (1 << 10)
+
+uint16_t getStatusFlags(const BMSData& data) {
+    uint16_t flags = 0;
+    if (data.overVoltageAlarm)  flags |= BMS_FLAG_OV;
+    if (data.underVoltageAlarm) flags |= BMS_FLAG_UV;
+    if (data.overCurrentAlarm)  flags |= BMS_FLAG_OC;
+    if (data.overTempAlarm)     flags |= BMS_FLAG_OT;
+    if (data.shortCircuitAlarm) flags |= BMS_FLAG_SC;
+    if (data.balancingActive)   flags |= BMS_FLAG_BAL;
+    if (data.isCharging)        flags |= BMS_FLAG_CHG;
+    if (data.isDischarging)     flags |= BMS_FLAG_DSG;
+    if (data.underTempAlarm)    flags |= BMS_FLAG_UT;
+    if (data.commsFaultAlarm)   flags |= BMS_FLAG_COMMS;
+    if (data.thermalLossAlarm)  flags |= BMS_FLAG_THERM;
+    return flags;
+}
+
+// Bit i = cell i+1 đang balancing
+uint16_t getBalancingMask(const BMSData& data) {
+    uint16_t mask = 0;
+    for (int i = 0; i < NUM_CELLS; i++) {
+        if (data.balancingCells[i]) mask |= (1 << i);
+    }
+    return mask;
+}
+
+// Frame STATUS của log nhị phân (LOG_FRAME_STATUS), giải mã bằng tools/bms_log_decode.py:
+// u32 ms | u8 cells | u16 cell mV × cells | i16 current (10mA) | i16 temp (0.1°C)
+// | u16 soc (0.1%) | u16 soh (0.1%) | u16 flags | u16 balancing mask
+#define BMS_STATUS_FRAME_SIZE (4 + 1 + 2 * NUM_CELLS + 12)
+
+size_t writeStatusFrame(const BMSData& data, uint32_t ms, uint8_t* payload, size_t size) {
+    LogFrameBuilder frame(payload, size);
+    frame.u32(ms);
+    frame.u8(NUM_CELLS);
+    for (int i = 0; i < NUM_CELLS; i++) {
+        frame.u16((uint16_t)lroundf(data.cellVoltages[i] * 1000.0));
+    }
+    frame.i16((int16_t)lroundf(data.current * 100.0));
+    frame.i16((int16_t)lroundf(data.packTemp * 10.0));
+    frame.u16((uint16_t)lroundf(data.soc * 10.0));
+    frame.u16((uint16_t)lroundf(data.soh * 10.0));
+    frame.u16(getStatusFlags(data));
+    frame.u16(getBalancingMask(data));
+    return frame.length();
+}
+
+// Kiểm tra balancing cần thiết, trả về độ lệch áp max - min
+float checkBalancing(BMSPack& pack) {
+    BMSData& data = *pack.data;
+    float maxV = data.cellVoltages[0];
+    float minV = data.cellVoltages[0];
     int maxIdx = 0;
     
     for (int i = 1; i < NUM_CELLS; i++) {
-        if (bmsData.cellVoltages[i] > maxV) {
-            maxV = bmsData.cellVoltages[i];
+        if (data.cellVoltages[i] > maxV) {
+            maxV = data.cellVoltages[i];
             maxIdx = i;
         }
-        if (bmsData.cellVoltages[i] < minV) {
-            minV = bmsData.cellVoltages[i];
+        if (data.cellVoltages[i] < minV) {
+            minV = data.cellVoltages[i];
         }
     }
     
     float diff = maxV - minV;
     
     if (diff > CELL_BALANCE_DIFF) {
-        bmsData.balancingActive = true;
+        data.balancingActive = true;
         for (int i = 0; i < NUM_CELLS; i++) {
-            if (bmsData.cellVoltages[i] >= (maxV - 0.01)) {
-                bmsData.balancingCells[i] = true;
+            if (data.cellVoltages[i] >= (maxV - 0.01)) {
+                data.balancingCells[i] = true;
             } else {
-                bmsData.balancingCells[i] = false;
+                data.balancingCells[i] = false;
             }
         }
     } else {
-        bmsData.balancingActive = false;
+        data.balancingActive = false;
         for (int i = 0; i < NUM_CELLS; i++) {
-            bmsData.balancingCells[i] = false;
+            data.balancingCells[i] = false;
         }
     }
+    return diff;
 }
 
-// Kiểm tra protection
-void checkProtection() {
+float checkBalancing() {
+    return checkBalancing(bmsPack);
+}
+
+// Ghi chuyển trạng thái vào nhật ký sự kiện, cực trị theo cả batch
+void recordEvents(BMSPack& pack, float maxCellVoltage, float minCellVoltage, float maxAbsCurrent,
+                  float maxTemp, float minTemp, float imbalance, uint32_t now) {
+    BMSData& data = *pack.data;
+    BMSTemperatureBank& thermal = *pack.temperatures;
+    BMSEventJournal& journal = *pack.events;
+    CellStatsBank<NUM_CELLS>& stats = *pack.cellStats;
+    journal.update(EVENT_OVER_VOLTAGE, data.overVoltageAlarm, maxCellVoltage, now);
+    journal.update(EVENT_UNDER_VOLTAGE, data.underVoltageAlarm, minCellVoltage, now);
+    journal.update(EVENT_OVER_CURRENT, data.overCurrentAlarm, maxAbsCurrent, now);
+    journal.update(EVENT_OVER_TEMPERATURE, data.overTempAlarm, maxTemp, now);
+    journal.update(EVENT_UNDER_TEMPERATURE, data.underTempAlarm, minTemp, now);
+    uint16_t faults = thermal.getFaultMask();
+    journal.update(EVENT_SENSOR_FAULT, faults != 0, faults ? __builtin_popcount(faults) : 0, now);
+    journal.update(EVENT_SHORT_CIRCUIT, data.shortCircuitAlarm, maxAbsCurrent, now);
+    journal.update(EVENT_BALANCING, data.balancingActive, imbalance, now);
+    uint32_t outliers = stats.getOutlierMask();
+    journal.update(EVENT_CELL_OUTLIER, outliers != 0,
+                   outliers ? fabsf(stats.getDeviation(stats.getWorstCell())) / 1000.0f : 0, now);
+    journal.update(EVENT_COMMS_FAULT, data.commsFaultAlarm, data.failedReads, now);
+    journal.update(EVENT_THERMAL_LOSS, data.thermalLossAlarm, faults ? __builtin_popcount(faults) : 0, now);
+}
+
+void recordEvents(float maxCellVoltage, float minCellVoltage, float maxAbsCurrent,
+                  float maxTemp, float minTemp, float imbalance, uint32_t now) {
+    recordEvents(bmsPack, maxCellVoltage, minCellVoltage, maxAbsCurrent,
+                 maxTemp, minTemp, imbalance, now);
+}
+
+// Kiểm tra protection theo giá trị cực trị (1 mẫu hoặc min/max của cả batch)
+void checkProtectionLimits(BMSPack& pack, float maxCellVoltage, float minCellVoltage,
+                           float maxAbsCurrent, float maxTemp, float minTemp) {
+    BMSData& data = *pack.data;
     // Over/Under Voltage
-    bmsData.overVoltageAlarm = false;
-    bmsData.underVoltageAlarm = false;
-    
-    for (int i = 0; i < NUM_CELLS; i++) {
-        if (bmsData.cellVoltages[i] > CELL_OV_THRESHOLD) {
-            bmsData.overVoltageAlarm = true;
-        }
-        if (bmsData.cellVoltages[i] < CELL_UV_THRESHOLD) {
-            bmsData.underVoltageAlarm = true;
-        }
-    }
+    data.overVoltageAlarm = (maxCellVoltage > CELL_OV_THRESHOLD);
+    data.underVoltageAlarm = (minCellVoltage < CELL_UV_THRESHOLD);
     
     // Over Current
-    bmsData.overCurrentAlarm = (abs(bmsData.current) > PACK_OC_THRESHOLD);
+    data.overCurrentAlarm = (maxAbsCurrent > PACK_OC_THRESHOLD);
     
-    // Over Temperature
-    bmsData.overTempAlarm = (bmsData.packTemp > PACK_OT_THRESHOLD);
+    // Over / Under Temperature (NAN = không còn kênh nhiệt độ hợp lệ => coi như vượt ngưỡng)
+    data.overTempAlarm = !(maxTemp <= PACK_OT_THRESHOLD);
+    data.underTempAlarm = !(minTemp >= PACK_UT_THRESHOLD);
     
     // Short Circuit
-    bmsData.shortCircuitAlarm = (abs(bmsData.current) > 10.0);
+    data.shortCircuitAlarm = (maxAbsCurrent > 10.0);
+}
+
+void checkProtectionLimits(float maxCellVoltage, float minCellVoltage,
+                           float maxAbsCurrent, float maxTemp, float minTemp) {
+    checkProtectionLimits(bmsPack, maxCellVoltage, minCellVoltage, maxAbsCurrent, maxTemp, minTemp);
+}
+
+// Kiểm tra protection với mẫu hiện tại trong bmsData
+void checkProtection(BMSPack& pack) {
+    BMSData& data = *pack.data;
+    float maxV = data.cellVoltages[0];
+    float minV = data.cellVoltages[0];
+    for (int i = 1; i < NUM_CELLS; i++) {
+        if (data.cellVoltages[i] > maxV) maxV = data.cellVoltages[i];
+        if (data.cellVoltages[i] < minV) minV = data.cellVoltages[i];
+    }
+    checkProtectionLimits(pack, maxV, minV, abs(data.current), data.packTemp, data.minTemp);
+}
+
+void checkProtection() {
+    checkProtection(bmsPack);
 }
 
-// Cập nhật charging status
-void updateChargingStatus() {
-    if (bmsData.current > 0.1) {
-        bmsData.isCharging = true;
-        bmsData.isDischarging = false;
-        bmsData.idleStartTime = 0;
-    } else if (bmsData.current < -0.1) {
-        bmsData.isCharging = false;
-        bmsData.isDischarging = true;
-        bmsData.idleStartTime = 0;
+// Cập nhật charging status (now = thời điểm của mẫu, ms)
+void updateChargingStatus(BMSPack& pack, unsigned long now) {
+    BMSData& data = *pack.data;
+    if (data.current > 0.1) {
+        data.isCharging = true;
+        data.isDischarging = false;
+        data.idleStartTime = 0;
+    } else if (data.current < -0.1) {
+        data.isCharging = false;
+        data.isDischarging = true;
+        data.idleStartTime = 0;
     } else {
-        bmsData.isCharging = false;
-        bmsData.isDischarging = false;
+        data.isCharging = false;
+        data.isDischarging = false;
         // Ghi lại thời gian pin bắt đầu idle (để calibrate OCV sau)
-        if (bmsData.idleStartTime == 0) {
-            bmsData.idleStartTime = millis();
+        if (data.idleStartTime == 0) {
+            data.idleStartTime = now;
         }
     }
 }
 
-// Cập nhật BMS data từ sensors và tính SOC
-void updateBMSData(float cell1, float cell2, float cell3, float cell4, 
-                   float current, float temp) {
-    // Cập nhật cell voltages
-    bmsData.cellVoltages[0] = cell1;
-    bmsData.cellVoltages[1] = cell2;
-    bmsData.cellVoltages[2] = cell3;
-    bmsData.cellVoltages[3] = cell4;
+void updateChargingStatus(unsigned long now) {
+    updateChargingStatus(bmsPack, now);
+}
+
+// ============ BATCH INGESTION ============
+
+// Một mẫu đo có timestamp riêng (từ buffer DMA/ADC hoặc trace phát lại)
+struct BMSSample {
+    unsigned long timestamp;        // ms, cùng gốc với millis()
+    float cellVoltages[NUM_CELLS];
+    float current;
+    float temperature;              // Kênh nóng nhất, NAN = mọi kênh nhiệt độ lỗi
+    float minTemperature;           // Kênh lạnh nhất, NAN = mọi kênh nhiệt độ lỗi
+};
+
+// Nạp một batch mẫu theo thứ tự thời gian:
+// - SOC tích phân hình thang theo timestamp của từng mẫu
+// - Protection chạy 1 lần với min/max của cả batch (không bỏ sót transient)
+// - Balancing/charging status chạy 1 lần theo mẫu cuối
+// - Mẫu mất nhiệt độ (NAN) vẫn được nạp: điện áp / dòng / SOC chạy bình thường, OT/UT
+//   coi như vượt ngưỡng và bật thermalLossAlarm; nhiệt độ hiển thị giữ giá trị hợp lệ cuối
+void updateBMSBatch(BMSPack& pack, const BMSSample* samples, size_t count) {
+    BMSData& data = *pack.data;
+    SOCEstimator& estimator = *pack.soc;
+    CellEstimatorBank<NUM_CELLS>& cellBank = *pack.cells;
+    BMSEventJournal& journal = *pack.events;
+    CellStatsBank<NUM_CELLS>& stats = *pack.cellStats;
+    if (count == 0) return;
+    
+    float maxCell = samples[0].cellVoltages[0];
+    float minCell = samples[0].cellVoltages[0];
+    float maxAbsCurrent = 0;
+    float maxTemp = -1000.0f;
+    float minTemp = 1000.0f;
+    bool thermalLoss = false;
+    
+    for (size_t s = 0; s < count; s++) {
+        const BMSSample& sample = samples[s];
+        bool tempValid = !isnan(sample.temperature) && !isnan(sample.minTemperature);
+        
+        // ======== UPDATE SOC USING COULOMB COUNTING ========
+        // Mất nhiệt độ: bù nhiệt theo giá trị hợp lệ cuối
+        estimator.updateAt(sample.current, tempValid ? sample.temperature : data.packTemp, sample.timestamp);
+        stats.update(sample.cellVoltages, sample.current, sample.timestamp);
+        
+        for (int i = 0; i < NUM_CELLS; i++) {
+            if (sample.cellVoltages[i] > maxCell) maxCell = sample.cellVoltages[i];
+            if (sample.cellVoltages[i] < minCell) minCell = sample.cellVoltages[i];
+        }
+        if (abs(sample.current) > maxAbsCurrent) maxAbsCurrent = abs(sample.current);
+        if (!tempValid) {
+            thermalLoss = true;
+            continue;
+        }
+        if (sample.temperature > maxTemp) maxTemp = sample.temperature;
+        if (sample.minTemperature < minTemp) minTemp = sample.minTemperature;
+    }
     
-    // Cập nhật pack voltage
-    bmsData.packVoltage = cell1 + cell2 + cell3 + cell4;
+    // Cả batch cùng 1 dòng qua mọi cell: cộng điện tích của batch vào từng cell
+    cellBank.update(estimator.getNetChargeUnits());
+    
+    // Giá trị hiển thị lấy theo mẫu cuối
+    const BMSSample& last = samples[count - 1];
+    data.packVoltage = 0;
+    for (int i = 0; i < NUM_CELLS; i++) {
+        data.cellVoltages[i] = last.cellVoltages[i];
+        data.packVoltage += last.cellVoltages[i];
+    }
     
     // Tính average cell voltage
-    bmsData.avgCellVoltage = bmsData.packVoltage / NUM_CELLS;
+    data.avgCellVoltage = data.packVoltage / NUM_CELLS;
     
     // Cập nhật current và temp
-    bmsData.current = current;
-    bmsData.packTemp = temp;
-    
-    // ======== UPDATE SOC USING COULOMB COUNTING ========
-    socEstimator.update(current, temp);
-    bmsData.soc = socEstimator.getSOC();
+    data.current = last.current;
+    if (!isnan(last.temperature) && !isnan(last.minTemperature)) {
+        data.packTemp = last.temperature;
+        data.minTemp = last.minTemperature;
+    }
+    data.soc = cellBank.getPackSOC();
     
     // ======== OCV CALIBRATION KHI PIN IDLE ========
     // Nếu pin idle > 30 phút, hiệu chỉnh SOC dựa trên OCV
-    if (abs(current) < 0.1 && bmsData.idleStartTime > 0) {
-        unsigned long idleTime = (millis() - bmsData.idleStartTime) / 1000;
+    if (abs(last.current) < 0.1 && data.idleStartTime > 0) {
+        unsigned long idleTime = (last.timestamp - data.idleStartTime) / 1000;
         if (idleTime > 1800) { // 30 phút
-            socEstimator.calibrateWithVoltage(bmsData.avgCellVoltage, idleTime);
-            bmsData.soc = socEstimator.getSOC();
-            bmsData.idleStartTime = 0; // Reset
+            estimator.calibrateWithVoltage(data.avgCellVoltage, idleTime);
+            cellBank.calibrate(data.cellVoltages, estimator);
+            data.soc = cellBank.getPackSOC();
+            data.idleStartTime = 0; // Reset
+            journal.record(EVENT_CALIBRATION, data.soc, last.timestamp);
         }
     }
     
     // SOH = Capacity Health (giả lập)
-    bmsData.soh = socEstimator.getCapacityHealth();
+    data.soh = estimator.getCapacityHealth();
     
-    // Kiểm tra các điều kiện
-    checkProtection();
-    checkBalancing();
-    updateChargingStatus();
+    // Đọc lại được: hết mất liên lạc
+    data.failedReads = 0;
+    data.commsFaultAlarm = false;
+    
+    // Có mẫu mất nhiệt độ trong batch: OT/UT theo NAN (vượt ngưỡng), sự kiện ghi giá trị hợp lệ cuối
+    data.thermalLossAlarm = thermalLoss;
+    if (thermalLoss) {
+        maxTemp = NAN;
+        minTemp = NAN;
+    }
     
-    bmsData.systemActive = true;
-    bmsData.lastUpdateTime = millis();
+    // Kiểm tra các điều kiện
+    checkProtectionLimits(pack, maxCell, minCell, maxAbsCurrent, maxTemp, minTemp);
+    float imbalance = checkBalancing(pack);
+    recordEvents(pack, maxCell, minCell, maxAbsCurrent, thermalLoss ? data.packTemp : maxTemp,
+                 thermalLoss ? data.minTemp : minTemp, imbalance, last.timestamp);
+    updateChargingStatus(pack, last.timestamp);
+    
+    data.systemActive = true;
+    data.lastUpdateTime = last.timestamp;
 }
 
-// Tạo JSON response
-String getBMSJson() {
-    StaticJsonDocument<2048> doc;
+void updateBMSBatch(const BMSSample* samples, size_t count) {
+    updateBMSBatch(bmsPack, samples, count);
+}
+
+// Driver cảm biến trả false (lỗi bus / CRC): bmsData vẫn giữ mẫu hợp lệ gần nhất, nhưng
+// sau SENSOR_COMMS_FAULT_READS lần liên tiếp thì bật alarm mất liên lạc (critical, cấm
+// sạc / xả qua CAN) tới khi đọc lại được. Đếm theo số lần đọc để 1 lỗi CRC lẻ không
+// cắt sạc ở chu kỳ lấy mẫu chậm
+void recordSensorReadFailure(BMSPack& pack, unsigned long now) {
+    BMSData& data = *pack.data;
+    if (data.failedReads < 0xFFFF) data.failedReads++;
+    if (data.failedReads >= SENSOR_COMMS_FAULT_READS) data.commsFaultAlarm = true;
+    pack.events->update(EVENT_COMMS_FAULT, data.commsFaultAlarm, data.failedReads, now);
+}
+
+void recordSensorReadFailure(unsigned long now) {
+    recordSensorReadFailure(bmsPack, now);
+}
+
+// Cập nhật BMS data từ sensors và tính SOC (1 mẫu, tại thời điểm hiện tại)
+// temp / minTemp: kênh nhiệt độ nóng nhất / lạnh nhất, NAN khi mọi kênh lỗi
+void updateBMSData(float cell1, float cell2, float cell3, float cell4, 
+                   float current, float temp, float minTemp) {
+    BMSSample sample;
+    sample.timestamp = millis();
+    sample.cellVoltages[0] = cell1;
+    sample.cellVoltages[1] = cell2;
+    sample.cellVoltages[2] = cell3;
+    sample.cellVoltages[3] = cell4;
+    sample.current = current;
+    sample.temperature = temp;
+    sample.minTemperature = minTemp;
+    
+    updateBMSBatch(&sample, 1);
+}
+
+// Chỉ có 1 cảm biến nhiệt độ
+void updateBMSData(float cell1, float cell2, float cell3, float cell4, 
+                   float current, float temp) {
+    updateBMSData(cell1, cell2, cell3, cell4, current, temp, temp);
+}
+
+// Tạo JSON response vào buffer cố định, trả về số byte đã ghi
+// Số thực được định dạng vào buffer tạm, gán dạng char* để ArduinoJson
+// copy vào pool của document (không tạo String trên heap)
+// doc: document tạm (mỗi thread 1 cái khi nhiều pack được phục vụ song song)
+size_t writeBMSJson(BMSPack& pack, JsonDocument& doc, char* out, size_t size) {
+    BMSData& data = *pack.data;
+    SOCEstimator& estimator = *pack.soc;
+    CellEstimatorBank<NUM_CELLS>& cellBank = *pack.cells;
+    BMSTemperatureBank& thermal = *pack.temperatures;
+    BMSEventJournal& journal = *pack.events;
+    CellStatsBank<NUM_CELLS>& stats = *pack.cellStats;
+    doc.clear();
+    char num[16];
     
     // ============ MEASUREMENT ============
     JsonObject measurement = doc.createNestedObject("measurement");
@@ -198,132 +468,166 @@ String getBMSJson() {
     for (int i = 0; i < NUM_CELLS; i++) {
         JsonObject cell = cells.createNestedObject();
         cell["cell"] = i + 1;
-        cell["voltage"] = String(bmsData.cellVoltages[i], 3);
+        cell["voltage"] = formatFloat(num, sizeof(num), data.cellVoltages[i], 3);
+        cell["soc"] = formatFloat(num, sizeof(num), cellBank.getSOC(i), 1);
+        cell["capacity"] = formatFloat(num, sizeof(num), cellBank.getCapacity(i), 3);
+        cell["deviation"] = formatFloat(num, sizeof(num), stats.getDeviation(i), 1);   // mV so với trung bình
+    }
+    
+    measurement["packVoltage"] = formatFloat(num, sizeof(num), data.packVoltage, 2);
+    measurement["avgCellVoltage"] = formatFloat(num, sizeof(num), data.avgCellVoltage, 3);
+    measurement["current"] = formatFloat(num, sizeof(num), data.current, 2);
+    measurement["packTemperature"] = formatFloat(num, sizeof(num), data.packTemp, 1);
+    measurement["minTemperature"] = formatFloat(num, sizeof(num), data.minTemp, 1);
+    
+    // Kênh chưa có driver nạp dữ liệu thì bỏ qua
+    JsonArray temperatures = measurement.createNestedArray("temperatures");
+    for (int ch = 0; ch < thermal.getChannelCount(); ch++) {
+        const BMSTemperatureBank::Channel& c = thermal.getChannel(ch);
+        if (!c.present) continue;
+        JsonObject t = temperatures.createNestedObject();
+        t["name"] = BMSTemperatureBank::channelName(ch);
+        if (c.fault) {
+            t["fault"] = true;
+            continue;
+        }
+        t["value"] = formatFloat(num, sizeof(num), thermal.getCelsius(ch), 1);
+        t["min"] = formatFloat(num, sizeof(num), thermal.getMin(ch), 1);
+        t["max"] = formatFloat(num, sizeof(num), thermal.getMax(ch), 1);
+        t["avg"] = formatFloat(num, sizeof(num), thermal.getAverage(ch), 1);
     }
     
-    measurement["packVoltage"] = String(bmsData.packVoltage, 2);
-    measurement["avgCellVoltage"] = String(bmsData.avgCellVoltage, 3);
-    measurement["current"] = String(bmsData.current, 2);
-    measurement["packTemperature"] = String(bmsData.packTemp, 1);
+    // ============ CHEMISTRY ============
+    // Dashboard đổi điện áp cell ra % theo dải này
+    JsonObject chemistry = doc.createNestedObject("chemistry");
+    chemistry["name"] = BatteryChemistry::name;
+    chemistry["emptyVoltage"] = formatFloat(num, sizeof(num), CELL_EMPTY_VOLTAGE, 2);
+    chemistry["fullVoltage"] = formatFloat(num, sizeof(num), CELL_FULL_VOLTAGE, 2);
+    chemistry["overVoltage"] = formatFloat(num, sizeof(num), CELL_OV_THRESHOLD, 2);
+    chemistry["underVoltage"] = formatFloat(num, sizeof(num), CELL_UV_THRESHOLD, 2);
     
     // ============ CALCULATION (SOC/SOH) ============
     JsonObject calculation = doc.createNestedObject("calculation");
-    calculation["soc"] = String(bmsData.soc, 1);
-    calculation["soh"] = String(bmsData.soh, 1);
-    calculation["remainingCapacity"] = String(socEstimator.getRemainingCapacity(), 3);
-    calculation["expectedVoltage"] = String(socEstimator.getExpectedVoltage(), 3);
+    calculation["soc"] = formatFloat(num, sizeof(num), data.soc, 1);
+    calculation["soh"] = formatFloat(num, sizeof(num), data.soh, 1);
+    calculation["remainingCapacity"] = formatFloat(num, sizeof(num), cellBank.getUsableCapacity(), 3);
+    calculation["weakestCell"] = cellBank.getWeakestCell() + 1;
+    calculation["expectedVoltage"] = formatFloat(num, sizeof(num), estimator.getExpectedVoltage(), 3);
     
     // ============ STATUS ============
     JsonObject status = doc.createNestedObject("status");
     
-    if (bmsData.isCharging) {
+    if (data.isCharging) {
         status["charging"] = "charging";
-    } else if (bmsData.isDischarging) {
+    } else if (data.isDischarging) {
         status["charging"] = "discharging";
     } else {
         status["charging"] = "idle";
     }
     
     JsonObject balancing = status.createNestedObject("balancing");
-    balancing["active"] = bmsData.balancingActive;
+    balancing["active"] = data.balancingActive;
     
     JsonArray balancingCellsArray = balancing.createNestedArray("cells");
-    if (bmsData.balancingActive) {
+    if (data.balancingActive) {
         for (int i = 0; i < NUM_CELLS; i++) {
-            if (bmsData.balancingCells[i]) {
+            if (data.balancingCells[i]) {
                 balancingCellsArray.add(i + 1);
             }
         }
     }
     
+    // Cell bất thường (bms_cell_stats.h), chi tiết ở /cells
+    JsonArray outliers = status.createNestedArray("outliers");
+    for (int i = 0; i < NUM_CELLS; i++) {
+        if (stats.isOutlier(i)) outliers.add(i + 1);
+    }
+    
     // ============ PROTECTION ============
     JsonObject protection = doc.createNestedObject("protection");
-    protection["overVoltage"] = statusToString(bmsData.overVoltageAlarm);
-    protection["underVoltage"] = statusToString(bmsData.underVoltageAlarm);
-    protection["overCurrent"] = statusToString(bmsData.overCurrentAlarm);
-    protection["overTemperature"] = statusToString(bmsData.overTempAlarm);
-    protection["shortCircuit"] = statusToString(bmsData.shortCircuitAlarm);
+    protection["overVoltage"] = statusToString(data.overVoltageAlarm);
+    protection["underVoltage"] = statusToString(data.underVoltageAlarm);
+    protection["overCurrent"] = statusToString(data.overCurrentAlarm);
+    protection["overTemperature"] = statusToString(data.overTempAlarm);
+    protection["underTemperature"] = statusToString(data.underTempAlarm);
+    protection["shortCircuit"] = statusToString(data.shortCircuitAlarm);
+    protection["commsFault"] = statusToString(data.commsFaultAlarm);
+    protection["thermalLoss"] = statusToString(data.thermalLossAlarm);
     
     // ============ ALERTS ============
+    // Các sự kiện đang mở trong nhật ký (không tính lại từ cờ / quét lại cell)
     JsonArray alerts = doc.createNestedArray("alerts");
-    
-    if (bmsData.overVoltageAlarm) {
-        JsonObject alert = alerts.createNestedObject();
-        alert["severity"] = "critical";
-        alert["message"] = "Over Voltage ALARM!";
-    }
-    
-    if (bmsData.underVoltageAlarm) {
-        JsonObject alert = alerts.createNestedObject();
-        alert["severity"] = "critical";
-        alert["message"] = "Under Voltage ALARM!";
-    }
-    
-    if (bmsData.overCurrentAlarm) {
-        JsonObject alert = alerts.createNestedObject();
-        alert["severity"] = "critical";
-        alert["message"] = "Over Current ALARM!";
-    }
-    
-    if (bmsData.overTempAlarm) {
+    journal.forEachActive([&](const BMSEvent& e) {
         JsonObject alert = alerts.createNestedObject();
-        alert["severity"] = "critical";
-        alert["message"] = "Over Temperature ALARM!";
-    }
-    
-    if (bmsData.shortCircuitAlarm) {
-        JsonObject alert = alerts.createNestedObject();
-        alert["severity"] = "critical";
-        alert["message"] = "Short Circuit ALARM!";
-    }
-    
-    if (bmsData.balancingActive) {
-        float maxV = bmsData.cellVoltages[0];
-        float minV = bmsData.cellVoltages[0];
-        for (int i = 1; i < NUM_CELLS; i++) {
-            if (bmsData.cellVoltages[i] > maxV) maxV = bmsData.cellVoltages[i];
-            if (bmsData.cellVoltages[i] < minV) minV = bmsData.cellVoltages[i];
-        }
-        if ((maxV - minV) > 0.05) {
-            JsonObject alert = alerts.createNestedObject();
-            alert["severity"] = "warning";
-            alert["message"] = "Cell voltage imbalance detected";
-        }
-    }
+        alert["severity"] = EVENT_TYPES[e.type].severity;
+        alert["message"] = EVENT_TYPES[e.type].message;
+    });
     
-    String output;
-    serializeJson(doc, output);
-    return output;
+    return serializeJson(doc, out, size);
 }
 
-void initBMSData() {
-    bmsData.packVoltage = 0;
-    bmsData.avgCellVoltage = 0;
-    bmsData.current = 0;
-    bmsData.packTemp = 25.0;
-    bmsData.soc = 100.0;
-    bmsData.soh = 100.0;
+size_t writeBMSJson(char* out, size_t size) {
+    return writeBMSJson(bmsPack, bmsJsonDoc, out, size);
+}
+
+String getBMSJson() {
+    writeBMSJson(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+    return String(bmsJsonBuffer);
+}
+
+// Đặt lại SOC cho pack và mọi cell
+void resetSOC(BMSPack& pack, float soc) {
+    BMSData& data = *pack.data;
+    SOCEstimator& estimator = *pack.soc;
+    CellEstimatorBank<NUM_CELLS>& cellBank = *pack.cells;
+    estimator.reset(soc);
+    cellBank.reset(soc, estimator.getNetChargeUnits());
+    data.soc = soc;
+}
+
+void resetSOC(float soc) {
+    resetSOC(bmsPack, soc);
+}
+
+void initBMSData(BMSPack& pack) {
+    BMSData& data = *pack.data;
+    data.packVoltage = 0;
+    data.avgCellVoltage = 0;
+    data.current = 0;
+    data.packTemp = 25.0;
+    data.minTemp = 25.0;
+    data.soc = 100.0;
+    data.soh = 100.0;
     
     for (int i = 0; i < NUM_CELLS; i++) {
-        bmsData.cellVoltages[i] = 0;
-        bmsData.balancingCells[i] = false;
+        data.cellVoltages[i] = 0;
+        data.balancingCells[i] = false;
     }
     
-    bmsData.overVoltageAlarm = false;
-    bmsData.underVoltageAlarm = false;
-    bmsData.overCurrentAlarm = false;
-    bmsData.overTempAlarm = false;
-    bmsData.shortCircuitAlarm = false;
-    bmsData.balancingActive = false;
-    bmsData.isCharging = false;
-    bmsData.isDischarging = false;
-    bmsData.systemActive = false;
-    bmsData.lastUpdateTime = 0;
-    bmsData.idleStartTime = 0;
-    bmsData.accumulatedCharge = 0;
+    data.overVoltageAlarm = false;
+    data.underVoltageAlarm = false;
+    data.overCurrentAlarm = false;
+    data.overTempAlarm = false;
+    data.underTempAlarm = false;
+    data.shortCircuitAlarm = false;
+    data.commsFaultAlarm = false;
+    data.thermalLossAlarm = false;
+    data.failedReads = 0;
+    data.balancingActive = false;
+    data.isCharging = false;
+    data.isDischarging = false;
+    data.systemActive = false;
+    data.lastUpdateTime = 0;
+    data.idleStartTime = 0;
+    data.accumulatedCharge = 0;
+    pack.cellStats->reset();
     
     // Initialize SOC Estimator
-    socEstimator.reset(100.0);
+    resetSOC(pack, 100.0);
+}
+
+void initBMSData() {
+    initBMSData(bmsPack);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,250 @@
+#ifndef BMS_EVENTS_H
+#define BMS_EVENTS_H
+
+#include <Arduino.h>
+#include "bms_memory.h"
+
+/*
+ * BMS Events - Nhật ký alarm / sự kiện có timestamp
+ * - Ghi lại chuyển trạng thái (protection, balancing, hiệu chỉnh SOC) ngay trong
+ *   đường lấy mẫu: alarm chỉ kéo dài giữa 2 lần poll vẫn còn trong nhật ký
+ * - Mỗi sự kiện: loại, thời điểm bắt đầu / kết thúc, giá trị cực trị, số lần lặp
+ * - Chống lặp: cùng loại bật lại trong EVENT_DEDUP_MS sau khi tắt thì mở lại
+ *   sự kiện cũ (count++) thay vì thêm sự kiện mới => alarm chập chờn không đẩy
+ *   sự kiện khác ra khỏi ring
+ * - Ring tĩnh EVENT_CAPACITY sự kiện, đầy thì ghi đè cũ nhất
+ * - Mỗi lần mở / đóng / mở lại tăng revision; client hỏi phần thay đổi bằng
+ *   /alerts?since=<revision> (MQTT đẩy cùng nội dung khi revision đổi).
+ *   Cực trị / thời điểm cuối của sự kiện đang mở không tăng revision
+ */
+
+#ifndef EVENT_CAPACITY
+#define EVENT_CAPACITY 32
+#endif
+#ifndef EVENT_DEDUP_MS
+#define EVENT_DEDUP_MS 30000
+#endif
+
+#define EVENT_JSON_MAX 224   // Byte tối đa cho 1 sự kiện dạng JSON
+
+// Thứ tự = thứ tự alert trong /bms
+#define EVENT_OVER_VOLTAGE      0
+#define EVENT_UNDER_VOLTAGE     1
+#define EVENT_OVER_CURRENT      2
+#define EVENT_OVER_TEMPERATURE  3
+#define EVENT_UNDER_TEMPERATURE 4
+#define EVENT_SENSOR_FAULT      5
+#define EVENT_SHORT_CIRCUIT     6
+#define EVENT_BALANCING         7
+#define EVENT_CALIBRATION       8
+#define EVENT_CELL_OUTLIER      9
+#define EVENT_COMMS_FAULT       10
+#define EVENT_THERMAL_LOSS      11
+#define EVENT_TYPE_COUNT        12
+
+struct EventTypeInfo {
+    const char* name;
+    const char* severity;
+    const char* message;
+    int8_t direction;    // 1: giá trị lớn hơn là tệ hơn, -1: nhỏ hơn là tệ hơn
+    uint8_t decimals;
+};
+
+const EventTypeInfo EVENT_TYPES[EVENT_TYPE_COUNT] = {
+    { "overVoltage",      "critical", "Over Voltage ALARM!",             1, 3 },   // V cell cao nhất
+    { "underVoltage",     "critical", "Under Voltage ALARM!",           -1, 3 },   // V cell thấp nhất
+    { "overCurrent",      "critical", "Over Current ALARM!",             1, 2 },   // |A|
+    { "overTemperature",  "critical", "Over Temperature ALARM!",         1, 1 },   // °C kênh nóng nhất
+    { "underTemperature", "critical", "Under Temperature ALARM!",       -1, 1 },   // °C kênh lạnh nhất
+    { "sensorFault",      "warning",  "Temperature sensor fault",        1, 0 },   // số kênh lỗi
+    { "shortCircuit",     "critical", "Short Circuit ALARM!",            1, 2 },   // |A|
+    { "balancing",        "warning",  "Cell voltage imbalance detected", 1, 3 },   // V lệch max - min
+    { "calibration",      "info",     "SOC calibrated from OCV",         1, 1 },   // SOC % sau hiệu chỉnh
+    { "cellOutlier",      "warning",  "Cell outlier detected",           1, 3 },   // V lệch của cell tệ nhất
+    { "commsFault",       "critical", "Sensor bus lost, readings stale", 1, 0 },   // số lần đọc lỗi liên tiếp
+    { "thermalLoss",      "critical", "All temperature sensors faulted", 1, 0 },   // số kênh lỗi
+};
+
+struct BMSEvent {
+    uint32_t id;         // Tăng liên tục từ lúc boot
+    uint32_t revision;   // Revision của lần thay đổi gần nhất
+    uint32_t start;      // ms
+    uint32_t end;        // ms, mẫu cuối còn alarm (đang mở) hoặc lúc tắt
+    float peak;
+    uint16_t count;      // Số lần bật (gộp lặp lại)
+    uint8_t type;
+    uint8_t active;
+};
+
+class BMSEventJournal {
+private:
+    BMSEvent events[EVENT_CAPACITY];
+    int8_t openSlot[EVENT_TYPE_COUNT];   // Ô của sự kiện đang mở, -1 nếu không có
+    int8_t lastSlot[EVENT_TYPE_COUNT];   // Ô của sự kiện gần nhất cùng loại
+    uint32_t nextId;
+    uint32_t revision;
+
+    // Thống kê
+    uint32_t inserted;
+    uint32_t deduplicated;
+    uint32_t overwritten;
+
+    static bool worse(uint8_t type, float value, float peak) {
+        return EVENT_TYPES[type].direction > 0 ? value > peak : value < peak;
+    }
+
+    // Sự kiện gần nhất cùng loại, còn trong ring và tắt chưa quá EVENT_DEDUP_MS
+    BMSEvent* recent(uint8_t type, uint32_t now) {
+        int slot = lastSlot[type];
+        if (slot < 0) return NULL;
+        BMSEvent& e = events[slot];
+        if (e.type != type || e.active || now - e.end > EVENT_DEDUP_MS) return NULL;
+        return &e;
+    }
+
+    BMSEvent& open(uint8_t type, float value, uint32_t now) {
+        BMSEvent* e = recent(type, now);
+        if (e) {
+            e->count++;
+            if (worse(type, value, e->peak)) e->peak = value;
+            deduplicated++;
+        } else {
+            int slot = nextId % EVENT_CAPACITY;
+            e = &events[slot];
+            if (e->count) {
+                overwritten++;
+                if (e->active) openSlot[e->type] = -1;
+                if (lastSlot[e->type] == slot) lastSlot[e->type] = -1;
+            }
+            e->id = nextId++;
+            e->type = type;
+            e->start = now;
+            e->peak = value;
+            e->count = 1;
+            lastSlot[type] = slot;
+            inserted++;
+        }
+        e->active = 1;
+        e->end = now;
+        e->revision = ++revision;
+        return *e;
+    }
+
+    void formatEvent(BufferWriter& out, const BMSEvent& e) {
+        const EventTypeInfo& info = EVENT_TYPES[e.type];
+        out.printf("{\"id\":%lu,\"type\":\"%s\",\"severity\":\"%s\",\"message\":\"%s\","
+                   "\"start\":%lu,\"end\":%lu,\"active\":%s,\"peak\":%.*f,\"count\":%u}",
+                   (unsigned long)e.id, info.name, info.severity, info.message,
+                   (unsigned long)e.start, (unsigned long)e.end, e.active ? "true" : "false",
+                   info.decimals, e.peak, e.count);
+    }
+
+public:
+    BMSEventJournal() {
+        reset();
+    }
+
+    void reset() {
+        for (int i = 0; i < EVENT_CAPACITY; i++) {
+            events[i].count = 0;
+            events[i].active = 0;
+        }
+        for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+            openSlot[t] = -1;
+            lastSlot[t] = -1;
+        }
+        nextId = 0;
+        revision = 0;
+        inserted = 0;
+        deduplicated = 0;
+        overwritten = 0;
+    }
+
+    // Gọi mỗi mẫu cho từng loại: active = điều kiện đang đúng, value = giá trị đo liên quan
+    // Không alarm và không có sự kiện mở (đa số mẫu) chỉ tốn 1 phép so sánh
+    inline void update(uint8_t type, bool active, float value, uint32_t now) {
+        if (openSlot[type] < 0 && !active) return;
+        change(type, active, value, now);
+    }
+
+    void change(uint8_t type, bool active, float value, uint32_t now) {
+        int slot = openSlot[type];
+        if (slot >= 0) {
+            BMSEvent& e = events[slot];
+            if (active) {
+                if (worse(type, value, e.peak)) e.peak = value;
+                e.end = now;
+            } else {
+                e.active = 0;
+                e.end = now;
+                e.revision = ++revision;
+                openSlot[type] = -1;
+            }
+        } else if (active) {
+            BMSEvent& e = open(type, value, now);
+            openSlot[type] = &e - events;
+        }
+    }
+
+    // Sự kiện tức thời (bắt đầu = kết thúc), ví dụ hiệu chỉnh SOC
+    void record(uint8_t type, float value, uint32_t now) {
+        BMSEvent& e = open(type, value, now);
+        e.active = 0;
+    }
+
+    bool isActive(uint8_t type) { return openSlot[type] >= 0; }
+
+    // Sự kiện gần nhất của loại này còn trong ring, NULL nếu không có
+    const BMSEvent* getLatest(uint8_t type) {
+        return lastSlot[type] >= 0 ? &events[lastSlot[type]] : NULL;
+    }
+
+    // Các sự kiện đang mở theo thứ tự loại (alert của /bms)
+    template <typename Fn>
+    void forEachActive(Fn fn) {
+        for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+            if (openSlot[t] >= 0) fn(events[openSlot[t]]);
+        }
+    }
+
+    // Ghi "revision":N,"more":bool,"events":[...] gồm các sự kiện có revision > since,
+    // theo thứ tự revision, dừng khi buffer sắp đầy (more = true, hỏi tiếp từ next).
+    // since lớn hơn revision hiện tại (client của lần boot trước) => gửi lại tất cả
+    void writeJson(BufferWriter& out, uint32_t since, uint32_t& next) {
+        if (since > revision) since = 0;
+        next = since;
+        bool more = false;
+        char item[EVENT_JSON_MAX];
+        out.printf("\"events\":[");
+        for (int n = 0; ; n++) {
+            // Sự kiện có revision nhỏ nhất còn lớn hơn next (ring nhỏ, quét tuyến tính)
+            const BMSEvent* best = NULL;
+            for (int i = 0; i < EVENT_CAPACITY; i++) {
+                const BMSEvent& e = events[i];
+                if (e.count && e.revision > next && (!best || e.revision < best->revision)) best = &e;
+            }
+            if (!best) break;
+
+            BufferWriter one(item, sizeof(item));
+            formatEvent(one, *best);
+            if (one.isTruncated() || one.length() + 48 > out.remaining()) {
+                more = true;
+                break;
+            }
+            out.printf("%s%s", n ? "," : "", item);
+            next = best->revision;
+        }
+        out.printf("],\"revision\":%lu,\"more\":%s", (unsigned long)next, more ? "true" : "false");
+    }
+
+    // Getters
+    uint32_t getRevision() { return revision; }
+    uint32_t getInsertedCount() { return inserted; }
+    uint32_t getDeduplicatedCount() { return deduplicated; }
+    uint32_t getOverwrittenCount() { return overwritten; }
+    uint32_t getCount() { return min(nextId, (uint32_t)EVENT_CAPACITY); }
+};
+
+BMSEventJournal bmsEvents;
+
+#endif
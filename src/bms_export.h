@@ -0,0 +1,274 @@
+#ifndef BMS_EXPORT_H
+#define BMS_EXPORT_H
+
+#include <Arduino.h>
+#include "bms_history.h"
+
+/*
+ * BMS Export - Xuất lịch sử (/export) dạng CSV hoặc nhị phân, theo từng chunk
+ * - Sinh dữ liệu từ ring lịch sử ngay lúc gửi: bộ nhớ cố định (1 đơn vị mã hoá
+ *   + buffer chunk của caller) dù tải bao nhiêu bản ghi
+ * - Hỗ trợ seek tới byte bất kỳ => HTTP Range / tải tiếp khi đứt kết nối
+ * - Khoảng xuất cố định theo seq [first, first + count): tải tiếp dùng lại
+ *   from/to cũ thì nội dung giống hệt (ring chỉ ghi thêm ở cuối)
+ *
+ * Định dạng:
+ *   csv   - dòng rộng cố định EXPORT_CSV_ROW byte (seek = phép chia)
+ *   bin   - header /history (version 1) + bản ghi 16 byte như trong RAM
+ *   delta - header /history (version HISTORY_VERSION_DELTA) + mỗi bản ghi là
+ *           7 varint zigzag: (Δtimestamp - interval), Δ của 6 trường còn lại
+ *           so với bản ghi trước; ~7 byte/bản ghi thay vì 16.
+ *           Seek phải mã hoá lại từ đầu (O(offset)), bộ nhớ vẫn cố định
+ */
+
+#define EXPORT_FORMAT_CSV   0
+#define EXPORT_FORMAT_BIN   1
+#define EXPORT_FORMAT_DELTA 2
+
+#define HISTORY_VERSION_DELTA 2
+
+#define EXPORT_CSV_ROW    55   // Byte mỗi dòng CSV, gồm '\n'
+#define EXPORT_UNIT_MAX   64   // Đơn vị mã hoá lớn nhất (header CSV / 1 dòng / 1 bản ghi delta)
+
+const char EXPORT_CSV_HEADER[] =
+    "timestamp_ms,pack_v,current_a,soc_pct,temp_c,min_cell_v,max_cell_v\n";
+
+class HistoryExporter {
+private:
+    BMSHistory* history;
+    uint8_t format;
+    uint32_t first;
+    uint32_t count;
+    uint32_t now;
+    size_t total;
+
+    // Đơn vị đang gửi: 0 = header, k = bản ghi first + k - 1
+    uint32_t unit;
+    uint8_t pending[EXPORT_UNIT_MAX];
+    size_t pendingLength;
+    size_t pendingPos;
+    HistoryRecord previous;   // delta: bản ghi trước
+    bool overwritten;
+
+    static size_t putVarint(uint8_t* out, int32_t value) {
+        uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+        size_t n = 0;
+        while (zigzag >= 0x80) {
+            out[n++] = (zigzag & 0x7F) | 0x80;
+            zigzag >>= 7;
+        }
+        out[n++] = zigzag;
+        return n;
+    }
+
+    // Số nguyên có scale 10^decimals -> chuỗi thập phân căn phải đúng width ký tự
+    // (width chọn theo miền int16 / uint16 của trường nên không bao giờ tràn)
+    static void putFixed(char* out, int width, int32_t value, int decimals) {
+        char tmp[16];
+        uint32_t magnitude = value < 0 ? -(int64_t)value : value;
+        uint32_t scale = decimals == 3 ? 1000 : decimals == 2 ? 100 : 10;
+        int length = snprintf(tmp, sizeof(tmp), "%s%lu.%0*lu", value < 0 ? "-" : "",
+                              (unsigned long)(magnitude / scale), decimals,
+                              (unsigned long)(magnitude % scale));
+        memset(out, ' ', width - length);
+        memcpy(out + width - length, tmp, length);
+    }
+
+    size_t headerLength() {
+        return format == EXPORT_FORMAT_CSV ? sizeof(EXPORT_CSV_HEADER) - 1 : HISTORY_HEADER_SIZE;
+    }
+
+    // Độ dài cố định mỗi bản ghi (0 = thay đổi, delta)
+    size_t recordLength() {
+        if (format == EXPORT_FORMAT_CSV) return EXPORT_CSV_ROW;
+        if (format == EXPORT_FORMAT_BIN) return sizeof(HistoryRecord);
+        return 0;
+    }
+
+    void encodeRecord(const HistoryRecord& r) {
+        if (format == EXPORT_FORMAT_BIN) {
+            memcpy(pending, &r, sizeof(r));
+            pendingLength = sizeof(r);
+        } else if (format == EXPORT_FORMAT_CSV) {
+            char* p = (char*)pending;
+            snprintf(p, 12, "%10lu,", (unsigned long)r.timestamp);
+            putFixed(p + 11, 6, r.packVoltage, 2);
+            p[17] = ',';
+            putFixed(p + 18, 7, r.current, 2);
+            p[25] = ',';
+            putFixed(p + 26, 6, r.soc, 1);
+            p[32] = ',';
+            putFixed(p + 33, 7, r.temperature, 1);
+            p[40] = ',';
+            putFixed(p + 41, 6, r.minCell, 3);
+            p[47] = ',';
+            putFixed(p + 48, 6, r.maxCell, 3);
+            p[54] = '\n';
+            pendingLength = EXPORT_CSV_ROW;
+        } else {
+            size_t n = 0;
+            n += putVarint(pending + n, (int32_t)(r.timestamp - previous.timestamp) - HISTORY_INTERVAL_MS);
+            n += putVarint(pending + n, (int32_t)r.packVoltage - previous.packVoltage);
+            n += putVarint(pending + n, (int32_t)r.current - previous.current);
+            n += putVarint(pending + n, (int32_t)r.soc - previous.soc);
+            n += putVarint(pending + n, (int32_t)r.temperature - previous.temperature);
+            n += putVarint(pending + n, (int32_t)r.minCell - previous.minCell);
+            n += putVarint(pending + n, (int32_t)r.maxCell - previous.maxCell);
+            previous = r;
+            pendingLength = n;
+        }
+    }
+
+    // Nạp đơn vị kế tiếp vào pending
+    void loadNext() {
+        if (unit == 0) {
+            if (format == EXPORT_FORMAT_CSV) {
+                memcpy(pending, EXPORT_CSV_HEADER, sizeof(EXPORT_CSV_HEADER) - 1);
+            } else {
+                history->writeHeader(pending, first, count, now,
+                                     format == EXPORT_FORMAT_DELTA ? HISTORY_VERSION_DELTA : HISTORY_VERSION);
+            }
+            pendingLength = headerLength();
+        } else {
+            uint32_t seq = first + unit - 1;
+            // Ring đã ghi đè bản ghi này (gửi chậm hơn tốc độ ghi): dừng, client tải lại
+            if (history->getNextSeq() - seq > HISTORY_CAPACITY) overwritten = true;
+            encodeRecord(history->getRecord(seq));
+        }
+        pendingPos = 0;
+        unit++;
+    }
+
+    void rewind() {
+        unit = 0;
+        pendingLength = 0;
+        pendingPos = 0;
+        memset(&previous, 0, sizeof(previous));
+        overwritten = false;
+    }
+
+public:
+    HistoryExporter(BMSHistory& source) {
+        history = &source;
+        format = EXPORT_FORMAT_CSV;
+        first = 0;
+        count = 0;
+        now = 0;
+        total = 0;
+        rewind();
+    }
+
+    // Chọn khoảng [from, to) (kẹp vào phần còn trong ring); false nếu from đã bị ghi đè
+    bool begin(uint8_t exportFormat, uint32_t from, uint32_t to, uint32_t nowMs, bool strict) {
+        uint32_t next = history->getNextSeq();
+        uint32_t oldest = next > HISTORY_CAPACITY ? next - HISTORY_CAPACITY : 0;
+        if (strict && from < oldest) return false;
+        format = exportFormat;
+        first = constrain(from, oldest, next);
+        count = constrain(to, first, next) - first;
+        now = nowMs;
+
+        // Tổng số byte: định dạng cố định tính thẳng, delta phải mã hoá 1 lượt
+        if (recordLength()) {
+            total = headerLength() + (size_t)count * recordLength();
+        } else {
+            rewind();
+            total = 0;
+            while (unit <= count) {
+                loadNext();
+                total += pendingLength;
+            }
+        }
+        rewind();
+        return true;
+    }
+
+    // Đặt vị trí byte kế tiếp sẽ đọc
+    void seek(size_t offset) {
+        rewind();
+        if (offset >= total) {
+            unit = count + 1;
+            return;
+        }
+        size_t skip = offset;
+        size_t fixed = recordLength();
+        if (fixed && offset >= headerLength()) {
+            uint32_t k = (offset - headerLength()) / fixed;
+            unit = k + 1;
+            skip = (offset - headerLength()) - (size_t)k * fixed;
+        }
+        loadNext();
+        while (skip >= pendingLength) {
+            skip -= pendingLength;
+            loadNext();
+        }
+        pendingPos = skip;
+    }
+
+    // Đọc tối đa size byte tiếp theo, trả về số byte (0 = hết)
+    size_t read(uint8_t* out, size_t size) {
+        size_t n = 0;
+        while (n < size) {
+            if (pendingPos == pendingLength) {
+                if (unit > count) break;
+                loadNext();
+            }
+            size_t take = min(size - n, pendingLength - pendingPos);
+            memcpy(out + n, pending + pendingPos, take);
+            pendingPos += take;
+            n += take;
+        }
+        return n;
+    }
+
+    static bool parseFormat(const char* name, uint8_t& out) {
+        if (strcmp(name, "csv") == 0) out = EXPORT_FORMAT_CSV;
+        else if (strcmp(name, "bin") == 0) out = EXPORT_FORMAT_BIN;
+        else if (strcmp(name, "delta") == 0) out = EXPORT_FORMAT_DELTA;
+        else return false;
+        return true;
+    }
+
+    // Getters
+    size_t size() { return total; }
+    uint32_t getFirst() { return first; }
+    uint32_t getCount() { return count; }
+    bool isOverwritten() { return overwritten; }
+    const char* contentType() { return format == EXPORT_FORMAT_CSV ? "text/csv" : "application/octet-stream"; }
+    const char* formatName() { return format == EXPORT_FORMAT_CSV ? "csv" : format == EXPORT_FORMAT_BIN ? "bin" : "delta"; }
+};
+
+HistoryExporter historyExporter(bmsHistory);
+
+// ============ HTTP RANGE ============
+
+// "bytes=a-b" / "bytes=a-" / "bytes=-n" trên tổng total byte -> [start, end]
+// Trả về false nếu không đáp ứng được (416); nhiều khoảng thì bỏ qua Range (gửi cả)
+bool parseByteRange(const char* header, size_t total, size_t& start, size_t& end, bool& ranged) {
+    ranged = false;
+    start = 0;
+    end = total ? total - 1 : 0;
+    if (!header || strncmp(header, "bytes=", 6) != 0 || strchr(header, ',')) return true;
+
+    const char* spec = header + 6;
+    const char* dash = strchr(spec, '-');
+    if (!dash) return true;
+    char* tail;
+    if (dash == spec) {
+        unsigned long suffix = strtoul(dash + 1, &tail, 10);
+        if (tail == dash + 1 || suffix == 0 || total == 0) return false;
+        start = suffix >= total ? 0 : total - suffix;
+    } else {
+        start = strtoul(spec, &tail, 10);
+        if (tail != dash || start >= total) return false;
+        if (dash[1]) {
+            unsigned long last = strtoul(dash + 1, &tail, 10);
+            if (last < start) return false;
+            end = min((size_t)last, total - 1);
+        }
+    }
+    ranged = true;
+    return true;
+}
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef BMS_FAULTS_H
+#define BMS_FAULTS_H
+
+#include <Arduino.h>
+#include "bms_sensors.h"
+#include "bms_memory.h"
+
+/*
+ * BMS Faults - Tiêm lỗi vào driver cảm biến để thử các đường bảo vệ
+ * - BMSFaultInjector bọc 1 BMSSensorDriver (giả lập hoặc AFE) và sửa giá trị đọc
+ *   được theo kịch bản; readAndUpdateBMS(), fleet simulator, bench không đổi gì
+ * - Kịch bản: các bước cách nhau ';', mỗi bước "<loại> [đích] [key=value ...]"
+ *     at=ms     bắt đầu, tính từ arm() (mặc định 0)
+ *     for=ms    thời lượng (mặc định 0 = tới khi clear())
+ *     value=x   biên độ;  rate=x  tốc độ dốc mỗi giây (0 = nhảy bậc)
+ *   cell N      cộng value V vào cell N (từ 1): âm = sụt áp, dương = quá sạc
+ *   temp N      cộng value °C vào kênh nhiệt N (từ 0, như BMSTemperatureBank)
+ *   current     dòng đo = value A (xung dòng, ngắn mạch)
+ *   open [N]    kênh nhiệt N hở mạch (ADC đầy thang), không có N = mọi kênh
+ *   dropout     readAllSensors() trả false (mất bus / lỗi CRC)
+ *   stuck N     cell N giữ nguyên giá trị lúc bắt đầu lỗi
+ *   noise       nhiễu Gauss sigma = value V trên mọi cell
+ *   Ví dụ: "cell 2 value=-1 rate=0.5 at=5000; temp 1 value=40 rate=1 at=8000 for=20000"
+ * - Chưa arm() hoặc không có bước nào đang chạy: giá trị đi qua nguyên vẹn
+ */
+
+#define FAULT_MAX_STEPS   8
+#define FAULT_MAX_CELLS   16     // BQ76952
+#define FAULT_TOKEN_MAX   24
+
+#define FAULT_CELL        0
+#define FAULT_TEMP        1
+#define FAULT_CURRENT     2
+#define FAULT_OPEN        3
+#define FAULT_DROPOUT     4
+#define FAULT_STUCK       5
+#define FAULT_NOISE       6
+#define FAULT_KIND_COUNT  7
+
+const char* const FAULT_KIND_NAMES[FAULT_KIND_COUNT] = {
+    "cell", "temp", "current", "open", "dropout", "stuck", "noise",
+};
+
+struct FaultStep {
+    uint8_t kind;
+    int8_t target;           // Cell (từ 1) hoặc kênh nhiệt (từ 0), -1 = không có
+    unsigned long atMs;
+    unsigned long forMs;     // 0 = không hết
+    float value;
+    float rate;              // Đơn vị value mỗi giây, 0 = nhảy bậc
+    float held;              // stuck: giá trị giữ
+    bool holding;
+};
+
+class BMSFaultInjector : public BMSSensorDriver {
+private:
+    BMSSensorDriver& inner;
+    FaultStep steps[FAULT_MAX_STEPS];
+    uint8_t stepCount;
+    bool armed;
+    unsigned long originMs;
+
+    // Giá trị sau khi tiêm lỗi của lần đọc gần nhất
+    float cellVoltages[FAULT_MAX_CELLS];
+    float current;
+    BMSTemperatureBank scratch;   // Kênh nhiệt của driver trước khi sửa
+    uint32_t noiseState;
+    uint32_t droppedReads;
+    uint32_t faultedReads;
+
+    static bool needsTarget(uint8_t kind) {
+        return kind == FAULT_CELL || kind == FAULT_TEMP || kind == FAULT_OPEN || kind == FAULT_STUCK;
+    }
+
+    // Token kế tiếp trong [p, end), bỏ khoảng trắng; false khi hết
+    static bool nextToken(const char*& p, const char* end, char* out) {
+        while (p < end && isspace((unsigned char)*p)) p++;
+        if (p >= end) return false;
+        size_t n = 0;
+        while (p < end && !isspace((unsigned char)*p)) {
+            if (n + 1 >= FAULT_TOKEN_MAX) return false;
+            out[n++] = *p++;
+        }
+        out[n] = '\0';
+        return true;
+    }
+
+    bool parseStep(const char* p, const char* end) {
+        char token[FAULT_TOKEN_MAX];
+        if (!nextToken(p, end, token)) return true;   // Bước rỗng ("a; ;b")
+        if (stepCount >= FAULT_MAX_STEPS) return false;
+        FaultStep& s = steps[stepCount];
+        memset(&s, 0, sizeof(s));
+        s.target = -1;
+        int kind = 0;
+        while (kind < FAULT_KIND_COUNT && strcmp(token, FAULT_KIND_NAMES[kind]) != 0) kind++;
+        if (kind == FAULT_KIND_COUNT) return false;
+        s.kind = kind;
+
+        while (nextToken(p, end, token)) {
+            char* eq = strchr(token, '=');
+            char* rest;
+            if (!eq) {
+                long target = strtol(token, &rest, 10);
+                if (*rest || !needsTarget(s.kind)) return false;
+                s.target = (int8_t)constrain(target, -1L, 127L);
+                continue;
+            }
+            *eq = '\0';
+            float value = strtof(eq + 1, &rest);
+            if (*rest || eq[1] == '\0') return false;
+            if (strcmp(token, "at") == 0 && value >= 0) s.atMs = (unsigned long)value;
+            else if (strcmp(token, "for") == 0 && value >= 0) s.forMs = (unsigned long)value;
+            else if (strcmp(token, "value") == 0) s.value = value;
+            else if (strcmp(token, "rate") == 0 && value >= 0) s.rate = value;
+            else return false;
+        }
+
+        if (needsTarget(s.kind) && !(s.kind == FAULT_OPEN && s.target < 0)) {
+            bool cell = s.kind == FAULT_CELL || s.kind == FAULT_STUCK;
+            int limit = cell ? FAULT_MAX_CELLS : TEMP_CHANNELS - 1;
+            if (s.target < (cell ? 1 : 0) || s.target > limit) return false;
+        }
+        stepCount++;
+        return true;
+    }
+
+    // Biên độ tại thời điểm t của bước (dốc rate tới value)
+    static float magnitude(const FaultStep& s, unsigned long t) {
+        if (s.rate <= 0) return s.value;
+        float ramp = s.rate * (t - s.atMs) / 1000.0f;
+        return s.value < 0 ? max(s.value, -ramp) : min(s.value, ramp);
+    }
+
+    bool active(const FaultStep& s, unsigned long t) {
+        return armed && t >= s.atMs && (s.forMs == 0 || t - s.atMs < s.forMs);
+    }
+
+    float gaussian(float sigma) {
+        float sum = 0;
+        for (int i = 0; i < 4; i++) {
+            noiseState = noiseState * 1664525u + 1013904223u;
+            sum += (noiseState >> 8) * (1.0f / 16777216.0f);
+        }
+        return (sum - 2.0f) * 1.7320508f * sigma;
+    }
+
+public:
+    BMSFaultInjector(BMSSensorDriver& driver) : inner(driver) {
+        stepCount = 0;
+        armed = false;
+        originMs = 0;
+        current = 0;
+        for (int i = 0; i < FAULT_MAX_CELLS; i++) cellVoltages[i] = 0;
+        noiseState = 1;
+        droppedReads = 0;
+        faultedReads = 0;
+    }
+
+    // Nạp kịch bản (chưa chạy tới khi arm()); false nếu sai cú pháp, khi đó không còn bước nào
+    bool load(const char* script) {
+        armed = false;
+        stepCount = 0;
+        const char* p = script;
+        while (*p) {
+            const char* end = strchr(p, ';');
+            if (!end) end = p + strlen(p);
+            if (!parseStep(p, end)) {
+                stepCount = 0;
+                return false;
+            }
+            p = *end ? end + 1 : end;
+        }
+        return true;
+    }
+
+    // Mốc thời gian của at= (ms, cùng gốc với millis())
+    void arm(unsigned long now) {
+        originMs = now;
+        armed = true;
+        for (int i = 0; i < stepCount; i++) steps[i].holding = false;
+        droppedReads = 0;
+        faultedReads = 0;
+    }
+
+    void clear() {
+        armed = false;
+        stepCount = 0;
+    }
+
+    void begin() override {
+        inner.begin();
+    }
+
+    bool readAllSensors() override {
+        unsigned long t = millis() - originMs;
+        for (int i = 0; i < stepCount; i++) {
+            if (steps[i].kind == FAULT_DROPOUT && active(steps[i], t)) {
+                droppedReads++;
+                return false;
+            }
+        }
+        if (!inner.readAllSensors()) return false;
+
+        int cells = min(inner.getCellCount(), FAULT_MAX_CELLS);
+        for (int c = 0; c < cells; c++) cellVoltages[c] = inner.getCellVoltage(c + 1);
+        current = inner.getCurrent();
+
+        bool faulted = false;
+        for (int i = 0; i < stepCount; i++) {
+            FaultStep& s = steps[i];
+            if (!active(s, t)) {
+                s.holding = false;
+                continue;
+            }
+            faulted = true;
+            int cell = s.target - 1;
+            switch (s.kind) {
+                case FAULT_CELL:
+                    if (cell < cells) cellVoltages[cell] += magnitude(s, t);
+                    break;
+                case FAULT_CURRENT:
+                    current = s.value;
+                    break;
+                case FAULT_STUCK:
+                    if (cell >= cells) break;
+                    if (!s.holding) {
+                        s.held = cellVoltages[cell];
+                        s.holding = true;
+                    }
+                    cellVoltages[cell] = s.held;
+                    break;
+                case FAULT_NOISE:
+                    for (int c = 0; c < cells; c++) cellVoltages[c] += gaussian(s.value);
+                    break;
+            }
+        }
+        if (faulted) faultedReads++;
+        return true;
+    }
+
+    // Kênh nhiệt: đi thẳng vào bank nếu không có lỗi nhiệt đang chạy, nếu có thì
+    // đọc qua bank tạm rồi chép sang (không ghi 2 lần vào min/max/trung bình)
+    void readThermistors(BMSTemperatureBank& bank) override {
+        unsigned long t = millis() - originMs;
+        bool thermal = false;
+        for (int i = 0; i < stepCount; i++) {
+            thermal |= (steps[i].kind == FAULT_TEMP || steps[i].kind == FAULT_OPEN) && active(steps[i], t);
+        }
+        if (!thermal) {
+            inner.readThermistors(bank);
+            return;
+        }
+        inner.readThermistors(scratch);
+        for (int ch = 0; ch < TEMP_CHANNELS; ch++) {
+            const BMSTemperatureBank::Channel& c = scratch.getChannel(ch);
+            if (!c.present) continue;
+            float offset = 0;
+            bool open = c.fault;
+            for (int i = 0; i < stepCount; i++) {
+                const FaultStep& s = steps[i];
+                bool all = s.kind == FAULT_OPEN && s.target < 0;
+                if ((s.target != ch && !all) || !active(s, t)) continue;
+                if (s.kind == FAULT_TEMP) offset += magnitude(s, t);
+                if (s.kind == FAULT_OPEN) open = true;
+            }
+            if (open) {
+                bank.setAdc(ch, TEMP_ADC_MAX);
+            } else {
+                bank.setCelsius(ch, scratch.getCelsius(ch) + offset);
+            }
+        }
+    }
+
+    int getCellCount() override { return inner.getCellCount(); }
+    float getCellVoltage(int cellNum) override {
+        return cellNum >= 1 && cellNum <= FAULT_MAX_CELLS ? cellVoltages[cellNum - 1] : 0.0f;
+    }
+    float getCurrent() override { return current; }
+    float getTemperature() override { return inner.getTemperature(); }
+    float getPackVoltage() override {
+        float sum = 0;
+        for (int c = 0; c < min(inner.getCellCount(), FAULT_MAX_CELLS); c++) sum += cellVoltages[c];
+        return sum;
+    }
+
+    // "Faults: ..." + 1 dòng mỗi bước (/fault, /info)
+    void printTo(BufferWriter& out) {
+        unsigned long t = millis() - originMs;
+        out.printf("Faults: %d steps, %s, %lu faulted / %lu dropped reads\n", stepCount,
+                   armed ? "armed" : "idle", (unsigned long)faultedReads, (unsigned long)droppedReads);
+        for (int i = 0; i < stepCount; i++) {
+            const FaultStep& s = steps[i];
+            out.printf("  %s", FAULT_KIND_NAMES[s.kind]);
+            if (s.target >= 0) out.printf(" %d", s.target);
+            out.printf(" value=%.3f rate=%.3f at=%lu for=%lu%s\n", s.value, s.rate,
+                       (unsigned long)s.atMs, (unsigned long)s.forMs, active(s, t) ? " [active]" : "");
+        }
+    }
+
+    // Getters
+    int getStepCount() { return stepCount; }
+    const FaultStep& getStep(int i) { return steps[i]; }
+    bool isArmed() { return armed; }
+    unsigned long getOrigin() { return originMs; }
+    uint32_t getFaultedReads() { return faultedReads; }
+    uint32_t getDroppedReads() { return droppedReads; }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef BMS_HISTORY_H
+#define BMS_HISTORY_H
+
+#include <Arduino.h>
+#include "bms_data.h"
+
+/*
+ * BMS History - Lịch sử xu hướng cho biểu đồ dashboard (/history)
+ * - Ring buffer tĩnh HISTORY_CAPACITY bản ghi 16 byte, 1 bản ghi mỗi
+ *   HISTORY_INTERVAL_MS (mặc định 1s x 3600 = 1 giờ, 57.6 KB)
+ * - Dòng điện là trung bình các mẫu trong khoảng, các giá trị khác lấy mẫu cuối;
+ *   lấy mẫu chậm hơn khoảng ghi (IDLE 2s) thì mỗi mẫu 1 bản ghi
+ * - Mỗi bản ghi có seq tăng liên tục từ lúc boot: client chỉ xin phần mới
+ *   (/history?since=seq), server gửi thẳng 2 đoạn liên tục của ring, không copy
+ *
+ * Response (little-endian): header HISTORY_HEADER_SIZE byte
+ *   u16 magic 0x4842 ("BH") | u8 version | u8 record size | u32 interval (ms)
+ *   | u32 seq bản ghi đầu | u32 số bản ghi | u32 millis() hiện tại
+ * rồi các bản ghi:
+ *   u32 timestamp (ms) | u16 pack V (10mV) | i16 current (10mA) | u16 SOC (0.1%)
+ *   | i16 nhiệt độ nóng nhất (0.1°C) | u16 cell thấp nhất (mV) | u16 cell cao nhất (mV)
+ */
+
+#ifndef HISTORY_CAPACITY
+#define HISTORY_CAPACITY 3600
+#endif
+#ifndef HISTORY_INTERVAL_MS
+#define HISTORY_INTERVAL_MS 1000
+#endif
+
+#define HISTORY_MAGIC       0x4842
+#define HISTORY_VERSION     1
+#define HISTORY_HEADER_SIZE 20
+
+// Bố cục trong RAM = bố cục trên dây (ESP32 little-endian)
+struct HistoryRecord {
+    uint32_t timestamp;
+    uint16_t packVoltage;
+    int16_t current;
+    uint16_t soc;
+    int16_t temperature;
+    uint16_t minCell;
+    uint16_t maxCell;
+};
+
+static_assert(sizeof(HistoryRecord) == 16, "HistoryRecord must stay 16 bytes");
+
+// Đoạn bản ghi liên tục trong ring
+struct HistorySpan {
+    const uint8_t* data;
+    size_t length;   // byte
+};
+
+class BMSHistory {
+private:
+    HistoryRecord records[HISTORY_CAPACITY];
+    uint32_t nextSeq;          // seq của bản ghi sẽ ghi tiếp
+    uint32_t lastRecordMs;
+    bool hasRecord;
+
+    // Cộng dồn dòng điện trong khoảng hiện tại
+    float currentSum;
+    uint32_t currentSamples;
+
+    static uint16_t scaleU16(float value, float factor) {
+        long scaled = lroundf(value * factor);
+        return (uint16_t)constrain(scaled, 0L, 65535L);
+    }
+
+    static int16_t scaleI16(float value, float factor) {
+        long scaled = lroundf(value * factor);
+        return (int16_t)constrain(scaled, -32768L, 32767L);
+    }
+
+    static void put16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = v >> 8;
+    }
+
+    static void put32(uint8_t* p, uint32_t v) {
+        put16(p, v & 0xFFFF);
+        put16(p + 2, v >> 16);
+    }
+
+public:
+    BMSHistory() {
+        reset();
+    }
+
+    void reset() {
+        nextSeq = 0;
+        lastRecordMs = 0;
+        hasRecord = false;
+        currentSum = 0;
+        currentSamples = 0;
+    }
+
+    // Gọi sau mỗi mẫu (updateBMSData); ghi bản ghi khi đủ HISTORY_INTERVAL_MS
+    void onSample(const BMSData& data, uint32_t now) {
+        currentSum += data.current;
+        currentSamples++;
+        if (hasRecord && now - lastRecordMs < HISTORY_INTERVAL_MS) return;
+
+        float minV = data.cellVoltages[0];
+        float maxV = data.cellVoltages[0];
+        for (int i = 1; i < NUM_CELLS; i++) {
+            if (data.cellVoltages[i] < minV) minV = data.cellVoltages[i];
+            if (data.cellVoltages[i] > maxV) maxV = data.cellVoltages[i];
+        }
+
+        HistoryRecord& r = records[nextSeq % HISTORY_CAPACITY];
+        r.timestamp = now;
+        r.packVoltage = scaleU16(data.packVoltage, 100.0f);
+        r.current = scaleI16(currentSum / currentSamples, 100.0f);
+        r.soc = scaleU16(data.soc, 10.0f);
+        r.temperature = scaleI16(data.packTemp, 10.0f);
+        r.minCell = scaleU16(minV, 1000.0f);
+        r.maxCell = scaleU16(maxV, 1000.0f);
+        nextSeq++;
+
+        // Giữ lưới thời gian đều (không trôi theo độ trễ của vòng lặp)
+        lastRecordMs = (hasRecord && now - lastRecordMs < 2 * HISTORY_INTERVAL_MS)
+                       ? lastRecordMs + HISTORY_INTERVAL_MS : now;
+        hasRecord = true;
+        currentSum = 0;
+        currentSamples = 0;
+    }
+
+    // Các bản ghi có seq >= since (since quá cũ thì từ bản ghi cũ nhất còn giữ,
+    // since lớn hơn seq hiện tại - client của lần boot trước - thì gửi lại tất cả)
+    // Trả về số bản ghi, first = seq bản ghi đầu, spans[0..1] theo thứ tự thời gian
+    uint32_t select(uint32_t since, uint32_t& first, HistorySpan spans[2]) {
+        uint32_t oldest = nextSeq > HISTORY_CAPACITY ? nextSeq - HISTORY_CAPACITY : 0;
+        if (since < oldest || since > nextSeq) since = oldest;
+        first = since;
+        uint32_t count = nextSeq - since;
+
+        uint32_t start = since % HISTORY_CAPACITY;
+        uint32_t firstPart = min(count, (uint32_t)HISTORY_CAPACITY - start);
+        spans[0].data = (const uint8_t*)&records[start];
+        spans[0].length = firstPart * sizeof(HistoryRecord);
+        spans[1].data = (const uint8_t*)&records[0];
+        spans[1].length = (count - firstPart) * sizeof(HistoryRecord);
+        return count;
+    }
+
+    void writeHeader(uint8_t* out, uint32_t first, uint32_t count, uint32_t now,
+                     uint8_t version = HISTORY_VERSION) {
+        put16(out, HISTORY_MAGIC);
+        out[2] = version;
+        out[3] = sizeof(HistoryRecord);
+        put32(out + 4, HISTORY_INTERVAL_MS);
+        put32(out + 8, first);
+        put32(out + 12, count);
+        put32(out + 16, now);
+    }
+
+    // Getters
+    uint32_t getNextSeq() { return nextSeq; }
+    uint32_t getCount() { return min(nextSeq, (uint32_t)HISTORY_CAPACITY); }
+    const HistoryRecord& getRecord(uint32_t seq) { return records[seq % HISTORY_CAPACITY]; }
+};
+
+BMSHistory bmsHistory;
+
+#endif
@@ -4,9 +4,11 @@
 #include <Arduino.h>
 #include "bms_html_styles.h"
 #include "bms_html_scripts.h"
+#include "bms_html_history.h"
 
-String getHTMLPage() {
-  String html = R"rawliteral(
+// Trang được chia thành các phần hằng trong flash:
+// HEAD + STYLES + BODY + HISTORY_WORKER + SCRIPT_OPEN + SCRIPTS + HISTORY_SCRIPTS + TAIL
+const char HTML_PAGE_HEAD[] PROGMEM = R"rawliteral(
 <!DOCTYPE html>
 <html lang="vi">
 <head>
@@ -16,10 +18,7 @@ String getHTMLPage() {
     <style>
 )rawliteral";
 
-  // Nhúng CSS từ bms_html_styles.h
-  html += getHTMLStyles();
-
-  html += R"rawliteral(
+const char HTML_PAGE_BODY[] PROGMEM = R"rawliteral(
     </style>
 </head>
 <body>
@@ -91,6 +90,14 @@ String getHTMLPage() {
                 </div>
             </div>
 
+            <div class="section trend-section" id="trendSection">
+                <div class="trend-header">
+                    <h2>📈 Xu Hướng</h2>
+                    <div class="trend-windows" id="trendWindows"></div>
+                </div>
+                <div class="trend-grid" id="trendGrid"></div>
+            </div>
+
             <div class="section">
                 <h2>🛡️ Protection Status</h2>
                 <div class="protection-grid">
@@ -133,6 +140,22 @@ String getHTMLPage() {
                             <div class="protection-status">Normal</div>
                         </div>
                     </div>
+
+                    <div class="protection-item" id="protectComms">
+                        <div class="protection-icon">⚠️</div>
+                        <div class="protection-info">
+                            <div class="protection-label">Sensor Bus</div>
+                            <div class="protection-status">Normal</div>
+                        </div>
+                    </div>
+
+                    <div class="protection-item" id="protectThermal">
+                        <div class="protection-icon">⚠️</div>
+                        <div class="protection-info">
+                            <div class="protection-label">Temp Sensors</div>
+                            <div class="protection-status">Normal</div>
+                        </div>
+                    </div>
                 </div>
             </div>
 
@@ -145,18 +168,48 @@ String getHTMLPage() {
         </div>
     </div>
 
-    <script>
+    <script type="text/js-worker" id="historyWorker">
 )rawliteral";
 
-  // Nhúng JS từ bms_html_scripts.h
-  html += getHTMLScripts();
+// Đóng script của worker (không chạy trên trang), mở script dashboard
+const char HTML_PAGE_SCRIPT_OPEN[] PROGMEM = R"rawliteral(
+    </script>
+    <script>
+)rawliteral";
 
-  html += R"rawliteral(
+const char HTML_PAGE_TAIL[] PROGMEM = R"rawliteral(
     </script>
 </body>
 </html>
 )rawliteral";
 
+const char* const HTML_PAGE_PARTS[] = {
+  HTML_PAGE_HEAD,
+  HTML_STYLES,   // Nhúng CSS từ bms_html_styles.h
+  HTML_PAGE_BODY,
+  HTML_HISTORY_WORKER,   // Mã Web Worker từ bms_html_history.h
+  HTML_PAGE_SCRIPT_OPEN,
+  HTML_SCRIPTS,  // Nhúng JS từ bms_html_scripts.h
+  HTML_HISTORY_SCRIPTS,  // Biểu đồ xu hướng từ bms_html_history.h
+  HTML_PAGE_TAIL
+};
+
+const int HTML_PAGE_PART_COUNT = sizeof(HTML_PAGE_PARTS) / sizeof(HTML_PAGE_PARTS[0]);
+
+size_t getHTMLPageLength() {
+  size_t total = 0;
+  for (int i = 0; i < HTML_PAGE_PART_COUNT; i++) {
+    total += strlen_P(HTML_PAGE_PARTS[i]);
+  }
+  return total;
+}
+
+String getHTMLPage() {
+  String html;
+  html.reserve(getHTMLPageLength());
+  for (int i = 0; i < HTML_PAGE_PART_COUNT; i++) {
+    html += HTML_PAGE_PARTS[i];
+  }
   return html;
 }
 
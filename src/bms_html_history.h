@@ -0,0 +1,449 @@
+#ifndef BMS_HTML_HISTORY_H
+#define BMS_HTML_HISTORY_H
+
+#include <Arduino.h>
+
+/*
+ * Biểu đồ xu hướng (pack V, dòng, SOC, nhiệt độ) từ /history
+ * - Worker (nhúng trong trang, tạo từ Blob): giải mã bản ghi nhị phân, giữ toàn bộ
+ *   mẫu, giảm mẫu bằng LTTB với bucket neo theo thời gian tuyệt đối
+ *   (bucket k = [k*bucketMs, (k+1)*bucketMs)): mẫu mới chỉ làm đổi 1-2 bucket cuối
+ * - Luồng chính: mỗi bucket = 1 cột pixel của canvas; bucket mới thì dịch ảnh
+ *   sang trái (drawImage) và chỉ vẽ lại đoạn cuối, vẽ lại toàn bộ khi đổi thang đo
+ * - Chỉ xin phần mới: /history?since=<seq kế tiếp>
+ */
+
+// Chạy trong Worker
+const char HTML_HISTORY_WORKER[] PROGMEM = R"rawliteral(
+const HISTORY_MAGIC = 0x4842;
+const HISTORY_HEADER = 20;
+const SERIES_COUNT = 4;          // pack V, current, SOC, nhiệt độ
+const MAX_SAMPLES = 86400;
+const WARMUP_BUCKETS = 32;
+
+let times = [];
+let values = [[], [], [], []];
+let removed = 0;                 // Số mẫu đã bỏ ở đầu mảng (chỉ số tuyệt đối = removed + i)
+let nextSeq = 0;
+let columns = 300;
+let windowMs = 3600000;
+let bucketMs = 12000;
+let selected = [new Map(), new Map(), new Map(), new Map()];   // bucket -> chỉ số tuyệt đối
+
+function parseHistory(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < HISTORY_HEADER || view.getUint16(0, true) !== HISTORY_MAGIC) return null;
+    const size = view.getUint8(3);
+    const first = view.getUint32(8, true);
+    const count = Math.min(view.getUint32(12, true), Math.floor((buffer.byteLength - HISTORY_HEADER) / size));
+    const records = [];
+    for (let i = 0; i < count; i++) {
+        const o = HISTORY_HEADER + i * size;
+        records.push([
+            view.getUint32(o, true),
+            view.getUint16(o + 4, true) / 100,
+            view.getInt16(o + 6, true) / 100,
+            view.getUint16(o + 8, true) / 10,
+            view.getInt16(o + 10, true) / 10
+        ]);
+    }
+    return { first: first, records: records };
+}
+
+function resetSamples() {
+    times = [];
+    values = [[], [], [], []];
+    removed = 0;
+    selected.forEach(m => m.clear());
+}
+
+// Chỉ số đầu tiên có times[i] >= t
+function lowerBound(t) {
+    let lo = 0, hi = times.length;
+    while (lo < hi) {
+        const mid = (lo + hi) >> 1;
+        if (times[mid] < t) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// LTTB 1 bucket: điểm tạo tam giác lớn nhất với điểm đã chọn của bucket trước (A)
+// và trung bình bucket sau (C); bucket cuối (đang ghi) lấy mẫu mới nhất
+function selectBucket(s, k, isLast) {
+    const i0 = lowerBound(k * bucketMs);
+    const i1 = lowerBound((k + 1) * bucketMs);
+    if (i0 >= i1) return -1;
+    if (isLast) return i1 - 1;
+
+    const ys = values[s];
+    const j0 = i1, j1 = lowerBound((k + 2) * bucketMs);
+    if (j0 >= j1) return i1 - 1;
+    let cx = 0, cy = 0;
+    for (let j = j0; j < j1; j++) {
+        cx += times[j];
+        cy += ys[j];
+    }
+    cx /= (j1 - j0);
+    cy /= (j1 - j0);
+
+    const prev = selected[s].get(k - 1);
+    const a = (prev !== undefined && prev - removed >= 0) ? prev - removed : i0;
+    const ax = times[a], ay = ys[a];
+    let best = i0, bestArea = -1;
+    for (let i = i0; i < i1; i++) {
+        const area = Math.abs((ax - cx) * (ys[i] - ay) - (ax - times[i]) * (cy - ay));
+        if (area > bestArea) {
+            bestArea = area;
+            best = i;
+        }
+    }
+    return best;
+}
+
+function buildUpdate(kFrom, full) {
+    const kLast = Math.floor(times[times.length - 1] / bucketMs);
+    kFrom = Math.max(kFrom, kLast - columns + 1);
+    const series = [];
+    const latest = [];
+    for (let s = 0; s < SERIES_COUNT; s++) {
+        const out = new Float32Array(kLast - kFrom + 1);
+        // Vẽ lại toàn bộ: chạy trước vài bucket ngoài cửa sổ để mép trái có điểm A
+        for (let k = full ? kFrom - WARMUP_BUCKETS : kFrom; k <= kLast; k++) {
+            const i = selectBucket(s, k, k === kLast);
+            if (i < 0) selected[s].delete(k);
+            else selected[s].set(k, removed + i);
+            if (k >= kFrom) out[k - kFrom] = i < 0 ? NaN : values[s][i];
+        }
+        for (const k of selected[s].keys()) {
+            if (k < kLast - columns - WARMUP_BUCKETS) selected[s].delete(k);
+        }
+        series.push(out);
+        latest.push(values[s][values[s].length - 1]);
+    }
+    return { type: 'update', full: full, kFrom: kFrom, kLast: kLast, bucketMs: bucketMs,
+             series: series, latest: latest, nextSeq: nextSeq };
+}
+
+function postUpdate(update) {
+    self.postMessage(update, update.series.map(a => a.buffer));
+}
+
+function onHistory(buffer) {
+    const parsed = parseHistory(buffer);
+    if (!parsed || parsed.records.length === 0) {
+        if (parsed) self.postMessage({ type: 'seq', nextSeq: nextSeq });
+        return;
+    }
+    const records = parsed.records;
+
+    // seq lùi (ESP32 khởi động lại) hoặc thời gian lùi: bỏ dữ liệu cũ
+    let full = false;
+    if (parsed.first < nextSeq || (times.length && records[0][0] < times[times.length - 1])) {
+        resetSamples();
+        full = true;
+    }
+    if (times.length === 0) full = true;
+
+    const kChanged = Math.floor(records[0][0] / bucketMs);
+    records.forEach(r => {
+        times.push(r[0]);
+        for (let s = 0; s < SERIES_COUNT; s++) values[s].push(r[s + 1]);
+    });
+    nextSeq = parsed.first + records.length;
+
+    if (times.length > MAX_SAMPLES * 1.1) {
+        const drop = times.length - MAX_SAMPLES;
+        times.splice(0, drop);
+        values.forEach(v => v.splice(0, drop));
+        removed += drop;
+    }
+    postUpdate(buildUpdate(full ? -Infinity : kChanged - 1, full));
+}
+
+self.onmessage = e => {
+    const msg = e.data;
+    if (msg.type === 'config') {
+        columns = Math.max(10, msg.columns | 0);
+        windowMs = msg.windowMs;
+        const width = Math.max(1, Math.ceil(windowMs / columns));
+        // Cùng độ rộng bucket (chỉ đổi số cột) thì giữ các điểm đã chọn
+        if (width !== bucketMs) selected.forEach(m => m.clear());
+        bucketMs = width;
+        if (times.length) postUpdate(buildUpdate(-Infinity, true));
+    } else if (msg.type === 'history') {
+        onHistory(msg.buffer);
+    }
+};
+)rawliteral";
+
+// Chạy trên luồng chính, sau HTML_SCRIPTS
+const char HTML_HISTORY_SCRIPTS[] PROGMEM = R"rawliteral(
+const TREND_SERIES = [
+    { name: 'Pack Voltage', unit: 'V', color: '#667eea', digits: 2, minSpan: 0.1 },
+    { name: 'Current', unit: 'A', color: '#ff9800', digits: 2, minSpan: 0.5 },
+    { name: 'SOC', unit: '%', color: '#43a047', digits: 1, min: 0, max: 100 },
+    { name: 'Temperature', unit: '°C', color: '#e53935', digits: 1, minSpan: 2 }
+];
+const TREND_WINDOWS = [[300, '5 phút'], [900, '15 phút'], [3600, '1 giờ']];
+
+const trends = {
+    worker: null,
+    charts: [],
+    windowMs: 3600000,
+    columns: 0,
+    nextSeq: 0,
+    inFlight: false,
+    queue: [],
+    frameRequested: false,
+    stats: { updates: 0, fullRedraws: 0, totalMs: 0, maxMs: 0 }
+};
+
+function initTrends() {
+    const grid = document.getElementById('trendGrid');
+    const source = document.getElementById('historyWorker');
+    if (!grid || !source || !window.Worker) {
+        const section = document.getElementById('trendSection');
+        if (section) section.classList.add('hidden');
+        return;
+    }
+
+    trends.worker = new Worker(URL.createObjectURL(new Blob([source.textContent], { type: 'text/javascript' })));
+    trends.worker.onmessage = e => {
+        if (e.data.nextSeq !== undefined) trends.nextSeq = e.data.nextSeq;
+        if (e.data.type !== 'update') return;
+        trends.queue.push(e.data);
+        if (trends.frameRequested) return;
+        trends.frameRequested = true;
+        requestAnimationFrame(() => {
+            trends.frameRequested = false;
+            const queue = trends.queue;
+            trends.queue = [];
+            queue.forEach(applyTrendUpdate);
+        });
+    };
+
+    TREND_SERIES.forEach(series => {
+        const card = document.createElement('div');
+        card.className = 'trend-card';
+        card.innerHTML = '<div class="trend-title"><span></span><span class="trend-value">--</span></div>' +
+                         '<canvas class="trend-canvas"></canvas>';
+        card.firstChild.firstChild.textContent = series.name;
+        grid.appendChild(card);
+        const canvas = card.querySelector('canvas');
+        trends.charts.push({
+            series: series, canvas: canvas, ctx: canvas.getContext('2d'),
+            valueEl: card.querySelector('.trend-value'),
+            values: null, kLast: -1, yMin: 0, yMax: 1, drawn: false
+        });
+    });
+
+    const controls = document.getElementById('trendWindows');
+    TREND_WINDOWS.forEach(([seconds, label]) => {
+        const button = document.createElement('button');
+        button.textContent = label;
+        button.onclick = () => {
+            trends.windowMs = seconds * 1000;
+            controls.querySelectorAll('button').forEach(b => b.classList.toggle('active', b === button));
+            configureTrends(true);
+        };
+        if (seconds * 1000 === trends.windowMs) button.classList.add('active');
+        controls.appendChild(button);
+    });
+
+    let resizeTimer = null;
+    window.addEventListener('resize', () => {
+        clearTimeout(resizeTimer);
+        resizeTimer = setTimeout(() => configureTrends(false), 200);
+    });
+
+    configureTrends(true);
+    fetchHistory();
+    setInterval(fetchHistory, UPDATE_INTERVAL);
+}
+
+// Lề trong canvas (pixel thiết bị)
+function trendLayout(chart) {
+    const dpr = window.devicePixelRatio || 1;
+    return { dpr: dpr, left: Math.round(46 * dpr), right: Math.round(6 * dpr),
+             top: Math.round(8 * dpr), bottom: Math.round(8 * dpr) };
+}
+
+// Kích thước canvas theo pixel thiết bị: 1 bucket = 1 cột pixel
+function configureTrends(force) {
+    let columns = 0;
+    trends.charts.forEach(chart => {
+        const layout = trendLayout(chart);
+        const width = Math.round(chart.canvas.clientWidth * layout.dpr);
+        const height = Math.round(chart.canvas.clientHeight * layout.dpr);
+        if (chart.canvas.width !== width || chart.canvas.height !== height) {
+            chart.canvas.width = width;
+            chart.canvas.height = height;
+            force = true;
+        }
+        columns = width - layout.left - layout.right;
+    });
+    if (!force || columns <= 0) return;
+    trends.columns = columns;
+    trends.charts.forEach(chart => {
+        chart.values = new Float32Array(columns).fill(NaN);
+        chart.kLast = -1;
+        chart.drawn = false;
+    });
+    trends.worker.postMessage({ type: 'config', columns: columns, windowMs: trends.windowMs });
+}
+
+async function fetchHistory() {
+    if (trends.inFlight || document.hidden) return;
+    trends.inFlight = true;
+    try {
+        const response = await fetch('/history?since=' + trends.nextSeq);
+        if (!response.ok) throw new Error('HTTP ' + response.status);
+        const buffer = await response.arrayBuffer();
+        trends.worker.postMessage({ type: 'history', buffer: buffer }, [buffer]);
+    } catch (error) {
+        console.error('History Error:', error);
+    }
+    trends.inFlight = false;
+}
+
+function trendRange(chart) {
+    const series = chart.series;
+    if (series.min !== undefined) return [series.min, series.max];
+    let lo = Infinity, hi = -Infinity;
+    chart.values.forEach(v => {
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+    });
+    if (lo > hi) return [0, 1];
+    const span = Math.max(hi - lo, series.minSpan);
+    const mid = (hi + lo) / 2;
+    return [mid - span * 0.6, mid + span * 0.6];
+}
+
+function applyTrendUpdate(update) {
+    const t0 = performance.now();
+    const columns = trends.columns;
+    let full = update.full;
+    trends.charts.forEach((chart, s) => {
+        if (!chart.values) return;
+        const shift = chart.kLast < 0 ? columns : update.kLast - chart.kLast;
+
+        // Bucket trống giữa 2 lần cập nhật (không có mẫu) => NaN
+        for (let k = Math.max(chart.kLast + 1, update.kLast - columns + 1); k < update.kFrom; k++) {
+            chart.values[((k % columns) + columns) % columns] = NaN;
+        }
+        const ys = update.series[s];
+        for (let i = 0; i < ys.length; i++) {
+            const k = update.kFrom + i;
+            chart.values[((k % columns) + columns) % columns] = ys[i];
+        }
+        chart.kLast = update.kLast;
+
+        const latest = update.latest[s];
+        setText(chart.valueEl, latest.toFixed(chart.series.digits) + ' ' + chart.series.unit);
+
+        // Thang đo: chỉ vẽ lại toàn bộ khi dữ liệu ra ngoài hoặc co lại nhiều
+        const [lo, hi] = trendRange(chart);
+        const span = chart.yMax - chart.yMin;
+        const rangeChanged = lo < chart.yMin || hi > chart.yMax || (hi - lo) < span * 0.4;
+        if (full || !chart.drawn || rangeChanged || shift >= columns) {
+            if (rangeChanged || !chart.drawn) {
+                chart.yMin = lo;
+                chart.yMax = hi;
+            }
+            drawTrendFull(chart);
+            trends.stats.fullRedraws++;
+        } else {
+            drawTrendTail(chart, shift, update.kFrom);
+        }
+    });
+    const elapsed = performance.now() - t0;
+    trends.stats.updates++;
+    trends.stats.totalMs += elapsed;
+    trends.stats.maxMs = Math.max(trends.stats.maxMs, elapsed);
+}
+
+function trendX(chart, layout, k) {
+    return layout.left + (k - (chart.kLast - trends.columns + 1)) + 0.5;
+}
+
+function trendY(chart, layout, v) {
+    const h = chart.canvas.height - layout.top - layout.bottom;
+    return layout.top + (chart.yMax - v) / (chart.yMax - chart.yMin) * h;
+}
+
+function drawTrendGrid(chart, layout, x0) {
+    const ctx = chart.ctx;
+    ctx.strokeStyle = '#e9ecef';
+    ctx.lineWidth = 1;
+    ctx.beginPath();
+    for (let i = 0; i <= 4; i++) {
+        const y = Math.round(trendY(chart, layout, chart.yMin + (chart.yMax - chart.yMin) * i / 4)) + 0.5;
+        ctx.moveTo(x0, y);
+        ctx.lineTo(chart.canvas.width - layout.right, y);
+    }
+    ctx.stroke();
+}
+
+function drawTrendLine(chart, layout, kFrom) {
+    const ctx = chart.ctx;
+    const columns = trends.columns;
+    ctx.strokeStyle = chart.series.color;
+    ctx.lineWidth = 1.5 * layout.dpr;
+    ctx.lineJoin = 'round';
+    ctx.beginPath();
+    let started = false;
+    for (let k = Math.max(kFrom, chart.kLast - columns + 1); k <= chart.kLast; k++) {
+        const v = chart.values[((k % columns) + columns) % columns];
+        if (isNaN(v)) continue;
+        const x = trendX(chart, layout, k), y = trendY(chart, layout, v);
+        if (started) ctx.lineTo(x, y); else ctx.moveTo(x, y);
+        started = true;
+    }
+    ctx.stroke();
+}
+
+function drawTrendFull(chart) {
+    const layout = trendLayout(chart);
+    const ctx = chart.ctx;
+    ctx.clearRect(0, 0, chart.canvas.width, chart.canvas.height);
+    drawTrendGrid(chart, layout, layout.left);
+
+    // Nhãn trục y ở lề trái
+    ctx.fillStyle = '#6c757d';
+    ctx.font = Math.round(10 * layout.dpr) + 'px sans-serif';
+    ctx.textAlign = 'right';
+    ctx.textBaseline = 'middle';
+    for (let i = 0; i <= 4; i++) {
+        const v = chart.yMin + (chart.yMax - chart.yMin) * i / 4;
+        ctx.fillText(v.toFixed(chart.series.digits), layout.left - 4 * layout.dpr, trendY(chart, layout, v));
+    }
+    drawTrendLine(chart, layout, -Infinity);
+    chart.drawn = true;
+}
+
+// Dịch ảnh sang trái theo số bucket mới, xoá và vẽ lại từ bucket thay đổi đầu tiên
+function drawTrendTail(chart, shift, kFrom) {
+    const layout = trendLayout(chart);
+    const ctx = chart.ctx;
+    const canvas = chart.canvas;
+    const plotRight = canvas.width - layout.right;
+    if (shift > 0) {
+        const w = plotRight - layout.left - shift;
+        ctx.drawImage(canvas, layout.left + shift, 0, w, canvas.height, layout.left, 0, w, canvas.height);
+    }
+    const x0 = Math.max(layout.left, Math.floor(trendX(chart, layout, kFrom - 2)));
+    ctx.save();
+    ctx.beginPath();
+    ctx.rect(x0, 0, canvas.width - x0, canvas.height);
+    ctx.clip();
+    ctx.clearRect(x0, 0, canvas.width - x0, canvas.height);
+    drawTrendGrid(chart, layout, x0);
+    drawTrendLine(chart, layout, kFrom - 3);
+    ctx.restore();
+}
+
+window.addEventListener('DOMContentLoaded', initTrends);
+)rawliteral";
+
+#endif
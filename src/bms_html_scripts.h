@@ -3,12 +3,21 @@
 
 #include <Arduino.h>
 
-String getHTMLScripts() {
-    return R"rawliteral(
+// Lưu trong flash (PROGMEM), gửi trực tiếp không qua heap
+const char HTML_SCRIPTS[] PROGMEM = R"rawliteral(
 const UPDATE_INTERVAL = 2000;
+const COMPACT_CELLS = 16;       // Nhiều cell hơn: lưới gọn
 let updateTimer = null;
 let isConnected = false;
 
+// Mẫu mới nhất chờ vẽ; mọi ghi DOM gom vào 1 requestAnimationFrame
+let pendingData = null;
+let frameRequested = false;
+
+// Phần tử từng cell / từng alert tạo 1 lần, sau đó chỉ sửa phần thay đổi
+let cellViews = [];
+const alertViews = new Map();   // severity:message -> phần tử
+
 const elements = {
     packVolt: document.getElementById('packVolt'),
     soc: document.getElementById('soc'),
@@ -22,10 +31,38 @@ const elements = {
     protectOC: document.getElementById('protectOC'),
     protectSC: document.getElementById('protectSC'),
     protectOT: document.getElementById('protectOT'),
+    protectComms: document.getElementById('protectComms'),
+    protectThermal: document.getElementById('protectThermal'),
     batteryDisplay: document.getElementById('batteryDisplay'),
     alertsContainer: document.getElementById('alertsContainer')
 };
 
+// ============ DOM PATCH ============
+// Giá trị đã ghi được nhớ trên chính phần tử: không đổi thì không chạm DOM
+
+function setText(el, text) {
+    if (el && el._text !== text) {
+        el._text = text;
+        el.textContent = text;
+    }
+}
+
+function setStyle(el, prop, value) {
+    const key = '_style_' + prop;
+    if (el && el[key] !== value) {
+        el[key] = value;
+        el.style[prop] = value;
+    }
+}
+
+function setClass(el, cls, on) {
+    const key = '_class_' + cls;
+    if (el && el[key] !== on) {
+        el[key] = on;
+        el.classList.toggle(cls, on);
+    }
+}
+
 function init() {
     console.log('BMS Dashboard Starting...');
     startAutoUpdate();
@@ -46,16 +83,31 @@ async function fetchBMSData() {
             isConnected = true;
             console.log('Connected to ESP32');
         }
-        updateDashboard(data);
+        scheduleRender(data);
     } catch (error) {
         console.error('Connection Error:', error);
         handleConnectionError();
     }
 }
 
+// Tab ẩn thì rAF dừng: chỉ giữ mẫu mới nhất, vẽ 1 lần khi quay lại
+function scheduleRender(data) {
+    pendingData = data;
+    if (frameRequested) return;
+    frameRequested = true;
+    requestAnimationFrame(() => {
+        frameRequested = false;
+        const latest = pendingData;
+        pendingData = null;
+        if (latest) updateDashboard(latest);
+    });
+}
+
 function handleConnectionError() {
     if (isConnected) {
         isConnected = false;
+        pendingData = null;
+        cellViews = [];
         elements.batteryDisplay.innerHTML = '<div class="loading" style="color: #f44336;">Connection Lost</div>';
     }
 }
@@ -70,51 +122,40 @@ function updateDashboard(data) {
 function updateStats(data) {
     const { measurement, calculation, status } = data;
     
-    if (elements.packVolt) elements.packVolt.textContent = measurement.packVoltage + 'V';
-    if (elements.soc) elements.soc.textContent = calculation.soc + '%';
-    if (elements.soh) elements.soh.textContent = calculation.soh + '%';
+    setText(elements.packVolt, measurement.packVoltage + 'V');
+    setText(elements.soc, calculation.soc + '%');
+    setText(elements.soh, calculation.soh + '%');
     
-    if (elements.current) {
-        const curr = parseFloat(measurement.current);
-        elements.current.textContent = (curr >= 0 ? '+' : '') + measurement.current + 'A';
-    }
+    const curr = parseFloat(measurement.current);
+    setText(elements.current, (curr >= 0 ? '+' : '') + measurement.current + 'A');
     
-    if (elements.packTemp) elements.packTemp.textContent = measurement.packTemperature + '°C';
+    setText(elements.packTemp, measurement.packTemperature + '°C');
     
-    if (elements.balancingStatus) {
-        if (status.balancing.active) {
-            elements.balancingStatus.textContent = 'Active (' + status.balancing.cells.length + ' cells)';
-            elements.balancingStatus.style.color = '#ff9800';
-        } else {
-            elements.balancingStatus.textContent = 'Inactive';
-            elements.balancingStatus.style.color = '#4caf50';
-        }
+    if (status.balancing.active) {
+        setText(elements.balancingStatus, 'Active (' + status.balancing.cells.length + ' cells)');
+        setStyle(elements.balancingStatus, 'color', '#ff9800');
+    } else {
+        setText(elements.balancingStatus, 'Inactive');
+        setStyle(elements.balancingStatus, 'color', '#4caf50');
     }
     
     updateChargingStatus(status.charging);
 }
 
+const CHARGING_STATES = {
+    charging:    { icon: '⚡', text: 'Charging' },
+    discharging: { icon: '🔋', text: 'Discharging' },
+    idle:        { icon: '⏸️', text: 'Idle' }
+};
+
 function updateChargingStatus(status) {
-    if (!elements.chargingStatus) return;
-    
-    const statusIcon = elements.chargingStatus.querySelector('.status-icon');
-    const statusText = elements.chargingStatus.querySelector('.status-text');
+    const el = elements.chargingStatus;
+    if (!el) return;
     
-    elements.chargingStatus.classList.remove('charging', 'discharging', 'idle');
-    
-    if (status === 'charging') {
-        elements.chargingStatus.classList.add('charging');
-        statusIcon.textContent = '⚡';
-        statusText.textContent = 'Charging';
-    } else if (status === 'discharging') {
-        elements.chargingStatus.classList.add('discharging');
-        statusIcon.textContent = '🔋';
-        statusText.textContent = 'Discharging';
-    } else {
-        elements.chargingStatus.classList.add('idle');
-        statusIcon.textContent = '⏸️';
-        statusText.textContent = 'Idle';
-    }
+    const state = CHARGING_STATES[status] ? status : 'idle';
+    for (const name in CHARGING_STATES) setClass(el, name, name === state);
+    setText(el.querySelector('.status-icon'), CHARGING_STATES[state].icon);
+    setText(el.querySelector('.status-text'), CHARGING_STATES[state].text);
 }
 
 function updateProtectionStatus(data) {
@@ -124,33 +165,72 @@ function updateProtectionStatus(data) {
     updateProtectionItem(elements.protectOC, protection.overCurrent);
     updateProtectionItem(elements.protectOT, protection.overTemperature);
     updateProtectionItem(elements.protectSC, protection.shortCircuit);
+    updateProtectionItem(elements.protectComms, protection.commsFault);
+    updateProtectionItem(elements.protectThermal, protection.thermalLoss);
 }
 
 function updateProtectionItem(element, status) {
     if (!element) return;
     const statusEl = element.querySelector('.protection-status');
-    element.classList.remove('alert', 'alarm');
+    const alarm = status === 'alarm';
     
-    if (status === 'alarm') {
-        element.classList.add('alarm');
-        statusEl.textContent = 'ALARM';
-        statusEl.style.color = '#d32f2f';
-    } else {
-        statusEl.textContent = 'Normal';
-        statusEl.style.color = '#4caf50';
+    setClass(element, 'alarm', alarm);
+    setText(statusEl, alarm ? 'ALARM' : 'Normal');
+    setStyle(statusEl, 'color', alarm ? '#d32f2f' : '#4caf50');
+}
+
+// ============ BATTERY CELLS ============
+
+function createCellView() {
+    const root = document.createElement('div');
+    root.className = 'battery-cell';
+    root.innerHTML = '<div class="cell-label"></div>' +
+        '<div class="battery-icon-container"><div class="battery-head"></div>' +
+        '<div class="battery-body"><div class="battery-level"></div></div></div>' +
+        '<div class="voltage-value"></div><div class="percentage"></div>';
+    return {
+        root: root,
+        label: root.querySelector('.cell-label'),
+        level: root.querySelector('.battery-level'),
+        voltage: root.querySelector('.voltage-value'),
+        percentage: root.querySelector('.percentage'),
+        levelClass: ''
+    };
+}
+
+// Thêm / bớt phần tử khi số cell đổi (lần đầu, hoặc đổi pack)
+function syncCellViews(count) {
+    if (cellViews.length === count) return;
+    const display = elements.batteryDisplay;
+    if (cellViews.length === 0) display.textContent = '';
+    
+    const fragment = document.createDocumentFragment();
+    while (cellViews.length < count) {
+        const view = createCellView();
+        cellViews.push(view);
+        fragment.appendChild(view.root);
     }
+    display.appendChild(fragment);
+    while (cellViews.length > count) cellViews.pop().root.remove();
+    setClass(display, 'compact', count > COMPACT_CELLS);
 }
 
 function updateBatteryCells(data) {
     if (!elements.batteryDisplay) return;
     
-    const { measurement, status } = data;
+    const { measurement, status, chemistry } = data;
     const cells = measurement.cellVoltages;
+    const emptyV = parseFloat(chemistry.emptyVoltage);
+    const fullV = parseFloat(chemistry.fullVoltage);
+    const balancing = new Set(status.balancing.active ? status.balancing.cells : []);
+    const outliers = new Set(status.outliers || []);
+    
+    syncCellViews(cells.length);
     
-    let html = '';
-    cells.forEach(cell => {
+    cells.forEach((cell, i) => {
+        const view = cellViews[i];
         const voltage = parseFloat(cell.voltage);
-        const percentage = Math.max(0, Math.min(100, ((voltage - 3.0) / 1.2) * 100));
+        const percentage = Math.max(0, Math.min(100, ((voltage - emptyV) / (fullV - emptyV)) * 100));
         
         let levelClass = 'critical';
         if (percentage >= 80) levelClass = 'full';
@@ -158,48 +238,60 @@ function updateBatteryCells(data) {
         else if (percentage >= 40) levelClass = 'medium';
         else if (percentage >= 20) levelClass = 'low';
         
-        const isBalancing = status.balancing.active && status.balancing.cells.includes(cell.cell);
+        if (view.levelClass !== levelClass) {
+            if (view.levelClass) view.level.classList.remove(view.levelClass);
+            view.level.classList.add(levelClass);
+            view.levelClass = levelClass;
+        }
         
-        html += '<div class="battery-cell' + (isBalancing ? ' balancing' : '') + '">';
-        html += '<div class="cell-label">Cell ' + cell.cell + '</div>';
-        html += '<div class="battery-icon-container">';
-        html += '<div class="battery-head"></div>';
-        html += '<div class="battery-body">';
-        html += '<div class="battery-level ' + levelClass + '" style="height: ' + percentage + '%;"></div>';
-        html += '</div></div>';
-        html += '<div class="voltage-value">' + voltage.toFixed(3) + 'V</div>';
-        html += '<div class="percentage">' + percentage.toFixed(0) + '%</div>';
-        html += '</div>';
+        // scaleY thay cho height: chỉ compositor, không layout lại lưới
+        setStyle(view.level, 'transform', 'scaleY(' + (percentage / 100).toFixed(3) + ')');
+        setClass(view.root, 'balancing', balancing.has(cell.cell));
+        setClass(view.root, 'outlier', outliers.has(cell.cell));
+        setText(view.label, 'Cell ' + cell.cell);
+        setText(view.voltage, voltage.toFixed(3) + 'V');
+        setText(view.percentage, percentage.toFixed(0) + '%');
     });
-    
-    elements.batteryDisplay.innerHTML = html;
 }
 
+// ============ ALERTS ============
+// Giữ phần tử của alert còn hiệu lực (animation slideIn chỉ chạy khi alert mới xuất hiện)
+
 function updateAlerts(data) {
-    if (!elements.alertsContainer) return;
+    const container = elements.alertsContainer;
+    if (!container) return;
     
     const alerts = data.alerts || [];
-    if (alerts.length === 0) {
-        elements.alertsContainer.classList.add('hidden');
-        return;
-    }
-    
-    elements.alertsContainer.classList.remove('hidden');
+    setClass(container, 'hidden', alerts.length === 0);
     
-    let html = '';
+    const active = new Set();
     alerts.forEach(alert => {
-        const icon = alert.severity === 'critical' ? '🚨' : '⚠️';
-        html += '<div class="alert ' + alert.severity + '">';
-        html += '<div class="alert-icon">' + icon + '</div>';
-        html += '<div class="alert-message">' + alert.message + '</div>';
-        html += '</div>';
+        const key = alert.severity + ':' + alert.message;
+        active.add(key);
+        if (alertViews.has(key)) return;
+        
+        const el = document.createElement('div');
+        el.className = 'alert ' + alert.severity;
+        el.innerHTML = '<div class="alert-icon"></div><div class="alert-message"></div>';
+        el.firstChild.textContent = alert.severity === 'critical' ? '🚨' : '⚠️';
+        el.lastChild.textContent = alert.message;
+        container.appendChild(el);
+        alertViews.set(key, el);
     });
     
-    elements.alertsContainer.innerHTML = html;
+    alertViews.forEach((el, key) => {
+        if (!active.has(key)) {
+            el.remove();
+            alertViews.delete(key);
+        }
+    });
 }
 
 window.addEventListener('DOMContentLoaded', init);
 )rawliteral";
+
+String getHTMLScripts() {
+    return String(HTML_SCRIPTS);
 }
 
 #endif
\ No newline at end of file
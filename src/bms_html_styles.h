@@ -3,8 +3,8 @@
 
 #include <Arduino.h>
 
-String getHTMLStyles() {
-    return R"rawliteral(
+// Lưu trong flash (PROGMEM), gửi trực tiếp không qua heap
+const char HTML_STYLES[] PROGMEM = R"rawliteral(
 * { margin: 0; padding: 0; box-sizing: border-box; }
 
 body {
@@ -197,6 +197,58 @@ h2 {
     margin-bottom: 15px;
 }
 
+.trend-section.hidden { display: none; }
+
+.trend-header {
+    display: flex;
+    justify-content: space-between;
+    align-items: center;
+    flex-wrap: wrap;
+    gap: 10px;
+}
+
+.trend-windows button {
+    border: 1px solid #dee2e6;
+    background: #f8f9fa;
+    color: #495057;
+    padding: 6px 12px;
+    border-radius: 8px;
+    cursor: pointer;
+    font-weight: 600;
+}
+
+.trend-windows button.active {
+    background: #667eea;
+    border-color: #667eea;
+    color: white;
+}
+
+.trend-grid {
+    display: grid;
+    grid-template-columns: repeat(2, 1fr);
+    gap: 15px;
+}
+
+.trend-card {
+    background: #f8f9fa;
+    border-radius: 12px;
+    padding: 12px;
+    min-width: 0;
+}
+
+.trend-title {
+    display: flex;
+    justify-content: space-between;
+    font-size: 0.9em;
+    color: #6c757d;
+    font-weight: 600;
+    margin-bottom: 6px;
+}
+
+.trend-value { color: #495057; font-family: 'Courier New', monospace; }
+
+.trend-canvas { display: block; width: 100%; height: 140px; }
+
 .protection-grid {
     display: grid;
     grid-template-columns: repeat(auto-fit, minmax(220px, 1fr));
@@ -267,6 +319,23 @@ h2 {
     gap: 20px;
 }
 
+/* Nhiều cell (24S, nhiều pack): ô nhỏ hơn */
+.battery-grid.compact {
+    grid-template-columns: repeat(auto-fill, minmax(96px, 1fr));
+    gap: 10px;
+}
+
+.battery-grid.compact .battery-cell { padding: 10px 6px; border-radius: 12px; }
+.battery-grid.compact .cell-label { font-size: 0.85em; margin-bottom: 4px; }
+.battery-grid.compact .battery-icon-container {
+    height: 80px;
+    margin: 4px auto;
+    transform: scale(0.6);
+    transform-origin: top center;
+}
+.battery-grid.compact .voltage-value { font-size: 1em; margin: 4px 0 2px; }
+.battery-grid.compact .percentage { font-size: 0.85em; }
+
 .loading {
     grid-column: 1 / -1;
     text-align: center;
@@ -290,6 +359,7 @@ h2 {
     transition: all 0.3s ease;
     border: 2px solid transparent;
     position: relative;
+    contain: layout style;
 }
 
 .battery-cell:hover {
@@ -312,6 +382,11 @@ h2 {
     animation: spin 2s linear infinite;
 }
 
+.battery-cell.outlier {
+    border-color: #e53935;
+    border-style: dashed;
+}
+
 @keyframes spin {
     from { transform: rotate(0deg); }
     to { transform: rotate(360deg); }
@@ -354,12 +429,16 @@ h2 {
     box-shadow: inset 0 2px 8px rgba(0,0,0,0.15);
 }
 
+/* Mức pin vẽ bằng scaleY (không layout lại khi đổi) */
 .battery-level {
     position: absolute;
     bottom: 0;
     left: 0;
     right: 0;
-    transition: height 0.6s cubic-bezier(0.4, 0, 0.2, 1), 
+    height: 100%;
+    transform: scaleY(0);
+    transform-origin: bottom;
+    transition: transform 0.6s cubic-bezier(0.4, 0, 0.2, 1), 
                 background-color 0.6s ease;
     border-radius: 6px;
     box-shadow: 0 -3px 10px rgba(0,0,0,0.2) inset;
@@ -412,8 +491,12 @@ h2 {
     .header { flex-direction: column; gap: 15px; align-items: flex-start; }
     .stats-grid { grid-template-columns: repeat(2, 1fr); gap: 12px; }
     .battery-grid { grid-template-columns: repeat(2, 1fr); gap: 15px; }
+    .trend-grid { grid-template-columns: 1fr; }
 }
 )rawliteral";
+
+String getHTMLStyles() {
+    return String(HTML_STYLES);
 }
 
 #endif
\ No newline at end of file
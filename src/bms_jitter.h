@@ -0,0 +1,83 @@
+#ifndef BMS_JITTER_H
+#define BMS_JITTER_H
+
+#include <Arduino.h>
+#include "bms_memory.h"
+
+/*
+ * BMS JITTER - Độ trễ của mỗi lần lấy mẫu so với lịch
+ * - late = (thời điểm lấy mẫu - mẫu trước) - chu kỳ, µs
+ * - Histogram theo ngưỡng cố định: tool đọc /info trước và sau một lần đo tải
+ *   rồi trừ 2 histogram => phân bố trễ trong đúng khoảng đó (không cần reset)
+ * - Dòng "Sample jitter" trong /info có định dạng cố định cho
+ *   tools/bms_loadtest.py; fleet simulator in cùng định dạng
+ */
+
+#define JITTER_BUCKETS 8
+
+// Cận trên (ms, không gồm) của 7 bucket đầu; bucket cuối: >= 100ms
+const uint16_t JITTER_BUCKET_MS[JITTER_BUCKETS - 1] = { 1, 2, 5, 10, 20, 50, 100 };
+
+class SampleJitter {
+private:
+    uint32_t samples;
+    uint64_t totalLateUs;
+    uint32_t maxLateUs;
+    uint32_t histogram[JITTER_BUCKETS];
+    unsigned long lastUs;
+    bool started;
+
+public:
+    SampleJitter() {
+        reset();
+    }
+
+    void reset() {
+        samples = 0;
+        totalLateUs = 0;
+        maxLateUs = 0;
+        memset(histogram, 0, sizeof(histogram));
+        lastUs = 0;
+        started = false;
+    }
+
+    // Gọi ngay khi bắt đầu 1 lần lấy mẫu; intervalMs = chu kỳ đã lên lịch
+    void onSample(unsigned long nowUs, unsigned long intervalMs) {
+        if (started) {
+            long late = (long)(nowUs - lastUs) - (long)(intervalMs * 1000);
+            record(late > 0 ? late : 0);
+        }
+        lastUs = nowUs;
+        started = true;
+    }
+
+    void record(uint32_t lateUs) {
+        int b = 0;
+        while (b < JITTER_BUCKETS - 1 && lateUs >= JITTER_BUCKET_MS[b] * 1000UL) b++;
+        histogram[b]++;
+        samples++;
+        totalLateUs += lateUs;
+        if (lateUs > maxLateUs) maxLateUs = lateUs;
+    }
+
+    // "Sample jitter: N samples, late avg X us / max Y us, <1ms:a <2ms:b ... >=100ms:h"
+    void printTo(BufferWriter& out) {
+        out.printf("Sample jitter: %lu samples, late avg %.0f us / max %lu us,",
+                   (unsigned long)samples, samples ? (double)totalLateUs / samples : 0.0,
+                   (unsigned long)maxLateUs);
+        for (int b = 0; b < JITTER_BUCKETS - 1; b++) {
+            out.printf(" <%ums:%lu", JITTER_BUCKET_MS[b], (unsigned long)histogram[b]);
+        }
+        out.printf(" >=%ums:%lu\n", JITTER_BUCKET_MS[JITTER_BUCKETS - 2],
+                   (unsigned long)histogram[JITTER_BUCKETS - 1]);
+    }
+
+    // Getters
+    uint32_t getSampleCount() { return samples; }
+    uint32_t getMaxLateUs() { return maxLateUs; }
+    uint32_t getBucket(int b) { return histogram[b]; }
+};
+
+SampleJitter sampleJitter;
+
+#endif
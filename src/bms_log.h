@@ -0,0 +1,271 @@
+#ifndef BMS_LOG_H
+#define BMS_LOG_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+/*
+ * BMS LOG - Ghi log bất đồng bộ, không chặn loop()
+ * - loop() chỉ format vào ring buffer (lock-free, 1 producer / 1 consumer)
+ * - Task ưu tiên thấp trên core 0 đẩy dữ liệu ra Serial (UART 115200 chậm)
+ * - Buffer đầy: bỏ message và đếm lại, không bao giờ chờ
+ * - BMS_LOG_BINARY: xuất frame nhị phân gọn, giải mã bằng tools/bms_log_decode.py
+ *   Frame: 0xA5 | type | len | payload[len] | crc8(type..payload)
+ * - BMS_LOG_SYNC: ghi thẳng Serial như cũ (để đo so sánh stall)
+ */
+
+// Mức log
+#define LOG_ERROR 0
+#define LOG_WARN  1
+#define LOG_INFO  2
+#define LOG_DEBUG 3
+
+// Build native không có FreeRTOS/task nền: ghi thẳng ra stdout
+#if !defined(ESP32) && !defined(BMS_LOG_SYNC)
+#define BMS_LOG_SYNC
+#endif
+
+#ifndef BMS_LOG_LEVEL
+#define BMS_LOG_LEVEL LOG_INFO
+#endif
+
+#define BMS_LOG_BUFFER_SIZE 4096   // Phải là lũy thừa của 2
+#define BMS_LOG_LINE_MAX    160    // Độ dài tối đa 1 message
+
+static_assert((BMS_LOG_BUFFER_SIZE & (BMS_LOG_BUFFER_SIZE - 1)) == 0,
+              "BMS_LOG_BUFFER_SIZE must be a power of 2");
+
+// Binary frame
+#define LOG_FRAME_SYNC   0xA5
+#define LOG_FRAME_TEXT   0x01   // payload: level + text
+#define LOG_FRAME_STATUS 0x10   // payload: xem printBMSStatus()
+
+#define LOG_DRAIN_CHUNK  256
+#define LOG_TASK_STACK   3072
+#define LOG_TASK_PRIO    1
+#define LOG_TASK_CORE    0      // loop() chạy trên core 1
+
+// CRC-8 poly 0x07 của frame nhị phân (type..payload); tools đọc log dùng lại
+uint8_t logFrameCrc8(const uint8_t* data, size_t len, uint8_t crc = 0) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+class BMSLogger {
+private:
+    uint8_t buffer[BMS_LOG_BUFFER_SIZE];
+    volatile uint32_t head;   // Vị trí ghi (producer)
+    volatile uint32_t tail;   // Vị trí đọc (consumer)
+
+    // Thống kê
+    uint32_t messages;
+    uint32_t dropped;
+    uint32_t stallMaxUs;
+    unsigned long long stallTotalUs;
+
+    size_t freeSpace() {
+        return BMS_LOG_BUFFER_SIZE - (head - tail);
+    }
+
+    // Chép vào ring tại head + offset (gọi sau khi đã kiểm tra đủ chỗ)
+    void put(uint32_t offset, const uint8_t* data, size_t len) {
+        uint32_t h = head + offset;
+        for (size_t i = 0; i < len; i++) {
+            buffer[(h + i) & (BMS_LOG_BUFFER_SIZE - 1)] = data[i];
+        }
+    }
+
+    void commit(size_t len) {
+        __sync_synchronize(); // Dữ liệu phải thấy trước khi head dịch chuyển
+        head = head + len;
+    }
+
+    void recordStall(unsigned long startUs) {
+        uint32_t us = micros() - startUs;
+        stallTotalUs += us;
+        if (us > stallMaxUs) stallMaxUs = us;
+        messages++;
+    }
+
+#ifndef BMS_LOG_SYNC
+    static void drainTask(void* arg) {
+        BMSLogger* self = (BMSLogger*)arg;
+        for (;;) {
+            if (self->drain() == 0) {
+                vTaskDelay(pdMS_TO_TICKS(10));
+            }
+        }
+    }
+#endif
+
+public:
+    BMSLogger() {
+        head = 0;
+        tail = 0;
+        messages = 0;
+        dropped = 0;
+        stallMaxUs = 0;
+        stallTotalUs = 0;
+    }
+
+    void begin() {
+#ifndef BMS_LOG_SYNC
+        xTaskCreatePinnedToCore(drainTask, "bms_log", LOG_TASK_STACK, this,
+                                LOG_TASK_PRIO, NULL, LOG_TASK_CORE);
+#endif
+    }
+
+    // Ghi 1 frame (binary mode) hoặc 1 dòng text vào ring
+    bool writeFrame(uint8_t type, const uint8_t* payload, uint8_t len) {
+        uint8_t header[3] = { LOG_FRAME_SYNC, type, len };
+        uint8_t crc = logFrameCrc8(header + 1, 2);
+        crc = logFrameCrc8(payload, len, crc);
+
+#ifdef BMS_LOG_SYNC
+        Serial.write(header, 3);
+        Serial.write(payload, len);
+        Serial.write(&crc, 1);
+        return true;
+#else
+        if (freeSpace() < (size_t)len + 4) {
+            dropped++;
+            return false;
+        }
+        put(0, header, 3);
+        put(3, payload, len);
+        put(3 + len, &crc, 1);
+        commit(len + 4);
+        return true;
+#endif
+    }
+
+    bool writeText(const char* text, size_t len) {
+#ifdef BMS_LOG_SYNC
+        Serial.write((const uint8_t*)text, len);
+        return true;
+#else
+        if (freeSpace() < len) {
+            dropped++;
+            return false;
+        }
+        put(0, (const uint8_t*)text, len);
+        commit(len);
+        return true;
+#endif
+    }
+
+    void vlog(uint8_t level, const char* format, va_list args) {
+        unsigned long start = micros();
+        char line[BMS_LOG_LINE_MAX];
+
+#ifdef BMS_LOG_BINARY
+        line[0] = level;
+        int n = vsnprintf(line + 1, sizeof(line) - 1, format, args);
+        if (n < 0) n = 0;
+        if (n > (int)sizeof(line) - 2) n = sizeof(line) - 2;
+        writeFrame(LOG_FRAME_TEXT, (const uint8_t*)line, n + 1);
+#else
+        static const char levelTag[] = "EWID";
+        int prefix = (level == LOG_INFO) ? 0 : snprintf(line, sizeof(line), "[%c] ", levelTag[level & 3]);
+        int n = vsnprintf(line + prefix, sizeof(line) - prefix - 1, format, args);
+        if (n < 0) n = 0;
+        size_t len = min((size_t)(prefix + n), sizeof(line) - 2);
+        line[len++] = '\n';
+        writeText(line, len);
+#endif
+        recordStall(start);
+    }
+
+    void log(uint8_t level, const char* format, ...) __attribute__((format(printf, 3, 4))) {
+        va_list args;
+        va_start(args, format);
+        vlog(level, format, args);
+        va_end(args);
+    }
+
+    // Frame nhị phân tuỳ ý (ví dụ status report)
+    void frame(uint8_t type, const uint8_t* payload, uint8_t len) {
+        unsigned long start = micros();
+        writeFrame(type, payload, len);
+        recordStall(start);
+    }
+
+    // Đẩy dữ liệu đang chờ ra Serial, trả về số byte đã ghi
+    // (task nền gọi liên tục; không có task thì gọi trực tiếp)
+    size_t drain() {
+        uint32_t available = head - tail;
+        if (available == 0) return 0;
+        __sync_synchronize();
+
+        uint32_t start = tail & (BMS_LOG_BUFFER_SIZE - 1);
+        uint32_t chunk = min(available, (uint32_t)(BMS_LOG_BUFFER_SIZE - start));
+        chunk = min(chunk, (uint32_t)LOG_DRAIN_CHUNK);
+        Serial.write(buffer + start, chunk);
+        tail = tail + chunk;
+        return chunk;
+    }
+
+    // Getters
+    uint32_t getMessageCount() { return messages; }
+    uint32_t getDroppedCount() { return dropped; }
+    uint32_t getMaxStallUs() { return stallMaxUs; }
+    float getAvgStallUs() { return messages ? (float)stallTotalUs / messages : 0; }
+    size_t getPending() { return head - tail; }
+};
+
+BMSLogger bmsLog;
+
+// Ghép payload little-endian cho binary frame
+class LogFrameBuilder {
+private:
+    uint8_t* data;
+    size_t capacity;
+    size_t used;
+
+public:
+    LogFrameBuilder(uint8_t* buf, size_t size) {
+        data = buf;
+        capacity = size;
+        used = 0;
+    }
+
+    void u8(uint8_t v) {
+        if (used < capacity) data[used++] = v;
+    }
+
+    void u16(uint16_t v) {
+        u8(v & 0xFF);
+        u8(v >> 8);
+    }
+
+    void i16(int16_t v) {
+        u16((uint16_t)v);
+    }
+
+    void u32(uint32_t v) {
+        u16(v & 0xFFFF);
+        u16(v >> 16);
+    }
+
+    size_t length() { return used; }
+};
+
+// Bỏ qua hoàn toàn lúc compile nếu thấp hơn BMS_LOG_LEVEL
+#define BMS_LOG(level, ...) \
+    do { if ((level) <= BMS_LOG_LEVEL) bmsLog.log((level), __VA_ARGS__); } while (0)
+
+#define LOGE(...) BMS_LOG(LOG_ERROR, __VA_ARGS__)
+#define LOGW(...) BMS_LOG(LOG_WARN, __VA_ARGS__)
+#define LOGI(...) BMS_LOG(LOG_INFO, __VA_ARGS__)
+#define LOGD(...) BMS_LOG(LOG_DEBUG, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef BMS_MEMORY_H
+#define BMS_MEMORY_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+/*
+ * BMS MEMORY - Bộ nhớ tĩnh cố định kích thước lúc compile
+ * - Buffer JSON / HTTP body dùng chung, không cấp phát String trên heap
+ * - Bảng "memory region" để in báo cáo ngân sách bộ nhớ (/memory)
+ * - Build mode BMS_STATIC_MEMORY (env esp32doit-devkit-v1-static):
+ *   bọc malloc/calloc/realloc để đếm cấp phát heap sau setup(),
+ *   BMS_HEAP_TRAP: abort() nếu cấp phát xảy ra trong vùng HeapGuardScope
+ */
+
+// Kích thước các vùng nhớ tĩnh (bytes)
+#define BMS_JSON_DOC_SIZE      3072   // StaticJsonDocument cho /bms (gồm các kênh nhiệt độ)
+#define BMS_JSON_BUFFER_SIZE   2048   // JSON đã serialize
+#define BMS_HTTP_BUFFER_SIZE   3072   // Body text (/info, /memory)
+#define BMS_MAX_MEMORY_REGIONS 32
+
+// Ngân sách tổng cho các buffer dùng chung
+#define BMS_ARENA_BUDGET 8192
+
+static_assert(BMS_JSON_DOC_SIZE + BMS_JSON_BUFFER_SIZE + BMS_HTTP_BUFFER_SIZE <= BMS_ARENA_BUDGET,
+              "Static buffers exceed BMS_ARENA_BUDGET");
+
+char bmsJsonBuffer[BMS_JSON_BUFFER_SIZE];
+char bmsHttpBuffer[BMS_HTTP_BUFFER_SIZE];
+
+// ============ BUFFER WRITER ============
+// Ghi text có định dạng vào buffer cố định, cắt bớt nếu tràn
+
+class BufferWriter {
+private:
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    bool truncated;
+
+public:
+    BufferWriter(char* buf, size_t size) {
+        buffer = buf;
+        capacity = size;
+        used = 0;
+        truncated = false;
+        buffer[0] = '\0';
+    }
+
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (used + 1 >= capacity) {
+            truncated = true;
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer + used, capacity - used, format, args);
+        va_end(args);
+        if (n < 0) return;
+        if ((size_t)n >= capacity - used) {
+            used = capacity - 1;
+            truncated = true;
+        } else {
+            used += n;
+        }
+    }
+
+    const char* c_str() { return buffer; }
+    size_t length() { return used; }
+    size_t remaining() { return capacity - used - 1; }
+    bool isTruncated() { return truncated; }
+};
+
+// Định dạng số thực vào buffer tạm (thay cho String(value, decimals))
+char* formatFloat(char* buf, size_t size, float value, int decimals) {
+    snprintf(buf, size, "%.*f", decimals, value);
+    return buf;
+}
+
+// ============ MEMORY REGIONS ============
+
+struct MemoryRegion {
+    const char* name;
+    const void* address;
+    size_t size;
+};
+
+MemoryRegion memoryRegions[BMS_MAX_MEMORY_REGIONS];
+int memoryRegionCount = 0;
+
+void registerMemoryRegion(const char* name, const void* address, size_t size) {
+    if (memoryRegionCount >= BMS_MAX_MEMORY_REGIONS) return;
+    memoryRegions[memoryRegionCount].name = name;
+    memoryRegions[memoryRegionCount].address = address;
+    memoryRegions[memoryRegionCount].size = size;
+    memoryRegionCount++;
+}
+
+#define BMS_MEMORY_REGION(obj) registerMemoryRegion(#obj, &(obj), sizeof(obj))
+
+size_t getStaticMemoryTotal() {
+    size_t total = 0;
+    for (int i = 0; i < memoryRegionCount; i++) {
+        total += memoryRegions[i].size;
+    }
+    return total;
+}
+
+// ============ HEAP GUARD ============
+
+volatile uint32_t heapAllocsAfterSetup = 0;   // Cấp phát từ task loop()
+volatile uint32_t heapBytesAfterSetup = 0;
+volatile uint32_t heapAllocsOtherTasks = 0;   // WiFi/lwIP/...
+volatile uint32_t heapGuardViolations = 0;    // Cấp phát trong HeapGuardScope
+volatile int heapGuardDepth = 0;
+bool heapGuardArmed = false;
+void* heapGuardTask = NULL;
+
+#ifdef BMS_STATIC_MEMORY
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+void heapGuardRecord(size_t size) {
+    if (!heapGuardArmed) return;
+    if (xTaskGetCurrentTaskHandle() != (TaskHandle_t)heapGuardTask) {
+        heapAllocsOtherTasks++;
+        return;
+    }
+    heapAllocsAfterSetup++;
+    heapBytesAfterSetup += size;
+    if (heapGuardDepth > 0) {
+        heapGuardViolations++;
+#ifdef BMS_HEAP_TRAP
+        abort();
+#endif
+    }
+}
+
+extern "C" {
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t count, size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+
+    void* __wrap_malloc(size_t size) {
+        heapGuardRecord(size);
+        return __real_malloc(size);
+    }
+
+    void* __wrap_calloc(size_t count, size_t size) {
+        heapGuardRecord(count * size);
+        return __real_calloc(count, size);
+    }
+
+    void* __wrap_realloc(void* ptr, size_t size) {
+        heapGuardRecord(size);
+        return __real_realloc(ptr, size);
+    }
+}
+
+// Gọi cuối setup(): từ đây mọi cấp phát heap của loop() đều được đếm
+void armHeapGuard() {
+    heapGuardTask = (void*)xTaskGetCurrentTaskHandle();
+    heapGuardArmed = true;
+}
+#else
+void armHeapGuard() {}
+#endif
+
+// Đánh dấu đoạn code không được phép cấp phát heap (sampling, JSON)
+class HeapGuardScope {
+public:
+    HeapGuardScope() { heapGuardDepth++; }
+    ~HeapGuardScope() { heapGuardDepth--; }
+};
+
+// ============ REPORT ============
+
+void writeMemoryReport(BufferWriter& out) {
+    out.printf("=== MEMORY BUDGET ===\n");
+    out.printf("%-24s %10s %8s\n", "Region", "Address", "Bytes");
+    for (int i = 0; i < memoryRegionCount; i++) {
+        out.printf("%-24s %10p %8u\n", memoryRegions[i].name,
+                   memoryRegions[i].address, (unsigned)memoryRegions[i].size);
+    }
+    out.printf("%-24s %10s %8u\n", "TOTAL", "", (unsigned)getStaticMemoryTotal());
+
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    out.printf("\nFree Heap: %u bytes (min %u)\n", (unsigned)freeHeap, (unsigned)ESP.getMinFreeHeap());
+    out.printf("Largest Free Block: %u bytes\n", (unsigned)largest);
+    out.printf("Fragmentation: %.1f%%\n", freeHeap ? (1.0 - (float)largest / freeHeap) * 100.0 : 0.0);
+
+#ifdef BMS_STATIC_MEMORY
+    out.printf("\nHeap Guard: %s\n", heapGuardArmed ? "armed" : "off");
+    out.printf("  loop() allocs after setup: %u (%u bytes)\n",
+               (unsigned)heapAllocsAfterSetup, (unsigned)heapBytesAfterSetup);
+    out.printf("  other task allocs: %u\n", (unsigned)heapAllocsOtherTasks);
+    out.printf("  guarded-scope violations: %u\n", (unsigned)heapGuardViolations);
+#endif
+}
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef BMS_MODBUS_H
+#define BMS_MODBUS_H
+
+#include <Arduino.h>
+#include "bms_data.h"
+#ifdef ESP32
+#include <WiFi.h>
+#endif
+
+/*
+ * BMS MODBUS - Modbus TCP server (port 502) cho inverter / SCADA
+ * - Bảng thanh ghi là snapshot của BMSData, cập nhật 1 lần sau mỗi mẫu,
+ *   lưu sẵn dạng big-endian => request chỉ memcpy, không format gì thêm
+ * - FC03 (holding) và FC04 (input) trả cùng một bảng, chỉ đọc,
+ *   đọc tối đa 125 thanh ghi liên tiếp trong 1 transaction
+ * - Phần xử lý frame (ModbusConnection) không phụ thuộc WiFi, chạy được
+ *   trên native (bench/bench_modbus.h dùng làm client giả lập)
+ *
+ * Bảng thanh ghi (địa chỉ 0-based):
+ *   0  số cell               8  cell TB (mV)
+ *   1  pack voltage (10 mV)  9  cell min (mV)
+ *   2  current (10 mA, i16)  10 cell max (mV)
+ *   3  nhiệt độ (0.1°C, i16) 11 dung lượng còn lại (mAh)
+ *   4  SOC (0.1%)            12-13 uptime (s, u32, word cao trước)
+ *   5  SOH (0.1%)            14 bộ đếm mẫu (tăng mỗi lần cập nhật)
+ *   6  cờ trạng thái (BMS_FLAG_*)  15 dự phòng
+ *   7  balancing mask        16.. điện áp từng cell (mV)
+ */
+
+#define MODBUS_PORT          502
+#define MODBUS_MAX_CLIENTS   2
+#define MODBUS_CLIENT_TIMEOUT 60000   // ms không có request thì đóng kết nối
+#define MODBUS_ADU_MAX       260      // MBAP 7 + PDU 253
+#define MODBUS_MAX_READ      125      // Giới hạn của FC03/FC04
+
+// Địa chỉ thanh ghi
+#define MB_REG_CELL_COUNT    0
+#define MB_REG_PACK_VOLTAGE  1
+#define MB_REG_CURRENT       2
+#define MB_REG_TEMPERATURE   3
+#define MB_REG_SOC           4
+#define MB_REG_SOH           5
+#define MB_REG_FLAGS         6
+#define MB_REG_BALANCING     7
+#define MB_REG_CELL_AVG      8
+#define MB_REG_CELL_MIN      9
+#define MB_REG_CELL_MAX      10
+#define MB_REG_REMAINING     11
+#define MB_REG_UPTIME_HI     12
+#define MB_REG_UPTIME_LO     13
+#define MB_REG_SAMPLE_COUNT  14
+#define MB_REG_CELL_BASE     16
+#define MODBUS_REG_COUNT     (MB_REG_CELL_BASE + NUM_CELLS)
+
+// Function code / exception code
+#define MODBUS_FC_READ_HOLDING 0x03
+#define MODBUS_FC_READ_INPUT   0x04
+#define MODBUS_EX_ILLEGAL_FUNCTION 0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS  0x02
+#define MODBUS_EX_ILLEGAL_VALUE    0x03
+
+// ============ REGISTER MAP ============
+
+class ModbusRegisterMap {
+private:
+    uint8_t registers[MODBUS_REG_COUNT * 2];   // Big-endian, đúng thứ tự trên dây
+    uint16_t sampleCount;
+
+    void set(uint16_t addr, uint16_t value) {
+        registers[addr * 2] = value >> 8;
+        registers[addr * 2 + 1] = value & 0xFF;
+    }
+
+    static uint16_t scaleU16(float value, float scale) {
+        long scaled = lroundf(value * scale);
+        return (uint16_t)constrain(scaled, 0L, 65535L);
+    }
+
+    static uint16_t scaleI16(float value, float scale) {
+        long scaled = lroundf(value * scale);
+        return (uint16_t)(int16_t)constrain(scaled, -32768L, 32767L);
+    }
+
+public:
+    ModbusRegisterMap() {
+        memset(registers, 0, sizeof(registers));
+        sampleCount = 0;
+        set(MB_REG_CELL_COUNT, NUM_CELLS);
+    }
+
+    // Gọi sau mỗi lần cập nhật bmsData
+    void update(const BMSData& data, float remainingAh, unsigned long nowMs) {
+        float minV = data.cellVoltages[0];
+        float maxV = data.cellVoltages[0];
+        for (int i = 0; i < NUM_CELLS; i++) {
+            set(MB_REG_CELL_BASE + i, scaleU16(data.cellVoltages[i], 1000.0f));
+            if (data.cellVoltages[i] < minV) minV = data.cellVoltages[i];
+            if (data.cellVoltages[i] > maxV) maxV = data.cellVoltages[i];
+        }
+
+        set(MB_REG_PACK_VOLTAGE, scaleU16(data.packVoltage, 100.0f));
+        set(MB_REG_CURRENT, scaleI16(data.current, 100.0f));
+        set(MB_REG_TEMPERATURE, scaleI16(data.packTemp, 10.0f));
+        set(MB_REG_SOC, scaleU16(data.soc, 10.0f));
+        set(MB_REG_SOH, scaleU16(data.soh, 10.0f));
+        set(MB_REG_FLAGS, getStatusFlags(data));
+        set(MB_REG_BALANCING, getBalancingMask(data));
+        set(MB_REG_CELL_AVG, scaleU16(data.avgCellVoltage, 1000.0f));
+        set(MB_REG_CELL_MIN, scaleU16(minV, 1000.0f));
+        set(MB_REG_CELL_MAX, scaleU16(maxV, 1000.0f));
+        set(MB_REG_REMAINING, scaleU16(remainingAh, 1000.0f));
+
+        uint32_t uptime = nowMs / 1000;
+        set(MB_REG_UPTIME_HI, uptime >> 16);
+        set(MB_REG_UPTIME_LO, uptime & 0xFFFF);
+        set(MB_REG_SAMPLE_COUNT, ++sampleCount);
+    }
+
+    uint16_t get(uint16_t addr) const {
+        return (registers[addr * 2] << 8) | registers[addr * 2 + 1];
+    }
+
+    const uint8_t* bytes(uint16_t addr) const {
+        return registers + addr * 2;
+    }
+};
+
+ModbusRegisterMap modbusRegisters;
+
+// ============ FRAME HANDLING ============
+// Một kết nối TCP: gom byte thành ADU hoàn chỉnh rồi trả lời từng ADU
+// (client có thể gửi nhiều request liên tiếp hoặc 1 request bị cắt đôi)
+
+class ModbusConnection {
+private:
+    uint8_t rx[MODBUS_ADU_MAX];
+    size_t rxLength;
+
+    static uint16_t readU16(const uint8_t* p) {
+        return (p[0] << 8) | p[1];
+    }
+
+    // Ghi MBAP header, trả về vị trí byte tiếp theo (function code)
+    static size_t writeHeader(uint8_t* out, const uint8_t* request, uint16_t pduLength) {
+        memcpy(out, request, 4);          // Transaction ID + Protocol ID
+        out[4] = (pduLength + 1) >> 8;    // Length = unit ID + PDU
+        out[5] = (pduLength + 1) & 0xFF;
+        out[6] = request[6];              // Unit ID
+        return 7;
+    }
+
+    static size_t exception(uint8_t* out, const uint8_t* request, uint8_t code) {
+        size_t n = writeHeader(out, request, 2);
+        out[n++] = request[7] | 0x80;
+        out[n++] = code;
+        return n;
+    }
+
+public:
+    ModbusConnection() {
+        rxLength = 0;
+    }
+
+    void reset() {
+        rxLength = 0;
+    }
+
+    size_t freeSpace() const {
+        return sizeof(rx) - rxLength;
+    }
+
+    // Nhận thêm byte từ socket (tối đa freeSpace())
+    size_t feed(const uint8_t* data, size_t len) {
+        len = min(len, freeSpace());
+        memcpy(rx + rxLength, data, len);
+        rxLength += len;
+        return len;
+    }
+
+    // Xử lý 1 ADU hoàn chỉnh trong buffer, ghi response vào out
+    // > 0: độ dài response; 0: cần thêm dữ liệu; < 0: frame sai, nên đóng kết nối
+    int process(const ModbusRegisterMap& map, uint8_t* out, size_t outSize) {
+        if (rxLength < 7) return 0;
+
+        uint16_t protocol = readU16(rx + 2);
+        uint16_t length = readU16(rx + 4);
+        if (protocol != 0 || length < 2 || length > MODBUS_ADU_MAX - 6) return -1;
+
+        size_t frameLength = 6 + length;
+        if (rxLength < frameLength) return 0;
+
+        size_t n;
+        uint8_t function = rx[7];
+        if (function != MODBUS_FC_READ_HOLDING && function != MODBUS_FC_READ_INPUT) {
+            n = exception(out, rx, MODBUS_EX_ILLEGAL_FUNCTION);
+        } else if (length != 6) {
+            n = exception(out, rx, MODBUS_EX_ILLEGAL_VALUE);
+        } else {
+            uint16_t start = readU16(rx + 8);
+            uint16_t count = readU16(rx + 10);
+            if (count == 0 || count > MODBUS_MAX_READ) {
+                n = exception(out, rx, MODBUS_EX_ILLEGAL_VALUE);
+            } else if ((uint32_t)start + count > MODBUS_REG_COUNT ||
+                       9 + count * 2U > outSize) {
+                n = exception(out, rx, MODBUS_EX_ILLEGAL_ADDRESS);
+            } else {
+                n = writeHeader(out, rx, 2 + count * 2);
+                out[n++] = function;
+                out[n++] = count * 2;
+                memcpy(out + n, map.bytes(start), count * 2);
+                n += count * 2;
+            }
+        }
+
+        // Dịch phần còn lại (request kế tiếp nếu client gửi dồn)
+        rxLength -= frameLength;
+        memmove(rx, rx + frameLength, rxLength);
+        return (int)n;
+    }
+};
+
+// ============ TCP SERVER ============
+
+#ifdef ESP32
+class BMSModbusServer {
+private:
+    WiFiServer server;
+    WiFiClient clients[MODBUS_MAX_CLIENTS];
+    ModbusConnection connections[MODBUS_MAX_CLIENTS];
+    unsigned long lastActivity[MODBUS_MAX_CLIENTS];
+    uint8_t response[MODBUS_ADU_MAX];
+
+    // Thống kê
+    uint32_t requests;
+    uint32_t exceptions;
+    uint32_t rejected;
+
+    void accept() {
+        WiFiClient incoming = server.available();
+        if (!incoming) return;
+
+        for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+            if (!clients[i].connected()) {
+                clients[i] = incoming;
+                clients[i].setNoDelay(true);
+                connections[i].reset();
+                lastActivity[i] = millis();
+                LOGI("🔌 Modbus client %d connected", i);
+                return;
+            }
+        }
+        // Hết slot: từ chối thay vì đẩy client cũ ra
+        incoming.stop();
+        rejected++;
+    }
+
+    void serve(int i) {
+        WiFiClient& client = clients[i];
+        ModbusConnection& connection = connections[i];
+
+        int available = client.available();
+        if (available > 0) {
+            uint8_t chunk[64];
+            while (available > 0 && connection.freeSpace() > 0) {
+                int n = client.read(chunk, min((size_t)available, min(sizeof(chunk), connection.freeSpace())));
+                if (n <= 0) break;
+                connection.feed(chunk, n);
+                available -= n;
+            }
+            lastActivity[i] = millis();
+        }
+
+        int length;
+        while ((length = connection.process(modbusRegisters, response, sizeof(response))) > 0) {
+            requests++;
+            if (response[7] & 0x80) exceptions++;
+            client.write(response, length);
+        }
+
+        if (length < 0 || millis() - lastActivity[i] > MODBUS_CLIENT_TIMEOUT) {
+            LOGW("⚠️  Modbus client %d closed (%s)", i, length < 0 ? "bad frame" : "timeout");
+            client.stop();
+            connection.reset();
+        }
+    }
+
+public:
+    BMSModbusServer() : server(MODBUS_PORT) {
+        for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+            lastActivity[i] = 0;
+        }
+        requests = 0;
+        exceptions = 0;
+        rejected = 0;
+    }
+
+    void begin() {
+        server.begin();
+        server.setNoDelay(true);
+        LOGI("✅ Modbus TCP server on port %d (%d registers)", MODBUS_PORT, MODBUS_REG_COUNT);
+    }
+
+    // Gọi mỗi vòng loop(), không chặn
+    void poll() {
+        accept();
+        for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+            if (clients[i].connected()) {
+                serve(i);
+            }
+        }
+    }
+
+    // Getters
+    int getClientCount() {
+        int count = 0;
+        for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+            if (clients[i].connected()) count++;
+        }
+        return count;
+    }
+
+    uint32_t getRequestCount() { return requests; }
+    uint32_t getExceptionCount() { return exceptions; }
+    uint32_t getRejectedCount() { return rejected; }
+};
+#endif
+
+#endif
@@ -0,0 +1,355 @@
+#ifndef BMS_MQTT_H
+#define BMS_MQTT_H
+
+#include <Arduino.h>
+#include "bms_data.h"
+#ifdef ESP32
+#include <WiFi.h>
+#include <MQTT.h>   // 256dpi/MQTT: publish QoS 0/1/2
+#endif
+
+/*
+ * BMS MQTT - Đẩy mẫu đo lên broker, có hàng đợi offline
+ * - enqueue() trong đường lấy mẫu chỉ nén mẫu thành struct nhỏ vào ring
+ *   (không format, không chờ mạng)
+ * - update() trong loop(): gom N mẫu / message, publish theo QoS đã chọn;
+ *   mẫu chỉ rời hàng đợi khi publish thành công
+ * - QoS 1/2: publish chặn tới PUBACK (tối đa MQTT_TIMEOUT_MS) => mỗi vòng loop()
+ *   chỉ 1 message; publish lỗi (broker chậm / TCP treo nửa chừng) thì chờ
+ *   MQTT_RECONNECT_MIN..MAX (tăng gấp đôi) mới thử lại => chu kỳ lấy mẫu bị kéo
+ *   dài tối đa 1 lần MQTT_TIMEOUT_MS mỗi lần chờ. QoS 0: tối đa MQTT_DRAIN_MESSAGES
+ * - Mất broker: mẫu tiếp tục vào ring (đầy thì bỏ mẫu cũ nhất, có đếm),
+ *   kết nối lại thì xả hàng đợi tồn theo batch MQTT_BATCH_MAX mẫu / message
+ * - MqttTransport tách thư viện MQTT ra để bench dùng broker giả lập
+ * - publishEvents(): nhật ký sự kiện đổi revision thì đẩy phần thay đổi lên
+ *   MQTT_EVENT_TOPIC trước các mẫu (cùng JSON với /alerts?since=), gửi lỗi thì
+ *   giữ nguyên vị trí, lần sau gửi lại
+ *
+ * Payload: {"dev":"esp32bms","n":2,"s":[[seq,ms,[mV...],cA,dC,soc‰,flags],...]}
+ *   seq tăng liên tục => phía nhận phát hiện mẫu bị mất
+ *   cA = dòng 10mA, dC = nhiệt độ 0.1°C, soc‰ = SOC 0.1%, flags = BMS_FLAG_*
+ */
+
+#ifndef MQTT_BROKER
+#define MQTT_BROKER "192.168.1.10"
+#endif
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+#ifndef MQTT_TOPIC
+#define MQTT_TOPIC "bms/esp32bms/samples"
+#endif
+#ifndef MQTT_EVENT_TOPIC
+#define MQTT_EVENT_TOPIC "bms/esp32bms/events"
+#endif
+#ifndef MQTT_QOS
+#define MQTT_QOS 1
+#endif
+#ifndef MQTT_BATCH_SAMPLES
+#define MQTT_BATCH_SAMPLES 1        // Số mẫu mỗi message khi online
+#endif
+
+#define MQTT_QUEUE_SIZE       256    // Mẫu giữ lại khi offline (lũy thừa của 2)
+#define MQTT_BATCH_MAX        32     // Số mẫu tối đa mỗi message
+#define MQTT_BATCH_MAX_AGE    2000   // ms: batch chưa đủ N mẫu vẫn gửi khi mẫu cũ nhất quá tuổi này
+#define MQTT_DRAIN_MESSAGES   4      // Message tối đa mỗi lần update() (không chiếm loop())
+#define MQTT_PAYLOAD_SIZE     2048
+#define MQTT_RECONNECT_MIN    1000   // ms
+#define MQTT_RECONNECT_MAX    15000  // ms (ngắn hơn thời gian hàng đợi đầy ở 500ms/mẫu)
+#define MQTT_TIMEOUT_MS       500    // TCP connect / CONNACK / PUBACK
+
+static_assert((MQTT_QUEUE_SIZE & (MQTT_QUEUE_SIZE - 1)) == 0,
+              "MQTT_QUEUE_SIZE must be a power of 2");
+
+char mqttPayload[MQTT_PAYLOAD_SIZE];
+
+// Mẫu đã nén (số nguyên có scale, giống status frame nhị phân)
+struct MqttSample {
+    uint32_t seq;
+    uint32_t timestamp;
+    uint16_t cellMv[NUM_CELLS];
+    int16_t current;       // 10 mA
+    int16_t temperature;   // 0.1°C
+    uint16_t soc;          // 0.1%
+    uint16_t flags;
+};
+
+// ============ TRANSPORT ============
+
+class MqttTransport {
+public:
+    virtual bool connected() = 0;
+    virtual bool connect() = 0;
+    virtual bool publish(const char* topic, const char* payload, size_t length, int qos) = 0;
+    virtual void loop() = 0;
+};
+
+#ifdef ESP32
+class MqttClientTransport : public MqttTransport {
+private:
+    WiFiClient net;
+    MQTTClient client;
+    const char* host;
+    uint16_t port;
+    const char* clientId;
+
+public:
+    MqttClientTransport(const char* brokerHost, uint16_t brokerPort, const char* id)
+        : client(MQTT_PAYLOAD_SIZE + 128) {
+        host = brokerHost;
+        port = brokerPort;
+        clientId = id;
+        client.begin(host, port, net);
+        client.setTimeout(MQTT_TIMEOUT_MS);
+    }
+
+    bool connected() override {
+        return client.connected();
+    }
+
+    // Tự mở TCP với timeout ngắn (mặc định của WiFiClient là vài giây)
+    bool connect() override {
+        if (!net.connect(host, port, MQTT_TIMEOUT_MS)) return false;
+        return client.connect(clientId, true);
+    }
+
+    bool publish(const char* topic, const char* payload, size_t length, int qos) override {
+        return client.publish(topic, payload, (int)length, false, qos);
+    }
+
+    void loop() override {
+        client.loop();
+    }
+};
+#endif
+
+// ============ PUBLISHER ============
+
+class BMSMqttPublisher {
+private:
+    MqttTransport* transport;
+    const char* topic;
+    const char* deviceId;
+    int qos;
+    uint16_t batchSize;
+
+    MqttSample queue[MQTT_QUEUE_SIZE];
+    uint32_t head;   // Mẫu kế tiếp được ghi
+    uint32_t tail;   // Mẫu cũ nhất chưa publish
+    uint32_t nextSeq;
+
+    // Nhật ký sự kiện (NULL = không đẩy)
+    BMSEventJournal* events;
+    const char* eventTopic;
+    uint32_t eventRevision;   // Revision cuối đã publish
+
+    unsigned long lastConnectAttempt;
+    unsigned long reconnectDelay;
+    bool wasConnected;
+    unsigned long lastFailure;    // Publish lỗi gần nhất
+    unsigned long retryDelay;     // 0 = publish được ngay
+
+    // Thống kê
+    uint32_t messages;
+    uint32_t samplesSent;
+    uint32_t dropped;
+    uint32_t failures;
+    uint32_t reconnects;
+    uint32_t highWater;
+    uint32_t eventMessages;
+
+    static uint16_t scaleU16(float value, float factor) {
+        long scaled = lroundf(value * factor);
+        return (uint16_t)constrain(scaled, 0L, 65535L);
+    }
+
+    static int16_t scaleI16(float value, float factor) {
+        long scaled = lroundf(value * factor);
+        return (int16_t)constrain(scaled, -32768L, 32767L);
+    }
+
+    // Format count mẫu từ tail vào mqttPayload, trả về độ dài (0 nếu tràn)
+    size_t formatBatch(uint32_t count) {
+        BufferWriter out(mqttPayload, sizeof(mqttPayload));
+        out.printf("{\"dev\":\"%s\",\"n\":%lu,\"s\":[", deviceId, (unsigned long)count);
+        for (uint32_t k = 0; k < count; k++) {
+            const MqttSample& s = queue[(tail + k) & (MQTT_QUEUE_SIZE - 1)];
+            out.printf("%s[%lu,%lu,[", k ? "," : "", (unsigned long)s.seq, (unsigned long)s.timestamp);
+            for (int i = 0; i < NUM_CELLS; i++) {
+                out.printf(i ? ",%u" : "%u", s.cellMv[i]);
+            }
+            out.printf("],%d,%d,%u,%u]", s.current, s.temperature, s.soc, s.flags);
+        }
+        out.printf("]}");
+        return out.isTruncated() ? 0 : out.length();
+    }
+
+    // Đẩy thay đổi của nhật ký sự kiện, trả về false nếu publish lỗi
+    bool publishEventChanges() {
+        if (!events || events->getRevision() == eventRevision) return true;
+        uint32_t next;
+        BufferWriter out(mqttPayload, sizeof(mqttPayload));
+        out.printf("{\"dev\":\"%s\",", deviceId);
+        events->writeJson(out, eventRevision, next);
+        out.printf("}");
+        if (out.isTruncated() || !transport->publish(eventTopic, mqttPayload, out.length(), qos)) {
+            return false;
+        }
+        eventRevision = next;
+        eventMessages++;
+        return true;
+    }
+
+    void tryConnect(unsigned long now) {
+        if (now - lastConnectAttempt < reconnectDelay) return;
+        lastConnectAttempt = now;
+        if (transport->connect()) {
+            reconnectDelay = MQTT_RECONNECT_MIN;
+            retryDelay = 0;
+            reconnects++;
+            LOGI("✅ MQTT connected, %lu samples queued", (unsigned long)getQueued());
+        } else {
+            reconnectDelay = min(reconnectDelay * 2, (unsigned long)MQTT_RECONNECT_MAX);
+        }
+    }
+
+    // Publish lỗi: giữ dữ liệu, chờ retryDelay (tăng gấp đôi) trước lần thử kế tiếp
+    void onPublishFailure(unsigned long now) {
+        failures++;
+        lastFailure = now;
+        retryDelay = retryDelay ? min(retryDelay * 2, (unsigned long)MQTT_RECONNECT_MAX) : MQTT_RECONNECT_MIN;
+    }
+
+public:
+    BMSMqttPublisher(MqttTransport* mqttTransport, const char* mqttTopic, const char* id,
+                     int mqttQos = MQTT_QOS, uint16_t samplesPerMessage = MQTT_BATCH_SAMPLES) {
+        transport = mqttTransport;
+        topic = mqttTopic;
+        deviceId = id;
+        qos = mqttQos;
+        batchSize = constrain(samplesPerMessage, (uint16_t)1, (uint16_t)MQTT_BATCH_MAX);
+
+        head = 0;
+        tail = 0;
+        nextSeq = 0;
+
+        events = NULL;
+        eventTopic = NULL;
+        eventRevision = 0;
+
+        lastConnectAttempt = 0;
+        reconnectDelay = 0;   // Thử kết nối ngay lần đầu
+        wasConnected = false;
+        lastFailure = 0;
+        retryDelay = 0;
+
+        messages = 0;
+        samplesSent = 0;
+        dropped = 0;
+        failures = 0;
+        reconnects = 0;
+        highWater = 0;
+        eventMessages = 0;
+    }
+
+    void publishEvents(BMSEventJournal* journal, const char* topic) {
+        events = journal;
+        eventTopic = topic;
+        eventRevision = 0;
+    }
+
+    // Gọi sau mỗi lần cập nhật bmsData (đường lấy mẫu, không chặn)
+    void enqueue(const BMSData& data, unsigned long now) {
+        if (head - tail >= MQTT_QUEUE_SIZE) {
+            tail++;   // Đầy: bỏ mẫu cũ nhất
+            dropped++;
+        }
+
+        MqttSample& s = queue[head & (MQTT_QUEUE_SIZE - 1)];
+        s.seq = nextSeq++;
+        s.timestamp = now;
+        for (int i = 0; i < NUM_CELLS; i++) {
+            s.cellMv[i] = scaleU16(data.cellVoltages[i], 1000.0f);
+        }
+        s.current = scaleI16(data.current, 100.0f);
+        s.temperature = scaleI16(data.packTemp, 10.0f);
+        s.soc = scaleU16(data.soc, 10.0f);
+        s.flags = getStatusFlags(data);
+        head++;
+
+        if (head - tail > highWater) highWater = head - tail;
+    }
+
+    // Gọi mỗi vòng loop(); networkUp = WiFi đang kết nối
+    void update(unsigned long now, bool networkUp) {
+        if (!networkUp) {
+            wasConnected = false;
+            return;
+        }
+
+        transport->loop();
+        if (!transport->connected()) {
+            if (wasConnected) {
+                LOGW("⚠️  MQTT broker lost, queueing samples");
+                wasConnected = false;
+                reconnectDelay = MQTT_RECONNECT_MIN;
+            }
+            tryConnect(now);
+            if (!transport->connected()) return;
+        }
+        wasConnected = true;
+        if (retryDelay && now - lastFailure < retryDelay) return;
+
+        // QoS > 0 chặn tới PUBACK: 1 message mỗi vòng loop()
+        int budget = qos > 0 ? 1 : MQTT_DRAIN_MESSAGES;
+
+        // Alarm trước, mẫu sau
+        if (events && events->getRevision() != eventRevision) {
+            if (!publishEventChanges()) {
+                onPublishFailure(now);
+                return;
+            }
+            retryDelay = 0;
+            budget--;
+        }
+
+        for (int m = 0; m < budget; m++) {
+            uint32_t pending = head - tail;
+            if (pending == 0) break;
+
+            // Chờ đủ batch, trừ khi mẫu cũ nhất đã quá tuổi
+            const MqttSample& oldest = queue[tail & (MQTT_QUEUE_SIZE - 1)];
+            if (pending < batchSize && now - oldest.timestamp < MQTT_BATCH_MAX_AGE) break;
+
+            // Hàng đợi tồn (sau khi mất broker): xả theo batch lớn nhất
+            uint32_t count = min(pending, (uint32_t)(pending > batchSize ? MQTT_BATCH_MAX : batchSize));
+            size_t length = formatBatch(count);
+            while (length == 0 && count > 1) {
+                count /= 2;   // Không vừa payload: chia đôi batch
+                length = formatBatch(count);
+            }
+            if (length == 0 || !transport->publish(topic, mqttPayload, length, qos)) {
+                onPublishFailure(now);
+                break;   // Giữ mẫu trong hàng đợi, thử lại sau retryDelay
+            }
+
+            retryDelay = 0;
+            tail += count;
+            messages++;
+            samplesSent += count;
+        }
+    }
+
+    // Getters
+    uint32_t getQueued() { return head - tail; }
+    uint32_t getMessageCount() { return messages; }
+    uint32_t getSampleCount() { return samplesSent; }
+    uint32_t getDroppedCount() { return dropped; }
+    uint32_t getFailureCount() { return failures; }
+    uint32_t getReconnectCount() { return reconnects; }
+    uint32_t getHighWater() { return highWater; }
+    uint32_t getEventMessageCount() { return eventMessages; }
+    bool isConnected() { return transport->connected(); }
+};
+
+#endif
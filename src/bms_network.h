@@ -0,0 +1,163 @@
+#ifndef BMS_NETWORK_H
+#define BMS_NETWORK_H
+
+#include <WiFi.h>
+#include <ESPmDNS.h>
+#include "bms_log.h"
+
+/*
+ * BMS NETWORK - WiFi/mDNS chạy nền (không chặn)
+ * - begin() chỉ khởi động kết nối rồi trả về ngay
+ * - update() gọi mỗi vòng loop(), là một state machine nhỏ
+ * - Mất kết nối / không có AP: thử lại với backoff tăng dần (1s -> 60s)
+ * => Sensor, protection và SOC chạy ngay từ lúc boot, không chờ WiFi
+ */
+
+// Tham số kết nối
+#define WIFI_CONNECT_TIMEOUT 15000   // ms chờ cho mỗi lần thử
+#define WIFI_BACKOFF_MIN     1000    // ms
+#define WIFI_BACKOFF_MAX     60000   // ms
+
+class BMSNetwork {
+public:
+    enum State { NET_IDLE, NET_CONNECTING, NET_CONNECTED, NET_BACKOFF };
+
+private:
+    const char* ssid;
+    const char* password;
+    const char* hostname;
+
+    State state;
+    unsigned long stateStartTime;
+    unsigned long backoffDelay;
+    bool mdnsStarted;
+
+    // Thống kê
+    int connectAttempts;
+    int reconnectCount;
+    unsigned long connectedSince;
+
+    void setState(State newState) {
+        state = newState;
+        stateStartTime = millis();
+    }
+
+    void startConnect() {
+        connectAttempts++;
+        LOGI("📡 WiFi connecting to \"%s\" (attempt %d)...", ssid, connectAttempts);
+        WiFi.begin(ssid, password);
+        setState(NET_CONNECTING);
+    }
+
+    void enterBackoff() {
+        WiFi.disconnect();
+        LOGW("⚠️  WiFi not available, retry in %lus", backoffDelay / 1000);
+        setState(NET_BACKOFF);
+    }
+
+    void onConnected() {
+        connectedSince = millis();
+        backoffDelay = WIFI_BACKOFF_MIN;
+        setState(NET_CONNECTED);
+
+        IPAddress ip = WiFi.localIP();
+        LOGI("✅ WiFi connected!");
+        LOGI("IP Address: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        LOGI("Signal Strength: %d dBm", (int)WiFi.RSSI());
+
+        // mDNS chỉ cần khởi động một lần, IDF tự xử lý khi reconnect
+        if (!mdnsStarted && MDNS.begin(hostname)) {
+            MDNS.addService("http", "tcp", 80);
+            mdnsStarted = true;
+            LOGI("✅ mDNS responder started: http://%s.local", hostname);
+        }
+
+        LOGI("📡 Access Dashboard at: http://%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    }
+
+public:
+    BMSNetwork(const char* wifiSsid, const char* wifiPassword, const char* mdnsName) {
+        ssid = wifiSsid;
+        password = wifiPassword;
+        hostname = mdnsName;
+
+        state = NET_IDLE;
+        stateStartTime = 0;
+        backoffDelay = WIFI_BACKOFF_MIN;
+        mdnsStarted = false;
+
+        connectAttempts = 0;
+        reconnectCount = 0;
+        connectedSince = 0;
+    }
+
+    // Khởi động kết nối, không chờ
+    void begin() {
+        WiFi.mode(WIFI_STA);
+        WiFi.setAutoReconnect(false); // Reconnect do state machine quản lý
+        startConnect();
+    }
+
+    // Gọi mỗi vòng loop(), không bao giờ chặn
+    void update() {
+        unsigned long elapsed = millis() - stateStartTime;
+
+        switch (state) {
+            case NET_IDLE:
+                break;
+
+            case NET_CONNECTING:
+                if (WiFi.status() == WL_CONNECTED) {
+                    onConnected();
+                } else if (elapsed >= WIFI_CONNECT_TIMEOUT) {
+                    enterBackoff();
+                }
+                break;
+
+            case NET_CONNECTED:
+                if (WiFi.status() != WL_CONNECTED) {
+                    LOGE("❌ WiFi connection lost!");
+                    reconnectCount++;
+                    backoffDelay = WIFI_BACKOFF_MIN;
+                    enterBackoff();
+                }
+                break;
+
+            case NET_BACKOFF:
+                if (elapsed >= backoffDelay) {
+                    // Tăng gấp đôi thời gian chờ cho lần thất bại tiếp theo
+                    backoffDelay = min(backoffDelay * 2, (unsigned long)WIFI_BACKOFF_MAX);
+                    startConnect();
+                }
+                break;
+        }
+    }
+
+    // Getters
+    bool isConnected() {
+        return state == NET_CONNECTED;
+    }
+
+    State getState() {
+        return state;
+    }
+
+    const char* getStateName() {
+        switch (state) {
+            case NET_CONNECTING: return "connecting";
+            case NET_CONNECTED:  return "connected";
+            case NET_BACKOFF:    return "backoff";
+            default:             return "idle";
+        }
+    }
+
+    int getReconnectCount() {
+        return reconnectCount;
+    }
+
+    unsigned long getConnectedTime() {
+        return isConnected() ? (millis() - connectedSince) / 1000 : 0;
+    }
+};
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef BMS_POWER_H
+#define BMS_POWER_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include "bms_data.h"
+
+/*
+ * BMS POWER - Chu kỳ lấy mẫu thích ứng + tiết kiệm năng lượng
+ * - FAST   (100ms): đang có transient (dòng/áp thay đổi nhanh) hoặc alarm
+ * - ACTIVE (500ms): đang sạc/xả ổn định
+ * - IDLE   (2000ms): pin nghỉ > 10s, CPU hạ xuống 80MHz
+ * Giữa các lần lấy mẫu CPU không quay vòng loop() nữa:
+ * - WiFi đang dùng: delay() từng đoạn ngắn (idle task + modem sleep),
+ *   web server vẫn được phục vụ mỗi POWER_HTTP_POLL_MS
+ * - Radio tắt (đang backoff): light sleep thật, đánh thức bằng timer
+ * setFixedInterval(): bỏ qua chế độ thích ứng, lấy mẫu với chu kỳ cố định
+ * (UDP stream 50-100 Hz khi đo đặc tính cell)
+ * SOCEstimator tích phân theo thời gian thực giữa 2 mẫu nên độ chính xác
+ * không phụ thuộc vào chu kỳ lấy mẫu.
+ */
+
+// Chu kỳ lấy mẫu (ms)
+#define SAMPLE_INTERVAL_FAST   100
+#define SAMPLE_INTERVAL_ACTIVE 500
+#define SAMPLE_INTERVAL_IDLE   2000
+
+// Ngưỡng phát hiện transient giữa 2 mẫu liên tiếp
+#define TRANSIENT_CURRENT_DELTA 0.5    // A
+#define TRANSIENT_VOLTAGE_DELTA 0.02   // V (per cell)
+#define TRANSIENT_HOLD_TIME     5000   // ms giữ FAST sau transient cuối
+#define IDLE_ENTER_TIME         10000  // ms idle trước khi vào IDLE
+
+// Thời gian ngủ tối đa mỗi lần khi WiFi đang bật (độ trễ HTTP tối đa)
+#define POWER_HTTP_POLL_MS 10
+// Không light sleep nếu chỉ còn ít hơn (ms)
+#define LIGHT_SLEEP_MIN_MS 5
+
+#define CPU_FREQ_ACTIVE 240
+#define CPU_FREQ_IDLE   80
+
+// Mô hình dòng tiêu thụ ESP32 (mA, theo datasheet) để ước tính dòng trung bình
+#define POWER_MA_BUSY_240   50.0
+#define POWER_MA_BUSY_80    25.0
+#define POWER_MA_WAIT_240   27.0   // Idle task + modem sleep
+#define POWER_MA_WAIT_80    15.0
+#define POWER_MA_LIGHT_SLEEP 0.8
+
+class BMSPowerManager {
+public:
+    enum Mode { POWER_FAST, POWER_ACTIVE, POWER_IDLE, POWER_MODE_COUNT };
+
+    struct ModeStats {
+        unsigned long long busyUs;       // CPU chạy code
+        unsigned long long waitUs;       // delay() (CPU chờ trong idle task)
+        unsigned long long lightSleepUs; // light sleep thật
+        unsigned long samples;
+    };
+
+private:
+    Mode mode;
+    ModeStats stats[POWER_MODE_COUNT];
+
+    float lastCurrent;
+    float lastCellVoltages[NUM_CELLS];
+    bool hasLastSample;
+    unsigned long lastTransientTime;
+    unsigned long idleSince;
+
+    unsigned long lastMarkUs;
+    uint32_t cpuFreq;
+    unsigned long fixedInterval;   // 0 = thích ứng
+
+    void setCpuFreq(uint32_t mhz) {
+        if (cpuFreq != mhz) {
+            setCpuFrequencyMhz(mhz);
+            cpuFreq = mhz;
+        }
+    }
+
+    bool detectTransient(const BMSData& data) {
+        if (!hasLastSample) return false;
+        if (abs(data.current - lastCurrent) > TRANSIENT_CURRENT_DELTA) return true;
+        for (int i = 0; i < NUM_CELLS; i++) {
+            if (abs(data.cellVoltages[i] - lastCellVoltages[i]) > TRANSIENT_VOLTAGE_DELTA) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool anyAlarm(const BMSData& data) {
+        return data.overVoltageAlarm || data.underVoltageAlarm ||
+               data.overCurrentAlarm || data.overTempAlarm ||
+               data.underTempAlarm || data.shortCircuitAlarm ||
+               data.commsFaultAlarm || data.thermalLossAlarm;
+    }
+
+public:
+    BMSPowerManager() {
+        mode = POWER_ACTIVE;
+        memset(stats, 0, sizeof(stats));
+        lastCurrent = 0;
+        hasLastSample = false;
+        lastTransientTime = 0;
+        idleSince = 0;
+        lastMarkUs = 0;
+        cpuFreq = CPU_FREQ_ACTIVE;
+        fixedInterval = 0;
+    }
+
+    void begin() {
+        lastMarkUs = micros();
+        cpuFreq = getCpuFrequencyMhz();
+        Serial.println("✅ Power manager: adaptive sampling 100/500/2000ms");
+    }
+
+    // Gọi sau mỗi lần lấy mẫu để chọn chu kỳ tiếp theo
+    void onSample(const BMSData& data) {
+        unsigned long now = millis();
+        stats[mode].samples++;
+
+        if (detectTransient(data) || anyAlarm(data)) {
+            lastTransientTime = now;
+        }
+
+        bool idle = !data.isCharging && !data.isDischarging;
+        if (!idle) {
+            idleSince = 0;
+        } else if (idleSince == 0) {
+            idleSince = now;
+        }
+
+        if (lastTransientTime != 0 && now - lastTransientTime < TRANSIENT_HOLD_TIME) {
+            mode = POWER_FAST;
+        } else if (idle && idleSince != 0 && now - idleSince >= IDLE_ENTER_TIME) {
+            mode = POWER_IDLE;
+        } else {
+            mode = POWER_ACTIVE;
+        }
+
+        setCpuFreq(mode == POWER_IDLE && fixedInterval == 0 ? CPU_FREQ_IDLE : CPU_FREQ_ACTIVE);
+
+        lastCurrent = data.current;
+        for (int i = 0; i < NUM_CELLS; i++) {
+            lastCellVoltages[i] = data.cellVoltages[i];
+        }
+        hasLastSample = true;
+    }
+
+    // Chu kỳ cố định (ms), 0 để quay lại chế độ thích ứng
+    void setFixedInterval(unsigned long ms) {
+        fixedInterval = ms;
+    }
+
+    unsigned long getSampleInterval() {
+        if (fixedInterval != 0) return fixedInterval;
+        switch (mode) {
+            case POWER_FAST: return SAMPLE_INTERVAL_FAST;
+            case POWER_IDLE: return SAMPLE_INTERVAL_IDLE;
+            default:         return SAMPLE_INTERVAL_ACTIVE;
+        }
+    }
+
+    // Gọi cuối loop(): ngủ tới lần lấy mẫu kế tiếp (hoặc tới lần poll HTTP kế tiếp)
+    // radioOff = true khi WiFi không hoạt động -> được phép light sleep
+    void sleepUntil(unsigned long remainingMs, bool radioOff) {
+        unsigned long start = micros();
+        stats[mode].busyUs += start - lastMarkUs;
+
+        if (radioOff && remainingMs >= LIGHT_SLEEP_MIN_MS) {
+            esp_sleep_enable_timer_wakeup((uint64_t)remainingMs * 1000ULL);
+            esp_light_sleep_start();
+            lastMarkUs = micros();
+            stats[mode].lightSleepUs += lastMarkUs - start;
+            return;
+        }
+
+        unsigned long waitMs = min(remainingMs, (unsigned long)POWER_HTTP_POLL_MS);
+        if (waitMs > 0) {
+            delay(waitMs);
+        }
+        lastMarkUs = micros();
+        stats[mode].waitUs += lastMarkUs - start;
+    }
+
+    // Getters
+    Mode getMode() {
+        return mode;
+    }
+
+    static const char* modeName(int m) {
+        switch (m) {
+            case POWER_FAST: return "fast";
+            case POWER_IDLE: return "idle";
+            default:         return "active";
+        }
+    }
+
+    const ModeStats& getStats(int m) {
+        return stats[m];
+    }
+
+    // CPU utilisation (%) trong một mode
+    float getCpuUtilisation(int m) {
+        unsigned long long total = stats[m].busyUs + stats[m].waitUs + stats[m].lightSleepUs;
+        if (total == 0) return 0;
+        return stats[m].busyUs * 100.0 / total;
+    }
+
+    // Dòng trung bình ước tính (mA) trong một mode, theo mô hình ở trên
+    float getEstimatedCurrent(int m) {
+        unsigned long long total = stats[m].busyUs + stats[m].waitUs + stats[m].lightSleepUs;
+        if (total == 0) return 0;
+        bool lowFreq = (m == POWER_IDLE);
+        float busyMa = lowFreq ? POWER_MA_BUSY_80 : POWER_MA_BUSY_240;
+        float waitMa = lowFreq ? POWER_MA_WAIT_80 : POWER_MA_WAIT_240;
+        double charge = stats[m].busyUs * (double)busyMa +
+                        stats[m].waitUs * (double)waitMa +
+                        stats[m].lightSleepUs * (double)POWER_MA_LIGHT_SLEEP;
+        return charge / total;
+    }
+
+    // Thời gian đã ở trong mode (s)
+    unsigned long getModeTime(int m) {
+        return (stats[m].busyUs + stats[m].waitUs + stats[m].lightSleepUs) / 1000000ULL;
+    }
+};
+
+#endif
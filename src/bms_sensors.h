@@ -2,15 +2,54 @@
 #define BMS_SENSORS_H
 
 #include <Arduino.h>
+#include "bms_chemistry.h"
+#include "bms_temperature.h"
 
-class BMSSensors {
+// ============ SENSOR DRIVER INTERFACE ============
+// readAndUpdateBMS() chỉ dùng interface này: BMSSensors (giả lập) hoặc
+// driver AFE thật (bms_afe.h)
+class BMSSensorDriver {
+public:
+    virtual void begin() = 0;
+    virtual bool readAllSensors() = 0;        // false: lỗi bus/CRC, giữ giá trị lần đọc trước
+    virtual int getCellCount() = 0;
+    virtual float getCellVoltage(int cellNum) = 0;   // cellNum từ 1
+    virtual float getCurrent() = 0;           // A, dương = sạc
+    virtual float getTemperature() = 0;       // °C
+    virtual float getPackVoltage() = 0;
+    
+    // Nạp các kênh nhiệt độ của lần đọc vừa rồi; mặc định 1 kênh = getTemperature()
+    virtual void readThermistors(BMSTemperatureBank& bank) {
+        bank.setCelsius(0, getTemperature());
+    }
+};
+
+// ============ SIMULATOR ============
+
+// Tham số mô phỏng; mặc định = pack 6Ah, chu kỳ 120s (firmware).
+// Fleet simulator trên PC tạo mỗi pack 1 bộ tham số khác nhau
+struct SimulationProfile {
+    float capacity;               // Ah ban đầu
+    float chargeCurrent;          // A
+    float dischargeCurrent;       // A (giá trị dương)
+    unsigned long cycleSeconds;   // 1/3 sạc, 1/3 xả, 1/3 idle
+    float ambient;                // °C trung bình
+    float cellSpread;             // V lệch của cell cao nhất / thấp nhất so với trung bình
+    unsigned long phaseMs;        // Lệch pha chu kỳ so với lúc khởi tạo
+};
+
+const SimulationProfile SIMULATION_DEFAULT = { 6.0, 1.5, 1.2, 120, 25.0, 0.01, 0 };
+
+class BMSSensors : public BMSSensorDriver {
 private:
     // Giá trị giả lập
     float cellVoltages[4];
     float current;
     float temperature;
+    uint16_t thermistorAdc[TEMP_CHANNELS];   // Mã ADC giả lập của từng kênh
     
     // ========== SIMULATION PARAMETERS ==========
+    SimulationProfile profile;
     unsigned long startTime;
     float simulatedCapacity;      // Dung lượng giảm theo thời gian
     int cycleCount;               // Số chu kỳ sạc/xả
@@ -21,86 +60,91 @@ private:
     ChargeState chargeState;
     unsigned long stateChangeTime;
     
+    // Lệch nhỏ giữa các cell quanh baseVoltage
+    void spreadCells(float baseVoltage) {
+        cellVoltages[0] = baseVoltage + profile.cellSpread;
+        cellVoltages[1] = baseVoltage + profile.cellSpread * 0.5f;
+        cellVoltages[2] = baseVoltage - profile.cellSpread * 0.5f;
+        cellVoltages[3] = baseVoltage - profile.cellSpread;
+    }
+    
 public:
-    BMSSensors() {
+    BMSSensors(const SimulationProfile& simulation = SIMULATION_DEFAULT) {
+        profile = simulation;
         // Khởi tạo dữ liệu giả lập
-        cellVoltages[0] = 3.40;
-        cellVoltages[1] = 3.40;
-        cellVoltages[2] = 3.40;
-        cellVoltages[3] = 3.40;
+        cellVoltages[0] = BatteryChemistry::fullVoltage;
+        cellVoltages[1] = BatteryChemistry::fullVoltage;
+        cellVoltages[2] = BatteryChemistry::fullVoltage;
+        cellVoltages[3] = BatteryChemistry::fullVoltage;
         current = 0.0;           // Ban đầu idle
-        temperature = 25.0;      // °C
+        temperature = profile.ambient;      // °C
+        for (int ch = 0; ch < TEMP_CHANNELS; ch++) {
+            thermistorAdc[ch] = thermistorAdcFromCelsius(temperature);
+        }
         
-        startTime = millis();
-        baseCapacity = 6.0;      // Dung lượng ban đầu (Ah)
-        simulatedCapacity = 6.0;
+        startTime = millis() - profile.phaseMs;
+        baseCapacity = profile.capacity;      // Dung lượng ban đầu (Ah)
+        simulatedCapacity = profile.capacity;
         cycleCount = 0;
         chargeState = IDLE;
         stateChangeTime = millis();
     }
 
-    void begin() {
+    void begin() override {
         Serial.println("✅ BMS Sensors initialized (simulation mode)");
         Serial.println("📊 Simulating battery degradation over time");
         Serial.println("   - Capacity loss: ~1% per 100 cycles");
         Serial.println("   - Temperature fluctuation: ±5°C");
-        Serial.println("   - Charge/Discharge cycling every 120 seconds\n");
+        Serial.printf("   - Charge/Discharge cycling every %lu seconds\n\n", profile.cycleSeconds);
     }
 
     // Cập nhật dữ liệu mô phỏng (thay đổi theo thời gian)
-    void readAllSensors() {
+    bool readAllSensors() override {
         unsigned long elapsed = millis() - startTime;
         unsigned long elapsedSeconds = elapsed / 1000;
         
         // ========== SIMULATION: CHARGE/DISCHARGE CYCLES ==========
-        // Chu kỳ 120 giây: 40s sạc + 40s xả + 40s idle
-        unsigned long cycleTime = elapsedSeconds % 120;
+        // Chu kỳ 120 giây (mặc định): 40s sạc + 40s xả + 40s idle
+        unsigned long phase = profile.cycleSeconds / 3;
+        unsigned long cycleTime = elapsedSeconds % profile.cycleSeconds;
         
-        if (cycleTime < 40) {
+        if (cycleTime < phase) {
             // ===== CHARGING PHASE (0-40s) =====
             chargeState = CHARGING;
-            current = 1.5;  // Sạc 1.5A
+            current = profile.chargeCurrent;  // Sạc 1.5A
             
-            // Điện áp tăng từ 3.0V đến 3.4V khi sạc
-            float chargeProgress = cycleTime / 40.0;  // 0.0 → 1.0
-            float baseVoltage = 3.0 + (chargeProgress * 0.4);
+            // Điện áp tăng theo OCV từ 20% đến 100% khi sạc (LiFePO4: 3.0V → 3.4V)
+            float chargeProgress = cycleTime / (float)phase;  // 0.0 → 1.0
+            float baseVoltage = chemistryOcv<BatteryChemistry>(20.0f + chargeProgress * 80.0f);
             
             // Thêm sự biến thiên nhỏ giữa các cell
-            cellVoltages[0] = baseVoltage + 0.01;
-            cellVoltages[1] = baseVoltage + 0.005;
-            cellVoltages[2] = baseVoltage - 0.005;
-            cellVoltages[3] = baseVoltage - 0.01;
+            spreadCells(baseVoltage);
             
-        } else if (cycleTime < 80) {
+        } else if (cycleTime < 2 * phase) {
             // ===== DISCHARGING PHASE (40-80s) =====
             chargeState = DISCHARGING;
-            current = -1.2;  // Xả 1.2A (dòng xả thường cao hơn dòng sạc)
+            current = -profile.dischargeCurrent;  // Xả 1.2A
             
-            // Điện áp giảm từ 3.4V đến 3.0V khi xả
-            float dischargeProgress = (cycleTime - 40) / 40.0;  // 0.0 → 1.0
-            float baseVoltage = 3.4 - (dischargeProgress * 0.4);
+            // Điện áp giảm theo OCV từ 100% về 20% khi xả
+            float dischargeProgress = (cycleTime - phase) / (float)phase;  // 0.0 → 1.0
+            float baseVoltage = chemistryOcv<BatteryChemistry>(100.0f - dischargeProgress * 80.0f);
             
-            cellVoltages[0] = baseVoltage + 0.01;
-            cellVoltages[1] = baseVoltage + 0.005;
-            cellVoltages[2] = baseVoltage - 0.005;
-            cellVoltages[3] = baseVoltage - 0.01;
+            spreadCells(baseVoltage);
             
         } else {
             // ===== IDLE PHASE (80-120s) =====
             chargeState = IDLE;
             current = 0.0;
             
-            // Điện áp ổn định ở ~3.2V
-            cellVoltages[0] = 3.20 + 0.01;
-            cellVoltages[1] = 3.20 + 0.005;
-            cellVoltages[2] = 3.20 - 0.005;
-            cellVoltages[3] = 3.20 - 0.01;
+            // Điện áp ổn định ở OCV 50% (LiFePO4 ~3.2V)
+            const float restVoltage = chemistryOcv<BatteryChemistry>(50.0f);
+            spreadCells(restVoltage);
         }
         
         // ========== SIMULATION: CAPACITY DEGRADATION ==========
         // Mô phỏng suy giảm dung lượng: 1% mất sau 100 chu kỳ
         // cycleCount tăng mỗi chu kỳ hoàn chỉnh (mỗi 120 giây)
-        cycleCount = elapsedSeconds / 120;
+        cycleCount = elapsedSeconds / profile.cycleSeconds;
         
         // Công thức: Capacity = Capacity_0 * (1 - degradation_rate * cycles)
         float degradationRate = 0.001;  // 0.1% mất per cycle
@@ -110,7 +154,7 @@ public:
         // ========== SIMULATION: TEMPERATURE FLUCTUATION ==========
         // Nhiệt độ biến đổi: 20-30°C theo thời gian
         float tempVariation = sin(elapsedSeconds * 0.01) * 5.0;  // ±5°C
-        temperature = 25.0 + tempVariation;
+        temperature = profile.ambient + tempVariation;
         
         // Nhiệt độ tăng khi sạc/xả, hạ khi idle
         if (chargeState == CHARGING) {
@@ -120,27 +164,54 @@ public:
         }
         
         temperature = constrain(temperature, 10.0, 50.0);
+        
+        // ========== SIMULATION: THERMISTOR CHANNELS ==========
+        // Nhóm cell lệch nhau ít, FET/shunt nóng theo dòng, môi trường mát hơn
+        for (int ch = 0; ch < TEMP_CHANNELS; ch++) {
+            float t = temperature;
+            if (ch < 4) {
+                t += 0.3 * ch - 0.5;
+            } else if (ch == 4) {
+                t += 2.5 * abs(current);        // FET
+            } else if (ch == 5) {
+                t += 1.5 * abs(current);        // Shunt
+            } else if (ch == 7) {
+                t -= 3.0;                       // Ambient
+            }
+            thermistorAdc[ch] = thermistorAdcFromCelsius(t);
+        }
+        return true;
     }
 
     // Getters
-    float getCellVoltage(int cellNum) {
+    int getCellCount() override {
+        return 4;
+    }
+
+    float getCellVoltage(int cellNum) override {
         if (cellNum >= 1 && cellNum <= 4)
             return cellVoltages[cellNum - 1];
         return 0.0;
     }
 
-    float getCurrent() {
+    float getCurrent() override {
         return current;
     }
 
-    float getTemperature() {
+    float getTemperature() override {
         return temperature;
     }
 
-    float getPackVoltage() {
+    float getPackVoltage() override {
         return cellVoltages[0] + cellVoltages[1] + cellVoltages[2] + cellVoltages[3];
     }
     
+    void readThermistors(BMSTemperatureBank& bank) override {
+        for (int ch = 0; ch < TEMP_CHANNELS; ch++) {
+            bank.setAdc(ch, thermistorAdc[ch]);
+        }
+    }
+    
     // Getter cho dung lượng mô phỏng (để debug)
     float getSimulatedCapacity() {
         return simulatedCapacity;
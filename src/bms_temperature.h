@@ -0,0 +1,231 @@
+#ifndef BMS_TEMPERATURE_H
+#define BMS_TEMPERATURE_H
+
+#include <Arduino.h>
+#include <math.h>
+
+/*
+ * BMS Temperature - Nhiều kênh thermistor (nhóm cell, FET, shunt, môi trường)
+ * - NTC nối GND, điện trở kéo TEMP_PULLUP_OHMS lên Vref, ADC 12-bit đọc điểm giữa
+ * - Đổi mã ADC -> 0.01°C bằng bảng TEMP_LUT_SIZE điểm sinh lúc biên dịch từ
+ *   phương trình Steinhart-Hart (constexpr), nội suy tuyến tính giữa 2 điểm:
+ *   không gọi log() trong đường lấy mẫu
+ * - Mã ADC sát 0 / sát 4095 = chập / hở mạch: kênh bị đánh dấu lỗi và bỏ qua
+ * - Mỗi kênh giữ min/max/trung bình kể từ boot; protection dùng kênh nóng
+ *   nhất (OT) và lạnh nhất (UT)
+ * - AFE tự đổi nhiệt độ (BQ76952) thì nạp thẳng °C bằng setCelsius()
+ */
+
+#ifndef TEMP_CHANNELS
+#define TEMP_CHANNELS      8
+#endif
+#define TEMP_MAX_CHANNELS  16
+
+// Thermistor 10k NTC (hệ số Steinhart-Hart) và mạch chia áp
+#ifndef TEMP_SH_A
+#define TEMP_SH_A          1.009249522e-3
+#define TEMP_SH_B          2.378405444e-4
+#define TEMP_SH_C          2.019202697e-7
+#endif
+#define TEMP_PULLUP_OHMS   10000.0
+#define TEMP_ADC_MAX       4095
+
+#define TEMP_LUT_SHIFT     4                                  // 16 mã ADC mỗi đoạn
+#define TEMP_LUT_SIZE      ((TEMP_ADC_MAX >> TEMP_LUT_SHIFT) + 2)
+#define TEMP_LUT_MIN_C     -55.0
+#define TEMP_LUT_MAX_C     150.0
+
+#define TEMP_ADC_SHORT     16      // Dưới mức này: thermistor chập
+#define TEMP_ADC_OPEN      4080    // Trên mức này: hở mạch / chưa cắm
+
+static_assert(TEMP_CHANNELS >= 1 && TEMP_CHANNELS <= TEMP_MAX_CHANNELS, "TEMP_CHANNELS out of range");
+
+// ============ STEINHART-HART ============
+
+// ln(x) dùng được lúc biên dịch: đưa x về [0.5, 1] * 2^k, ln x = 2 atanh((x-1)/(x+1))
+constexpr double thermistorLog(double x) {
+    int k = 0;
+    while (x > 1.0) { x /= 2; k++; }
+    while (x < 0.5) { x *= 2; k--; }
+    double y = (x - 1) / (x + 1);
+    double term = y;
+    double sum = 0;
+    for (int n = 1; n < 40; n += 2) {
+        sum += term / n;
+        term *= y * y;
+    }
+    return 2 * sum + k * 0.69314718055994530942;
+}
+
+// Mã ADC -> °C theo Steinhart-Hart, lúc biên dịch (sinh bảng)
+constexpr double thermistorCelsiusExact(double adc) {
+    double r = TEMP_PULLUP_OHMS * adc / (TEMP_ADC_MAX - adc);
+    double l = thermistorLog(r);
+    return 1.0 / (TEMP_SH_A + TEMP_SH_B * l + TEMP_SH_C * l * l * l) - 273.15;
+}
+
+// Cách tính trực tiếp (1 logf mỗi lần đổi), dùng làm tham chiếu
+inline float thermistorSteinhartHart(uint16_t adc) {
+    float r = (float)TEMP_PULLUP_OHMS * adc / (TEMP_ADC_MAX - adc);
+    float l = logf(r);
+    return 1.0f / ((float)TEMP_SH_A + (float)TEMP_SH_B * l + (float)TEMP_SH_C * l * l * l) - 273.15f;
+}
+
+// °C -> mã ADC (nghịch đảo Steinhart-Hart, dùng cho mô phỏng và kiểm tra)
+inline uint16_t thermistorAdcFromCelsius(float celsius) {
+    double x = (TEMP_SH_A - 1.0 / (celsius + 273.15)) / TEMP_SH_C;
+    double y = sqrt(pow(TEMP_SH_B / (3 * TEMP_SH_C), 3) + x * x / 4);
+    double r = exp(cbrt(y - x / 2) - cbrt(y + x / 2));
+    long adc = lround(TEMP_ADC_MAX * r / (r + TEMP_PULLUP_OHMS));
+    return (uint16_t)constrain(adc, 0L, (long)TEMP_ADC_MAX);
+}
+
+struct ThermistorTable {
+    int16_t centiCelsius[TEMP_LUT_SIZE];
+};
+
+constexpr ThermistorTable makeThermistorTable() {
+    ThermistorTable table{};
+    for (int i = 0; i < TEMP_LUT_SIZE; i++) {
+        int adc = i << TEMP_LUT_SHIFT;
+        if (adc < 1) adc = 1;
+        if (adc > TEMP_ADC_MAX - 1) adc = TEMP_ADC_MAX - 1;
+        double c = thermistorCelsiusExact(adc);
+        if (c < TEMP_LUT_MIN_C) c = TEMP_LUT_MIN_C;
+        if (c > TEMP_LUT_MAX_C) c = TEMP_LUT_MAX_C;
+        table.centiCelsius[i] = (int16_t)(c * 100 + (c < 0 ? -0.5 : 0.5));
+    }
+    return table;
+}
+
+constexpr ThermistorTable thermistorTable = makeThermistorTable();
+
+// Mã ADC -> 0.01°C: 1 lần tra bảng + nội suy tuyến tính
+inline int16_t thermistorCentiCelsius(uint16_t adc) {
+    if (adc > TEMP_ADC_MAX) adc = TEMP_ADC_MAX;
+    int i = adc >> TEMP_LUT_SHIFT;
+    int frac = adc & ((1 << TEMP_LUT_SHIFT) - 1);
+    int a = thermistorTable.centiCelsius[i];
+    int b = thermistorTable.centiCelsius[i + 1];
+    return (int16_t)(a + (b - a) * frac / (1 << TEMP_LUT_SHIFT));
+}
+
+// ============ CHANNEL BANK ============
+
+class BMSTemperatureBank {
+public:
+    struct Channel {
+        int16_t centi;      // 0.01°C, mẫu mới nhất
+        int16_t minCenti;
+        int16_t maxCenti;
+        int64_t sumCenti;
+        uint32_t samples;
+        bool present;       // Đã có driver nạp dữ liệu
+        bool fault;         // Chập / hở mạch ở mẫu mới nhất
+    };
+
+private:
+    Channel channels[TEMP_CHANNELS];
+    int hottest;
+    int coldest;
+    uint16_t faultMask;
+
+    void record(int ch, int16_t centi) {
+        Channel& c = channels[ch];
+        c.centi = centi;
+        c.fault = false;
+        if (c.samples == 0 || centi < c.minCenti) c.minCenti = centi;
+        if (c.samples == 0 || centi > c.maxCenti) c.maxCenti = centi;
+        c.sumCenti += centi;
+        c.samples++;
+    }
+
+public:
+    BMSTemperatureBank() {
+        reset();
+    }
+
+    void reset() {
+        for (int ch = 0; ch < TEMP_CHANNELS; ch++) {
+            channels[ch].centi = 2500;
+            channels[ch].minCenti = 2500;
+            channels[ch].maxCenti = 2500;
+            channels[ch].sumCenti = 0;
+            channels[ch].samples = 0;
+            channels[ch].present = false;
+            channels[ch].fault = false;
+        }
+        hottest = 0;
+        coldest = 0;
+        faultMask = 0;
+    }
+
+    static const char* channelName(int ch) {
+        static const char* const names[TEMP_MAX_CHANNELS] = {
+            "Cell 1", "Cell 2", "Cell 3", "Cell 4", "FET", "Shunt", "Balancer", "Ambient",
+            "Aux 1", "Aux 2", "Aux 3", "Aux 4", "Aux 5", "Aux 6", "Aux 7", "Aux 8",
+        };
+        return names[ch];
+    }
+
+    // Nạp mã ADC 12-bit của thermistor
+    void setAdc(int ch, uint16_t adc) {
+        if (ch < 0 || ch >= TEMP_CHANNELS) return;
+        channels[ch].present = true;
+        if (adc < TEMP_ADC_SHORT || adc > TEMP_ADC_OPEN) {
+            channels[ch].fault = true;
+            return;
+        }
+        record(ch, thermistorCentiCelsius(adc));
+    }
+
+    // Nạp nhiệt độ đã đổi sẵn (AFE)
+    void setCelsius(int ch, float celsius) {
+        if (ch < 0 || ch >= TEMP_CHANNELS) return;
+        channels[ch].present = true;
+        long centi = lroundf(celsius * 100.0f);
+        record(ch, (int16_t)constrain(centi, -32768L, 32767L));
+    }
+
+    // Gọi sau khi nạp đủ các kênh của 1 mẫu; false nếu không còn kênh hợp lệ
+    // (giữ kênh nóng/lạnh nhất của mẫu trước)
+    bool update() {
+        int hot = -1, cold = -1;
+        uint16_t faults = 0;
+        for (int ch = 0; ch < TEMP_CHANNELS; ch++) {
+            const Channel& c = channels[ch];
+            if (!c.present) continue;
+            if (c.fault) {
+                faults |= 1 << ch;
+                continue;
+            }
+            if (hot < 0 || c.centi > channels[hot].centi) hot = ch;
+            if (cold < 0 || c.centi < channels[cold].centi) cold = ch;
+        }
+        faultMask = faults;
+        if (hot < 0) return false;
+        hottest = hot;
+        coldest = cold;
+        return true;
+    }
+
+    // Getters
+    int getChannelCount() { return TEMP_CHANNELS; }
+    const Channel& getChannel(int ch) { return channels[ch]; }
+    float getCelsius(int ch) { return channels[ch].centi / 100.0f; }
+    float getMin(int ch) { return channels[ch].minCenti / 100.0f; }
+    float getMax(int ch) { return channels[ch].maxCenti / 100.0f; }
+    float getAverage(int ch) {
+        const Channel& c = channels[ch];
+        return c.samples ? (float)((double)c.sumCenti / c.samples / 100.0) : c.centi / 100.0f;
+    }
+    int getHottestChannel() { return hottest; }
+    int getColdestChannel() { return coldest; }
+    float getHottest() { return getCelsius(hottest); }
+    float getColdest() { return getCelsius(coldest); }
+    uint16_t getFaultMask() { return faultMask; }
+};
+
+BMSTemperatureBank temperatureBank;
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef BMS_UDP_H
+#define BMS_UDP_H
+
+#include <Arduino.h>
+#include "bms_data.h"
+#ifdef ESP32
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#endif
+
+/*
+ * BMS UDP - Stream mẫu tốc độ cao cho đo đặc tính cell (-DBMS_UDP_STREAM)
+ * - Lấy mẫu cố định UDP_STREAM_INTERVAL (10ms = 100 Hz), mỗi mẫu 1 frame
+ *   nhị phân kích thước cố định, gửi ngay trong đường lấy mẫu
+ * - UDP_FRAMES_PER_PACKET frame gom vào 1 datagram để giảm số gói/giây
+ * - Đích là 1 host hoặc nhóm multicast (224.x - 239.x)
+ * - Nhận trên PC: python tools/bms_udp_receiver.py --csv cells.csv
+ *
+ * Frame (little-endian, UDP_FRAME_SIZE byte):
+ *   u16 magic 0x5342 ("BS") | u8 version | u8 cells | u32 seq | u32 timestamp (µs)
+ *   | u16 cell mV × cells | i16 current (mA) | i16 nhiệt độ (0.01°C)
+ *   | u16 SOC (0.1%) | u16 flags (BMS_FLAG_*)
+ * seq tăng liên tục => phía nhận phát hiện frame bị mất
+ */
+
+#ifndef UDP_TARGET
+#define UDP_TARGET "239.1.2.3"
+#endif
+#ifndef UDP_PORT
+#define UDP_PORT 5005
+#endif
+#ifndef UDP_STREAM_INTERVAL
+#define UDP_STREAM_INTERVAL 10      // ms
+#endif
+#ifndef UDP_FRAMES_PER_PACKET
+#define UDP_FRAMES_PER_PACKET 1
+#endif
+
+#define UDP_FRAME_MAGIC   0x5342
+#define UDP_FRAME_VERSION 1
+#define UDP_FRAME_SIZE    (12 + 2 * NUM_CELLS + 8)
+
+// ============ FRAME ENCODER ============
+
+class UdpFrameEncoder {
+private:
+    static void put16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = v >> 8;
+    }
+
+    static void put32(uint8_t* p, uint32_t v) {
+        put16(p, v & 0xFFFF);
+        put16(p + 2, v >> 16);
+    }
+
+    static uint16_t scaleU16(float value, float factor) {
+        long scaled = lroundf(value * factor);
+        return (uint16_t)constrain(scaled, 0L, 65535L);
+    }
+
+    static uint16_t scaleI16(float value, float factor) {
+        long scaled = lroundf(value * factor);
+        return (uint16_t)(int16_t)constrain(scaled, -32768L, 32767L);
+    }
+
+public:
+    // Ghi 1 frame vào out (UDP_FRAME_SIZE byte)
+    static void encode(const BMSData& data, uint32_t seq, uint32_t timestampUs, uint8_t* out) {
+        put16(out, UDP_FRAME_MAGIC);
+        out[2] = UDP_FRAME_VERSION;
+        out[3] = NUM_CELLS;
+        put32(out + 4, seq);
+        put32(out + 8, timestampUs);
+        uint8_t* p = out + 12;
+        for (int i = 0; i < NUM_CELLS; i++, p += 2) {
+            put16(p, scaleU16(data.cellVoltages[i], 1000.0f));
+        }
+        put16(p, scaleI16(data.current, 1000.0f));
+        put16(p + 2, scaleI16(data.packTemp, 100.0f));
+        put16(p + 4, scaleU16(data.soc, 10.0f));
+        put16(p + 6, getStatusFlags(data));
+    }
+};
+
+// ============ STREAM ============
+
+#ifdef ESP32
+class BMSUdpStream {
+private:
+    WiFiUDP udp;
+    IPAddress target;
+    uint16_t port;
+    uint8_t packet[UDP_FRAME_SIZE * UDP_FRAMES_PER_PACKET];
+    int framesInPacket;
+    uint32_t seq;
+
+    // Thống kê
+    uint32_t samples;
+    uint32_t framesSent;
+    uint32_t packetsSent;
+    uint32_t sendFailures;
+    unsigned long long sendUs;   // Thời gian CPU trong encode + gửi
+    uint32_t maxSendUs;          // Lần chậm nhất (thường là lần gửi datagram)
+    unsigned long startMs;
+
+public:
+    BMSUdpStream(const char* targetAddress, uint16_t targetPort) {
+        target.fromString(targetAddress);
+        port = targetPort;
+        framesInPacket = 0;
+        seq = 0;
+        samples = 0;
+        framesSent = 0;
+        packetsSent = 0;
+        sendFailures = 0;
+        sendUs = 0;
+        maxSendUs = 0;
+        startMs = 0;
+    }
+
+    void begin() {
+        startMs = millis();
+        WiFi.setSleep(false);   // Modem sleep làm gói đi thành từng cụm theo DTIM
+        LOGI("✅ UDP stream %u.%u.%u.%u:%u, %d ms/sample, %d frames/packet",
+             target[0], target[1], target[2], target[3], port,
+             UDP_STREAM_INTERVAL, UDP_FRAMES_PER_PACKET);
+    }
+
+    // Gọi ngay sau mỗi lần lấy mẫu; không có WiFi thì bỏ frame (seq vẫn tăng)
+    void onSample(const BMSData& data, bool networkUp) {
+        unsigned long start = micros();
+        UdpFrameEncoder::encode(data, seq++, start, packet + framesInPacket * UDP_FRAME_SIZE);
+        framesInPacket++;
+        samples++;
+
+        if (framesInPacket == UDP_FRAMES_PER_PACKET) {
+            size_t length = framesInPacket * UDP_FRAME_SIZE;
+            framesInPacket = 0;
+            if (networkUp) {
+                if (udp.beginPacket(target, port) && udp.write(packet, length) == length &&
+                    udp.endPacket()) {
+                    packetsSent++;
+                    framesSent += UDP_FRAMES_PER_PACKET;
+                } else {
+                    sendFailures++;
+                }
+            }
+        }
+
+        uint32_t us = micros() - start;
+        sendUs += us;
+        if (us > maxSendUs) maxSendUs = us;
+    }
+
+    // Getters
+    uint32_t getFrameCount() { return framesSent; }
+    uint32_t getPacketCount() { return packetsSent; }
+    uint32_t getFailureCount() { return sendFailures; }
+    uint32_t getMaxSendUs() { return maxSendUs; }
+    float getAvgSampleUs() { return samples ? (float)sendUs / samples : 0; }
+
+    // Phần trăm thời gian CPU dành cho stream kể từ begin()
+    float getCpuPercent() {
+        unsigned long elapsedMs = millis() - startMs;
+        return elapsedMs ? sendUs / (elapsedMs * 10.0f) : 0;
+    }
+
+    float getFrameRate() {
+        unsigned long elapsedMs = millis() - startMs;
+        return elapsedMs ? framesSent * 1000.0f / elapsedMs : 0;
+    }
+};
+#endif
+
+#endif
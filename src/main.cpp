@@ -1,84 +1,385 @@
 #include <WiFi.h>
 #include <WebServer.h>
 #include <ESPmDNS.h>
+#include "bms_network.h"
 #include "bms_sensors.h"
+#include "bms_afe.h"
+#include "bms_faults.h"
 #include "bms_data.h"
+#include "bms_history.h"
+#include "bms_export.h"
+#include "bms_jitter.h"
+#include "bms_admission.h"
+#include "bms_power.h"
 #include "bms_html.h"
+#include "bms_modbus.h"
+#include "bms_can.h"
+#include "bms_mqtt.h"
+#include "bms_udp.h"
 
 // ============ WiFi Configuration ============
 const char* WIFI_SSID = "Wifi 2.4G";
 const char* WIFI_PASSWORD = "66668888";
 
+// ============ Network (WiFi + mDNS chạy nền) ============
+BMSNetwork network(WIFI_SSID, WIFI_PASSWORD, "esp32bms");
+
 // ============ Web Server ============
 WebServer server(80);
 
+// ============ Modbus TCP (inverter / SCADA) ============
+BMSModbusServer modbusServer;
+
+// ============ CAN inverter (-DBMS_CAN_ENABLE) ============
+#ifdef BMS_CAN_ENABLE
+BMSCanBus canBus;
+CANScheduler canScheduler;
+#endif
+
+// ============ MQTT telemetry (-DBMS_MQTT_ENABLE) ============
+#ifdef BMS_MQTT_ENABLE
+MqttClientTransport mqttTransport(MQTT_BROKER, MQTT_PORT, "esp32bms");
+BMSMqttPublisher mqtt(&mqttTransport, MQTT_TOPIC, "esp32bms");
+#endif
+
+// ============ UDP stream cho đo đặc tính (-DBMS_UDP_STREAM) ============
+#ifdef BMS_UDP_STREAM
+BMSUdpStream udpStream(UDP_TARGET, UDP_PORT);
+#endif
+
 // ============ BMS Objects ============
-BMSSensors sensors;
+#ifdef BMS_AFE_BQ76952
+I2CAfeBus afeBus(Wire, AFE_SDA_PIN, AFE_SCL_PIN, AFE_I2C_HZ);
+BQ76952Afe sensors(&afeBus);
+#else
+BMSSensors sensors;   // Giả lập
+#endif
+#ifdef BMS_FAULT_INJECT
+// Kịch bản lỗi nạp qua /fault (chỉ bản thử nghiệm)
+BMSFaultInjector faultInjector(sensors);
+BMSSensorDriver& sensorDriver = faultInjector;
+#else
+BMSSensorDriver& sensorDriver = sensors;
+#endif
+BMSPowerManager power;
 
 // ============ Timing ============
-unsigned long lastSensorRead = 0;
-const unsigned long SENSOR_READ_INTERVAL = 500;
+unsigned long lastSensorRead = 0;  // Chu kỳ lấy mẫu do BMSPowerManager quyết định
+uint32_t sensorReadFailures = 0;
 
 unsigned long lastDebugPrint = 0;
 const unsigned long DEBUG_PRINT_INTERVAL = 5000;
 
+// ============ Boot Timing (µs kể từ khi boot) ============
+unsigned long bootFirstSampleUs = 0;
+unsigned long bootFirstProtectionUs = 0;
+
+// ============ Export (/export) ============
+// Handler chỉ gửi header, body gửi dần trong loop() (pumpHistoryExport)
+WiFiClient exportClient;
+size_t exportRemaining = 0;
+size_t exportSent = 0;
+unsigned long exportStartMs = 0;
+uint32_t exportRequests = 0;
+unsigned long lastExportBytes = 0;
+unsigned long lastExportMs = 0;
+
+void endHistoryExport();
+
 // ============================================
-// WIFI CONNECTION (ĐẶT TRƯỚC SETUP)
+// WEB SERVER SETUP
 // ============================================
-void connectWiFi() {
-    Serial.println("📡 Connecting to WiFi...");
-    Serial.print("SSID: ");
-    Serial.println(WIFI_SSID);
-    
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+void sendHTMLPage() {
+    // Gửi từng phần trang từ flash, không ghép thành String
+    server.setContentLength(getHTMLPageLength());
+    server.send(200, "text/html", "");
+    for (int i = 0; i < HTML_PAGE_PART_COUNT; i++) {
+        server.sendContent_P(HTML_PAGE_PARTS[i]);
     }
-    
-    Serial.println();
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("✅ WiFi connected!");
-        Serial.print("IP Address: ");
-        Serial.println(WiFi.localIP());
-        Serial.print("Signal Strength: ");
-        Serial.print(WiFi.RSSI());
-        Serial.println(" dBm");
+}
+
+// Xuất lịch sử theo chunk (CSV / bin / delta), hỗ trợ Range để tải tiếp
+// Tải tiếp: dùng lại from/to trong X-Export-First / X-Export-To + Range
+void sendHistoryExport() {
+    // 1 exporter + 1 kết nối: lượt tải tiếp theo của client tới sau khi body trước gửi xong
+    if (exportRemaining > 0) {
+        server.sendHeader("Retry-After", "1");
+        server.send(503, "text/plain", "export in progress");
+        return;
+    }
+    uint8_t format = EXPORT_FORMAT_CSV;
+    if (server.hasArg("format") && !HistoryExporter::parseFormat(server.arg("format").c_str(), format)) {
+        server.send(400, "text/plain", "format: csv | bin | delta");
+        return;
+    }
+    bool explicitFrom = server.hasArg("from");
+    uint32_t from = explicitFrom ? strtoul(server.arg("from").c_str(), NULL, 10) : 0;
+    uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), NULL, 10) : bmsHistory.getNextSeq();
+    if (!historyExporter.begin(format, from, to, millis(), explicitFrom)) {
+        server.send(410, "text/plain", "records overwritten, restart export");
+        return;
+    }
+
+    size_t total = historyExporter.size();
+    size_t start, end;
+    bool ranged;
+    String range = server.header("Range");
+    char value[64];
+    if (!parseByteRange(range.length() ? range.c_str() : NULL, total, start, end, ranged)) {
+        snprintf(value, sizeof(value), "bytes */%lu", (unsigned long)total);
+        server.sendHeader("Content-Range", value);
+        server.send(416, "text/plain", "");
+        return;
+    }
+
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.sendHeader("Accept-Ranges", "bytes");
+    snprintf(value, sizeof(value), "%lu", (unsigned long)historyExporter.getFirst());
+    server.sendHeader("X-Export-First", value);
+    snprintf(value, sizeof(value), "%lu", (unsigned long)(historyExporter.getFirst() + historyExporter.getCount()));
+    server.sendHeader("X-Export-To", value);
+    snprintf(value, sizeof(value), "attachment; filename=\"bms_history_%lu.%s\"",
+             (unsigned long)historyExporter.getFirst(), historyExporter.formatName());
+    server.sendHeader("Content-Disposition", value);
+    if (ranged) {
+        snprintf(value, sizeof(value), "bytes %lu-%lu/%lu", (unsigned long)start, (unsigned long)end,
+                 (unsigned long)total);
+        server.sendHeader("Content-Range", value);
+    }
+    size_t length = total ? end - start + 1 : 0;
+    server.setContentLength(length);
+    server.send(ranged ? 206 : 200, historyExporter.contentType(), "");
+
+    // Giữ kết nối sau khi handler trả về, body gửi từ lượt loop() sau
+    exportClient = server.client();
+    exportRemaining = length;
+    exportSent = 0;
+    exportStartMs = millis();
+    historyExporter.seek(start);
+    if (length == 0) endHistoryExport();
+}
+
+void endHistoryExport() {
+    exportRemaining = 0;
+    exportClient.stop();
+    exportRequests++;
+    lastExportBytes = exportSent;
+    lastExportMs = millis() - exportStartMs;
+}
+
+// Mỗi lượt loop() gửi tối đa 1 chunk body /export (trong ngân sách HTTP của tick):
+// lấy mẫu, modbus, CAN, MQTT chạy xen giữa các chunk như bình thường
+void pumpHistoryExport() {
+    if (exportRemaining == 0) return;
+    unsigned long start = micros();
+    // Chunk trong bmsJsonBuffer: đọc và gửi ngay trong lượt này, /bms giữa các lượt không đè
+    size_t n = exportClient.connected()
+        ? historyExporter.read((uint8_t*)bmsJsonBuffer, min(exportRemaining, sizeof(bmsJsonBuffer)))
+        : 0;
+    if (n > 0 && !historyExporter.isOverwritten() && exportClient.write((const uint8_t*)bmsJsonBuffer, n) == n) {
+        exportSent += n;
+        exportRemaining -= n;
     } else {
-        Serial.println("❌ WiFi connection failed!");
-        Serial.println("⚠️  System will continue without WiFi");
+        exportRemaining = 0;   // Client thấy thiếu byte, tải lại
     }
+    admission.charge(micros() - start);
+    if (exportRemaining == 0) endHistoryExport();
+}
+
+// ============ ADMISSION CONTROL ============
+
+void sendRejection(uint8_t verdict) {
+    static char retryAfter[12];
+    if (!retryAfter[0]) snprintf(retryAfter, sizeof(retryAfter), "%d", ADMISSION_RETRY_AFTER_S);
+    server.sendHeader("Retry-After", retryAfter);
+    server.send(BMSAdmission::statusCode(verdict), "text/plain", BMSAdmission::verdictName(verdict));
+}
+
+// Bọc handler qua admission control: 429/503 khi quá tải, đo thời gian phục vụ
+// cost = token mỗi request, estimateUs = ước lượng trước khi đo được
+WebServer::THandlerFunction admitted(const char* path, uint8_t cost, uint32_t estimateUs,
+                                     WebServer::THandlerFunction handler) {
+    uint8_t route = admission.addRoute(path, cost, estimateUs);
+    return [route, handler]() {
+        unsigned long start = micros();
+        uint8_t verdict = admission.admit(route, (uint32_t)server.client().remoteIP(), start);
+        if (verdict == ADMIT_OK) {
+            handler();
+        } else {
+            sendRejection(verdict);
+        }
+        admission.finish(route, verdict, micros() - start);
+    };
 }
 
-// ============================================
-// WEB SERVER SETUP
-// ============================================
 void setupWebServer() {
-    server.on("/", HTTP_GET, []() {
-        server.send(200, "text/html", getHTMLPage());
-    });
+    // Header cần đọc (WebServer mặc định bỏ qua)
+    static const char* collectedHeaders[] = { "Range" };
+    server.collectHeaders(collectedHeaders, 1);
+    
+
+    server.on("/", HTTP_GET, admitted("/", 4, 60000, []() {
+        sendHTMLPage();
+    }));
     
-    server.on("/bms", HTTP_GET, []() {
+    server.on("/bms", HTTP_GET, admitted("/bms", 1, 3000, []() {
+        size_t len;
+        {
+            HeapGuardScope guard;
+            len = writeBMSJson(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+        }
         server.sendHeader("Access-Control-Allow-Origin", "*");
-        server.send(200, "application/json", getBMSJson());
-    });
+        server.send_P(200, "application/json", bmsJsonBuffer, len);
+    }));
     
-    server.on("/info", HTTP_GET, []() {
-        String info = "ESP32 BMS System\n";
-        info += "Uptime: " + String(millis() / 1000) + "s\n";
-        info += "Free Heap: " + String(ESP.getFreeHeap()) + " bytes\n";
-        info += "WiFi RSSI: " + String(WiFi.RSSI()) + " dBm\n";
-        server.send(200, "text/plain", info);
-    });
+    // Lịch sử cho biểu đồ: header + bản ghi gửi thẳng từ ring (nhị phân)
+    server.on("/history", HTTP_GET, admitted("/history", 2, 20000, []() {
+        uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : 0;
+        uint32_t first;
+        HistorySpan spans[2];
+        uint32_t count = bmsHistory.select(since, first, spans);
+        uint8_t header[HISTORY_HEADER_SIZE];
+        bmsHistory.writeHeader(header, first, count, millis());
+        
+        server.sendHeader("Access-Control-Allow-Origin", "*");
+        server.setContentLength(sizeof(header) + spans[0].length + spans[1].length);
+        server.send(200, "application/octet-stream", "");
+        server.sendContent((const char*)header, sizeof(header));
+        for (int i = 0; i < 2; i++) {
+            if (spans[i].length) server.sendContent((const char*)spans[i].data, spans[i].length);
+        }
+    }));
     
-    server.onNotFound([]() {
+    server.on("/export", HTTP_GET, admitted("/export", 4, 20000, sendHistoryExport));
+    
+    // Nhật ký sự kiện: phần thay đổi sau revision since (more = true thì hỏi tiếp)
+    server.on("/alerts", HTTP_GET, admitted("/alerts", 1, 3000, []() {
+        uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : 0;
+        uint32_t next;
+        BufferWriter out(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+        out.printf("{\"now\":%lu,", (unsigned long)millis());
+        bmsEvents.writeJson(out, since, next);
+        out.printf("}");
+        server.sendHeader("Access-Control-Allow-Origin", "*");
+        server.send_P(200, "application/json", out.c_str(), out.length());
+    }));
+    
+    // Thống kê từng cell: độ lệch, sigma, drift, tự xả, điểm bất thường
+    server.on("/cells", HTTP_GET, admitted("/cells", 1, 2000, []() {
+        BufferWriter out(bmsJsonBuffer, sizeof(bmsJsonBuffer));
+        cellStats.writeJson(out, millis());
+        server.sendHeader("Access-Control-Allow-Origin", "*");
+        server.send_P(200, "application/json", out.c_str(), out.length());
+    }));
+    
+    server.on("/info", HTTP_GET, admitted("/info", 1, 5000, []() {
+        BufferWriter info(bmsHttpBuffer, sizeof(bmsHttpBuffer));
+        info.printf("ESP32 BMS System\n");
+        info.printf("Uptime: %lus\n", millis() / 1000);
+        info.printf("Free Heap: %u bytes\n", (unsigned)ESP.getFreeHeap());
+        info.printf("WiFi: %s\n", network.getStateName());
+        info.printf("WiFi RSSI: %d dBm\n", (int)WiFi.RSSI());
+        info.printf("WiFi Reconnects: %d\n", network.getReconnectCount());
+        info.printf("Boot -> First Sample: %lu us\n", bootFirstSampleUs);
+        info.printf("Boot -> First Protection Check: %lu us\n", bootFirstProtectionUs);
+        info.printf("Log: %lu msgs, %lu dropped, %u pending, stall avg %.1f us / max %lu us\n",
+                    (unsigned long)bmsLog.getMessageCount(), (unsigned long)bmsLog.getDroppedCount(),
+                    (unsigned)bmsLog.getPending(), bmsLog.getAvgStallUs(),
+                    (unsigned long)bmsLog.getMaxStallUs());
+        info.printf("Sampling Mode: %s (%lu ms)\n",
+                    BMSPowerManager::modeName(power.getMode()), power.getSampleInterval());
+        for (int m = 0; m < BMSPowerManager::POWER_MODE_COUNT; m++) {
+            info.printf("  [%s] time: %lus, samples: %lu, CPU: %.2f%%, est. current: %.1f mA\n",
+                        BMSPowerManager::modeName(m), power.getModeTime(m),
+                        power.getStats(m).samples, power.getCpuUtilisation(m),
+                        power.getEstimatedCurrent(m));
+        }
+        sampleJitter.printTo(info);
+        admission.printTo(info);
+        info.printf("History: %lu records (%lu s each, capacity %d)\n",
+                    (unsigned long)bmsHistory.getCount(), (unsigned long)(HISTORY_INTERVAL_MS / 1000),
+                    HISTORY_CAPACITY);
+        info.printf("Export: %lu requests, last %lu B in %lu ms (%.1f KB/s)\n",
+                    (unsigned long)exportRequests, lastExportBytes, lastExportMs,
+                    lastExportMs ? lastExportBytes / (float)lastExportMs : 0.0f);
+        info.printf("Events: %lu in ring (capacity %d), revision %lu, %lu inserted, %lu deduplicated, %lu overwritten\n",
+                    (unsigned long)bmsEvents.getCount(), EVENT_CAPACITY,
+                    (unsigned long)bmsEvents.getRevision(), (unsigned long)bmsEvents.getInsertedCount(),
+                    (unsigned long)bmsEvents.getDeduplicatedCount(),
+                    (unsigned long)bmsEvents.getOverwrittenCount());
+        info.printf("Cell stats: %lu samples, outliers 0x%lX, worst cell %d (score %.2f), %u self-discharge periods\n",
+                    (unsigned long)cellStats.getSampleCount(), (unsigned long)cellStats.getOutlierMask(),
+                    cellStats.getWorstCell() + 1, cellStats.getWorstScore(),
+                    cellStats.getSelfDischargePeriods());
+        info.printf("Sensors: %d cells, %lu failed reads\n", sensorDriver.getCellCount(),
+                    (unsigned long)sensorReadFailures);
+#ifdef BMS_AFE_BQ76952
+        info.printf("AFE: %lu reads, %lu bus errors, %lu CRC errors, %d blocks, last %lu us / max %lu us\n",
+                    (unsigned long)sensors.getReadCount(), (unsigned long)sensors.getBusErrorCount(),
+                    (unsigned long)sensors.getCrcErrorCount(), sensors.getSpanCount(),
+                    (unsigned long)sensors.getLastReadUs(), (unsigned long)sensors.getMaxReadUs());
+#endif
+        info.printf("Modbus: %d clients, %lu requests, %lu exceptions, %lu rejected\n",
+                    modbusServer.getClientCount(), (unsigned long)modbusServer.getRequestCount(),
+                    (unsigned long)modbusServer.getExceptionCount(),
+                    (unsigned long)modbusServer.getRejectedCount());
+#ifdef BMS_CAN_ENABLE
+        info.printf("CAN: %lu frames, %lu failed, %lu bus-off\n",
+                    (unsigned long)canBus.getTransmittedCount(),
+                    (unsigned long)canScheduler.getFailedCount(),
+                    (unsigned long)canBus.getBusOffCount());
+        for (int i = 0; i < canScheduler.getCount(); i++) {
+            const CANScheduler::Entry& e = canScheduler.getEntry(i);
+            info.printf("  [0x%03lX] sent: %lu, late avg %.0f us / max %lu us\n",
+                        (unsigned long)e.id, (unsigned long)e.sent,
+                        e.sent ? (float)e.totalLateUs / e.sent : 0.0f, (unsigned long)e.maxLateUs);
+        }
+#endif
+#ifdef BMS_MQTT_ENABLE
+        info.printf("MQTT: %s, %lu msgs, %lu samples, %lu event msgs, queued %lu (max %lu), %lu dropped, %lu failed\n",
+                    mqtt.isConnected() ? "connected" : "offline",
+                    (unsigned long)mqtt.getMessageCount(), (unsigned long)mqtt.getSampleCount(),
+                    (unsigned long)mqtt.getEventMessageCount(),
+                    (unsigned long)mqtt.getQueued(), (unsigned long)mqtt.getHighWater(),
+                    (unsigned long)mqtt.getDroppedCount(), (unsigned long)mqtt.getFailureCount());
+#endif
+#ifdef BMS_UDP_STREAM
+        info.printf("UDP stream: %.1f frames/s, %lu packets, %lu failed, CPU %.2f%% (avg %.1f us, max %lu us)\n",
+                    udpStream.getFrameRate(), (unsigned long)udpStream.getPacketCount(),
+                    (unsigned long)udpStream.getFailureCount(), udpStream.getCpuPercent(),
+                    udpStream.getAvgSampleUs(), (unsigned long)udpStream.getMaxSendUs());
+#endif
+        server.send_P(200, "text/plain", info.c_str(), info.length());
+    }));
+    
+    server.on("/memory", HTTP_GET, admitted("/memory", 1, 3000, []() {
+        BufferWriter report(bmsHttpBuffer, sizeof(bmsHttpBuffer));
+        writeMemoryReport(report);
+        server.send_P(200, "text/plain", report.c_str(), report.length());
+    }));
+    
+#ifdef BMS_FAULT_INJECT
+    // Tiêm lỗi: /fault?script=<kịch bản> nạp và chạy từ bây giờ, /fault?clear=1 dừng,
+    // /fault không tham số xem trạng thái (cú pháp ở bms_faults.h)
+    server.on("/fault", HTTP_GET, admitted("/fault", 1, 3000, []() {
+        if (server.hasArg("clear")) faultInjector.clear();
+        if (server.hasArg("script")) {
+            if (!faultInjector.load(server.arg("script").c_str())) {
+                server.send(400, "text/plain", "bad fault script");
+                return;
+            }
+            faultInjector.arm(millis());
+            LOGW("⚠️  Fault injection armed: %s", server.arg("script").c_str());
+        }
+        BufferWriter out(bmsHttpBuffer, sizeof(bmsHttpBuffer));
+        faultInjector.printTo(out);
+        server.send_P(200, "text/plain", out.c_str(), out.length());
+    }));
+#endif
+    
+    server.onNotFound(admitted("404", 1, 1000, []() {
         server.send(404, "text/plain", "404: Not Found");
-    });
+    }));
     
     Serial.println("✅ Web server routes configured");
 }
@@ -87,55 +388,137 @@ void setupWebServer() {
 // BMS FUNCTIONS
 // ============================================
 void readAndUpdateBMS() {
-    sensors.readAllSensors();
+    HeapGuardScope guard; // Đường lấy mẫu không được cấp phát heap
+    
+    // Lỗi bus/CRC: bỏ mẫu này, bmsData giữ mẫu hợp lệ gần nhất; lỗi liên tiếp => alarm
+    // mất liên lạc (cấm sạc/xả qua CAN, Modbus thấy cờ ngay)
+    if (!sensorDriver.readAllSensors()) {
+        if (sensorReadFailures++ % 100 == 0) {
+            LOGW("⚠️  Sensor read failed (%lu total)", (unsigned long)sensorReadFailures);
+        }
+        bool wasFault = bmsData.commsFaultAlarm;
+        recordSensorReadFailure(millis());
+        if (bmsData.commsFaultAlarm && !wasFault) {
+            LOGE("🚨 Sensor bus lost: %u reads failed in a row", bmsData.failedReads);
+        }
+        modbusRegisters.update(bmsData, cellEstimators.getUsableCapacity(), millis());
+        return;
+    }
     
-    float cell1 = sensors.getCellVoltage(1);
-    float cell2 = sensors.getCellVoltage(2);
-    float cell3 = sensors.getCellVoltage(3);
-    float cell4 = sensors.getCellVoltage(4);
-    float current = sensors.getCurrent();
-    float temp = sensors.getTemperature();
+    if (bootFirstSampleUs == 0) {
+        bootFirstSampleUs = micros();
+    }
+    
+    float cell1 = sensorDriver.getCellVoltage(1);
+    float cell2 = sensorDriver.getCellVoltage(2);
+    float cell3 = sensorDriver.getCellVoltage(3);
+    float cell4 = sensorDriver.getCellVoltage(4);
+    float current = sensorDriver.getCurrent();
     
-    updateBMSData(cell1, cell2, cell3, cell4, current, temp);
+    // Protection theo kênh nóng nhất / lạnh nhất; mọi kênh lỗi thì nạp NAN (OT/UT coi như
+    // vượt ngưỡng, alarm riêng) nhưng điện áp / dòng / SOC vẫn cập nhật
+    sensorDriver.readThermistors(temperatureBank);
+    bool tempValid = temperatureBank.update();
+    if (!tempValid && !bmsData.thermalLossAlarm) {
+        LOGE("🚨 All temperature sensors faulted (mask 0x%04X)", temperatureBank.getFaultMask());
+    }
+    
+    updateBMSData(cell1, cell2, cell3, cell4, current,
+                  tempValid ? temperatureBank.getHottest() : NAN,
+                  tempValid ? temperatureBank.getColdest() : NAN);
+    modbusRegisters.update(bmsData, cellEstimators.getUsableCapacity(), millis());
+    bmsHistory.onSample(bmsData, millis());
+#ifdef BMS_MQTT_ENABLE
+    mqtt.enqueue(bmsData, millis());
+#endif
+    
+    // updateBMSData() đã chạy checkProtection()
+    if (bootFirstProtectionUs == 0) {
+        bootFirstProtectionUs = micros();
+    }
 }
 
 void printBMSStatus() {
-    Serial.println("\n========================================");
-    Serial.println("📊 BMS STATUS REPORT");
-    Serial.println("========================================");
+#ifdef BMS_LOG_BINARY
+    uint8_t payload[BMS_STATUS_FRAME_SIZE];
+    size_t length = writeStatusFrame(bmsData, millis(), payload, sizeof(payload));
+    bmsLog.frame(LOG_FRAME_STATUS, payload, length);
+#else
+    LOGI("========================================");
+    LOGI("📊 BMS STATUS REPORT");
+    LOGI("========================================");
     
-    Serial.println("📦 CELLS:");
+    LOGI("📦 CELLS:");
     for (int i = 0; i < NUM_CELLS; i++) {
-        Serial.printf("  Cell %d: %.3fV", i+1, bmsData.cellVoltages[i]);
-        if (bmsData.balancingCells[i]) {
-            Serial.print(" [BALANCING]");
-        }
-        Serial.println();
+        LOGI("  Cell %d: %.3fV%s", i+1, bmsData.cellVoltages[i],
+             bmsData.balancingCells[i] ? " [BALANCING]" : "");
     }
     
-    Serial.println("\n⚡ PACK:");
-    Serial.printf("  Voltage: %.2fV\n", bmsData.packVoltage);
-    Serial.printf("  Current: %.2fA", bmsData.current);
-    if (bmsData.isCharging) Serial.print(" [CHARGING]");
-    if (bmsData.isDischarging) Serial.print(" [DISCHARGING]");
-    Serial.println();
-    Serial.printf("  Temperature: %.1f°C\n", bmsData.packTemp);
+    LOGI("⚡ PACK:");
+    LOGI("  Voltage: %.2fV", bmsData.packVoltage);
+    LOGI("  Current: %.2fA%s", bmsData.current,
+         bmsData.isCharging ? " [CHARGING]" : (bmsData.isDischarging ? " [DISCHARGING]" : ""));
+    LOGI("  Temperature: %.1f°C (%s) / min %.1f°C (%s)", bmsData.packTemp,
+         BMSTemperatureBank::channelName(temperatureBank.getHottestChannel()), bmsData.minTemp,
+         BMSTemperatureBank::channelName(temperatureBank.getColdestChannel()));
     
-    Serial.println("\n📊 STATE:");
-    Serial.printf("  SOC: %.1f%%\n", bmsData.soc);
-    Serial.printf("  SOH: %.1f%%\n", bmsData.soh);
+    LOGI("📊 STATE:");
+    LOGI("  SOC: %.1f%%", bmsData.soc);
+    LOGI("  SOH: %.1f%%", bmsData.soh);
+    LOGI("  Sampling: %s (%lu ms)", 
+         BMSPowerManager::modeName(power.getMode()), power.getSampleInterval());
     
-    Serial.println("\n🛡️ PROTECTION:");
-    Serial.printf("  Over Voltage: %s\n", bmsData.overVoltageAlarm ? "ALARM" : "OK");
-    Serial.printf("  Under Voltage: %s\n", bmsData.underVoltageAlarm ? "ALARM" : "OK");
-    Serial.printf("  Over Current: %s\n", bmsData.overCurrentAlarm ? "ALARM" : "OK");
-    Serial.printf("  Over Temperature: %s\n", bmsData.overTempAlarm ? "ALARM" : "OK");
+    LOGI("🛡️ PROTECTION:");
+    LOGI("  Over Voltage: %s", bmsData.overVoltageAlarm ? "ALARM" : "OK");
+    LOGI("  Under Voltage: %s", bmsData.underVoltageAlarm ? "ALARM" : "OK");
+    LOGI("  Over Current: %s", bmsData.overCurrentAlarm ? "ALARM" : "OK");
+    LOGI("  Over Temperature: %s", bmsData.overTempAlarm ? "ALARM" : "OK");
+    LOGI("  Under Temperature: %s", bmsData.underTempAlarm ? "ALARM" : "OK");
     
-    Serial.println("========================================\n");
+    LOGI("========================================");
+#endif
+}
+
+// Bảng ngân sách bộ nhớ tĩnh (in lúc boot và qua /memory)
+void registerMemoryRegions() {
+    BMS_MEMORY_REGION(bmsData);
+    BMS_MEMORY_REGION(socEstimator);
+    BMS_MEMORY_REGION(cellEstimators);
+    BMS_MEMORY_REGION(cellStats);
+    BMS_MEMORY_REGION(sensors);
+    BMS_MEMORY_REGION(temperatureBank);
+    BMS_MEMORY_REGION(bmsHistory);
+    BMS_MEMORY_REGION(bmsEvents);
+    BMS_MEMORY_REGION(historyExporter);
+    BMS_MEMORY_REGION(sampleJitter);
+    BMS_MEMORY_REGION(admission);
+    BMS_MEMORY_REGION(power);
+    BMS_MEMORY_REGION(network);
+    BMS_MEMORY_REGION(modbusRegisters);
+    BMS_MEMORY_REGION(modbusServer);
+#ifdef BMS_UDP_STREAM
+    BMS_MEMORY_REGION(udpStream);
+#endif
+#ifdef BMS_MQTT_ENABLE
+    BMS_MEMORY_REGION(mqtt);
+    BMS_MEMORY_REGION(mqttPayload);
+#endif
+#ifdef BMS_FAULT_INJECT
+    BMS_MEMORY_REGION(faultInjector);
+#endif
+#ifdef BMS_CAN_ENABLE
+    BMS_MEMORY_REGION(canBus);
+    BMS_MEMORY_REGION(canScheduler);
+#endif
+    BMS_MEMORY_REGION(bmsJsonDoc);
+    BMS_MEMORY_REGION(bmsJsonBuffer);
+    BMS_MEMORY_REGION(bmsHttpBuffer);
+    BMS_MEMORY_REGION(bmsLog);
+    BMS_MEMORY_REGION(memoryRegions);
 }
 
 // ============================================
-// SETUP (BÂY GIỜ MỚI ĐẾN SETUP)
+// SETUP
 // ============================================
 void setup() {
     Serial.begin(115200);
@@ -144,43 +527,113 @@ void setup() {
     Serial.println("🔋 ESP32 BMS System Starting...");
     Serial.println("========================================");
     
+    // Từ đây log đi qua ring buffer, task nền đẩy ra Serial
+    bmsLog.begin();
+    
     initBMSData();
     Serial.println("✅ BMS Data initialized");
     
-    sensors.begin();
+    sensorDriver.begin();
     
-    connectWiFi();
+    // Lấy mẫu + protection ngay lập tức, không chờ WiFi
+    readAndUpdateBMS();
+    lastSensorRead = millis();
+    power.onSample(bmsData);
+    admission.onTick(micros(), power.getSampleInterval() * 1000UL);
+    Serial.printf("✅ First sample: %lu us, first protection check: %lu us after boot\n",
+                  bootFirstSampleUs, bootFirstProtectionUs);
     
-    if (MDNS.begin("esp32bms")) {
-        Serial.println("✅ mDNS responder started: http://esp32bms.local");
-    }
+    // WiFi/mDNS kết nối nền trong loop()
+    network.begin();
     
     setupWebServer();
     
     server.begin();
     Serial.println("✅ HTTP server started");
     
+    modbusServer.begin();
+    
+#ifdef BMS_CAN_ENABLE
+    canBus.begin();
+    canScheduler.begin(micros());
+#endif
+    
+#ifdef BMS_MQTT_ENABLE
+    mqtt.publishEvents(&bmsEvents, MQTT_EVENT_TOPIC);
+#endif
+    
+    power.begin();
+#ifdef BMS_UDP_STREAM
+    power.setFixedInterval(UDP_STREAM_INTERVAL);
+    udpStream.begin();
+#endif
+    
+    registerMemoryRegions();
+    BufferWriter report(bmsHttpBuffer, sizeof(bmsHttpBuffer));
+    writeMemoryReport(report);
+    Serial.println(report.c_str());
+    
     Serial.println("========================================");
-    Serial.println("🎉 BMS System Ready!");
-    Serial.println("========================================");
-    Serial.print("📡 Access Dashboard at: http://");
-    Serial.println(WiFi.localIP());
+    Serial.println("🎉 BMS System Ready! (WiFi connecting in background)");
     Serial.println("========================================\n");
+    
+    // Từ đây mọi cấp phát heap trong loop() đều được đếm (BMS_STATIC_MEMORY)
+    armHeapGuard();
 }
 
 // ============================================
 // MAIN LOOP
 // ============================================
+
+// Lấy mẫu khi tới chu kỳ
+void sampleIfDue() {
+    unsigned long interval = power.getSampleInterval();
+    if (millis() - lastSensorRead < interval) return;
+    sampleJitter.onSample(micros(), interval);
+    lastSensorRead = millis();
+    readAndUpdateBMS();
+#ifdef BMS_UDP_STREAM
+    // Ngoài HeapGuardScope: lwIP cấp phát pbuf khi gửi
+    udpStream.onSample(bmsData, network.isConnected());
+#endif
+    power.onSample(bmsData);
+    // Ngân sách HTTP mới cho chu kỳ tới (theo chu kỳ sau khi đổi chế độ nguồn)
+    admission.onTick(micros(), power.getSampleInterval() * 1000UL);
+}
+
 void loop() {
-    server.handleClient();
-    
-    if (millis() - lastSensorRead >= SENSOR_READ_INTERVAL) {
-        lastSensorRead = millis();
-        readAndUpdateBMS();
+    network.update();
+    // Hết ngân sách của chu kỳ hoặc mẫu kế tiếp sắp tới: kết nối chờ trong backlog tới mẫu sau
+    if (admission.accepting(micros())) {
+        server.handleClient();
+        pumpHistoryExport();
     }
+    modbusServer.poll();
+    
+#ifdef BMS_MQTT_ENABLE
+    mqtt.update(millis(), network.isConnected());
+#endif
+    
+#ifdef BMS_CAN_ENABLE
+    canBus.update();
+    canScheduler.poll(bmsData, micros(), [](const CANFrame& frame) {
+        return canBus.transmit(frame);
+    });
+#endif
+    
+    sampleIfDue();
+    unsigned long interval = power.getSampleInterval();
     
     if (millis() - lastDebugPrint >= DEBUG_PRINT_INTERVAL) {
         lastDebugPrint = millis();
         printBMSStatus();
     }
+    
+    // Ngủ tới lần lấy mẫu kế tiếp thay vì quay vòng loop() liên tục
+    unsigned long sinceSample = millis() - lastSensorRead;
+    unsigned long remaining = (sinceSample < interval) ? (interval - sinceSample) : 0;
+#ifdef BMS_CAN_ENABLE
+    remaining = min(remaining, canScheduler.msUntilNext(micros()));
+#endif
+    power.sleepUntil(remaining, network.getState() == BMSNetwork::NET_BACKOFF);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define SOC_ESTIMATOR_H
 
 #include <Arduino.h>
+#include "bms_log.h"
+#include "bms_chemistry.h"
 
 /*
  * SOC ESTIMATOR - Simplified Version (Bỏ Peukert)
@@ -9,113 +11,154 @@
  * - Coulomb Counting cơ bản
  * - Hiệu chỉnh nhiệt độ
  * - OCV calibration khi pin nghỉ
+ * - Bảng OCV, hiệu suất sạc, hệ số nhiệt độ lấy từ Chemistry (bms_chemistry.h),
+ *   là hằng lúc biên dịch
+ * - Điện tích đếm bằng số nguyên int64 (không trôi theo thời gian):
+ *   đơn vị 0.5 µA·ms, dòng lượng tử hoá 1 µA, chỉ đổi ra Ah khi đọc
  */
 
-class SOCEstimator {
+// Đơn vị bộ đếm: 0.5 µA·ms, để hình thang (i0 + i1) * dt không phải chia 2
+// 1 Ah = 2 * 1e6 µA * 3.6e6 ms
+#define CHARGE_UNITS_PER_AH 7200000000000LL
+#define PPM_SCALE 1000000
+
+template <typename Chemistry>
+class SOCEstimatorT {
 private:
+    // Hằng số suy ra từ Chemistry, tính lúc biên dịch
+    static constexpr int32_t chargeEfficiencyPpm =
+        (int32_t)(Chemistry::chargeEfficiency * PPM_SCALE + 0.5f);
+    static constexpr float temperatureSlope = Chemistry::temperatureCoefficient / 100.0f;
+    
+
     float batteryCapacity;      // 6.0 Ah (tính cho từng cell)
+    int64_t capacityUnits;      // batteryCapacity theo đơn vị bộ đếm
     float currentSOC;
-    float chargeAccumulated;
+    int64_t chargeAccumulated;  // Đơn vị 0.5 µA·ms
+    int64_t netCharge;          // Tổng điện tích đã áp dụng, không kẹp theo dung lượng
     unsigned long lastUpdateTime;
+    int32_t lastCurrentUa;      // Dòng của mẫu trước (tích phân hình thang)
+    bool hasLastSample;
     
-    float chargeEfficiency;     // 0.97 khi sạc
-    float referenceTemperature; // 25°C
-    float temperatureCoefficient; // 0.6 %/°C
+    // Phần dư khi nhân hệ số (ppm), giữ lại cho lần sau để không mất điện tích
+    int64_t efficiencyRemainder;
+    int64_t temperatureRemainder;
     
-    // Thống kê
-    float totalChargeIn;
-    float totalChargeOut;
+    // Thống kê (đơn vị bộ đếm)
+    int64_t totalChargeIn;
+    int64_t totalChargeOut;
     int cycleCount;
     
-    // OCV Lookup Table cho LiFePO4 (SOC% -> Voltage per cell)
-    const float ocvTable[11][2] = {
-        {0,   2.50}, {10,  2.90}, {20,  3.00}, {30,  3.10},
-        {40,  3.15}, {50,  3.20}, {60,  3.25}, {70,  3.28},
-        {80,  3.30}, {90,  3.35}, {100, 3.40}
-    };
-    
+public:
     // Nội suy tuyến tính từ OCV table
     float interpolateOCV(float soc) {
-        soc = constrain(soc, 0, 100);
-        for (int i = 0; i < 10; i++) {
-            if (soc >= ocvTable[i][0] && soc <= ocvTable[i + 1][0]) {
-                float soc1 = ocvTable[i][0];
-                float soc2 = ocvTable[i + 1][0];
-                float v1 = ocvTable[i][1];
-                float v2 = ocvTable[i + 1][1];
-                return v1 + (v2 - v1) * (soc - soc1) / (soc2 - soc1);
-            }
-        }
-        return 3.20;
+        return chemistryOcv<Chemistry>(soc);
     }
     
     // Chuyển đổi điện áp thành SOC
     float socFromOCV(float voltage) {
-        voltage = constrain(voltage, 2.5, 3.6);
-        for (int i = 0; i < 10; i++) {
-            if (voltage >= ocvTable[i][1] && voltage <= ocvTable[i + 1][1]) {
-                float v1 = ocvTable[i][1];
-                float v2 = ocvTable[i + 1][1];
-                float soc1 = ocvTable[i][0];
-                float soc2 = ocvTable[i + 1][0];
-                return soc1 + (soc2 - soc1) * (voltage - v1) / (v2 - v1);
-            }
+        return chemistrySocFromOcv<Chemistry>(voltage);
+    }
+    
+private:
+    // value * ppm / 1e6 chính xác tuyệt đối (value >= 0), phần dư cộng dồn
+    // Tách value để tích không tràn int64
+    static int64_t scalePpm(int64_t value, int32_t ppm, int64_t& remainder) {
+        int64_t high = value / PPM_SCALE;
+        int64_t low = value % PPM_SCALE;
+        int64_t numerator = low * ppm + remainder;
+        int64_t quotient = numerator / PPM_SCALE;
+        remainder = numerator - quotient * PPM_SCALE;
+        return high * ppm + quotient;
+    }
+    
+    // Cộng/trừ một lượng điện tích (đơn vị bộ đếm, dương = sạc)
+    void applyCharge(int64_t units, int32_t tempFactorPpm) {
+        if (units > 0) {
+            // Sạc: áp dụng hiệu suất
+            int64_t applied = scalePpm(units, chargeEfficiencyPpm, efficiencyRemainder);
+            chargeAccumulated += applied;
+            netCharge += applied;
+            totalChargeIn += units;
+        } else if (units < 0) {
+            // Xả: Coulomb counting + ảnh hưởng nhiệt độ
+            int64_t applied = scalePpm(-units, tempFactorPpm, temperatureRemainder);
+            chargeAccumulated -= applied;
+            netCharge -= applied;
+            totalChargeOut += -units;
         }
-        return 50.0;
+    }
+    
+    void setChargeFromSOC(float soc) {
+        chargeAccumulated = (int64_t)llround((soc / 100.0) * (double)capacityUnits);
+    }
+    
+    static float unitsToAh(int64_t units) {
+        return (float)((double)units / CHARGE_UNITS_PER_AH);
     }
     
 public:
-    SOCEstimator(float capacity = 6.0, float initialSOC = 100.0) {
+    SOCEstimatorT(float capacity = 6.0, float initialSOC = 100.0) {
         batteryCapacity = capacity;
+        capacityUnits = (int64_t)llround((double)capacity * CHARGE_UNITS_PER_AH);
         currentSOC = initialSOC;
-        chargeAccumulated = (initialSOC / 100.0) * capacity;
+        setChargeFromSOC(initialSOC);
+        netCharge = 0;
         lastUpdateTime = millis();
+        lastCurrentUa = 0;
+        hasLastSample = false;
         
-        chargeEfficiency = 0.97;
-        referenceTemperature = 25.0;
-        temperatureCoefficient = 0.6; // 0.6%/°C
+        efficiencyRemainder = 0;
+        temperatureRemainder = 0;
         
         totalChargeIn = 0;
         totalChargeOut = 0;
         cycleCount = 0;
     }
     
-    // Cập nhật SOC với dòng và nhiệt độ
+    // Cập nhật SOC với dòng và nhiệt độ, mẫu lấy tại thời điểm hiện tại
     void update(float current, float temperature = 25.0) {
-        unsigned long now = millis();
-        float deltaTime = (now - lastUpdateTime) / 3600000.0; // Convert to hours
-        lastUpdateTime = now;
+        updateAt(current, temperature, millis());
+    }
+    
+    // Cập nhật SOC với mẫu có timestamp riêng (ms, cùng gốc với millis())
+    // Tích phân hình thang giữa mẫu trước và mẫu này; nếu dòng đổi chiều
+    // trong khoảng đó thì tách tại điểm 0 để hiệu suất sạc/xả áp dụng đúng
+    void updateAt(float current, float temperature, unsigned long timestamp) {
+        unsigned long deltaMs = timestamp - lastUpdateTime;
+        int32_t currentUa = lroundf(current * 1000000.0f);
+        int32_t prevUa = hasLastSample ? lastCurrentUa : currentUa;
+        lastUpdateTime = timestamp;
+        lastCurrentUa = currentUa;
+        hasLastSample = true;
         
-        if (deltaTime == 0 || deltaTime > 1.0) return;
+        if (deltaMs == 0 || deltaMs > 3600000UL) return; // > 1 giờ: bỏ qua
         
         // Tính toán ảnh hưởng nhiệt độ
-        float tempDiff = temperature - referenceTemperature;
-        float tempFactor = 1.0 + (temperatureCoefficient * tempDiff / 100.0);
-        tempFactor = constrain(tempFactor, 0.8, 1.2);
+        float tempDiff = temperature - Chemistry::referenceTemperature;
+        float tempFactor = 1.0f + temperatureSlope * tempDiff;
+        tempFactor = constrain(tempFactor, Chemistry::temperatureFactorMin, Chemistry::temperatureFactorMax);
+        int32_t tempFactorPpm = lroundf(tempFactor * PPM_SCALE);
         
-        if (current > 0) {
-            // Sạc: áp dụng hiệu suất
-            float effectiveCharge = current * deltaTime * chargeEfficiency;
-            chargeAccumulated += effectiveCharge;
-            totalChargeIn += current * deltaTime;
-            
-        } else if (current < 0) {
-            // Xả: Coulomb counting + ảnh hưởng nhiệt độ
-            float discharge = abs(current) * deltaTime * tempFactor;
-            chargeAccumulated -= discharge;
-            totalChargeOut += abs(current) * deltaTime;
+        if ((prevUa >= 0) == (currentUa >= 0)) {
+            applyCharge(((int64_t)prevUa + currentUa) * (int64_t)deltaMs, tempFactorPpm);
+        } else {
+            // Dòng đổi chiều: 2 tam giác hai bên điểm 0
+            double total = fabs((double)prevUa) + fabs((double)currentUa);
+            applyCharge(llround((double)prevUa * deltaMs * fabs((double)prevUa) / total), tempFactorPpm);
+            applyCharge(llround((double)currentUa * deltaMs * fabs((double)currentUa) / total), tempFactorPpm);
         }
         
-        chargeAccumulated = constrain(chargeAccumulated, 0, batteryCapacity);
-        currentSOC = (chargeAccumulated / batteryCapacity) * 100.0;
+        chargeAccumulated = constrain(chargeAccumulated, (int64_t)0, capacityUnits);
+        currentSOC = (float)chargeAccumulated / (float)capacityUnits * 100.0f;
     }
     
     // Hiệu chỉnh SOC dựa trên điện áp OCV
     // Chỉ nên gọi khi pin nghỉ (restTime > 30 phút)
     void calibrateWithVoltage(float avgCellVoltage, float restTime = 0) {
         if (restTime < 1800) { // < 30 phút
-            Serial.println("⚠️ Warning: Battery not rested enough for OCV calibration");
-            Serial.println("   Recommended rest time: >= 30 minutes");
+            LOGW("⚠️ Warning: Battery not rested enough for OCV calibration");
+            LOGW("   Recommended rest time: >= 30 minutes");
             return;
         }
         
@@ -124,14 +167,14 @@ public:
         // Weighted average: 70% Coulomb, 30% OCV
         float calibratedSOC = currentSOC * 0.7 + socFromVoltage * 0.3;
         
-        Serial.println("=== SOC CALIBRATION ===");
-        Serial.printf("  Coulomb SOC: %.2f%%\n", currentSOC);
-        Serial.printf("  OCV SOC: %.2f%% (from %.3fV)\n", socFromVoltage, avgCellVoltage);
-        Serial.printf("  Calibrated SOC: %.2f%%\n", calibratedSOC);
-        Serial.println("=======================");
+        LOGI("=== SOC CALIBRATION ===");
+        LOGI("  Coulomb SOC: %.2f%%", currentSOC);
+        LOGI("  OCV SOC: %.2f%% (from %.3fV)", socFromVoltage, avgCellVoltage);
+        LOGI("  Calibrated SOC: %.2f%%", calibratedSOC);
+        LOGI("=======================");
         
         currentSOC = calibratedSOC;
-        chargeAccumulated = (currentSOC / 100.0) * batteryCapacity;
+        setChargeFromSOC(currentSOC);
     }
     
     // Getters
@@ -140,7 +183,22 @@ public:
     }
     
     float getRemainingCapacity() { 
-        return chargeAccumulated; 
+        return unitsToAh(chargeAccumulated); 
+    }
+    
+    // Tổng điện tích sạc vào / xả ra trong suốt thời gian chạy (Ah)
+    float getTotalChargeIn() {
+        return unitsToAh(totalChargeIn);
+    }
+    
+    float getTotalChargeOut() {
+        return unitsToAh(totalChargeOut);
+    }
+    
+    // Điện tích ròng đã áp dụng (đơn vị bộ đếm, sau hiệu suất/nhiệt độ) kể từ khi
+    // khởi tạo; ước lượng từng cell (bms_cells.h) lấy phần chênh giữa 2 lần gọi
+    int64_t getNetChargeUnits() {
+        return netCharge;
     }
     
     float getExpectedVoltage() { 
@@ -161,26 +219,29 @@ public:
     // Reset SOC
     void reset(float newSOC = 100.0) {
         currentSOC = newSOC;
-        chargeAccumulated = (newSOC / 100.0) * batteryCapacity;
+        setChargeFromSOC(newSOC);
         lastUpdateTime = millis();
+        hasLastSample = false;
     }
     
     // In thông tin debug
     void printDebug(float avgCellVoltage, float current, float temperature) {
         Serial.println("===== SOC ESTIMATOR DEBUG =====");
-        Serial.printf("🔋 Battery: %.1f Ah @ %.1f°C\n", batteryCapacity, temperature);
+        Serial.printf("🔋 Battery: %s %.1f Ah @ %.1f°C\n", Chemistry::name, batteryCapacity, temperature);
         Serial.printf("⚡ Current: %.3f A (%.2fC rate)\n", 
                       current, abs(current) / batteryCapacity);
         Serial.println("-------------------------------");
         Serial.printf("📊 SOC (Coulomb): %.2f%%\n", currentSOC);
         Serial.printf("📍 SOC (OCV): %.2f%% (from %.3fV)\n", 
                       socFromOCV(avgCellVoltage), avgCellVoltage);
-        Serial.printf("💾 Remaining: %.3f Ah\n", chargeAccumulated);
+        Serial.printf("💾 Remaining: %.3f Ah\n", getRemainingCapacity());
         Serial.printf("📈 Expected OCV: %.3f V\n", getExpectedVoltage());
-        Serial.printf("📥 Total In: %.3f Ah\n", totalChargeIn);
-        Serial.printf("📤 Total Out: %.3f Ah\n", totalChargeOut);
+        Serial.printf("📥 Total In: %.3f Ah\n", getTotalChargeIn());
+        Serial.printf("📤 Total Out: %.3f Ah\n", getTotalChargeOut());
         Serial.println("===============================\n");
     }
 };
 
+typedef SOCEstimatorT<BatteryChemistry> SOCEstimator;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,588 @@
+/*
+ * FLEET ANALYZE - Tính lại SOC / SOH, chu kỳ, lịch sử alarm từ log nhị phân của nhiều pack
+ *   pio run -e analyze && .pio/build/analyze/program [tham số] <file | thư mục> ...
+ *
+ * Đầu vào: log của firmware build với -DBMS_LOG_BINARY (capture Serial, cùng định dạng với
+ * tools/bms_log_decode.py) hoặc của fleet_sim --write-logs; 1 file = 1 pack. Mỗi frame STATUS
+ * (writeStatusFrame(), bms_data.h) là 1 mẫu, chạy lại qua đúng pipeline của firmware:
+ * updateBMSBatch() trên BMSPack riêng của file (SOCEstimator, CellEstimatorBank, protection,
+ * BMSEventJournal, CellStatsBank). Sửa estimator / ngưỡng trong src/, build lại rồi chạy là có
+ * kết quả mới cho cả fleet, so với SOC / SOH / cờ alarm mà firmware đã ghi trong log.
+ * - File được mmap (chỉ đọc, MADV_SEQUENTIAL), parse thẳng trên vùng map không chép; byte
+ *   ngoài frame (banner boot) và frame sai CRC bị bỏ qua, dò lại từ byte 0xA5 kế tiếp
+ * - Mỗi file 1 task trên WorkStealingPool (tools/fleet/fleet_pool.h), file lớn chia trước để
+ *   không còn 1 file dài chạy một mình ở cuối
+ * - millis() lùi lại = pack khởi động lại: thời gian nối tiếp mẫu trước, SOC đếm tiếp
+ *   (firmware thì bắt đầu lại từ SOC mặc định)
+ * - Chu kỳ = điện tích xả ra / dung lượng danh định (chu kỳ tương đương 100% DoD);
+ *   SOH = dung lượng cell yếu nhất (CellEstimatorBank, học qua các lần hiệu chỉnh OCV) / danh định
+ * - Cờ alarm khác log ở vài mẫu là bình thường: frame lượng tử hoá 1 mV / 10 mA / 0.1°C nên
+ *   giá trị sát ngưỡng (45.04°C ghi thành 45.0) được so lại ở phía bên kia ngưỡng
+ * - Thông lượng tính từ lúc mmap tới khi task cuối xong (file đã nằm trong page cache thì
+ *   GB/s là tốc độ xử lý, không phải tốc độ đĩa)
+ *
+ *   --threads N       số worker (mặc định = số core)
+ *   --capacity AH     dung lượng danh định mỗi pack (mặc định BATTERY_CAPACITY)
+ *   --csv FILE        1 dòng tóm tắt mỗi pack
+ *   --scaling         chạy lại với 1, 2, 4 .. N thread, in files/s và GB/s theo số thread
+ *   --quiet           không in bảng từng pack
+ */
+
+#include <Arduino.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Log hiệu chỉnh SOC của hàng nghìn pack không có ích ở đây
+#ifndef BMS_LOG_LEVEL
+#define BMS_LOG_LEVEL LOG_WARN
+#endif
+
+#include "bms_data.h"
+#include "../fleet/fleet_pool.h"
+
+#define ANALYZE_ALARM_FLAGS (BMS_FLAG_OV | BMS_FLAG_UV | BMS_FLAG_OC | BMS_FLAG_OT | BMS_FLAG_SC | BMS_FLAG_UT)
+#define ANALYZE_SOH_LOW     80.0f   // Pack dưới mức này được đếm riêng
+
+static uint64_t analyzeNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ============ INPUT ============
+
+struct LogFile {
+    std::string path;
+    uint64_t size;
+};
+
+// Đối số là file hoặc thư mục (không đệ quy, mọi file thường bên trong)
+static bool collectFiles(const char* path, std::vector<LogFile>& files) {
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back({ path, (uint64_t)st.st_size });
+        return true;
+    }
+    DIR* dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "cannot list %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string child = std::string(path) + "/" + entry->d_name;
+        if (stat(child.c_str(), &st) == 0 && S_ISREG(st.st_mode)) files.push_back({ child, (uint64_t)st.st_size });
+    }
+    closedir(dir);
+    return true;
+}
+
+// File chỉ đọc được map vào bộ nhớ, unmap khi hủy
+class MappedFile {
+private:
+    const uint8_t* data;
+    size_t length;
+    bool opened;
+
+public:
+    MappedFile(const char* path) {
+        data = NULL;
+        length = 0;
+        opened = false;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            length = st.st_size;
+            opened = true;
+            if (length > 0) {
+                void* map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (map == MAP_FAILED) {
+                    opened = false;
+                    length = 0;
+                } else {
+                    data = (const uint8_t*)map;
+                    madvise(map, length, MADV_SEQUENTIAL);
+                }
+            }
+        }
+        close(fd);   // Vùng map vẫn còn sau khi đóng fd
+    }
+
+    ~MappedFile() {
+        if (data) munmap((void*)data, length);
+    }
+
+    bool isOpen() { return opened; }
+    const uint8_t* begin() { return data; }
+    const uint8_t* end() { return data + length; }
+    size_t size() { return length; }
+};
+
+// ============ REPLAY ============
+
+struct PackSummary {
+    bool ok;
+    uint64_t bytes;
+    uint32_t frames;
+    uint32_t samples;           // Frame STATUS đã chạy lại
+    uint32_t textFrames;
+    uint32_t foreignFrames;     // STATUS của build khác (số cell khác NUM_CELLS)
+    uint64_t skippedBytes;      // Ngoài frame hoặc sai CRC
+    uint32_t reboots;
+    uint64_t durationMs;
+
+    // Firmware (giá trị trong log) so với lần chạy lại
+    float loggedSocFirst;
+    float loggedSoc;
+    float loggedSoh;
+    float soc;
+    float socDiffMax;
+    double socDiffSum;
+    uint32_t flagMismatches;    // Mẫu có cờ alarm khác với log
+
+    float chargeInAh;
+    float chargeOutAh;
+    float cycles;
+    float capacityAh;           // Cell yếu nhất
+    float soh;
+    uint32_t calibrations;
+
+    float minCell;
+    float maxCell;
+    float maxAbsCurrent;
+    float maxTemp;
+
+    uint32_t onsets[EVENT_TYPE_COUNT];
+    uint64_t activeMs[EVENT_TYPE_COUNT];
+};
+
+// Bảng cho logFrameCrc8(): 1 lần tra mỗi byte thay vì 8 vòng dịch bit
+static uint8_t crcTable[256];
+
+static void buildCrcTable() {
+    for (int i = 0; i < 256; i++) {
+        uint8_t byte = i;
+        crcTable[i] = logFrameCrc8(&byte, 1);
+    }
+}
+
+static inline uint16_t le16(const uint8_t* p) {
+    return p[0] | (uint16_t)p[1] << 8;
+}
+
+static inline uint32_t le32(const uint8_t* p) {
+    return le16(p) | (uint32_t)le16(p + 2) << 16;
+}
+
+// Trạng thái firmware của 1 pack, nạp lại từ log
+class PackReplay {
+private:
+    BMSData data;
+    SOCEstimator soc;
+    CellEstimatorBank<NUM_CELLS> cells;
+    BMSTemperatureBank temperatures;
+    BMSEventJournal events;
+    CellStatsBank<NUM_CELLS> cellStats;
+    BMSPack pack;
+    PackSummary& summary;
+    float capacity;
+
+    bool started;
+    uint32_t lastMs;            // millis() của firmware ở frame trước
+    uint64_t timeMs;            // Thời gian liên tục qua các lần khởi động lại
+    bool wasActive[EVENT_TYPE_COUNT];
+    uint32_t lastCalibrationId;
+
+    static bool checkCrc(const uint8_t* frame, uint8_t length) {
+        uint8_t crc = 0;
+        for (int i = 1; i < 3 + length; i++) crc = crcTable[crc ^ frame[i]];
+        return crc == frame[3 + length];
+    }
+
+    void onStatus(const uint8_t* p, uint8_t length) {
+        if (length != BMS_STATUS_FRAME_SIZE || p[4] != NUM_CELLS) {
+            summary.foreignFrames++;
+            return;
+        }
+        uint32_t ms = le32(p);
+        const uint8_t* tail = p + 5 + 2 * NUM_CELLS;
+        float loggedSoc = le16(tail + 4) / 10.0f;
+        BMSSample sample;
+        for (int i = 0; i < NUM_CELLS; i++) sample.cellVoltages[i] = le16(p + 5 + 2 * i) / 1000.0f;
+        sample.current = (int16_t)le16(tail) / 100.0f;
+        sample.temperature = (int16_t)le16(tail + 2) / 10.0f;
+        sample.minTemperature = sample.temperature;   // Frame chỉ có kênh nóng nhất
+        uint16_t loggedFlags = le16(tail + 8);
+        if (loggedFlags & BMS_FLAG_THERM) {
+            // Firmware ghi nhiệt độ hợp lệ cuối: nạp lại như mẫu mất nhiệt độ
+            sample.temperature = NAN;
+            sample.minTemperature = NAN;
+        }
+
+        if (!started) {
+            started = true;
+            timeMs = ms;
+            hostSetMillis(timeMs);
+            resetSOC(pack, loggedSoc);
+            summary.loggedSocFirst = loggedSoc;
+        } else {
+            uint32_t dt = ms;
+            if (ms >= lastMs) dt = ms - lastMs;
+            else summary.reboots++;
+            timeMs += dt;
+            summary.durationMs += dt;
+            for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+                if (wasActive[t]) summary.activeMs[t] += dt;
+            }
+        }
+        lastMs = ms;
+        sample.timestamp = timeMs;
+        hostSetMillis(timeMs);
+        updateBMSBatch(pack, &sample, 1);
+        summary.samples++;
+
+        float diff = fabsf(data.soc - loggedSoc);
+        summary.socDiffSum += diff;
+        if (diff > summary.socDiffMax) summary.socDiffMax = diff;
+        if ((loggedFlags ^ getStatusFlags(data)) & ANALYZE_ALARM_FLAGS) summary.flagMismatches++;
+        summary.loggedSoc = loggedSoc;
+        summary.loggedSoh = le16(tail + 6) / 10.0f;
+
+        for (int i = 0; i < NUM_CELLS; i++) {
+            summary.minCell = min(summary.minCell, sample.cellVoltages[i]);
+            summary.maxCell = max(summary.maxCell, sample.cellVoltages[i]);
+        }
+        summary.maxAbsCurrent = max(summary.maxAbsCurrent, fabsf(sample.current));
+        if (!isnan(sample.temperature)) summary.maxTemp = max(summary.maxTemp, sample.temperature);
+
+        // Lịch sử alarm: ring của journal chỉ giữ EVENT_CAPACITY sự kiện, đếm theo cạnh lên
+        for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+            bool active = events.isActive(t);
+            if (active && !wasActive[t]) summary.onsets[t]++;
+            wasActive[t] = active;
+        }
+        const BMSEvent* calibration = events.getLatest(EVENT_CALIBRATION);
+        if (calibration && calibration->id != lastCalibrationId) {
+            summary.calibrations++;
+            lastCalibrationId = calibration->id;
+        }
+    }
+
+public:
+    PackReplay(float capacityAh, PackSummary& out)
+        : soc(capacityAh, 100.0), cells(capacityAh), summary(out) {
+        capacity = capacityAh;
+        pack = { &data, &soc, &cells, &temperatures, &events, &cellStats };
+        initBMSData(pack);
+        started = false;
+        lastMs = 0;
+        timeMs = 0;
+        for (int t = 0; t < EVENT_TYPE_COUNT; t++) wasActive[t] = false;
+        lastCalibrationId = 0xFFFFFFFF;
+
+        memset(&summary, 0, sizeof(summary));
+        summary.minCell = 1e9f;
+        summary.maxCell = -1e9f;
+        summary.maxTemp = -1e9f;
+    }
+
+    // Parse cả file: frame hợp lệ = 0xA5 | type | len | payload | crc8
+    void run(const uint8_t* p, const uint8_t* end) {
+        while (p < end) {
+            if (*p != LOG_FRAME_SYNC) {
+                const uint8_t* sync = (const uint8_t*)memchr(p, LOG_FRAME_SYNC, end - p);
+                if (!sync) sync = end;
+                summary.skippedBytes += sync - p;
+                p = sync;
+                continue;
+            }
+            if (end - p < 4 || end - p < 4 + p[2]) {   // Frame cụt ở cuối capture
+                summary.skippedBytes += end - p;
+                break;
+            }
+            uint8_t length = p[2];
+            if (!checkCrc(p, length)) {
+                summary.skippedBytes++;
+                p++;
+                continue;
+            }
+            summary.frames++;
+            if (p[1] == LOG_FRAME_STATUS) onStatus(p + 3, length);
+            else if (p[1] == LOG_FRAME_TEXT) summary.textFrames++;
+            p += 4 + length;
+        }
+    }
+
+    void finish() {
+        summary.ok = true;
+        summary.soc = data.soc;
+        summary.chargeInAh = soc.getTotalChargeIn();
+        summary.chargeOutAh = soc.getTotalChargeOut();
+        summary.cycles = summary.chargeOutAh / capacity;
+        summary.capacityAh = cells.getCapacity(0);
+        for (int i = 1; i < NUM_CELLS; i++) summary.capacityAh = min(summary.capacityAh, cells.getCapacity(i));
+        summary.soh = summary.capacityAh / capacity * 100.0f;
+    }
+};
+
+// Chạy lại mọi file trên threads worker; trả về thời gian (s)
+static double analyzeFleet(const std::vector<LogFile>& files, int threads, float capacity,
+                           std::vector<PackSummary>& results) {
+    results.assign(files.size(), PackSummary());
+    WorkStealingPool pool(threads);
+    uint64_t start = analyzeNowNs();
+    pool.run(files.size(), [&](uint32_t i) {
+        PackSummary& summary = results[i];
+        PackReplay replay(capacity, summary);
+        MappedFile file(files[i].path.c_str());
+        if (!file.isOpen()) return;
+        replay.run(file.begin(), file.end());
+        replay.finish();
+        summary.bytes = file.size();
+    });
+    return (analyzeNowNs() - start) / 1e9;
+}
+
+// ============ REPORT ============
+
+static const char* baseName(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+// Các loại sự kiện có onset, dạng "overCurrent:3,balancing:12"
+static void formatOnsets(const PackSummary& s, char* out, size_t size) {
+    BufferWriter writer(out, size);
+    const char* sep = "";
+    for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+        if (!s.onsets[t]) continue;
+        writer.printf("%s%s:%lu", sep, EVENT_TYPES[t].name, (unsigned long)s.onsets[t]);
+        sep = ",";
+    }
+    if (!*sep) writer.printf("-");
+}
+
+static void printPacks(const std::vector<LogFile>& files, const std::vector<PackSummary>& results) {
+    printf("%-20s %7s %8s %4s %13s %7s %6s %8s %8s %7s %13s %4s  %s\n", "file", "hours", "samples", "rbt",
+           "SOC log>new", "max|d|", "flagd", "in Ah", "out Ah", "cycles", "SOH log>new", "cal", "alarms");
+    char onsets[256];
+    for (size_t i = 0; i < files.size(); i++) {
+        const PackSummary& s = results[i];
+        if (!s.ok) {
+            printf("%-20s unreadable\n", baseName(files[i].path));
+            continue;
+        }
+        formatOnsets(s, onsets, sizeof(onsets));
+        printf("%-20s %7.1f %8lu %4lu %6.1f>%5.1f %7.2f %6lu %8.2f %8.2f %7.2f %6.1f>%5.1f %4lu  %s\n",
+               baseName(files[i].path), s.durationMs / 3600000.0, (unsigned long)s.samples,
+               (unsigned long)s.reboots, s.loggedSoc, s.soc, s.socDiffMax, (unsigned long)s.flagMismatches,
+               s.chargeInAh, s.chargeOutAh, s.cycles, s.loggedSoh, s.soh, (unsigned long)s.calibrations, onsets);
+    }
+}
+
+// values đã sắp xếp, không rỗng
+static float percentile(const std::vector<float>& values, int p) {
+    return values[min(values.size() - 1, values.size() * p / 100)];
+}
+
+static void printFleet(const std::vector<PackSummary>& results, float capacity) {
+    uint64_t bytes = 0, skipped = 0, durationMs = 0, samples = 0;
+    uint32_t unreadable = 0, reboots = 0, foreign = 0, mismatchPacks = 0, lowSoh = 0;
+    double cycles = 0, chargeOut = 0;
+    float maxCycles = 0, minSoh = 1e9f;
+    std::vector<float> socDiff, socFinal, soh;
+    uint32_t packs[EVENT_TYPE_COUNT] = {}, onsets[EVENT_TYPE_COUNT] = {};
+    uint64_t activeMs[EVENT_TYPE_COUNT] = {};
+    for (const PackSummary& s : results) {
+        if (!s.ok) {
+            unreadable++;
+            continue;
+        }
+        bytes += s.bytes;
+        skipped += s.skippedBytes;
+        durationMs += s.durationMs;
+        samples += s.samples;
+        reboots += s.reboots;
+        foreign += s.foreignFrames;
+        if (!s.samples) continue;
+        mismatchPacks += s.flagMismatches != 0;
+        cycles += s.cycles;
+        chargeOut += s.chargeOutAh;
+        maxCycles = max(maxCycles, s.cycles);
+        minSoh = min(minSoh, s.soh);
+        lowSoh += s.soh < ANALYZE_SOH_LOW;
+        socDiff.push_back(s.socDiffMax);
+        socFinal.push_back(fabsf(s.soc - s.loggedSoc));
+        soh.push_back(s.soh);
+        for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+            packs[t] += s.onsets[t] != 0;
+            onsets[t] += s.onsets[t];
+            activeMs[t] += s.activeMs[t];
+        }
+    }
+    size_t replayed = soh.size();
+
+    printf("\n=== Fleet: %lu packs (%lu unreadable), %.1f MB, %.0f pack-hours, %llu samples, nominal %.1f Ah ===\n",
+           (unsigned long)results.size(), (unsigned long)unreadable, bytes / 1e6, durationMs / 3600000.0,
+           (unsigned long long)samples, capacity);
+    printf("log: %llu bytes outside frames / bad CRC, %lu reboots, %lu STATUS frames of other builds\n",
+           (unsigned long long)skipped, (unsigned long)reboots, (unsigned long)foreign);
+    if (!replayed) return;
+    std::sort(socDiff.begin(), socDiff.end());
+    std::sort(socFinal.begin(), socFinal.end());
+    std::sort(soh.begin(), soh.end());
+    float finalMean = 0;
+    for (float d : socFinal) finalMean += d / replayed;
+    printf("SOC new vs log: final |d| mean %.2f p50 %.2f p95 %.2f max %.2f, per-pack max |d| p95 %.2f max %.2f\n",
+           finalMean, percentile(socFinal, 50), percentile(socFinal, 95), socFinal.back(),
+           percentile(socDiff, 95), socDiff.back());
+    printf("alarm flags differ from log: %lu packs\n", (unsigned long)mismatchPacks);
+    printf("cycles (discharged / nominal): total %.1f, mean %.2f, max %.2f; %.1f Ah discharged\n",
+           cycles, cycles / replayed, maxCycles, chargeOut);
+    printf("SOH (weakest cell capacity): min %.1f%%, p5 %.1f%%, median %.1f%%; %lu packs < %.0f%%\n",
+           minSoh, percentile(soh, 5), percentile(soh, 50), (unsigned long)lowSoh, ANALYZE_SOH_LOW);
+    printf("%-18s %-9s %8s %8s %12s\n", "event", "severity", "packs", "onsets", "active h");
+    for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+        if (!packs[t]) continue;
+        printf("%-18s %-9s %8lu %8lu %12.2f\n", EVENT_TYPES[t].name, EVENT_TYPES[t].severity,
+               (unsigned long)packs[t], (unsigned long)onsets[t], activeMs[t] / 3600000.0);
+    }
+}
+
+static bool writeCsv(const char* path, const std::vector<LogFile>& files, const std::vector<PackSummary>& results) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "cannot write %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    fprintf(out, "file,bytes,samples,reboots,hours,soc_logged,soc,soc_diff_max,soc_diff_mean,flag_mismatches,"
+                 "charge_in_ah,charge_out_ah,cycles,soh_logged,soh,capacity_ah,calibrations,"
+                 "min_cell_v,max_cell_v,max_abs_current_a,max_temp_c");
+    for (int t = 0; t < EVENT_TYPE_COUNT; t++) fprintf(out, ",%s_onsets,%s_hours", EVENT_TYPES[t].name, EVENT_TYPES[t].name);
+    fprintf(out, "\n");
+    for (size_t i = 0; i < files.size(); i++) {
+        const PackSummary& s = results[i];
+        if (!s.ok || !s.samples) continue;
+        fprintf(out, "%s,%llu,%lu,%lu,%.3f,%.1f,%.2f,%.2f,%.3f,%lu,%.4f,%.4f,%.3f,%.1f,%.2f,%.4f,%lu,%.3f,%.3f,%.2f,%.1f",
+                files[i].path.c_str(), (unsigned long long)s.bytes, (unsigned long)s.samples,
+                (unsigned long)s.reboots, s.durationMs / 3600000.0, s.loggedSoc, s.soc, s.socDiffMax,
+                s.socDiffSum / s.samples, (unsigned long)s.flagMismatches, s.chargeInAh, s.chargeOutAh,
+                s.cycles, s.loggedSoh, s.soh, s.capacityAh, (unsigned long)s.calibrations, s.minCell,
+                s.maxCell, s.maxAbsCurrent, s.maxTemp);
+        for (int t = 0; t < EVENT_TYPE_COUNT; t++) {
+            fprintf(out, ",%lu,%.3f", (unsigned long)s.onsets[t], s.activeMs[t] / 3600000.0);
+        }
+        fprintf(out, "\n");
+    }
+    fclose(out);
+    return true;
+}
+
+static void printThroughput(int threads, double seconds, size_t files, uint64_t bytes, uint64_t samples,
+                            double single) {
+    printf("%8d %10.2f %10.0f %10.3f %12.2f", threads, seconds, files / seconds, bytes / seconds / 1e9,
+           samples / seconds / 1e6);
+    if (single > 0) printf(" %9.2fx", single / seconds);
+    printf("\n");
+}
+
+// ============ MAIN ============
+
+int main(int argc, char** argv) {
+    int threads = std::thread::hardware_concurrency();
+    float capacity = BATTERY_CAPACITY;
+    const char* csvPath = NULL;
+    bool scaling = false;
+    bool quiet = false;
+    std::vector<LogFile> files;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--scaling") == 0) {
+            scaling = true;
+            continue;
+        }
+        if (strcmp(arg, "--quiet") == 0) {
+            quiet = true;
+            continue;
+        }
+        if (strncmp(arg, "--", 2) != 0) {
+            if (!collectFiles(arg, files)) return 1;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (strcmp(arg, "--capacity") == 0) capacity = atof(value);
+        else if (strcmp(arg, "--csv") == 0) csvPath = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (files.empty() || capacity <= 0) {
+        fprintf(stderr, "usage: %s [--threads N] [--capacity AH] [--csv FILE] [--scaling] [--quiet] <log | dir> ...\n",
+                argv[0]);
+        return 1;
+    }
+
+    // File lớn trước; kết quả in theo tên
+    std::sort(files.begin(), files.end(), [](const LogFile& a, const LogFile& b) {
+        return a.size != b.size ? a.size > b.size : a.path < b.path;
+    });
+    buildCrcTable();
+
+    std::vector<PackSummary> results;
+    double seconds = analyzeFleet(files, threads, capacity, results);
+
+    std::vector<size_t> order(files.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return files[a].path < files[b].path; });
+    std::vector<LogFile> sortedFiles;
+    std::vector<PackSummary> sortedResults;
+    for (size_t i : order) {
+        sortedFiles.push_back(files[i]);
+        sortedResults.push_back(results[i]);
+    }
+    if (!quiet) printPacks(sortedFiles, sortedResults);
+    printFleet(sortedResults, capacity);
+    if (csvPath && !writeCsv(csvPath, sortedFiles, sortedResults)) return 1;
+
+    uint64_t bytes = 0, samples = 0;
+    for (const PackSummary& s : results) {
+        bytes += s.bytes;
+        samples += s.samples;
+    }
+    printf("\n%8s %10s %10s %10s %12s %10s\n", "threads", "seconds", "files/s", "GB/s", "Msamples/s", "speedup");
+    if (!scaling) {
+        printThroughput(threads, seconds, files.size(), bytes, samples, 0);
+        return 0;
+    }
+    std::vector<int> counts;
+    for (int t = 1; t < threads; t *= 2) counts.push_back(t);
+    counts.push_back(threads);
+    double single = 0;
+    for (int t : counts) {
+        std::vector<PackSummary> rerun;
+        double s = analyzeFleet(files, t, capacity, rerun);
+        if (t == 1) single = s;
+        printThroughput(t, s, files.size(), bytes, samples, single);
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Tải lịch sử từ /export theo từng đoạn Range, tự tải tiếp khi đứt kết nối.
+
+Khoảng xuất cố định theo seq (X-Export-First / X-Export-To của response đầu),
+các request sau dùng lại from/to đó + Range nên ghép lại đúng một file.
+Firmware trả 410 khi bản ghi đầu đã bị ghi đè (tải quá chậm) -> tải lại từ đầu.
+
+    python tools/bms_export.py 192.168.4.1 -o history.csv
+    python tools/bms_export.py 192.168.4.1 --format delta -o history.bin --decode history.csv
+    python tools/bms_export.py --decode history.csv history.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+import urllib.error
+import urllib.request
+
+HISTORY_MAGIC = 0x4842
+HEADER = struct.Struct("<HBBIIII")
+RECORD = struct.Struct("<IHhHhHH")
+CSV_HEADER = "timestamp_ms,pack_v,current_a,soc_pct,temp_c,min_cell_v,max_cell_v\n"
+
+
+def fetch(host, fmt, start_from, to, offset, chunk, timeout):
+    query = "format=%s" % fmt
+    if start_from is not None:
+        query += "&from=%d&to=%d" % (start_from, to)
+    req = urllib.request.Request("http://%s/export?%s" % (host, query))
+    req.add_header("Range", "bytes=%d-%d" % (offset, offset + chunk - 1))
+    return urllib.request.urlopen(req, timeout=timeout)
+
+
+def download(host, fmt, out, chunk, retries, timeout):
+    start_from = to = None
+    total = None
+    offset = 0
+    failures = 0
+    began = time.time()
+    while total is None or offset < total:
+        try:
+            with fetch(host, fmt, start_from, to, offset, chunk, timeout) as resp:
+                if start_from is None:
+                    start_from = int(resp.headers["X-Export-First"])
+                    to = int(resp.headers["X-Export-To"])
+                content_range = resp.headers.get("Content-Range")
+                total = int(content_range.rsplit("/", 1)[1]) if content_range else int(
+                    resp.headers["Content-Length"])
+                data = resp.read()
+        except urllib.error.HTTPError as e:
+            if e.code == 410:
+                print("records overwritten, restarting", file=sys.stderr)
+                out.seek(0)
+                out.truncate()
+                start_from = to = total = None
+                offset = 0
+                continue
+            if e.code in (429, 503):
+                # Admission control / export khác đang chạy: đợi Retry-After rồi thử lại
+                failures += 1
+                if failures > retries:
+                    raise
+                time.sleep(int(e.headers.get("Retry-After", "1")))
+                continue
+            raise
+        except OSError as e:
+            failures += 1
+            if failures > retries:
+                raise
+            print("retry at %d: %s" % (offset, e), file=sys.stderr)
+            time.sleep(min(2 ** failures, 10))
+            continue
+        if not data:
+            failures += 1
+            if failures > retries:
+                raise RuntimeError("empty response at offset %d" % offset)
+            continue
+        failures = 0
+        out.write(data)
+        offset += len(data)
+    elapsed = max(time.time() - began, 1e-6)
+    print("%d records [%d, %d), %d B in %.2f s (%.1f KB/s)" % (
+        to - start_from, start_from, to, offset, elapsed, offset / 1024.0 / elapsed), file=sys.stderr)
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return (value >> 1) ^ -(value & 1), pos
+
+
+def decode(data):
+    magic, version, record_size, interval, first, count, now = HEADER.unpack_from(data, 0)
+    if magic != HISTORY_MAGIC:
+        raise ValueError("not a history export (magic 0x%04x)" % magic)
+    pos = HEADER.size
+    if version == 1:
+        for i in range(count):
+            yield RECORD.unpack_from(data, pos + i * record_size)
+    elif version == 2:
+        prev = [0] * 7
+        for _ in range(count):
+            fields = []
+            for k in range(7):
+                delta, pos = read_varint(data, pos)
+                fields.append(prev[k] + delta + (interval if k == 0 else 0))
+            prev = fields
+            yield tuple(fields)
+    else:
+        raise ValueError("unknown version %d" % version)
+
+
+def write_csv(records, path):
+    with open(path, "w") as f:
+        f.write(CSV_HEADER)
+        for ts, pack, current, soc, temp, min_cell, max_cell in records:
+            f.write("%d,%.2f,%.2f,%.1f,%.1f,%.3f,%.3f\n" % (
+                ts, pack / 100.0, current / 100.0, soc / 10.0, temp / 10.0,
+                min_cell / 1000.0, max_cell / 1000.0))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="IP/host của ESP32, hoặc file .bin khi chỉ --decode")
+    ap.add_argument("-o", "--output", help="file lưu dữ liệu tải về")
+    ap.add_argument("--format", choices=["csv", "bin", "delta"], default="csv")
+    ap.add_argument("--chunk", type=int, default=32768, help="byte mỗi request Range")
+    ap.add_argument("--retries", type=int, default=5)
+    ap.add_argument("--timeout", type=float, default=10.0)
+    ap.add_argument("--decode", metavar="CSV", help="chuyển file bin/delta sang CSV")
+    args = ap.parse_args()
+
+    path = args.output
+    if args.output:
+        with open(args.output, "wb") as out:
+            download(args.source, args.format, out, args.chunk, args.retries, args.timeout)
+    else:
+        path = args.source
+    if args.decode:
+        with open(path, "rb") as f:
+            data = f.read()
+        write_csv(decode(data), args.decode)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+"""Load test các endpoint HTTP của thiết bị (hoặc fleet simulator, cổng --ports).
+
+Mỗi client ảo là 1 thread chạy 1 kịch bản, mỗi request mở kết nối mới như
+trình duyệt với WebServer của ESP32 (Connection: close):
+  dashboard  / rồi /history đầy đủ, sau đó mỗi 2s /bms + /history?since= (như dashboard)
+  poll       /bms mỗi --poll-interval giây (0 = liên tục)
+  page       tải lại / liên tục
+  info       /info mỗi 5s
+  history    /history đầy đủ liên tục
+  flood      / và /bms xen kẽ liên tục, không chờ (client hỏng / tấn công)
+Trộn bằng --mix, ví dụ dashboard=4,poll=8,info=1.
+
+Báo cáo theo endpoint: số request, req/s, KB/s, tỉ lệ lỗi, tỉ lệ bị từ chối
+(429/503 của admission control), latency p50/p90/p99/max.
+Jitter lấy mẫu của chính thiết bị: đọc dòng "Sample jitter" trong /info trước
+và sau lần chạy, trừ 2 histogram => phân bố trễ trong đúng khoảng đo.
+--save thêm 1 dòng JSON cho mỗi lần chạy (--label: phiên bản firmware),
+--compare in chênh lệch so với lần chạy trước cùng mix (hoặc --baseline LABEL).
+--flood-source IP: client flood gửi từ IP riêng (giới hạn theo IP của thiết bị).
+--tolerance-ms N: thoát mã 1 nếu p99 trễ lấy mẫu trong lúc chạy không dưới N ms.
+
+    python tools/bms_loadtest.py 192.168.4.1 --mix dashboard=2,poll=4 --duration 60
+    python tools/bms_loadtest.py localhost:9000 --mix poll=16 --save loadtest.jsonl --label v1.3
+    python tools/bms_loadtest.py 192.168.4.1 --mix page=4 --save loadtest.jsonl --compare
+    python tools/bms_loadtest.py localhost:9100 --mix flood=16,dashboard=1 --tolerance-ms 10
+"""
+
+import argparse
+import http.client
+import json
+import re
+import struct
+import sys
+import threading
+import time
+
+JITTER_RE = re.compile(r"Sample jitter: (\d+) samples, late avg (\d+) us / max (\d+) us,(.*)")
+BUCKET_RE = re.compile(r"(<|>=)(\d+)ms:(\d+)")
+ADMISSION_RE = re.compile(r"Admission: (\d+) served, (\d+) 429 \(client\), (\d+) 503 \(rate\), (\d+) 503 \(cpu\)")
+SCENARIOS = ("dashboard", "poll", "page", "info", "history", "flood")
+REJECTED = (429, 503)
+DASHBOARD_INTERVAL = 2.0   # UPDATE_INTERVAL trong bms_html_scripts.h
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.endpoints = {}
+
+    def add(self, name, latency, size, status):
+        with self.lock:
+            e = self.endpoints.setdefault(name, {"latencies": [], "bytes": 0, "errors": 0, "rejected": 0})
+            if status == 200:
+                e["latencies"].append(latency)
+                e["bytes"] += size
+            elif status in REJECTED:
+                e["rejected"] += 1
+            else:
+                e["errors"] += 1
+
+
+class Client(threading.Thread):
+    def __init__(self, scenario, host, port, stats, args, start, stop):
+        super().__init__(daemon=True)
+        self.scenario = scenario
+        self.host = host
+        self.port = port
+        self.stats = stats
+        self.args = args
+        self.start_at = start
+        self.stop_at = stop
+
+    def request(self, path, name=None):
+        began = time.perf_counter()
+        body = None
+        try:
+            source = (self.args.flood_source, 0) if self.scenario == "flood" and self.args.flood_source else None
+            conn = http.client.HTTPConnection(self.host, self.port, timeout=self.args.timeout,
+                                              source_address=source)
+            conn.request("GET", path)
+            resp = conn.getresponse()
+            body = resp.read()
+            conn.close()
+            status = resp.status
+        except (OSError, http.client.HTTPException):
+            status = 0
+        now = time.perf_counter()
+        if began >= self.start_at:   # Bỏ qua giai đoạn warmup
+            self.stats.add(name or path, (now - began) * 1000.0, len(body or b""), status)
+        return body if status == 200 else None
+
+    def wait(self, seconds):
+        time.sleep(max(0.0, min(seconds, self.stop_at - time.perf_counter())))
+
+    def run(self):
+        next_seq = 0
+        if self.scenario == "dashboard":
+            self.request("/")
+            next_seq = history_next(self.request("/history", "/history (full)"), next_seq)
+        while time.perf_counter() < self.stop_at:
+            began = time.perf_counter()
+            if self.scenario == "dashboard":
+                self.request("/bms")
+                next_seq = history_next(self.request("/history?since=%d" % next_seq, "/history?since"),
+                                        next_seq)
+                self.wait(DASHBOARD_INTERVAL - (time.perf_counter() - began))
+            elif self.scenario == "poll":
+                self.request("/bms")
+                self.wait(self.args.poll_interval - (time.perf_counter() - began))
+            elif self.scenario == "page":
+                self.request("/")
+            elif self.scenario == "info":
+                self.request("/info")
+                self.wait(5.0 - (time.perf_counter() - began))
+            elif self.scenario == "history":
+                self.request("/history", "/history (full)")
+            elif self.scenario == "flood":
+                self.request("/", "/ (flood)")
+                self.request("/bms", "/bms (flood)")
+
+
+def history_next(body, current):
+    # Header /history: u16 magic | u8 version | u8 size | u32 interval | u32 first | u32 count | u32 now
+    if not body or len(body) < 20:
+        return current
+    _, _, _, _, first, count, _ = struct.unpack_from("<HBBIIII", body, 0)
+    return first + count
+
+
+def read_info(host, port, timeout):
+    # Thiết bị đang bị flood có thể trả 429/503 (Retry-After): thử lại vài lần
+    for _ in range(20):
+        try:
+            conn = http.client.HTTPConnection(host, port, timeout=timeout)
+            conn.request("GET", "/info")
+            resp = conn.getresponse()
+            text = resp.read().decode("utf-8", "replace")
+            conn.close()
+            if resp.status == 200:
+                return text
+            if resp.status not in REJECTED:
+                return None
+        except (OSError, http.client.HTTPException):
+            pass
+        time.sleep(0.25)
+    return None
+
+
+def parse_jitter(text):
+    m = JITTER_RE.search(text or "")
+    if not m:
+        return None
+    buckets = [(op + ms + "ms", int(ms), int(n)) for op, ms, n in BUCKET_RE.findall(m.group(4))]
+    return {"samples": int(m.group(1)), "avg_us": int(m.group(2)), "max_us": int(m.group(3)),
+            "buckets": buckets}
+
+
+def parse_admission(text):
+    m = ADMISSION_RE.search(text or "")
+    return [int(v) for v in m.groups()] if m else None
+
+
+def jitter_delta(before, after):
+    if not before or not after:
+        return None
+    counts = [a[2] - b[2] for a, b in zip(after["buckets"], before["buckets"])]
+    names = [a[0] for a in after["buckets"]]
+    total = sum(counts)
+
+    def bucket_at(q):
+        if total == 0:
+            return "-"
+        need = q * total
+        seen = 0
+        for name, n in zip(names, counts):
+            seen += n
+            if seen >= need:
+                return name
+        return names[-1]
+
+    worst = next((name for name, n in reversed(list(zip(names, counts))) if n), "-")
+    p99 = bucket_at(0.99)
+    bounds = dict((a[0], a[1]) for a in after["buckets"])
+    # Cận trên của bucket p99 ("<5ms" -> 5, ">=100ms" -> vô cùng)
+    p99_bound = None if p99 == "-" or p99.startswith(">=") else bounds[p99]
+    return {"samples": total, "p50": bucket_at(0.5), "p99": p99, "p99_below_ms": p99_bound,
+            "worst": worst, "histogram": dict(zip(names, counts)), "max_us_since_boot": after["max_us"]}
+
+
+def admission_delta(before, after):
+    if not before or not after:
+        return None
+    return dict(zip(("served", "429_client", "503_rate", "503_cpu"),
+                    (a - b for a, b in zip(after, before))))
+
+
+def percentile(values, q):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+
+def summarize(stats, duration):
+    result = {}
+    for name, e in sorted(stats.endpoints.items()):
+        lat = e["latencies"]
+        total = len(lat) + e["errors"]
+        total += e["rejected"]
+        result[name] = {
+            "requests": total,
+            "rps": len(lat) / duration,
+            "kbps": e["bytes"] / 1024.0 / duration,
+            "error_pct": 100.0 * e["errors"] / total if total else 0.0,
+            "rejected_pct": 100.0 * e["rejected"] / total if total else 0.0,
+            "p50_ms": percentile(lat, 0.50),
+            "p90_ms": percentile(lat, 0.90),
+            "p99_ms": percentile(lat, 0.99),
+            "max_ms": max(lat) if lat else 0.0,
+        }
+    return result
+
+
+def print_report(run):
+    print("\n%-18s %8s %8s %9s %7s %7s %8s %8s %8s %8s" % (
+        "endpoint", "requests", "req/s", "KB/s", "err%", "rej%", "p50 ms", "p90 ms", "p99 ms", "max ms"))
+    for name, r in run["endpoints"].items():
+        print("%-18s %8d %8.1f %9.1f %7.2f %7.2f %8.1f %8.1f %8.1f %8.1f" % (
+            name, r["requests"], r["rps"], r["kbps"], r["error_pct"], r.get("rejected_pct", 0.0),
+            r["p50_ms"], r["p90_ms"], r["p99_ms"], r["max_ms"]))
+    j = run["jitter"]
+    if j:
+        hist = " ".join("%s:%d" % (k, v) for k, v in j["histogram"].items())
+        print("\nsample jitter during run: %d samples, p50 %s, p99 %s, worst %s (max since boot %d us)" % (
+            j["samples"], j["p50"], j["p99"], j["worst"], j["max_us_since_boot"]))
+        print("  " + hist)
+    else:
+        print("\nsample jitter: /info has no 'Sample jitter' line")
+    a = run.get("admission")
+    if a:
+        print("device admission during run: %d served, %d x 429 (client), %d x 503 (rate), %d x 503 (cpu)" % (
+            a["served"], a["429_client"], a["503_rate"], a["503_cpu"]))
+
+
+def print_compare(run, base):
+    print("\nvs %s (%s):" % (base.get("label") or "previous", base["time"]))
+    print("%-18s %18s %18s %14s" % ("endpoint", "req/s", "p99 ms", "err%"))
+    for name, r in run["endpoints"].items():
+        b = base["endpoints"].get(name)
+        if not b:
+            continue
+        print("%-18s %8.1f -> %-7.1f %8.1f -> %-7.1f %6.2f -> %-5.2f" % (
+            name, b["rps"], r["rps"], b["p99_ms"], r["p99_ms"], b["error_pct"], r["error_pct"]))
+    if run["jitter"] and base.get("jitter"):
+        print("%-18s %8s -> %-7s %8s -> %-7s" % ("sample jitter", base["jitter"]["p99"],
+                                                 run["jitter"]["p99"], base["jitter"]["worst"],
+                                                 run["jitter"]["worst"]))
+
+
+def parse_mix(text):
+    mix = {}
+    for part in text.split(","):
+        name, _, count = part.partition("=")
+        if name not in SCENARIOS:
+            raise argparse.ArgumentTypeError("unknown scenario %r (%s)" % (name, ", ".join(SCENARIOS)))
+        mix[name] = int(count or 1)
+    return mix
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("target", help="host[:port] của thiết bị hoặc fleet simulator")
+    ap.add_argument("--mix", type=parse_mix, default=parse_mix("dashboard=2,poll=4,info=1"))
+    ap.add_argument("--duration", type=float, default=30.0, help="giây đo")
+    ap.add_argument("--warmup", type=float, default=2.0, help="giây đầu không tính")
+    ap.add_argument("--poll-interval", type=float, default=1.0)
+    ap.add_argument("--timeout", type=float, default=5.0)
+    ap.add_argument("--label", default="", help="tên lần chạy (phiên bản firmware)")
+    ap.add_argument("--save", metavar="FILE", help="thêm kết quả vào file JSON lines")
+    ap.add_argument("--compare", action="store_true", help="so với lần chạy trước cùng mix trong --save")
+    ap.add_argument("--baseline", metavar="LABEL", help="so với lần chạy có label này")
+    ap.add_argument("--flood-source", metavar="IP",
+                    help="IP nguồn cho client flood (vd 127.0.0.66 khi test simulator trên máy): "
+                         "tách kẻ flood khỏi dashboard trong giới hạn theo IP")
+    ap.add_argument("--tolerance-ms", type=float, help="thoát mã 1 nếu p99 trễ lấy mẫu không dưới N ms")
+    args = ap.parse_args()
+
+    host, _, port = args.target.partition(":")
+    port = int(port or 80)
+    before_info = read_info(host, port, args.timeout)
+
+    stats = Stats()
+    start = time.perf_counter() + args.warmup
+    stop = start + args.duration
+    clients = [Client(s, host, port, stats, args, start, stop)
+               for s, n in args.mix.items() for _ in range(n)]
+    mix_text = ",".join("%s=%d" % kv for kv in args.mix.items())
+    print("%s:%d  mix %s  %d clients  %.0f s (+%.0f s warmup)" % (
+        host, port, mix_text, len(clients), args.duration, args.warmup))
+    for c in clients:
+        c.start()
+    for c in clients:
+        c.join(stop - time.perf_counter() + args.timeout + 1)
+
+    after_info = read_info(host, port, args.timeout)
+    run = {
+        "time": time.strftime("%Y-%m-%d %H:%M:%S"),
+        "label": args.label,
+        "target": args.target,
+        "mix": mix_text,
+        "duration": args.duration,
+        "endpoints": summarize(stats, args.duration),
+        "jitter": jitter_delta(parse_jitter(before_info), parse_jitter(after_info)),
+        "admission": admission_delta(parse_admission(before_info), parse_admission(after_info)),
+    }
+    print_report(run)
+
+    if args.save:
+        previous = []
+        try:
+            with open(args.save) as f:
+                previous = [json.loads(line) for line in f if line.strip()]
+        except FileNotFoundError:
+            pass
+        if args.compare or args.baseline:
+            if args.baseline:
+                matches = [r for r in previous if r.get("label") == args.baseline and r["mix"] == mix_text]
+            else:
+                matches = [r for r in previous if r["mix"] == mix_text]
+            if matches:
+                print_compare(run, matches[-1])
+            else:
+                print("\nno earlier run with mix %s to compare" % mix_text, file=sys.stderr)
+        with open(args.save, "a") as f:
+            f.write(json.dumps(run) + "\n")
+
+    if args.tolerance_ms is not None:
+        j = run["jitter"]
+        bound = j["p99_below_ms"] if j else None
+        ok = bound is not None and bound <= args.tolerance_ms
+        print("\nsampling p99 late %s: %s %.0f ms tolerance" % (
+            j["p99"] if j else "unknown", "within" if ok else "OUT OF", args.tolerance_ms))
+        if not ok:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Giải mã log nhị phân của firmware (build với -DBMS_LOG_BINARY).
+
+Frame: 0xA5 | type | len | payload[len] | crc8(type..payload), poly 0x07.
+Byte nằm ngoài frame hợp lệ (log lúc boot) được in ra nguyên dạng text.
+
+    python tools/bms_log_decode.py capture.bin
+    python tools/bms_log_decode.py /dev/ttyUSB0 --baud 115200 --csv status.csv
+"""
+
+import argparse
+import struct
+import sys
+
+FRAME_SYNC = 0xA5
+FRAME_TEXT = 0x01
+FRAME_STATUS = 0x10
+
+LEVELS = "EWID"
+FLAG_NAMES = ["OV", "UV", "OC", "OT", "SC", "BAL", "CHG", "DSG", "UT", "COMMS", "THERM"]
+
+
+def crc8(data, crc=0):
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def decode_status(payload):
+    ms, cells = struct.unpack_from("<IB", payload, 0)
+    offset = 5
+    voltages = [v / 1000.0 for v in struct.unpack_from("<%dH" % cells, payload, offset)]
+    offset += 2 * cells
+    current, temp, soc, soh, flags, balancing = struct.unpack_from("<hhHHHH", payload, offset)
+    return {
+        "ms": ms,
+        "cells": voltages,
+        "current": current / 100.0,
+        "temp": temp / 10.0,
+        "soc": soc / 10.0,
+        "soh": soh / 10.0,
+        "flags": flags,
+        "balancing": balancing,
+    }
+
+
+def format_status(s):
+    flags = [name for bit, name in enumerate(FLAG_NAMES) if s["flags"] & (1 << bit)]
+    cells = " ".join("%.3f" % v for v in s["cells"])
+    return "[%10.3fs] STATUS cells=[%s] I=%.2fA T=%.1fC SOC=%.1f%% SOH=%.1f%% %s" % (
+        s["ms"] / 1000.0, cells, s["current"], s["temp"], s["soc"], s["soh"], ",".join(flags))
+
+
+class Decoder:
+    def __init__(self, out, csv_file=None):
+        self.buf = bytearray()
+        self.raw = bytearray()
+        self.out = out
+        self.csv = csv_file
+        self.frames = 0
+        self.crc_errors = 0
+
+    def flush_raw(self):
+        if self.raw:
+            self.out.write(self.raw.decode("utf-8", "replace"))
+            self.raw.clear()
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            if self.buf[0] != FRAME_SYNC:
+                self.raw.append(self.buf.pop(0))
+                continue
+            if len(self.buf) < 3:
+                return
+            length = self.buf[2]
+            if len(self.buf) < length + 4:
+                return
+            body = bytes(self.buf[1:3 + length])
+            if crc8(body) != self.buf[3 + length]:
+                # Không phải frame: coi 0xA5 là byte text và dò tiếp
+                self.crc_errors += 1
+                self.raw.append(self.buf.pop(0))
+                continue
+            del self.buf[:length + 4]
+            self.flush_raw()
+            self.handle(body[0], body[2:])
+
+    def handle(self, frame_type, payload):
+        self.frames += 1
+        if frame_type == FRAME_TEXT and payload:
+            level = LEVELS[payload[0] & 3]
+            text = payload[1:].decode("utf-8", "replace")
+            self.out.write("[%s] %s\n" % (level, text))
+        elif frame_type == FRAME_STATUS:
+            status = decode_status(payload)
+            self.out.write(format_status(status) + "\n")
+            if self.csv:
+                row = [status["ms"]] + status["cells"] + [
+                    status["current"], status["temp"], status["soc"], status["soh"],
+                    status["flags"], status["balancing"]]
+                self.csv.write(",".join(str(v) for v in row) + "\n")
+        else:
+            self.out.write("[?] frame type 0x%02X len %d\n" % (frame_type, len(payload)))
+
+
+def open_source(path, baud):
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial  # pyserial
+        return serial.Serial(path, baud, timeout=0.2)
+    return open(path, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="file nhị phân hoặc cổng serial")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--csv", help="ghi status frame ra file CSV")
+    args = parser.parse_args()
+
+    csv_file = open(args.csv, "w") if args.csv else None
+    decoder = Decoder(sys.stdout, csv_file)
+    source = open_source(args.source, args.baud)
+    try:
+        while True:
+            data = source.read(4096)
+            if not data:
+                if hasattr(source, "in_waiting"):
+                    continue
+                break
+            decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+    decoder.flush_raw()
+    sys.stderr.write("%d frames, %d CRC errors\n" % (decoder.frames, decoder.crc_errors))
+    if csv_file:
+        csv_file.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""Nhận UDP stream của firmware (build với -DBMS_UDP_STREAM).
+
+Frame (little-endian): u16 magic 0x5342 | u8 version | u8 cells | u32 seq
+| u32 timestamp (us) | u16 cell mV x cells | i16 current (mA)
+| i16 temp (0.01C) | u16 soc (0.1%) | u16 flags. Một datagram chứa 1 hoặc
+nhiều frame. Phát hiện frame mất / đảo thứ tự qua seq.
+
+    python tools/bms_udp_receiver.py --csv cells.csv
+    python tools/bms_udp_receiver.py --group 239.1.2.3 --bin raw.bin --duration 600
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+FRAME_MAGIC = 0x5342
+FRAME_VERSION = 1
+HEADER = struct.Struct("<HBBII")
+
+
+def frame_size(cells):
+    return HEADER.size + 2 * cells + 8
+
+
+def parse_frames(datagram):
+    """Trả về list (seq, timestamp_us, cells_mv, current_ma, temp, soc, flags, raw)."""
+    frames = []
+    offset = 0
+    while offset + HEADER.size <= len(datagram):
+        magic, version, cells, seq, timestamp = HEADER.unpack_from(datagram, offset)
+        size = frame_size(cells)
+        if magic != FRAME_MAGIC or version != FRAME_VERSION or offset + size > len(datagram):
+            break
+        cells_mv = struct.unpack_from("<%dH" % cells, datagram, offset + HEADER.size)
+        current, temp, soc, flags = struct.unpack_from("<hhHH", datagram, offset + HEADER.size + 2 * cells)
+        frames.append((seq, timestamp, cells_mv, current, temp, soc, flags,
+                       datagram[offset:offset + size]))
+        offset += size
+    return frames
+
+
+class GapTracker:
+    def __init__(self):
+        self.expected = None
+        self.received = 0
+        self.lost = 0
+        self.reordered = 0
+        self.restarts = 0
+        self.gaps = []
+
+    def add(self, seq):
+        self.received += 1
+        if self.expected is None or (seq == 0 and self.expected > 1):
+            if self.expected is not None:
+                self.restarts += 1   # Thiết bị khởi động lại
+            self.expected = seq + 1
+            return
+        if seq > self.expected:
+            self.lost += seq - self.expected
+            self.gaps.append((self.expected, seq - 1))
+        elif seq < self.expected:
+            self.reordered += 1
+            return
+        self.expected = seq + 1
+
+
+def open_socket(bind, port, group):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind((bind, port))
+    if group:
+        membership = struct.pack("4s4s", socket.inet_aton(group), socket.inet_aton("0.0.0.0"))
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    sock.settimeout(0.5)
+    return sock
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=5005)
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--group", help="nhóm multicast cần join (ví dụ 239.1.2.3)")
+    parser.add_argument("--csv", help="ghi mẫu ra file CSV")
+    parser.add_argument("--bin", help="ghi frame nhị phân nguyên dạng")
+    parser.add_argument("--duration", type=float, default=0, help="giây, 0 = tới khi Ctrl+C")
+    parser.add_argument("--quiet", action="store_true", help="không in thống kê mỗi giây")
+    args = parser.parse_args()
+
+    sock = open_socket(args.bind, args.port, args.group)
+    csv_file = open(args.csv, "w") if args.csv else None
+    bin_file = open(args.bin, "wb") if args.bin else None
+    header_written = False
+    tracker = GapTracker()
+
+    start = time.monotonic()
+    last_report = start
+    frames_since_report = 0
+    try:
+        while not args.duration or time.monotonic() - start < args.duration:
+            try:
+                datagram, _ = sock.recvfrom(65535)
+            except socket.timeout:
+                datagram = b""
+
+            for seq, timestamp, cells, current, temp, soc, flags, raw in parse_frames(datagram):
+                tracker.add(seq)
+                frames_since_report += 1
+                if bin_file:
+                    bin_file.write(raw)
+                if csv_file:
+                    if not header_written:
+                        names = ["cell%d_mv" % (i + 1) for i in range(len(cells))]
+                        csv_file.write(",".join(["seq", "timestamp_us"] + names +
+                                                ["current_ma", "temp_c", "soc", "flags"]) + "\n")
+                        header_written = True
+                    row = [seq, timestamp] + list(cells) + [current, temp / 100.0, soc / 10.0, flags]
+                    csv_file.write(",".join(str(v) for v in row) + "\n")
+
+            now = time.monotonic()
+            if now - last_report >= 1.0:
+                if not args.quiet:
+                    sys.stderr.write("%7.1f frames/s  received %d  lost %d  reordered %d\n" % (
+                        frames_since_report / (now - last_report), tracker.received,
+                        tracker.lost, tracker.reordered))
+                frames_since_report = 0
+                last_report = now
+    except KeyboardInterrupt:
+        pass
+
+    elapsed = time.monotonic() - start
+    total = tracker.received + tracker.lost
+    sys.stderr.write("%d frames in %.1fs (%.1f/s), lost %d (%.3f%%), reordered %d, restarts %d\n" % (
+        tracker.received, elapsed, tracker.received / elapsed if elapsed else 0, tracker.lost,
+        100.0 * tracker.lost / total if total else 0, tracker.reordered, tracker.restarts))
+    for first, last in tracker.gaps[:20]:
+        sys.stderr.write("  gap: seq %d..%d\n" % (first, last))
+    if csv_file:
+        csv_file.close()
+    if bin_file:
+        bin_file.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""Sinh trang benchmark dashboard (chạy trong trình duyệt, dữ liệu giả lập).
+
+Ghép trang y như firmware gửi (theo HTML_PAGE_PARTS trong src/bms_html.h),
+thay fetch('/bms') bằng dữ liệu giả lập N cell, fetch('/history') bằng bản ghi
+nhị phân giả lập (1 giờ lúc đầu, rồi mỗi lần poll thêm vài bản ghi) và thêm
+bảng đo: mỗi lần cập nhật tính thời gian script + style + layout (ép layout
+ngay sau khi vẽ), so sánh renderer hiện tại (sửa DOM từng phần) với cách cũ
+(dựng lại lưới cell / alert bằng innerHTML mỗi lần poll). Kèm thời gian vẽ
+biểu đồ xu hướng trên luồng chính (trends.stats).
+
+    python tools/dashboard_bench.py -o dashboard_bench.html
+    # mở file, bấm Run (hoặc thêm ?run vào URL để tự chạy)
+    python tools/dashboard_bench.py --cells 4,24,96,192 --iterations 200 -o bench.html
+"""
+
+import argparse
+import os
+import re
+import sys
+
+SRC = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src")
+
+# Chạy trước script dashboard: /bms trả dữ liệu giả lập
+FETCH_STUB = r"""
+<script>
+const BENCH_DEMO_CELLS = 24;
+let benchDemoStep = 0;
+
+function benchMakeData(n, step) {
+    const cells = [];
+    let maxV = 0;
+    for (let i = 0; i < n; i++) {
+        const v = 3.15 + 0.2 * Math.sin((i + step) * 0.37) + (((i * 7 + step * 13) % 11) - 5) * 0.001;
+        maxV = Math.max(maxV, v);
+        cells.push({ cell: i + 1, voltage: v.toFixed(3), soc: '50.0', capacity: '6.000' });
+    }
+    const balancingCells = cells.filter(c => parseFloat(c.voltage) >= maxV - 0.01).map(c => c.cell);
+    const alerts = [{ severity: 'warning', message: 'Temperature sensor fault' }];
+    if (step % 20 < 10) alerts.unshift({ severity: 'critical', message: 'Over Voltage ALARM!' });
+    return {
+        measurement: {
+            cellVoltages: cells,
+            packVoltage: (3.2 * n).toFixed(2),
+            avgCellVoltage: '3.200',
+            current: (Math.sin(step * 0.1) * 2).toFixed(2),
+            packTemperature: (25 + step % 10).toFixed(1),
+            minTemperature: '20.0',
+            temperatures: []
+        },
+        chemistry: { name: 'LiFePO4', emptyVoltage: '2.50', fullVoltage: '3.40',
+                     overVoltage: '3.65', underVoltage: '2.80' },
+        calculation: { soc: (50 + step % 50).toFixed(1), soh: '98.0', remainingCapacity: '3.000',
+                       weakestCell: 1, expectedVoltage: '3.200' },
+        status: {
+            charging: ['charging', 'discharging', 'idle'][Math.floor(step / 5) % 3],
+            balancing: { active: balancingCells.length > 0, cells: balancingCells }
+        },
+        protection: { overVoltage: step % 20 < 10 ? 'alarm' : 'normal', underVoltage: 'normal',
+                      overCurrent: 'normal', overTemperature: 'normal',
+                      underTemperature: 'normal', shortCircuit: 'normal',
+                      commsFault: 'normal', thermalLoss: 'normal' },
+        alerts: alerts
+    };
+}
+
+// /history: header 20 byte + bản ghi 16 byte (xem src/bms_history.h), 1 bản ghi / giây
+let benchHistorySeq = 0;
+
+function benchMakeHistory() {
+    const count = benchHistorySeq === 0 ? 3600 : 2;
+    const first = benchHistorySeq;
+    const buffer = new ArrayBuffer(20 + 16 * count);
+    const view = new DataView(buffer);
+    view.setUint16(0, 0x4842, true);
+    view.setUint8(2, 1);
+    view.setUint8(3, 16);
+    view.setUint32(4, 1000, true);
+    view.setUint32(8, first, true);
+    view.setUint32(12, count, true);
+    for (let i = 0; i < count; i++) {
+        const seq = first + i;
+        const o = 20 + 16 * i;
+        const current = 2 * Math.sin(seq / 300) + (seq % 173 === 0 ? 8 : 0) + ((seq * 7919) % 21 - 10) * 0.01;
+        view.setUint32(o, seq * 1000, true);
+        view.setUint16(o + 4, Math.round((51.2 + current * 0.4) * 100), true);
+        view.setInt16(o + 6, Math.round(current * 100), true);
+        view.setUint16(o + 8, Math.round((50 + 30 * Math.sin(seq / 2000)) * 10), true);
+        view.setInt16(o + 10, Math.round((28 + 3 * Math.sin(seq / 900)) * 10), true);
+        view.setUint16(o + 12, 3190, true);
+        view.setUint16(o + 14, 3230, true);
+    }
+    view.setUint32(16, (first + count) * 1000, true);
+    benchHistorySeq += count;
+    return buffer;
+}
+
+window.fetch = async function (url) {
+    if (String(url).indexOf('/history') === 0) {
+        const buffer = benchMakeHistory();
+        return { ok: true, status: 200, arrayBuffer: async () => buffer };
+    }
+    const data = benchMakeData(BENCH_DEMO_CELLS, benchDemoStep++);
+    return { ok: true, status: 200, json: async () => data };
+};
+</script>
+"""
+
+# Chạy sau script dashboard: bảng điều khiển + vòng đo
+HARNESS = r"""
+<div id="benchPanel" style="position:fixed;right:12px;bottom:12px;z-index:1000;background:#fff;
+     padding:12px 16px;border-radius:12px;box-shadow:0 8px 30px rgba(0,0,0,.3);font:13px monospace;max-width:640px">
+  <b>Dashboard benchmark</b>
+  cells <input id="benchCells" value="{{CELLS}}" size="14">
+  iterations <input id="benchIterations" value="{{ITERATIONS}}" size="5">
+  <button id="benchRun">Run</button>
+  <pre id="benchResult" style="margin:8px 0 0"></pre>
+</div>
+<script>
+// Cách cũ: dựng lại toàn bộ lưới cell và alert bằng innerHTML (tham chiếu)
+function legacyUpdateBatteryCells(data) {
+    const { measurement, status, chemistry } = data;
+    const emptyV = parseFloat(chemistry.emptyVoltage);
+    const fullV = parseFloat(chemistry.fullVoltage);
+    let html = '';
+    measurement.cellVoltages.forEach(cell => {
+        const voltage = parseFloat(cell.voltage);
+        const percentage = Math.max(0, Math.min(100, ((voltage - emptyV) / (fullV - emptyV)) * 100));
+        let levelClass = 'critical';
+        if (percentage >= 80) levelClass = 'full';
+        else if (percentage >= 60) levelClass = 'good';
+        else if (percentage >= 40) levelClass = 'medium';
+        else if (percentage >= 20) levelClass = 'low';
+        const isBalancing = status.balancing.active && status.balancing.cells.includes(cell.cell);
+        html += '<div class="battery-cell' + (isBalancing ? ' balancing' : '') + '">';
+        html += '<div class="cell-label">Cell ' + cell.cell + '</div>';
+        html += '<div class="battery-icon-container">';
+        html += '<div class="battery-head"></div>';
+        html += '<div class="battery-body">';
+        html += '<div class="battery-level ' + levelClass + '" style="height: ' + percentage + '%; transform: none;"></div>';
+        html += '</div></div>';
+        html += '<div class="voltage-value">' + voltage.toFixed(3) + 'V</div>';
+        html += '<div class="percentage">' + percentage.toFixed(0) + '%</div>';
+        html += '</div>';
+    });
+    elements.batteryDisplay.innerHTML = html;
+}
+
+function legacyUpdateAlerts(data) {
+    const alerts = data.alerts || [];
+    elements.alertsContainer.classList.toggle('hidden', alerts.length === 0);
+    let html = '';
+    alerts.forEach(alert => {
+        const icon = alert.severity === 'critical' ? '🚨' : '⚠️';
+        html += '<div class="alert ' + alert.severity + '">';
+        html += '<div class="alert-icon">' + icon + '</div>';
+        html += '<div class="alert-message">' + alert.message + '</div>';
+        html += '</div>';
+    });
+    elements.alertsContainer.innerHTML = html;
+}
+
+const BENCH_RENDERERS = {
+    innerHTML: data => {
+        updateStats(data);
+        updateProtectionStatus(data);
+        legacyUpdateBatteryCells(data);
+        legacyUpdateAlerts(data);
+    },
+    incremental: data => updateDashboard(data)
+};
+
+function benchResetDom() {
+    cellViews = [];
+    alertViews.clear();
+    elements.batteryDisplay.textContent = '';
+    elements.alertsContainer.textContent = '';
+    elements.batteryDisplay.classList.remove('compact');
+    elements.batteryDisplay._class_compact = undefined;
+    elements.alertsContainer._class_hidden = undefined;
+}
+
+function benchPercentile(sorted, p) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function benchRun() {
+    clearInterval(updateTimer);
+    pendingData = null;
+    const counts = document.getElementById('benchCells').value.split(',').map(Number).filter(n => n > 0);
+    const iterations = parseInt(document.getElementById('benchIterations').value, 10);
+    const out = document.getElementById('benchResult');
+    const results = [];
+    out.textContent = 'running...';
+
+    // Đếm số phần tử được chèn vào DOM mỗi lần cập nhật (không tính text node)
+    let added = 0;
+    const countAdded = records => records.forEach(m => m.addedNodes.forEach(node => {
+        if (node.nodeType === 1) added++;
+    }));
+    const observer = new MutationObserver(countAdded);
+    observer.observe(document.querySelector('.dashboard') || document.body, { childList: true, subtree: true });
+
+    for (const n of counts) {
+        for (const mode of Object.keys(BENCH_RENDERERS)) {
+            benchResetDom();
+            const render = BENCH_RENDERERS[mode];
+            const times = [];
+            for (let step = 0; step < iterations + 10; step++) {
+                const data = benchMakeData(n, step);
+                // Mỗi lần đo trong 1 frame riêng (như poll thật), transition/animation chạy tiếp
+                await new Promise(resolve => requestAnimationFrame(resolve));
+                observer.takeRecords();
+                if (step === 10) added = 0;
+                const t0 = performance.now();
+                render(data);
+                document.body.offsetHeight;   // Ép style + layout ngay trong phép đo
+                const t1 = performance.now();
+                if (step >= 10) {
+                    times.push(t1 - t0);
+                    countAdded(observer.takeRecords());
+                }
+            }
+            times.sort((a, b) => a - b);
+            results.push({
+                cells: n, mode: mode,
+                median: benchPercentile(times, 0.5), p95: benchPercentile(times, 0.95),
+                max: times[times.length - 1], elementsPerUpdate: added / iterations
+            });
+            added = 0;
+        }
+    }
+    observer.disconnect();
+
+    let text = 'cells  mode          median ms   p95 ms   max ms  elements/update\n';
+    results.forEach(r => {
+        text += String(r.cells).padStart(5) + '  ' + r.mode.padEnd(12) +
+            r.median.toFixed(3).padStart(11) + r.p95.toFixed(3).padStart(9) +
+            r.max.toFixed(3).padStart(9) + r.elementsPerUpdate.toFixed(1).padStart(16) + '\n';
+    });
+    const ts = trends.stats;
+    if (ts.updates) {
+        text += '\ntrend charts: ' + ts.updates + ' updates, ' + ts.fullRedraws + ' full redraws, avg ' +
+            (ts.totalMs / ts.updates).toFixed(3) + ' ms, max ' + ts.maxMs.toFixed(3) + ' ms (main thread)\n';
+    }
+    out.textContent = text;
+    console.table(results);
+    window.benchResults = results;
+}
+
+document.getElementById('benchRun').addEventListener('click', benchRun);
+if (location.search.indexOf('run') >= 0) window.addEventListener('load', () => setTimeout(benchRun, 500));
+</script>
+"""
+
+RAW_LITERAL = r'const char (\w+)\[\] PROGMEM = R"rawliteral\((.*?)\)rawliteral";'
+
+
+def page_parts():
+    """Tên các phần theo thứ tự trong HTML_PAGE_PARTS + nội dung mọi rawliteral."""
+    literals = {}
+    for filename in sorted(os.listdir(SRC)):
+        if filename.startswith("bms_html") and filename.endswith(".h"):
+            with open(os.path.join(SRC, filename), encoding="utf-8") as f:
+                literals.update(re.findall(RAW_LITERAL, f.read(), re.S))
+    with open(os.path.join(SRC, "bms_html.h"), encoding="utf-8") as f:
+        match = re.search(r"HTML_PAGE_PARTS\[\] = \{(.*?)\};", f.read(), re.S)
+    if not match:
+        sys.exit("HTML_PAGE_PARTS not found in bms_html.h")
+    names = re.findall(r"^\s*(\w+),?", re.sub(r"//.*", "", match.group(1)), re.M)
+    missing = [name for name in names if name not in literals]
+    if missing:
+        sys.exit("page parts not found: %s" % ", ".join(missing))
+    return [literals[name] for name in names]
+
+
+def build_page(cells, iterations):
+    page = "".join(page_parts())
+    if "<head>" not in page or "</body>" not in page:
+        sys.exit("unexpected page layout")
+    page = page.replace("<head>", "<head>" + FETCH_STUB, 1)
+    harness = HARNESS.replace("{{CELLS}}", cells).replace("{{ITERATIONS}}", str(iterations))
+    return page.replace("</body>", harness + "</body>", 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-o", "--output", default="dashboard_bench.html")
+    parser.add_argument("--cells", default="4,24,96,192", help="số cell mỗi lượt, cách nhau bởi dấu phẩy")
+    parser.add_argument("--iterations", type=int, default=100, help="số lần cập nhật đo mỗi lượt")
+    args = parser.parse_args()
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write(build_page(args.cells, args.iterations))
+    print("wrote %s (open in a browser, click Run or append ?run to the URL)" % args.output)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,121 @@
+#ifndef FLEET_POOL_H
+#define FLEET_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Thread pool dùng chung cho tools trên PC: fleet simulator (bước pack),
+ * fleet_analyze (mỗi task 1 file log)
+ */
+
+// ============ WORK-STEALING POOL ============
+// Mỗi worker 1 hàng đợi: lấy task từ đầu hàng của mình, hết thì lấy trộm
+// từ đầu hàng của worker khác. run() chia task vòng tròn rồi chờ xong hết;
+// task chạy theo thứ tự chỉ số => caller xếp task nặng trước (LPT)
+class WorkStealingPool {
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<uint32_t> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::function<void(uint32_t)> job;
+    std::mutex stateLock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation;
+    bool stopping;
+    std::atomic<uint32_t> remaining;
+    std::atomic<uint64_t> steals;
+
+    bool pop(int self, uint32_t& task) {
+        Queue& q = *queues[self];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty()) return false;
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(int self, uint32_t& task) {
+        int n = queues.size();
+        for (int k = 1; k < n; k++) {
+            Queue& q = *queues[(self + k) % n];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.tasks.empty()) continue;
+            task = q.tasks.front();
+            q.tasks.pop_front();
+            steals++;
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(int self) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(stateLock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            uint32_t task;
+            while (pop(self, task) || steal(self, task)) {
+                job(task);
+                if (remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> guard(stateLock);
+                    done.notify_all();
+                }
+            }
+        }
+    }
+
+public:
+    WorkStealingPool(int threads) {
+        generation = 0;
+        stopping = false;
+        remaining = 0;
+        steals = 0;
+        for (int i = 0; i < threads; i++) queues.emplace_back(new Queue());
+        for (int i = 0; i < threads; i++) workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    void run(uint32_t taskCount, const std::function<void(uint32_t)>& fn) {
+        if (taskCount == 0) return;
+        job = fn;
+        remaining = taskCount;
+        for (uint32_t t = 0; t < taskCount; t++) {
+            Queue& q = *queues[t % queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            q.tasks.push_back(t);
+        }
+        std::unique_lock<std::mutex> guard(stateLock);
+        generation++;
+        wake.notify_all();
+        done.wait(guard, [&] { return remaining.load() == 0; });
+    }
+
+    int getThreadCount() { return workers.size(); }
+    uint64_t getStealCount() { return steals; }
+};
+
+#endif
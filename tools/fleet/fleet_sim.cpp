@@ -0,0 +1,788 @@
+/*
+ * FLEET SIMULATOR - Hàng nghìn pack ảo trên PC (Linux) để load-test collector / dashboard
+ *   pio run -e fleet && .pio/build/fleet/program [tham số]
+ *
+ * Mỗi pack là 1 pipeline độc lập như firmware: BMSSensors (tham số mô phỏng
+ * ngẫu nhiên theo seed) -> BMSTemperatureBank -> updateBMSBatch() trên BMSPack
+ * riêng (BMSData + SOCEstimator + CellEstimatorBank + BMSEventJournal).
+ * Các pack được bước song song trên work-stealing pool; mỗi pack có đồng hồ ảo
+ * riêng (host/Arduino.h: millis() thread_local, đặt lại trước mỗi lần bước).
+ *
+ *   --packs N            số pack (mặc định 1000)
+ *   --threads N          số worker (mặc định = số core)
+ *   --interval MS        chu kỳ lấy mẫu của mỗi pack (mặc định 100)
+ *   --seed N             seed sinh tham số pack (mặc định 1)
+ *   --serve PORT         HTTP multiplex: /bms/<id> (hoặc /bms?id=<id>), /fleet
+ *   --ports BASE[:N]     N pack đầu (mặc định 16) mỗi pack 1 cổng BASE + id, phục vụ như
+ *                        1 thiết bị: /, /bms, /history, /info (cho tools/bms_loadtest.py)
+ *   --http-threads N     số thread phục vụ HTTP (mặc định 2)
+ *   --fast               không bám đồng hồ thật khi --serve (mô phỏng nhanh nhất có thể)
+ *   --scaling SECONDS    đo samples/s theo số core với SECONDS giây mô phỏng rồi thoát
+ *   --device PORT        1 pack chạy như loop() của firmware trên 1 thread: mỗi vòng nhận tối
+ *                        đa 1 kết nối, lấy mẫu khi tới chu kỳ, ngủ tối đa DEVICE_POLL_MS;
+ *                        thời gian phục vụ giả lập ESP32 (--slowdown N lần CPU của PC,
+ *                        --link-kbps KB/s WiFi), qua admission control (bms_admission.h) trừ khi
+ *                        --no-admission. Jitter lấy mẫu + bộ đếm 429/503 ở /info => đo bằng
+ *                        tools/bms_loadtest.py --flood
+ *   --fault SCRIPT       kịch bản tiêm lỗi (bms_faults.h) cho mọi pack, at= tính từ lúc
+ *                        khởi động, vd --fault "cell 2 value=-1 rate=0.25 at=30000"
+ *   --write-logs DIR     mỗi pack 1 file DIR/pack_NNNNN.bin như log nhị phân của firmware
+ *                        (-DBMS_LOG_BINARY: banner boot + frame STATUS mỗi 5 s) cho --hours giờ
+ *                        mô phỏng (mặc định 24) rồi thoát; đầu vào của tools/analyze.
+ *                        Nên dùng --interval 1000 (100ms: 864k mẫu / pack / ngày)
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Log hiệu chỉnh SOC của hàng nghìn pack không có ích ở đây
+#ifndef BMS_LOG_LEVEL
+#define BMS_LOG_LEVEL LOG_WARN
+#endif
+
+#include "bms_data.h"
+#include "bms_sensors.h"
+#include "bms_history.h"
+#include "bms_jitter.h"
+#include "bms_faults.h"
+#include "bms_html.h"
+#include "bms_admission.h"
+#include "fleet_pool.h"
+
+#define FLEET_TASK_PACKS    16    // Pack mỗi task của pool
+#define FLEET_ROUND_TICKS   10    // Số mẫu mỗi pack bước liền trong 1 task
+#define FLEET_REQUEST_MAX   2048
+#define FLEET_BACKLOG       256
+#define DEVICE_BACKLOG      4       // Như WiFiServer mặc định của ESP32
+#define DEVICE_CONNECTION_US 1000   // accept + đóng kết nối qua lwIP
+#define DEVICE_POLL_MS      10      // = POWER_HTTP_POLL_MS (bms_power.h cần esp_sleep.h)
+#define FLEET_LOG_INTERVAL_MS 5000  // = DEBUG_PRINT_INTERVAL (printBMSStatus)
+
+static uint64_t fleetNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU thread này đã dùng: không tính lúc bị tiến trình khác (load test) chiếm CPU
+static uint64_t fleetThreadCpuNs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ============ VIRTUAL PACK ============
+
+// 1 frame log nhị phân như BMSLogger::writeFrame(): 0xA5 | type | len | payload | crc8
+static void appendLogFrame(std::vector<uint8_t>& out, uint8_t type, const uint8_t* payload, uint8_t length) {
+    uint8_t header[3] = { LOG_FRAME_SYNC, type, length };
+    out.insert(out.end(), header, header + 3);
+    out.insert(out.end(), payload, payload + length);
+    out.push_back(logFrameCrc8(payload, length, logFrameCrc8(header + 1, 2)));
+}
+
+// Tham số ngẫu nhiên quanh cấu hình firmware; vài pack xả > PACK_OC_THRESHOLD
+// để collector / dashboard có alarm thật
+static SimulationProfile fleetProfile(uint32_t& seed) {
+    auto next = [&](float low, float high) {
+        seed = seed * 1664525u + 1013904223u;
+        return low + (high - low) * ((seed >> 8) / 16777216.0f);
+    };
+    SimulationProfile p;
+    p.capacity = next(4.0f, 8.0f);
+    p.chargeCurrent = next(0.5f, 3.0f);
+    p.dischargeCurrent = next(0.5f, 6.0f);
+    p.cycleSeconds = 3 * (unsigned long)next(20.0f, 200.0f);
+    p.ambient = next(15.0f, 35.0f);
+    p.cellSpread = next(0.002f, 0.03f);
+    p.phaseMs = (unsigned long)next(0.0f, p.cycleSeconds * 1000.0f);
+    return p;
+}
+
+class VirtualPack {
+private:
+    BMSData data;
+    SOCEstimator soc;
+    CellEstimatorBank<NUM_CELLS> cells;
+    BMSTemperatureBank temperatures;
+    BMSEventJournal events;
+    CellStatsBank<NUM_CELLS> cellStats;
+    BMSSensors sensors;
+    BMSFaultInjector faults;   // Đi qua nguyên vẹn khi chưa nạp kịch bản (--fault)
+    BMSPack pack;
+    std::unique_ptr<BMSHistory> history;   // Chỉ pack có cổng riêng (57KB mỗi pack)
+    uint64_t nowMs;
+    std::mutex lock;   // Bước mô phỏng và HTTP không chạy cùng lúc trên 1 pack
+
+public:
+    // Đồng hồ ảo phải đặt sẵn ở startMs (SOCEstimator / BMSSensors đọc millis())
+    VirtualPack(const SimulationProfile& profile, float initialSoc, uint64_t startMs)
+        : soc(profile.capacity, initialSoc), cells(profile.capacity), sensors(profile), faults(sensors) {
+        nowMs = startMs;
+        pack = { &data, &soc, &cells, &temperatures, &events, &cellStats };
+        initBMSData(pack);
+        resetSOC(pack, initialSoc);
+    }
+
+    // Lấy ticks mẫu liên tiếp, mỗi mẫu cách intervalMs (như readAndUpdateBMS)
+    void step(int ticks, uint32_t intervalMs) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int i = 0; i < ticks; i++) {
+            nowMs += intervalMs;
+            hostSetMillis(nowMs);
+            if (!faults.readAllSensors()) {
+                recordSensorReadFailure(pack, nowMs);
+                continue;
+            }
+            faults.readThermistors(temperatures);
+            bool tempValid = temperatures.update();
+            BMSSample sample;
+            sample.timestamp = nowMs;
+            for (int c = 0; c < NUM_CELLS; c++) sample.cellVoltages[c] = faults.getCellVoltage(c + 1);
+            sample.current = faults.getCurrent();
+            sample.temperature = tempValid ? temperatures.getHottest() : NAN;
+            sample.minTemperature = tempValid ? temperatures.getColdest() : NAN;
+            updateBMSBatch(pack, &sample, 1);
+            if (history) history->onSample(data, nowMs);
+        }
+    }
+
+    // Nạp kịch bản lỗi (bms_faults.h), at= tính từ thời điểm ảo hiện tại của pack
+    bool injectFaults(const char* script) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!faults.load(script)) return false;
+        faults.arm(nowMs);
+        return true;
+    }
+
+    void enableHistory() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!history) history.reset(new BMSHistory());
+    }
+
+    // Response /history?since= như firmware: header + bản ghi; false nếu không có lịch sử
+    bool writeHistory(uint32_t since, std::vector<char>& out) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!history) return false;
+        uint32_t first;
+        HistorySpan spans[2];
+        uint32_t count = history->select(since, first, spans);
+        out.resize(HISTORY_HEADER_SIZE);
+        history->writeHeader((uint8_t*)out.data(), first, count, nowMs);
+        for (int i = 0; i < 2; i++) out.insert(out.end(), spans[i].data, spans[i].data + spans[i].length);
+        return true;
+    }
+
+    size_t writeJson(JsonDocument& doc, char* out, size_t size) {
+        std::lock_guard<std::mutex> guard(lock);
+        return writeBMSJson(pack, doc, out, size);
+    }
+
+    // Frame STATUS như printBMSStatus() (ms theo đồng hồ ảo của pack)
+    void appendStatusFrame(std::vector<uint8_t>& out) {
+        std::lock_guard<std::mutex> guard(lock);
+        uint8_t payload[BMS_STATUS_FRAME_SIZE];
+        size_t length = writeStatusFrame(data, nowMs, payload, sizeof(payload));
+        appendLogFrame(out, LOG_FRAME_STATUS, payload, length);
+    }
+
+    uint64_t getNowMs() { return nowMs; }
+    bool hasAlarm() {
+        std::lock_guard<std::mutex> guard(lock);
+        return getStatusFlags(data) & (BMS_FLAG_OV | BMS_FLAG_UV | BMS_FLAG_OC | BMS_FLAG_OT |
+                                       BMS_FLAG_SC | BMS_FLAG_UT);
+    }
+};
+
+class Fleet {
+private:
+    std::vector<std::unique_ptr<VirtualPack>> packs;
+    WorkStealingPool pool;
+    uint32_t intervalMs;
+    std::atomic<uint64_t> samples;
+    SampleJitter jitter;    // Trễ của mỗi round so với lịch đồng hồ thật
+    std::mutex jitterLock;
+
+public:
+    Fleet(int count, int threads, uint32_t interval, uint32_t seed) : pool(threads) {
+        intervalMs = interval;
+        samples = 0;
+        hostSetMillis(1000);
+        for (int i = 0; i < count; i++) {
+            SimulationProfile profile = fleetProfile(seed);
+            float initialSoc = 20.0f + (seed >> 8) % 80;
+            packs.emplace_back(new VirtualPack(profile, initialSoc, 1000));
+        }
+    }
+
+    // Mỗi pack lấy ticks mẫu; task = FLEET_TASK_PACKS pack liền nhau
+    void round(int ticks) {
+        {
+            std::lock_guard<std::mutex> guard(jitterLock);
+            jitter.onSample(fleetNowNs() / 1000, intervalMs * ticks);
+        }
+        uint32_t tasks = (packs.size() + FLEET_TASK_PACKS - 1) / FLEET_TASK_PACKS;
+        pool.run(tasks, [&](uint32_t task) {
+            size_t end = min(packs.size(), (size_t)(task + 1) * FLEET_TASK_PACKS);
+            for (size_t i = (size_t)task * FLEET_TASK_PACKS; i < end; i++) packs[i]->step(ticks, intervalMs);
+        });
+        samples += (uint64_t)packs.size() * ticks;
+    }
+
+    bool injectFaults(const char* script) {
+        for (auto& pack : packs) {
+            if (!pack->injectFaults(script)) {
+                fprintf(stderr, "bad fault script: %s\n", script);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // --write-logs: task = 1 pack, bước hết hours giờ rồi ghi 1 file; trả về tổng byte,
+    // 0 nếu có file ghi lỗi
+    uint64_t writeLogs(const char* dir, uint32_t hours) {
+        uint32_t ticksPerFrame = max((uint32_t)1, (uint32_t)(FLEET_LOG_INTERVAL_MS / intervalMs));
+        uint64_t frames = hours * 3600000ULL / (ticksPerFrame * intervalMs);
+        std::atomic<uint64_t> bytes(0);
+        std::atomic<int> failed(0);
+        pool.run(packs.size(), [&](uint32_t id) {
+            // Banner ROM của ESP32 (byte ngoài frame) + 1 frame text như lúc boot
+            static const char banner[] = "ets Jun  8 2016 00:22:57\r\n\r\nrst:0x1 (POWERON_RESET),boot:0x13\r\n";
+            char text[64];
+            text[0] = LOG_INFO;
+            int n = snprintf(text + 1, sizeof(text) - 1, "fleet pack %u boot", id);
+            std::vector<uint8_t> log(banner, banner + sizeof(banner) - 1);
+            log.reserve(log.size() + frames * (BMS_STATUS_FRAME_SIZE + 4) + 64);
+            appendLogFrame(log, LOG_FRAME_TEXT, (const uint8_t*)text, n + 1);
+            for (uint64_t f = 0; f < frames; f++) {
+                packs[id]->step(ticksPerFrame, intervalMs);
+                packs[id]->appendStatusFrame(log);
+            }
+            char path[512];
+            snprintf(path, sizeof(path), "%s/pack_%05u.bin", dir, id);
+            FILE* file = fopen(path, "wb");
+            if (!file || fwrite(log.data(), 1, log.size(), file) != log.size()) failed++;
+            if (file) fclose(file);
+            bytes += log.size();
+        });
+        samples += packs.size() * frames * ticksPerFrame;
+        return failed ? 0 : bytes.load();
+    }
+
+    VirtualPack* get(long id) {
+        return id >= 0 && id < (long)packs.size() ? packs[id].get() : NULL;
+    }
+
+    size_t size() { return packs.size(); }
+    uint32_t getIntervalMs() { return intervalMs; }
+    uint64_t getSampleCount() { return samples; }
+    uint64_t getStealCount() { return pool.getStealCount(); }
+    int getThreadCount() { return pool.getThreadCount(); }
+
+    void printJitter(BufferWriter& out) {
+        std::lock_guard<std::mutex> guard(jitterLock);
+        jitter.printTo(out);
+    }
+};
+
+// ============ SCALING ============
+
+static void runScaling(int packCount, int maxThreads, uint32_t interval, uint32_t seed, int seconds) {
+    int ticks = seconds * 1000 / interval;
+    int rounds = (ticks + FLEET_ROUND_TICKS - 1) / FLEET_ROUND_TICKS;
+    printf("\n=== Fleet scaling: %d packs, %d s simulated (%d samples/pack, every %lu ms) ===\n",
+           packCount, seconds, rounds * FLEET_ROUND_TICKS, (unsigned long)interval);
+    printf("%8s %14s %10s %12s %10s %10s\n", "threads", "samples/s", "speedup", "efficiency",
+           "realtime", "steals");
+
+    std::vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    double single = 0;
+    for (int threads : counts) {
+        Fleet fleet(packCount, threads, interval, seed);
+        uint64_t start = fleetNowNs();
+        for (int r = 0; r < rounds; r++) fleet.round(FLEET_ROUND_TICKS);
+        double elapsed = (fleetNowNs() - start) / 1e9;
+        double rate = fleet.getSampleCount() / elapsed;
+        if (threads == 1) single = rate;
+        // realtime: số lần nhanh hơn đồng hồ thật (cả fleet)
+        printf("%8d %14.0f %9.2fx %11.0f%% %9.0fx %10llu\n", threads, rate, rate / single,
+               100.0 * rate / single / threads, seconds / elapsed,
+               (unsigned long long)fleet.getStealCount());
+    }
+    printf("packs sustainable in real time at %lu ms: ~%.0f per core\n", (unsigned long)interval,
+           single * interval / 1000.0);
+}
+
+// ============ HTTP ============
+
+struct Listener {
+    int fd;
+    long packId;   // -1: cổng multiplex
+};
+
+static int openListener(int port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+static void sendAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        data += n;
+        length -= n;
+    }
+}
+
+static const char* statusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 429: return "Too Many Requests";
+        case 503: return "Service Unavailable";
+        default:  return "Not Found";
+    }
+}
+
+// Trả về số byte đã gửi (header + body)
+static size_t sendResponse(int fd, int code, const char* type, const char* body, size_t length) {
+    char header[256];
+    char retry[32] = "";
+    if (code == 429 || code == 503) snprintf(retry, sizeof(retry), "Retry-After: %d\r\n", ADMISSION_RETRY_AFTER_S);
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n%s"
+                     "Access-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                     code, statusText(code), type, (unsigned long)length, retry);
+    sendAll(fd, header, n);
+    sendAll(fd, body, length);
+    return n + length;
+}
+
+class FleetServer {
+private:
+    Fleet* fleet;
+    std::vector<Listener> listeners;
+    std::vector<std::thread> threads;
+    std::atomic<uint64_t> requests;
+    uint64_t startNs;
+    std::string page;
+
+    // --device: jitter của loop, admission (NULL = tắt), giả lập thời gian phục vụ ESP32
+    SampleJitter* deviceJitter;
+    BMSAdmission* deviceAdmission;
+    uint8_t deviceRoutes[5];   // /, /bms, /history, /info, còn lại
+    uint32_t slowdown;
+    uint32_t linkKBps;
+
+    uint8_t deviceRoute(const char* path) {
+        if (strcmp(path, "/") == 0) return deviceRoutes[0];
+        if (strcmp(path, "/bms") == 0) return deviceRoutes[1];
+        if (strcmp(path, "/history") == 0) return deviceRoutes[2];
+        if (strcmp(path, "/info") == 0) return deviceRoutes[3];
+        return deviceRoutes[4];
+    }
+
+    // Giữ thread (= loop() của thiết bị) bận đúng thời gian ESP32 cần: chờ client
+    // gửi request như thật, CPU xử lý (đo bằng CPU time của thread) chậm hơn
+    // slowdown lần, gửi qua WiFi linkKBps, cộng chi phí kết nối. Trả về thời gian
+    // tính vào ngân sách admission (từ lúc đọc xong request, như micros() của handler)
+    uint32_t emulateDevice(uint64_t startNs, uint64_t workNs, uint64_t workCpuNs, size_t bytes) {
+        uint64_t elapsedUs = (fleetNowNs() - startNs) / 1000;
+        uint64_t waitUs = (workNs - startNs) / 1000;
+        uint64_t cpuUs = (fleetThreadCpuNs() - workCpuNs) / 1000;
+        uint64_t deviceUs = waitUs + cpuUs * slowdown +
+                            (uint64_t)bytes * 1000000 / ((uint64_t)linkKBps * 1024) + DEVICE_CONNECTION_US;
+        if (deviceUs > elapsedUs) std::this_thread::sleep_for(std::chrono::microseconds(deviceUs - elapsedUs));
+        return deviceUs - waitUs;
+    }
+
+    // Cùng định dạng với /info của firmware ở các dòng tool cần đọc
+    size_t writeInfo(long packId, char* buffer) {
+        BufferWriter info(buffer, BMS_JSON_BUFFER_SIZE);
+        info.printf("ESP32 BMS System (fleet simulator)\n");
+        info.printf("Uptime: %lus\n", (unsigned long)((fleetNowNs() - startNs) / 1000000000ULL));
+        if (packId >= 0) info.printf("Pack: %ld of %lu\n", packId, (unsigned long)fleet->size());
+        if (deviceJitter) {
+            info.printf("Device loop: %lu ms interval, ESP32 emulation x%lu CPU, %lu KB/s link\n",
+                        (unsigned long)fleet->getIntervalMs(), (unsigned long)slowdown,
+                        (unsigned long)linkKBps);
+            deviceJitter->printTo(info);
+            if (deviceAdmission) deviceAdmission->printTo(info);
+            return info.length();
+        }
+        info.printf("Fleet: %lu packs, %d threads, %lu samples, %lu ms interval\n",
+                    (unsigned long)fleet->size(), fleet->getThreadCount(),
+                    (unsigned long)fleet->getSampleCount(), (unsigned long)fleet->getIntervalMs());
+        fleet->printJitter(info);
+        return info.length();
+    }
+
+    void handle(int fd, uint32_t ip, long packId, JsonDocument& doc, char* buffer, std::vector<char>& history) {
+        uint64_t startNs = fleetNowNs();
+        char request[FLEET_REQUEST_MAX];
+        size_t length = 0;
+        while (length < sizeof(request) - 1) {
+            ssize_t n = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+            if (n <= 0) break;
+            length += n;
+            request[length] = '\0';
+            if (strstr(request, "\r\n\r\n")) break;
+        }
+        request[length] = '\0';
+        uint64_t workNs = fleetNowNs();
+        uint64_t workCpuNs = fleetThreadCpuNs();
+        if (strncmp(request, "GET ", 4) != 0) return;
+        char* path = request + 4;
+        char* space = strchr(path, ' ');
+        if (space) *space = '\0';
+        requests++;
+
+        char* query = strchr(path, '?');
+        if (query) *query++ = '\0';
+        uint32_t since = query && strncmp(query, "since=", 6) == 0 ? strtoul(query + 6, NULL, 10) : 0;
+
+        uint8_t route = deviceJitter ? deviceRoute(path) : 0;
+        if (deviceAdmission) {
+            uint8_t verdict = deviceAdmission->admit(route, ip, workNs / 1000);
+            if (verdict != ADMIT_OK) {
+                const char* text = BMSAdmission::verdictName(verdict);
+                size_t sent = sendResponse(fd, BMSAdmission::statusCode(verdict), "text/plain", text, strlen(text));
+                deviceAdmission->finish(route, verdict, emulateDevice(startNs, workNs, workCpuNs, sent));
+                return;
+            }
+        }
+        size_t sent = 0;
+
+        // Cổng riêng: như 1 thiết bị. Cổng multiplex: /bms/<id> hoặc /bms?id=<id>
+        if (packId < 0 && strncmp(path, "/bms/", 5) == 0) {
+            packId = strtol(path + 5, NULL, 10);
+            path[4] = '\0';
+        } else if (packId < 0 && strcmp(path, "/bms") == 0 && query && strncmp(query, "id=", 3) == 0) {
+            packId = strtol(query + 3, NULL, 10);
+        }
+
+        VirtualPack* pack = fleet->get(packId);
+        if (strcmp(path, "/bms") == 0 && pack) {
+            size_t n = pack->writeJson(doc, buffer, BMS_JSON_BUFFER_SIZE);
+            sent = sendResponse(fd, 200, "application/json", buffer, n);
+        } else if (strcmp(path, "/history") == 0 && pack && pack->writeHistory(since, history)) {
+            sent = sendResponse(fd, 200, "application/octet-stream", history.data(), history.size());
+        } else if (strcmp(path, "/") == 0) {
+            sent = sendResponse(fd, 200, "text/html", page.data(), page.size());
+        } else if (strcmp(path, "/info") == 0) {
+            size_t n = writeInfo(packId, buffer);
+            sent = sendResponse(fd, 200, "text/plain", buffer, n);
+        } else if (strcmp(path, "/fleet") == 0) {
+            int alarms = 0;
+            for (size_t i = 0; i < fleet->size(); i++) alarms += fleet->get(i)->hasAlarm();
+            double elapsed = (fleetNowNs() - startNs) / 1e9;
+            int n = snprintf(buffer, BMS_JSON_BUFFER_SIZE,
+                             "{\"packs\":%lu,\"threads\":%d,\"intervalMs\":%lu,\"simulatedMs\":%llu,"
+                             "\"samples\":%llu,\"samplesPerSecond\":%.0f,\"steals\":%llu,"
+                             "\"packsInAlarm\":%d,\"requests\":%llu}",
+                             (unsigned long)fleet->size(), fleet->getThreadCount(),
+                             (unsigned long)fleet->getIntervalMs(),
+                             (unsigned long long)fleet->get(0)->getNowMs(),
+                             (unsigned long long)fleet->getSampleCount(),
+                             fleet->getSampleCount() / elapsed,
+                             (unsigned long long)fleet->getStealCount(), alarms,
+                             (unsigned long long)requests.load());
+            sent = sendResponse(fd, 200, "application/json", buffer, n);
+        } else {
+            const char* text = "GET /, /bms/<id>, /bms?id=<id>, /info, /fleet\n";
+            sent = sendResponse(fd, 404, "text/plain", text, strlen(text));
+        }
+        if (deviceJitter) {
+            uint32_t deviceUs = emulateDevice(startNs, workNs, workCpuNs, sent);
+            if (deviceAdmission) deviceAdmission->finish(route, ADMIT_OK, deviceUs);
+        }
+    }
+
+    bool acceptOne(const Listener& listener, JsonDocument& doc, char* buffer, std::vector<char>& history) {
+        sockaddr_in peer;
+        socklen_t peerLength = sizeof(peer);
+        int client = accept(listener.fd, (sockaddr*)&peer, &peerLength);
+        if (client < 0) return false;
+        timeval timeout = { 2, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        handle(client, ntohl(peer.sin_addr.s_addr), listener.packId, doc, buffer, history);
+        close(client);
+        return true;
+    }
+
+    // Mọi thread cùng poll tất cả cổng; accept() không chặn nên thread chậm chân chỉ nhận EAGAIN
+    void serveLoop() {
+        std::unique_ptr<DynamicJsonDocument> doc(new DynamicJsonDocument(BMS_JSON_DOC_SIZE));
+        std::vector<char> buffer(BMS_JSON_BUFFER_SIZE);
+        std::vector<char> history;
+        std::vector<pollfd> fds(listeners.size());
+        for (size_t i = 0; i < listeners.size(); i++) {
+            fds[i].fd = listeners[i].fd;
+            fds[i].events = POLLIN;
+        }
+        while (true) {
+            if (poll(fds.data(), fds.size(), 1000) <= 0) continue;
+            for (size_t i = 0; i < fds.size(); i++) {
+                if (!(fds[i].revents & POLLIN)) continue;
+                acceptOne(listeners[i], *doc, buffer.data(), history);
+            }
+        }
+    }
+
+public:
+    FleetServer(Fleet& source) {
+        fleet = &source;
+        requests = 0;
+        startNs = fleetNowNs();
+        page = getHTMLPage().c_str();
+        deviceJitter = NULL;
+        deviceAdmission = NULL;
+        slowdown = 1;
+        linkKBps = 0;
+    }
+
+    bool listenOn(int port, long packId, int backlog = FLEET_BACKLOG) {
+        int fd = openListener(port, backlog);
+        if (fd < 0) {
+            fprintf(stderr, "cannot listen on port %d: %s\n", port, strerror(errno));
+            return false;
+        }
+        listeners.push_back({ fd, packId });
+        return true;
+    }
+
+    void start(int threadCount) {
+        for (int i = 0; i < threadCount; i++) threads.emplace_back(&FleetServer::serveLoop, this);
+    }
+
+    // --device: phục vụ trên thread gọi (serveOne), giả lập thời gian ESP32
+    void attachDevice(SampleJitter* jitter, BMSAdmission* control, uint32_t cpuSlowdown, uint32_t kbps) {
+        deviceJitter = jitter;
+        deviceAdmission = control;
+        slowdown = cpuSlowdown;
+        linkKBps = kbps;
+        memset(deviceRoutes, 0, sizeof(deviceRoutes));
+        if (!control) return;
+        // Cùng giá token / ước lượng ban đầu như setupWebServer() của firmware
+        deviceRoutes[0] = control->addRoute("/", 4, 60000);
+        deviceRoutes[1] = control->addRoute("/bms", 1, 3000);
+        deviceRoutes[2] = control->addRoute("/history", 2, 20000);
+        deviceRoutes[3] = control->addRoute("/info", 1, 5000);
+        deviceRoutes[4] = control->addRoute("404", 1, 1000);
+    }
+
+    // Như 1 lần server.handleClient(): nhận tối đa 1 kết nối đang chờ, không chặn
+    bool serveOne(JsonDocument& doc, char* buffer, std::vector<char>& history) {
+        for (const Listener& listener : listeners) {
+            if (acceptOne(listener, doc, buffer, history)) return true;
+        }
+        return false;
+    }
+};
+
+// ============ DEVICE LOOP ============
+
+// 1 pack, 1 thread, cùng thứ tự với loop() của firmware: handleClient (nếu admission
+// còn ngân sách) -> sampleIfDue -> ngủ tới mẫu kế tiếp, tối đa DEVICE_POLL_MS
+static void runDevice(Fleet& fleet, FleetServer& server, bool useAdmission, uint32_t slowdown, uint32_t linkKBps) {
+    VirtualPack* pack = fleet.get(0);
+    uint32_t intervalMs = fleet.getIntervalMs();
+    SampleJitter jitter;
+    server.attachDevice(&jitter, useAdmission ? &admission : NULL, slowdown, linkKBps);
+
+    std::unique_ptr<DynamicJsonDocument> doc(new DynamicJsonDocument(BMS_JSON_DOC_SIZE));
+    std::vector<char> buffer(BMS_JSON_BUFFER_SIZE);
+    std::vector<char> history;
+    uint64_t lastSampleUs = fleetNowNs() / 1000;
+    admission.onTick(lastSampleUs, intervalMs * 1000);
+    while (true) {
+        if (!useAdmission || admission.accepting(fleetNowNs() / 1000)) {
+            server.serveOne(*doc, buffer.data(), history);
+        }
+
+        uint64_t nowUs = fleetNowNs() / 1000;
+        if (nowUs - lastSampleUs >= intervalMs * 1000ULL) {
+            jitter.onSample(nowUs, intervalMs);
+            lastSampleUs = nowUs;
+            pack->step(1, intervalMs);
+            admission.onTick(nowUs, intervalMs * 1000);
+        }
+
+        uint64_t sinceSample = fleetNowNs() / 1000 - lastSampleUs;
+        uint64_t remaining = sinceSample < intervalMs * 1000ULL ? intervalMs * 1000ULL - sinceSample : 0;
+        std::this_thread::sleep_for(std::chrono::microseconds(min(remaining, (uint64_t)DEVICE_POLL_MS * 1000)));
+    }
+}
+
+// ============ MAIN ============
+
+int main(int argc, char** argv) {
+    int packCount = 1000;
+    int threads = std::thread::hardware_concurrency();
+    uint32_t interval = 100;
+    uint32_t seed = 1;
+    int servePort = 0;
+    int portBase = 0;
+    int portCount = 16;
+    int httpThreads = 2;
+    bool fast = false;
+    int scalingSeconds = 0;
+    int devicePort = 0;
+    bool useAdmission = true;
+    uint32_t slowdown = 20;
+    uint32_t linkKBps = 500;
+    const char* faultScript = NULL;
+    const char* logDir = NULL;
+    uint32_t logHours = 24;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--fast") == 0) {
+            fast = true;
+            continue;
+        }
+        if (strcmp(arg, "--no-admission") == 0) {
+            useAdmission = false;
+            continue;
+        }
+        if (!value) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "--packs") == 0) packCount = atoi(value);
+        else if (strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (strcmp(arg, "--interval") == 0) interval = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) seed = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--serve") == 0) servePort = atoi(value);
+        else if (strcmp(arg, "--http-threads") == 0) httpThreads = atoi(value);
+        else if (strcmp(arg, "--scaling") == 0) scalingSeconds = atoi(value);
+        else if (strcmp(arg, "--device") == 0) devicePort = atoi(value);
+        else if (strcmp(arg, "--fault") == 0) faultScript = value;
+        else if (strcmp(arg, "--write-logs") == 0) logDir = value;
+        else if (strcmp(arg, "--hours") == 0) logHours = max(1, atoi(value));
+        else if (strcmp(arg, "--slowdown") == 0) slowdown = max(1, atoi(value));
+        else if (strcmp(arg, "--link-kbps") == 0) linkKBps = max(1, atoi(value));
+        else if (strcmp(arg, "--ports") == 0) {
+            portBase = atoi(value);
+            const char* colon = strchr(value, ':');
+            if (colon) portCount = atoi(colon + 1);
+        } else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (packCount < 1 || interval < 1) {
+        fprintf(stderr, "--packs and --interval must be positive\n");
+        return 1;
+    }
+
+    if (scalingSeconds > 0) {
+        runScaling(packCount, threads, interval, seed, scalingSeconds);
+        return 0;
+    }
+
+    if (logDir) {
+        if (mkdir(logDir, 0755) < 0 && errno != EEXIST) {
+            fprintf(stderr, "cannot create %s: %s\n", logDir, strerror(errno));
+            return 1;
+        }
+        Fleet fleet(packCount, threads, interval, seed);
+        if (faultScript && !fleet.injectFaults(faultScript)) return 1;
+        uint64_t start = fleetNowNs();
+        uint64_t bytes = fleet.writeLogs(logDir, logHours);
+        if (bytes == 0) {
+            fprintf(stderr, "writing logs to %s failed\n", logDir);
+            return 1;
+        }
+        printf("%d logs, %lu h each (%.1f MB) in %s: %.1f s on %d threads\n", packCount,
+               (unsigned long)logHours, bytes / 1e6, logDir, (fleetNowNs() - start) / 1e9, threads);
+        return 0;
+    }
+
+    if (devicePort) {
+        Fleet fleet(1, 1, interval, seed);
+        if (faultScript && !fleet.injectFaults(faultScript)) return 1;
+        FleetServer server(fleet);
+        if (!server.listenOn(devicePort, 0, DEVICE_BACKLOG)) return 1;
+        fleet.get(0)->enableHistory();
+        printf("device loop on http://localhost:%d (%lu ms interval, admission %s, ESP32 x%lu CPU, %lu KB/s)\n",
+               devicePort, (unsigned long)interval, useAdmission ? "on" : "off", (unsigned long)slowdown,
+               (unsigned long)linkKBps);
+        fflush(stdout);
+        runDevice(fleet, server, useAdmission, slowdown, linkKBps);
+        return 0;
+    }
+
+    Fleet fleet(packCount, threads, interval, seed);
+    if (faultScript && !fleet.injectFaults(faultScript)) return 1;
+    FleetServer server(fleet);
+    if (servePort && !server.listenOn(servePort, -1)) return 1;
+    for (int id = 0; portBase && id < portCount && id < packCount; id++) {
+        if (!server.listenOn(portBase + id, id)) return 1;
+        fleet.get(id)->enableHistory();
+    }
+    server.start(httpThreads);
+    printf("%d packs on %d threads, sample every %lu ms%s\n", packCount, threads,
+           (unsigned long)interval, fast ? " (fast)" : "");
+    if (servePort) printf("multiplexed: http://localhost:%d/bms/<id>, /fleet\n", servePort);
+    if (portBase) printf("per-pack: http://localhost:%d..%d/bms\n", portBase,
+                         portBase + min(portCount, packCount) - 1);
+
+    // Bám đồng hồ thật: mỗi round = FLEET_ROUND_TICKS mẫu / pack
+    uint64_t roundNs = (uint64_t)interval * FLEET_ROUND_TICKS * 1000000ULL;
+    uint64_t deadline = fleetNowNs();
+    uint64_t lastReport = deadline;
+    uint64_t lastSamples = 0;
+    while (true) {
+        fleet.round(FLEET_ROUND_TICKS);
+        uint64_t now = fleetNowNs();
+        if (!fast) {
+            deadline += roundNs;
+            if (deadline > now) std::this_thread::sleep_for(std::chrono::nanoseconds(deadline - now));
+            else deadline = now;   // Không theo kịp: chạy hết tốc lực, không dồn nợ
+        }
+        if (now - lastReport >= 5000000000ULL) {
+            uint64_t total = fleet.getSampleCount();
+            printf("%.0f samples/s, simulated %.1f s, %llu steals\n",
+                   (total - lastSamples) / ((now - lastReport) / 1e9),
+                   fleet.get(0)->getNowMs() / 1000.0, (unsigned long long)fleet.getStealCount());
+            fflush(stdout);
+            lastReport = now;
+            lastSamples = total;
+        }
+    }
+}